@@ -0,0 +1,379 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef NS3_OPTIMISTIC_SIMULATOR_IMPL_H
+#define NS3_OPTIMISTIC_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/event-id.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/nstime.h"
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <deque>
+#include <vector>
+#include <utility>
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \ingroup mpi
+ *
+ * \brief Distributed simulator implementation using optimistic (Time Warp)
+ * synchronization
+ *
+ * Each rank executes its events without waiting for the other ranks and
+ * rolls back when a packet arrives in its past (a straggler) or when a
+ * packet it has already executed is cancelled. There is no lookahead, so
+ * links between ranks may have an arbitrarily small delay.
+ *
+ * The state of the nodes is saved by forking: Run keeps the MPI rank
+ * process as a communication process and forks a worker process that
+ * executes the events. Every SnapshotInterval events the worker forks a
+ * snapshot, a stopped copy of its whole memory which costs only the pages
+ * written afterwards. On a rollback the rank process kills the worker and
+ * the snapshots newer than the straggler, resumes the latest older
+ * snapshot as the new worker and replays the packets received since. So any
+ * model can be rolled back without being instrumented. The packets sent
+ * since are cancelled lazily: an anti-message is only sent for those the
+ * new worker does not send again unchanged. The packets received are
+ * executed before the local events at the same time, in the order they
+ * were received, so a replay executes the events in the same order.
+ *
+ * The global virtual time (GVT) is computed every GvtInterval of wall
+ * clock time with two non-blocking reductions: the counts of sent and
+ * received messages first, until no message is in transit, then the
+ * minimum of the local virtual times. No rank can roll back before the
+ * GVT, so older snapshots and logged messages are released (fossil
+ * collection). The simulation ends when the GVT passes the stop time of
+ * every rank; the worker then returns from Run with the final state and
+ * the rank process finalizes MPI and exits with the status of the worker.
+ *
+ * Limitations: it requires fork, so it is only available on POSIX systems;
+ * Run may be called once; output written by the models while executing
+ * optimistically may be repeated after a rollback; the execution of the
+ * events must only depend on the simulation state, as events older than
+ * the GVT may be executed again after a rollback and must send the same
+ * packets; a rank may schedule at most 2^31 events.
+ */
+class OptimisticSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  OptimisticSimulatorImpl ();
+  ~OptimisticSimulatorImpl ();
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &delay);
+  virtual EventId Schedule (Time const &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \return the instance of the simulator
+   */
+  static OptimisticSimulatorImpl * GetInstance (void);
+
+  /**
+   * \return true in the worker process, once Run has been called
+   */
+  static bool IsWorker (void);
+
+  /**
+   * Hand a packet for a node of another rank over to the rank process
+   *
+   * \param p the packet
+   * \param rxTime the reception time
+   * \param node the destination node
+   * \param dev the destination device
+   */
+  void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+
+  /**
+   * \return the number of events executed by the current worker and the
+   *         snapshots it was resumed from, which is the number of events
+   *         committed once Run returns
+   */
+  uint64_t GetEventCount (void) const;
+  /**
+   * \return the number of rollbacks of this rank, valid once Run returns
+   */
+  uint64_t GetRollbackCount (void) const;
+  /**
+   * \return the number of events undone by rollbacks on this rank, valid
+   *         once Run returns
+   */
+  uint64_t GetRolledBackEventCount (void) const;
+  /**
+   * \return the number of anti-messages sent by this rank, valid once Run
+   *         returns
+   */
+  uint64_t GetAntiMessageCount (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /// Types of the frames exchanged by the rank process and the worker
+  enum FrameType
+  {
+    PACKET_FRAME,    //!< a packet, in either direction
+    SNAPSHOT_FRAME,  //!< a snapshot was taken
+    STATUS_FRAME,    //!< the local virtual time of the worker
+    ROLLBACK_FRAME,  //!< the worker must be rolled back
+    CANCEL_FRAME,    //!< a received packet is cancelled
+    GVT_FRAME,       //!< a new global virtual time
+    REPLAY_FRAME,    //!< the frames replayed after a rollback are all sent
+    END_FRAME        //!< the simulation is over
+  };
+
+  /// A snapshot, as seen by the rank process
+  struct Snapshot
+  {
+    int32_t pid;        //!< process of the snapshot
+    uint64_t limit;     //!< earliest straggler timestamp it can be resumed for
+    uint64_t seq;       //!< last received packet executed by the snapshot
+    uint64_t position;  //!< number of packets sent before the snapshot
+    uint64_t events;    //!< events executed before the snapshot
+    uint64_t stopTs;    //!< stop time of the snapshot
+  };
+
+  /// A packet received from another rank
+  struct Input
+  {
+    uint32_t source;            //!< the source rank
+    uint64_t id;                //!< the id of the packet at the source
+    uint64_t ts;                //!< the reception time
+    bool cancelled;             //!< whether an anti-message was received
+    std::vector<uint8_t> data;  //!< the node, device and packet
+  };
+
+  /// A packet sent to another rank
+  struct Output
+  {
+    uint64_t position;          //!< position in the packets sent by the worker
+    uint64_t id;                //!< the id of the packet
+    uint32_t dest;              //!< the destination rank
+    uint64_t ts;                //!< the reception time
+    uint64_t sendTs;            //!< the time it was sent at
+    uint64_t hash;              //!< hash of the content of the packet
+    bool sent;                  //!< false while held during a GVT computation
+    std::vector<uint8_t> data;  //!< the message, while held
+  };
+
+  /// An anti-message held during a GVT computation
+  struct AntiMessage
+  {
+    uint32_t dest;  //!< the destination rank
+    uint64_t id;    //!< the id of the cancelled packet
+    uint64_t ts;    //!< the reception time of the cancelled packet
+  };
+
+  /// Phases of the GVT computation
+  enum GvtPhase
+  {
+    GVT_IDLE,   //!< no computation in progress
+    GVT_COUNT,  //!< reducing the messages in transit
+    GVT_MIN     //!< reducing the local virtual times
+  };
+
+  /**
+   * Execute events as the worker until the end of the simulation
+   */
+  void RunWorker (void);
+  /** Execute the next event */
+  void ProcessOneEvent (void);
+  /** \return the timestamp of the next event before the stop time */
+  uint64_t NextTs (void) const;
+  /** \return true if the next event may be executed */
+  bool IsReady (void) const;
+  /** Fork a snapshot of the worker, which resumes here when restored */
+  void TakeSnapshot (void);
+  /** Report the local virtual time to the rank process */
+  void SendStatus (void);
+  /**
+   * Read and handle the frames from the rank process
+   * \param block whether to wait for a frame
+   */
+  void ReadFrames (bool block);
+  /**
+   * Handle a frame from the rank process
+   * \param type the type of the frame
+   * \param data the payload
+   * \param size the size of the payload
+   */
+  void HandleFrame (uint32_t type, const uint8_t *data, uint32_t size);
+  /**
+   * Ask the rank process for a rollback and wait to be killed
+   * \param ts the timestamp to roll back to
+   */
+  void RequestRollback (uint64_t ts);
+  /**
+   * Write a frame to the rank process
+   * \param type the type of the frame
+   * \param data the payload
+   */
+  void WriteFrame (uint32_t type, const std::vector<uint8_t> &data);
+
+  /**
+   * Serve the worker and the other ranks until the end of the simulation
+   */
+  void RunRank (void);
+  /** Wait for the worker to exit and exit with its status */
+  void Finish (void);
+  /** Handle the messages from the other ranks */
+  void ReceiveMessages (void);
+  /** Read and handle the frames from the worker */
+  void ReadWorkerFrames (void);
+  /**
+   * Handle a frame from the worker
+   * \param type the type of the frame
+   * \param data the payload
+   * \param size the size of the payload
+   */
+  void HandleWorkerFrame (uint32_t type, const uint8_t *data, uint32_t size);
+  /** Write the queued frames to the worker, without blocking */
+  void WriteWorkerFrames (void);
+  /**
+   * Queue a frame for the worker
+   * \param type the type of the frame
+   * \param data the payload
+   * \param ts the timestamp the frame may roll the worker back to
+   */
+  void QueueFrame (uint32_t type, const std::vector<uint8_t> &data, uint64_t ts);
+  /**
+   * Queue a received packet for the worker
+   * \param seq the sequence number of the packet
+   * \param input the packet
+   */
+  void QueueInput (uint64_t seq, const Input &input);
+  /**
+   * Send a packet to its rank, or hold it during a GVT computation
+   * \param output the packet
+   */
+  void SendOutput (Output &output);
+  /**
+   * Send an anti-message, or hold it during a GVT computation
+   * \param anti the anti-message
+   */
+  void SendAntiMessage (const AntiMessage &anti);
+  /**
+   * Roll the worker back
+   * \param ts the timestamp of the straggler
+   * \param events the number of events executed by the worker
+   */
+  void Rollback (uint64_t ts, uint64_t events);
+  /** Advance the GVT computation */
+  void UpdateGvt (void);
+  /** \return the local contribution to the GVT */
+  uint64_t GetLocalMinimum (void) const;
+  /** Release what can no longer be rolled back */
+  void CollectFossils (void);
+  /** Reap the killed processes */
+  void ReapChildren (void);
+
+  typedef std::list<EventId> DestroyEvents;
+
+  DestroyEvents m_destroyEvents;
+  Ptr<Scheduler> m_events;
+  uint32_t m_uid;
+  uint32_t m_inputUid; //!< uid of the next packet received
+  uint32_t m_currentUid;
+  uint64_t m_currentTs;
+  uint32_t m_currentContext;
+  // number of events that have been inserted but not yet scheduled,
+  // not counting the "destroy" events; this is used for validation
+  int m_unscheduledEvents;
+  uint64_t m_stopTs;   //!< timestamp of the stop
+  uint32_t m_stopUid;  //!< events at m_stopTs from this uid on are not executed
+  uint32_t m_myId;     //!< MPI rank
+
+  uint32_t m_snapshotInterval;  //!< events between snapshots
+  Time m_gvtInterval;           //!< wall clock time between GVT computations
+  Time m_optimismWindow;        //!< how far the worker may run ahead of the GVT
+
+  int m_toRank[2];    //!< pipe from the worker to the rank process
+  int m_toWorker[2];  //!< pipe from the rank process to the worker
+  bool m_running;     //!< whether Run was called
+  bool m_end;         //!< whether the simulation is over
+  uint64_t m_gvt;     //!< the last global virtual time
+
+  // worker state
+  std::vector<uint8_t> m_inputBuffer;  //!< bytes read from the rank process
+  uint64_t m_frames;                   //!< frames read since resumed
+  bool m_replaying;                    //!< whether frames are replayed
+  uint64_t m_lastSeq;                  //!< last received packet scheduled
+  uint64_t m_eventCount;               //!< events executed
+  uint64_t m_lastStatus;               //!< local virtual time last reported
+  uint64_t m_lastStatusFrames;         //!< frames read when last reported
+  /// events of the received packets, to cancel them
+  std::map<uint64_t, EventId> m_received;
+  uint64_t m_rollbacks;                //!< rollbacks, set at the end
+  uint64_t m_rolledBackEvents;         //!< events rolled back, set at the end
+  uint64_t m_antiMessages;             //!< anti-messages, set at the end
+
+  // rank process state
+  int32_t m_worker;                    //!< process of the worker
+  std::vector<uint8_t> m_workerBuffer; //!< bytes read from the worker
+  std::vector<uint8_t> m_frameBuffer;  //!< frames not yet written to the worker
+  uint64_t m_framesQueued;             //!< frames queued since the last resume
+  /// frames which may roll the worker back, with their timestamps
+  std::deque<std::pair<uint64_t, uint64_t> > m_pendingFrames;
+  uint64_t m_workerLvt;                //!< local virtual time of the worker
+  uint64_t m_workerStopTs;             //!< stop time of the worker
+  std::deque<Snapshot> m_snapshots;    //!< the snapshots, oldest first
+  std::map<uint64_t, Input> m_inputs;  //!< received packets by sequence number
+  /// sequence numbers of the received packets by source and id
+  std::map<std::pair<uint32_t, uint64_t>, uint64_t> m_inputIds;
+  uint64_t m_seq;                      //!< last sequence number
+  std::deque<Output> m_outputs;        //!< sent packets, by position
+  std::deque<Output> m_lazy;           //!< rolled back packets not yet sent again
+  std::vector<AntiMessage> m_heldAntiMessages; //!< held anti-messages
+  uint64_t m_position;                 //!< packets sent by the worker
+  uint64_t m_nextId;                   //!< id of the next packet sent
+  int64_t m_sentCount;                 //!< messages sent to other ranks
+  int64_t m_receivedCount;             //!< messages received from other ranks
+  GvtPhase m_gvtPhase;                 //!< phase of the GVT computation
+  int64_t m_lastGvtMs;                 //!< wall clock of the last GVT computation
+
+  static OptimisticSimulatorImpl* g_instance; //!< the instance
+  static bool g_worker;                       //!< whether this is the worker
+};
+
+} // namespace ns3
+
+#endif /* NS3_OPTIMISTIC_SIMULATOR_IMPL_H */
@@ -0,0 +1,159 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PCAPNG_FILE_H
+#define PCAPNG_FILE_H
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#ifdef NS3_MTP
+#include <mutex>
+#endif
+
+namespace ns3 {
+
+class Packet;
+class Header;
+class AsyncFileWriter;
+
+/**
+ * \brief A pcapng file, with several interfaces
+ *
+ * A pcapng file holds the packets captured on several interfaces, each
+ * with its own data link type and snap length, in a single section. The
+ * blocks are written in the byte order of the host, which the readers
+ * detect from the section header.
+ *
+ * The files are only written. #Get shares a file between all the
+ * PcapFileWrapper writing to the same filename, see the PcapNgFile
+ * attribute of PcapFileWrapper.
+ */
+class PcapNgFile : public SimpleRefCount<PcapNgFile>
+{
+public:
+  PcapNgFile ();
+  ~PcapNgFile ();
+
+  /**
+   * \brief Get the file with a name, opening it if needed
+   *
+   * \param filename the name of the file
+   * \param async whether to write a new file through an AsyncFileWriter
+   * \return the file, which is closed with the last reference to it
+   */
+  static Ptr<PcapNgFile> Get (std::string const &filename, bool async);
+
+  /**
+   * Create a file and write its section header.
+   *
+   * \param filename the name of the file
+   * \param async whether to write the file through an AsyncFileWriter
+   */
+  void Open (std::string const &filename, bool async);
+  /**
+   * Close the file.
+   */
+  void Close (void);
+  /**
+   * \return true if the file could not be opened or written, false otherwise.
+   */
+  bool Fail (void) const;
+
+  /**
+   * \brief Add an interface to the file
+   *
+   * \param dataLinkType the data link type of the packets, see PcapFile::Init
+   * \param snapLen the maximum length of the packets written
+   * \param name the name of the interface
+   * \param nanosecMode whether the timestamps are in nanoseconds, or
+   *        in microseconds
+   * \return the identifier of the interface in the file
+   */
+  uint32_t AddInterface (uint32_t dataLinkType, uint32_t snapLen,
+                         std::string const &name, bool nanosecMode);
+
+  /**
+   * \brief Write a packet to the file
+   *
+   * \param interface the identifier of the interface
+   * \param ts the timestamp, in the resolution of the interface
+   * \param data the data of the packet
+   * \param totalLen the length of the packet
+   */
+  void Write (uint32_t interface, uint64_t ts, uint8_t const *data, uint32_t totalLen);
+  /**
+   * \brief Write a packet to the file
+   *
+   * \param interface the identifier of the interface
+   * \param ts the timestamp, in the resolution of the interface
+   * \param p the packet
+   */
+  void Write (uint32_t interface, uint64_t ts, Ptr<const Packet> p);
+  /**
+   * \brief Write a packet to the file
+   *
+   * \param interface the identifier of the interface
+   * \param ts the timestamp, in the resolution of the interface
+   * \param header the header to write in front of the packet
+   * \param p the packet
+   */
+  void Write (uint32_t interface, uint64_t ts, const Header &header, Ptr<const Packet> p);
+
+private:
+  /**
+   * \brief Write the header of an enhanced packet block
+   *
+   * \param interface the identifier of the interface
+   * \param ts the timestamp
+   * \param totalLen the length of the packet
+   * \return the number of bytes of the packet to write
+   */
+  uint32_t WritePacketHeader (uint32_t interface, uint64_t ts, uint32_t totalLen);
+  /**
+   * \brief Write the end of an enhanced packet block
+   *
+   * \param inclLen the number of bytes of the packet written
+   */
+  void WritePacketTrailer (uint32_t inclLen);
+  /**
+   * \brief Write data to the file stream, or to the AsyncFileWriter
+   * \param data the data
+   * \param size the number of bytes of data
+   */
+  void WriteData (void const *data, uint32_t size);
+  /**
+   * \brief Write a 32 bit word to the file
+   * \param value the word
+   */
+  void WriteU32 (uint32_t value);
+
+  std::string m_filename;                //!< file name
+  std::ofstream m_file;                  //!< file stream of a synchronous file
+  AsyncFileWriter *m_writer;             //!< the writer of an asynchronous file, or 0
+  std::vector<uint32_t> m_snapLen;       //!< snap length of each interface
+#ifdef NS3_MTP
+  std::mutex m_mutex;                    //!< serializes the writes of the nodes of different threads
+#endif
+};
+
+} // namespace ns3
+
+#endif /* PCAPNG_FILE_H */
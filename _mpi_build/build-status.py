@@ -0,0 +1,8 @@
+#! /usr/bin/env python
+
+# Programs that are runnable.
+ns3_runnable_programs = ['_mpi_build/src/core/examples/ns3-dev-main-callback-debug', '_mpi_build/src/core/examples/ns3-dev-sample-simulator-debug', '_mpi_build/src/core/examples/ns3-dev-main-ptr-debug', '_mpi_build/src/core/examples/ns3-dev-sample-random-variable-debug', '_mpi_build/src/core/examples/ns3-dev-sample-random-variable-stream-debug', '_mpi_build/src/core/examples/ns3-dev-command-line-example-debug', '_mpi_build/src/core/examples/ns3-dev-hash-example-debug', '_mpi_build/src/core/examples/ns3-dev-main-test-sync-debug', '_mpi_build/src/mpi/examples/ns3-dev-phold-distributed-debug', '_mpi_build/src/network/examples/ns3-dev-main-packet-header-debug', '_mpi_build/src/network/examples/ns3-dev-main-packet-tag-debug', '_mpi_build/src/network/examples/ns3-dev-packet-socket-apps-debug', '_mpi_build/src/point-to-point/examples/ns3-dev-main-attribute-value-debug', '_mpi_build/src/stats/examples/ns3-dev-gnuplot-example-debug', '_mpi_build/src/stats/examples/ns3-dev-double-probe-example-debug', '_mpi_build/src/stats/examples/ns3-dev-time-probe-example-debug', '_mpi_build/src/stats/examples/ns3-dev-gnuplot-aggregator-example-debug', '_mpi_build/src/stats/examples/ns3-dev-gnuplot-helper-example-debug', '_mpi_build/src/stats/examples/ns3-dev-file-aggregator-example-debug', '_mpi_build/src/stats/examples/ns3-dev-file-helper-example-debug', '_mpi_build/examples/tutorial/ns3-dev-hello-simulator-debug', '_mpi_build/examples/tutorial/ns3-dev-fourth-debug', '_mpi_build/scratch/subdir/ns3-dev-subdir-debug', '_mpi_build/scratch/ns3-dev-fso-channel-helper-study-debug', '_mpi_build/scratch/ns3-dev-scratch-simulator-debug']
+
+# Scripts that are runnable.
+ns3_runnable_scripts = ['sample-simulator.py']
+
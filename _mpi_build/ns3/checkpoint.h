@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup simulator
+ * Declaration of class ns3::Checkpoint.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ *
+ * \brief Branch several runs from the current state of a simulation
+ *
+ * A checkpoint is taken between two calls to Simulator::Run, typically
+ * at the end of a long warm-up. Each branch is a copy of the process,
+ * made by fork (), which holds the complete state of the simulation:
+ * the pending events, the state of the random number streams, the
+ * attribute values and the objects of the NodeList and the ChannelList,
+ * and the internal state of the models (TCP windows, queues, ...). The
+ * copy costs a few milliseconds whatever the length of the warm-up, as
+ * its memory is shared with the original process until written.
+ *
+ * \code
+ *   Simulator::Stop (Hours (8));
+ *   Simulator::Run ();
+ *   uint32_t branch = Checkpoint::Branch (rates.size (), 4);
+ *   if (branch == 0)
+ *     {
+ *       // All the branches have exited, see Checkpoint::GetExitStatus
+ *       return 0;
+ *     }
+ *   Config::Set ("/NodeList/0/DeviceList/0/DataRate", rates[branch - 1]);
+ *   Simulator::Stop (Minutes (10));
+ *   Simulator::Run ();
+ *   Simulator::Destroy ();
+ * \endcode
+ *
+ * The branches continue the random number streams of the checkpoint, so
+ * the parameters of a sweep are compared with common random numbers. A
+ * branch should write to its own output files: the files opened before
+ * the checkpoint are shared by all the branches. Only the thread calling
+ * Branch is copied, so the simulator must not run other threads, as the
+ * RealtimeSimulatorImpl and the emulation devices do.
+ *
+ * The pending events are closures over the objects of the simulation, so
+ * a checkpoint lives as long as the process taking it, it is not saved
+ * to a file.
+ */
+class Checkpoint
+{
+public:
+  /**
+   * Run branches from the current state of the simulation.
+   *
+   * The standard output streams are flushed before the branches are
+   * made. In the calling process, the call returns once all the
+   * branches have exited.
+   *
+   * \param branches the number of branches
+   * \param parallel the maximum number of branches running at once
+   * \return in a branch, its index from 1 to branches; in the calling
+   *         process, 0
+   */
+  static uint32_t Branch (uint32_t branches, uint32_t parallel = 1);
+
+  /**
+   * \return the index of the current branch, 0 in the original process
+   */
+  static uint32_t GetBranch (void);
+
+  /**
+   * \param branch the index of a branch of the last call to Branch
+   * \return the exit status of the branch, or 128 plus the number of the
+   *         signal which terminated it
+   */
+  static int GetExitStatus (uint32_t branch);
+};
+
+} // namespace ns3
+
+#endif /* CHECKPOINT_H */
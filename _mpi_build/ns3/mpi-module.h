@@ -0,0 +1,16 @@
+
+#ifdef NS3_MODULE_COMPILATION
+# error "Do not include ns3 module aggregator headers from other modules; these are meant only for end user scripts."
+#endif
+
+#ifndef NS3_MODULE_MPI
+    
+
+// Module headers:
+#include "granted-time-window-mpi-interface.h"
+#include "mpi-interface.h"
+#include "mpi-partition-helper.h"
+#include "mpi-receiver.h"
+#include "optimistic-simulator-impl.h"
+#include "parallel-communication-interface.h"
+#endif
@@ -0,0 +1,8 @@
+#! /usr/bin/env python
+
+# Programs that are runnable.
+ns3_runnable_programs = ['_mtp_build/scratch/subdir/ns3-dev-subdir-debug', '_mtp_build/scratch/ns3-dev-fso-channel-helper-study-debug', '_mtp_build/scratch/ns3-dev-scratch-simulator-debug']
+
+# Scripts that are runnable.
+ns3_runnable_scripts = []
+
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MPI_PARTITION_HELPER_H
+#define MPI_PARTITION_HELPER_H
+
+#include <stdint.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Assign the nodes of a topology to the ranks of a distributed run
+ *
+ * The topology is described as a graph: the nodes, weighted by their
+ * expected load, and the links between them, with their delay and their
+ * expected traffic. Partition computes a balanced assignment of the nodes
+ * to the ranks which minimizes the traffic of the links cut between ranks,
+ * with a multilevel algorithm: the graph is coarsened by merging the nodes
+ * along the heaviest links, the coarsest graph is split by growing the
+ * partitions greedily, and the split is refined at each level while the
+ * graph is projected back.
+ *
+ * The partitioning is lookahead aware: the links whose delay is smaller
+ * than the minimum lookahead are never cut, so the conservative
+ * synchronization of the ranks is granted at least this lookahead.
+ * GetLookahead returns the lookahead actually granted by an assignment.
+ *
+ * The algorithm is deterministic, so every rank computes the same
+ * assignment without communicating. The topology is either described
+ * with AddNode and AddLink before the nodes are created, then created
+ * with the rank of each node, or inspected with AddTopology in a first
+ * (e.g. serial) run whose assignment is used by the distributed run.
+ */
+class MpiPartitionHelper
+{
+public:
+  MpiPartitionHelper ();
+
+  /**
+   * \param weight the expected load of the node, e.g. its events
+   * \return the index of the node, the nodes are numbered from zero
+   */
+  uint32_t AddNode (double weight = 1.0);
+  /**
+   * Add a link between two nodes. The traffic of several links between
+   * the same nodes is added and their smallest delay kept.
+   *
+   * \param a the index of a node
+   * \param b the index of another node
+   * \param delay the delay of the link
+   * \param traffic the expected traffic of the link
+   */
+  void AddLink (uint32_t a, uint32_t b, Time delay, double traffic = 1.0);
+  /**
+   * Add the nodes of the NodeList with a unit weight, so that the index
+   * of a node is its id, and a link of unit traffic between all the nodes
+   * of each channel of the ChannelList, with the Delay attribute of the
+   * channel or zero. No node must have been added before.
+   */
+  void AddTopology (void);
+  /**
+   * \return the number of nodes
+   */
+  uint32_t GetNNodes (void) const;
+
+  /**
+   * \param imbalance how much heavier than the average a partition may be,
+   *        e.g. 0.05 for 5%
+   */
+  void SetImbalance (double imbalance);
+  /**
+   * \param lookahead the links of a smaller delay are not cut
+   */
+  void SetMinimumLookahead (Time lookahead);
+
+  /**
+   * \param parts the number of ranks
+   * \return the rank of each node
+   */
+  std::vector<uint32_t> Partition (uint32_t parts) const;
+  /**
+   * \param ranks the rank of each node
+   * \return the traffic of the links between nodes of different ranks
+   */
+  double GetCutTraffic (const std::vector<uint32_t> &ranks) const;
+  /**
+   * \param ranks the rank of each node
+   * \return the smallest delay of the links between nodes of different
+   *         ranks, Time::Max () if no link is cut
+   */
+  Time GetLookahead (const std::vector<uint32_t> &ranks) const;
+
+private:
+  /// Delay and traffic of the links between two nodes
+  struct Link
+  {
+    Time delay;      //!< smallest delay of the links
+    double traffic;  //!< traffic of the links
+  };
+
+  /// A level of the coarsening of the graph
+  struct Graph
+  {
+    std::vector<double> weights;                                   //!< weight of the vertices
+    std::vector<std::vector<std::pair<uint32_t, double> > > edges; //!< neighbors and traffic, sorted
+    std::vector<uint32_t> coarse;                                  //!< vertex of the next level
+  };
+
+  /**
+   * Merge the vertices of a graph along its heaviest edges
+   *
+   * \param fine the graph, its coarse vertices are set
+   * \param maxWeight the maximum weight of a merged vertex
+   * \return the coarse graph, or an empty graph if too few vertices merge
+   */
+  static Graph Coarsen (Graph &fine, double maxWeight);
+  /**
+   * Split a graph by growing each partition from its heaviest vertex
+   *
+   * \param graph the graph
+   * \param parts the number of partitions
+   * \return the partition of each vertex
+   */
+  static std::vector<uint32_t> Grow (const Graph &graph, uint32_t parts);
+  /**
+   * Move the vertices at the boundary of the partitions to reduce the
+   * traffic cut and to restore the balance
+   *
+   * \param graph the graph
+   * \param parts the number of partitions
+   * \param maxWeight the maximum weight of a partition
+   * \param partition the partition of each vertex, updated
+   */
+  static void Refine (const Graph &graph, uint32_t parts, double maxWeight, std::vector<uint32_t> &partition);
+
+  std::vector<double> m_weights;                         //!< weight of the nodes
+  std::map<std::pair<uint32_t, uint32_t>, Link> m_links; //!< links by pair of nodes
+  double m_imbalance;                                    //!< allowed imbalance
+  Time m_minimumLookahead;                               //!< links not cut below
+};
+
+} // namespace ns3
+
+#endif /* MPI_PARTITION_HELPER_H */
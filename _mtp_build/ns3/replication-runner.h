@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef REPLICATION_RUNNER_H
+#define REPLICATION_RUNNER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "callback.h"
+
+/**
+ * \file
+ * \ingroup simulator
+ * Declaration of class ns3::ReplicationRunner.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ *
+ * \brief Run independent replications of a simulation on all the cores
+ *
+ * Each replication runs in its own process, forked by Checkpoint::Branch
+ * from the process calling Run, so the start-up of the program and the
+ * registration of the types are paid once. The replications are handed
+ * out to the processes as they become free, so the cores stay busy when
+ * the replications do not last the same time.
+ *
+ * A replication is a callback which builds and runs a simulation and
+ * destroys it. It runs with its own run number, set with
+ * RngSeedManager::SetRun before the callback is called, and records its
+ * results with Record. The results of all the replications are available
+ * once Run returns, and can be added to a DataCollector with
+ * DataCollector::AddReplications.
+ *
+ * \code
+ *   void Replicate (uint64_t run)
+ *   {
+ *     ... build the topology ...
+ *     Simulator::Run ();
+ *     ReplicationRunner::Record ("throughput", sink->GetTotalRx () * 8.0 / 100);
+ *     Simulator::Destroy ();
+ *   }
+ *
+ *   ReplicationRunner runner;
+ *   runner.Run (200, MakeCallback (&Replicate));
+ *   std::vector<double> throughput = runner.GetValues ("throughput");
+ * \endcode
+ *
+ * The replications must not be started while the simulator runs other
+ * threads, see Checkpoint.
+ */
+class ReplicationRunner
+{
+public:
+  ReplicationRunner ();
+
+  /**
+   * \param workers the maximum number of replications running at once,
+   *        by default the number of cores
+   */
+  void SetWorkers (uint32_t workers);
+
+  /**
+   * \return the maximum number of replications running at once
+   */
+  uint32_t GetWorkers (void) const;
+
+  /**
+   * \param run the run number of the first replication, by default the
+   *        run number of RngSeedManager
+   */
+  void SetFirstRun (uint64_t run);
+
+  /**
+   * \return the run number of the first replication
+   */
+  uint64_t GetFirstRun (void) const;
+
+  /**
+   * Run the replications and wait for their end.
+   *
+   * \param replications the number of replications
+   * \param replicate the replication, called with its run number
+   * \return the number of replications which failed
+   */
+  uint32_t Run (uint32_t replications, Callback<void, uint64_t> replicate);
+
+  /**
+   * Record a result of the current replication. Outside of a replication
+   * the result is ignored.
+   *
+   * \param name the name of the result, without tabs and new lines
+   * \param value the value of the result
+   */
+  static void Record (const std::string &name, double value);
+
+  /**
+   * \return the number of replications of the last call to Run
+   */
+  uint32_t GetReplications (void) const;
+
+  /**
+   * \param replication the index of a replication, from 0
+   * \return the run number of the replication
+   */
+  uint64_t GetRun (uint32_t replication) const;
+
+  /**
+   * \param replication the index of a replication, from 0
+   * \return the exit status of the process of the replication, 0 if it
+   *         succeeded, see Checkpoint::GetExitStatus
+   */
+  int GetExitStatus (uint32_t replication) const;
+
+  /**
+   * \return the names of the results recorded by the replications
+   */
+  std::vector<std::string> GetNames (void) const;
+
+  /**
+   * \param name the name of a result
+   * \return the values of the result recorded by the replications which
+   *         succeeded, in the order of the replications
+   */
+  std::vector<double> GetValues (const std::string &name) const;
+
+private:
+  uint32_t m_workers;                //!< replications running at once
+  uint64_t m_firstRun;               //!< run number of the first replication
+  bool m_firstRunSet;                //!< whether the first run number was set
+  std::vector<int> m_status;         //!< exit status of the replications
+  /** The recorded values of each result, by replication */
+  std::map<std::string, std::map<uint32_t, double> > m_results;
+};
+
+} // namespace ns3
+
+#endif /* REPLICATION_RUNNER_H */
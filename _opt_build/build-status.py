@@ -0,0 +1,8 @@
+#! /usr/bin/env python
+
+# Programs that are runnable.
+ns3_runnable_programs = ['_opt_build/scratch/subdir/ns3-dev-subdir-optimized', '_opt_build/scratch/ns3-dev-fso-channel-helper-study-optimized', '_opt_build/scratch/ns3-dev-scratch-simulator-optimized']
+
+# Scripts that are runnable.
+ns3_runnable_scripts = []
+
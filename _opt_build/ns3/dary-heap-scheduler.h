@@ -0,0 +1,159 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef DARY_HEAP_SCHEDULER_H
+#define DARY_HEAP_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Declaration of ns3::DaryHeapScheduler class.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a d-ary heap event scheduler with inline event keys
+ *
+ * The other schedulers store the full Scheduler::Event in their
+ * containers, and the MapScheduler allocates a tree node per event.
+ * This scheduler instead keeps an implicit d-ary heap of small
+ * fixed size entries holding only what is compared, the timestamp
+ * and the uid of the event, plus the index of a slot holding the
+ * rest of the event. With the default arity of 4, the 16 byte entries
+ * of the children of a node span 64 bytes, so a level of the heap
+ * costs one or two cache lines while the tree is half as deep as a
+ * binary heap.
+ *
+ * The slots are recycled through an intrusive free list. The slot index
+ * is stored in the EventImpl (see EventImpl::SetSchedulerHandle) so
+ * Remove() finds the event in constant time. The removed event is only
+ * marked in its slot: its entry is dropped when it reaches the root, or
+ * when the removed entries are more than half of the heap, which is then
+ * rebuilt. Neither the comparisons nor the moves of the entries touch
+ * the slots or the EventImpl.
+ *
+ * Insertion is O(log n) in the worst case but O(1) on average when the
+ * new timestamps are random, since most new entries stay at the bottom
+ * of the heap. RemoveNext() is O(d log n / log d). Remove() marks the
+ * event in constant time, dropping its entry later costs as much as a
+ * RemoveNext().
+ */
+class DaryHeapScheduler : public Scheduler
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  DaryHeapScheduler ();
+  /** Destructor. */
+  virtual ~DaryHeapScheduler ();
+
+  /**
+   * Set the number of children of each node.
+   *
+   * \param [in] arity The arity, a power of two, 2 to 64.
+   *
+   * The arity can only be changed while the heap is empty.
+   */
+  void SetArity (uint32_t arity);
+  /**
+   * \returns The number of children of each node.
+   */
+  uint32_t GetArity (void) const;
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+private:
+  /** Heap entry, the ordering key of an event. */
+  struct Entry
+  {
+    uint64_t m_ts;    /**< Event time stamp. */
+    uint32_t m_uid;   /**< Event unique id. */
+    uint32_t m_slot;  /**< Index of the Slot of the event. */
+  };
+  /** Rest of an event, stored at a stable index. */
+  struct Slot
+  {
+    EventImpl *m_impl;     /**< Event implementation, 0 if removed or free. */
+    uint32_t m_context;    /**< Event context, or next free slot. */
+    uint32_t m_uid;        /**< Event unique id. */
+  };
+
+  /**
+   * Compare (less than) two entries.
+   *
+   * \param [in] a The first entry.
+   * \param [in] b The second entry.
+   * \returns \c true if \c a sorts before \c b
+   */
+  static inline bool IsLess (const Entry &a, const Entry &b);
+  /**
+   * Move an entry toward the root until the heap is ordered.
+   *
+   * \param [in] position The index of the entry.
+   */
+  void SiftUp (uint32_t position);
+  /**
+   * Move an entry toward the leaves until the heap is ordered.
+   *
+   * \param [in] position The index of the entry.
+   */
+  void SiftDown (uint32_t position);
+  /** Remove the root entry and free its slot. */
+  void PopRoot (void);
+  /** Pop the removed entries at the root, so that the root is an event. */
+  void PopRemoved (void);
+  /** Drop all the removed entries and rebuild the heap. */
+  void Compact (void);
+  /**
+   * Find the slot of an event.
+   *
+   * \param [in] ev The event.
+   * \returns The index of the slot of the event.
+   */
+  uint32_t Find (const Scheduler::Event &ev) const;
+
+  /** The implicit heap of entries, the root at index 0. */
+  std::vector<Entry> m_heap;
+  /** The slots, indexed by Entry::m_slot. */
+  std::vector<Slot> m_slots;
+  /** First free slot, or NO_SLOT if none is free. */
+  uint32_t m_freeSlot;
+  /** Number of removed entries still in the heap. */
+  uint32_t m_removed;
+  /** log2 of the arity. */
+  uint32_t m_shift;
+};
+
+} // namespace ns3
+
+#endif /* DARY_HEAP_SCHEDULER_H */
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PACKET_ARENA_H
+#define PACKET_ARENA_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief Per thread memory arenas of the packet buffers and metadata
+ *
+ * The memory of Buffer and PacketMetadata is recycled through the arena
+ * of the thread which allocated it. An arena keeps free lists of blocks
+ * in power of two size classes, so that a block can serve any later
+ * request of its class. A block freed by another thread is returned to
+ * the arena of its owner through a lock-free queue, which the owner
+ * drains when a free list is empty, so packets created by a thread
+ * (e.g., an emulation or a channel thread) and destroyed by another one
+ * are recycled without any lock.
+ *
+ * The arena of an exiting thread releases its free blocks, and is later
+ * reused by a new thread. Blocks larger than the largest size class are
+ * not pooled.
+ */
+class PacketArena
+{
+public:
+  /**
+   * Counters of the arenas, summed over all the threads.
+   */
+  struct Statistics
+  {
+    uint64_t hits;        //!< allocations served by a free list
+    uint64_t misses;      //!< allocations served by the heap
+    uint64_t remoteFrees; //!< blocks returned by another thread than their owner
+  };
+
+  /**
+   * \param size the number of bytes needed
+   * \param capacity set to the number of bytes usable in the block, at least size
+   * \returns a block of the arena of this thread
+   */
+  static void *Allocate (uint32_t size, uint32_t *capacity);
+  /**
+   * Return a block to the arena of the thread which allocated it.
+   *
+   * \param block a block returned by Allocate
+   */
+  static void Deallocate (void *block);
+  /**
+   * \returns the counters of all the arenas
+   */
+  static struct Statistics GetStatistics (void);
+  /**
+   * Reset the counters of all the arenas.
+   */
+  static void ResetStatistics (void);
+};
+
+} // namespace ns3
+
+#endif /* PACKET_ARENA_H */
@@ -0,0 +1,366 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2006 INRIA
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
+ */
+#ifndef PACKET_TAG_LIST_H
+#define PACKET_TAG_LIST_H
+
+/**
+\file   packet-tag-list.h
+\brief  Defines a small inline array of Packet tags.
+*/
+
+#include <stdint.h>
+#include <cstring>
+#include <ostream>
+#include "ns3/type-id.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
+
+namespace ns3 {
+
+class Tag;
+
+/**
+ * \ingroup packet
+ *
+ * \brief List of the packet tags stored in a packet.
+ *
+ * This class is mostly private to the Packet implementation and users
+ * should never have to access it directly.
+ *
+ * \internal
+ *
+ * Packets seldom carry more than a few packet tags, so the tags are
+ * stored in serialized form in a small array of TagData held in the
+ * PacketTagList itself, in the order in which they were added:
+ *
+ *   - #Add appends the new tag to the array. When the array is full,
+ *     all the tags are moved to an array twice as large allocated
+ *     from the PacketArena (the SpillData), which the list keeps
+ *     until #RemoveAll.
+ *
+ *   - #Peek, #Remove and #Replace look the tag up by its TypeId,
+ *     scanning the array from the most recent tag, which is usually
+ *     the one looked up. #Remove moves the tags added after the
+ *     removed one down by one entry.
+ *
+ *   - Copy constructor (PacketTagList(const PacketTagList & o))
+ *     and assignment (#operator=(const PacketTagList & o)) copy the
+ *     inline tags, which is cheaper than allocating a list node for
+ *     each tag. The SpillData is shared instead, incrementing its
+ *     \c count, and #Add, #Remove and #Replace copy it before writing
+ *     to it if <tt>count \> 1</tt>.
+ *
+ * \par <b> Memory Management: </b>
+ * \n
+ * Packet tags must serialize to a finite maximum size, see TagData
+ */
+class PacketTagList 
+{
+public:
+  /**
+   * Serialized tag.
+   *
+   * See TagData::TagData_e for a discussion of the size limit on
+   * tag serialization.
+   */
+  struct TagData
+  {
+    /**
+     * \brief Packet Tag maximum size
+     *
+     * The maximum size (in bytes) of a Tag is stored
+     * in this constant.
+     *
+     * \internal
+     * ns3:Ipv6PacketInfoTag needs 19 bytes. The current implementation
+     * allows 21 bytes, which gives TagData a size of 24 bytes with
+     * the #tid and one byte of padding.
+     */
+    enum TagData_e
+    {
+      MAX_SIZE = 21           /**< Size of serialization buffer #data */
+  };
+
+    uint8_t data[MAX_SIZE];   /**< Serialization buffer */
+    TypeId tid;               /**< Type of the tag serialized into #data */
+  };  /* struct TagData */
+
+  /**
+   * \brief Number of tags stored in the PacketTagList itself
+   */
+  enum PacketTagList_e
+  {
+    INLINE_SIZE = 4           /**< Size of the inline array #m_inline */
+  };
+
+  /**
+   * Create a new PacketTagList.
+   */
+  inline PacketTagList ();
+  /**
+   * Copy constructor
+   *
+   * \param [in] o The PacketTagList to copy.
+   *
+   * This copies the tags of \pname{o}.
+   */
+  inline PacketTagList (PacketTagList const &o);
+  /**
+   * Assignment
+   *
+   * \param [in] o The PacketTagList to copy.
+   * \returns the copied object
+   *
+   * This replaces the tags of this list by copies of the tags
+   * of \pname{o}.
+   */
+  inline PacketTagList &operator = (PacketTagList const &o);
+  /**
+   * Destructor
+   *
+   * #RemoveAll's the tags.
+   */
+  inline ~PacketTagList ();
+
+  /**
+   * Add a tag to the list.
+   *
+   * \param [in] tag The tag to add
+   */
+  void Add (Tag const&tag) const;
+  /**
+   * Remove (the first instance of) tag from the list.
+   *
+   * \param [in,out] tag The tag type to remove.  If found,
+   *          \pname{tag} is set to the value of the tag found.
+   * \returns True if \pname{tag} is found, false otherwise.
+   */
+  bool Remove (Tag &tag);
+  /**
+   * Replace the value of a tag.
+   *
+   * \param [in] tag The tag type to replace.  To get the old
+   *        value of the tag, use #Peek first.
+   * \returns True if \pname{tag} is found, false otherwise.
+   *        If \pname{tag} wasn't found, Add is performed instead (so
+   *        the list is guaranteed to have the new tag value either way).
+   */
+  bool Replace (Tag &tag);
+  /**
+   * Find a tag and return its value.
+   *
+   * \param [in,out] tag The tag type to find.  If found,
+   *          \pname{tag} is set to the value of the tag found.
+   * \returns True if \pname{tag} is found, false otherwise.
+   */
+  bool Peek (Tag &tag) const;
+  /**
+   * Remove all tags from this list, and release the SpillData.
+   */
+  inline void RemoveAll (void);
+  /**
+   * \returns pointer to the first (oldest) tag of the list
+   */
+  inline const struct PacketTagList::TagData *Begin (void) const;
+  /**
+   * \returns pointer past the last (most recent) tag of the list
+   */
+  inline const struct PacketTagList::TagData *End (void) const;
+
+private:
+  /**
+   * Spill array, shared copy-on-write by the lists copied from the
+   * list which allocated it.
+   */
+  struct SpillData
+  {
+#ifdef NS3_MTP
+    std::atomic<uint32_t> count; /**< Number of lists sharing the array */
+#else
+    uint32_t count;           /**< Number of lists sharing the array */
+#endif
+    uint32_t capacity;        /**< Number of tags which fit in #tags */
+    struct TagData tags[1];   /**< The tags, allocated past the end */
+  };
+
+  /**
+   * \returns pointer to the array of tags
+   */
+  inline struct PacketTagList::TagData *GetTags (void);
+  /**
+   * Look a tag up.
+   *
+   * \param [in] tid The TypeId of the tag to find.
+   * \returns the index of the tag in the array, or -1 if the
+   *          list has no tag of this type.
+   */
+  inline int32_t Find (TypeId tid) const;
+  /**
+   * Copy the tags of another list, replacing the tags of this list.
+   *
+   * \param [in] o The PacketTagList to copy.
+   */
+  inline void Assign (PacketTagList const &o);
+  /**
+   * Move the tags to a new SpillData of at least \pname{n} tags.
+   *
+   * \param [in] n The number of tags the array must hold.
+   */
+  void Reserve (uint32_t n);
+  /**
+   * Copy the SpillData if it is shared with other lists, before
+   * writing to it.
+   */
+  inline void Unshare (void);
+  /**
+   * Release the SpillData, deleting it if this was the last list
+   * sharing it, and go back to the inline array.
+   */
+  void Release (void);
+
+  /**
+   * Storage of the tags while there are at most INLINE_SIZE of them
+   */
+  struct TagData m_inline[INLINE_SIZE];
+  /**
+   * Storage of the tags when the inline array overflowed, or 0
+   */
+  struct SpillData *m_spill;
+  uint16_t m_size;     //!< number of tags in the list
+  uint16_t m_capacity; //!< number of tags which fit in the current array
+};
+
+} // namespace ns3
+
+/****************************************************
+ *  Implementation of inline methods for performance
+ ****************************************************/
+
+namespace ns3 {
+
+PacketTagList::PacketTagList ()
+  : m_spill (0),
+    m_size (0),
+    m_capacity (INLINE_SIZE)
+{
+}
+
+PacketTagList::PacketTagList (PacketTagList const &o)
+  : m_spill (0),
+    m_size (0),
+    m_capacity (INLINE_SIZE)
+{
+  Assign (o);
+}
+
+PacketTagList &
+PacketTagList::operator = (PacketTagList const &o)
+{
+  // self assignment
+  if (this == &o) 
+    {
+      return *this;
+    }
+  Assign (o);
+  return *this;
+}
+
+PacketTagList::~PacketTagList ()
+{
+  RemoveAll ();
+}
+
+void
+PacketTagList::RemoveAll (void)
+{
+  m_size = 0;
+  if (m_spill != 0)
+    {
+      Release ();
+    }
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::Begin (void) const
+{
+  return m_spill != 0 ? m_spill->tags : m_inline;
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::End (void) const
+{
+  return Begin () + m_size;
+}
+
+struct PacketTagList::TagData *
+PacketTagList::GetTags (void)
+{
+  return m_spill != 0 ? m_spill->tags : m_inline;
+}
+
+void
+PacketTagList::Assign (PacketTagList const &o)
+{
+  if (m_spill != 0)
+    {
+      Release ();
+    }
+  if (o.m_spill != 0)
+    {
+      m_spill = o.m_spill;
+      m_spill->count++;
+      m_capacity = o.m_capacity;
+    }
+  else
+    {
+      // TypeId is a plain uid, so the tags can be copied as bytes,
+      // and copying the whole array avoids a call to memcpy
+      std::memcpy (static_cast<void *> (m_inline), o.m_inline, sizeof (m_inline));
+    }
+  m_size = o.m_size;
+}
+
+int32_t
+PacketTagList::Find (TypeId tid) const
+{
+  const struct TagData *tags = Begin ();
+  for (int32_t i = m_size - 1; i >= 0; i--)
+    {
+      if (tags[i].tid == tid)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+void
+PacketTagList::Unshare (void)
+{
+  if (m_spill != 0 && m_spill->count > 1)
+    {
+      Reserve (m_capacity);
+    }
+}
+
+} // namespace ns3
+
+#endif /* PACKET_TAG_LIST_H */
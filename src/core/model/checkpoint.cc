@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "checkpoint.h"
+#include "log.h"
+#include "assert.h"
+#include "abort.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * \file
+ * \ingroup simulator
+ * Implementation of class ns3::Checkpoint.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Checkpoint");
+
+/** The index of the current branch. */
+static uint32_t g_checkpointBranch = 0;
+/** The exit status of the branches of the last checkpoint. */
+static std::vector<int> g_checkpointStatus;
+
+/**
+ * Wait for a branch to exit.
+ *
+ * Only the branches are waited for, polling each of them: the other
+ * children of the process, and their exit status, belong to the caller.
+ *
+ * \param [in,out] running the branches running, by process id
+ */
+static void
+CheckpointWait (std::map<pid_t, uint32_t> &running)
+{
+  int status;
+  std::map<pid_t, uint32_t>::iterator it = running.begin ();
+  while (true)
+    {
+      pid_t pid = waitpid (it->first, &status, WNOHANG);
+      NS_ABORT_MSG_IF (pid == -1 && errno != EINTR, "Checkpoint: waitpid failed: " << std::strerror (errno));
+      if (pid == it->first)
+        {
+          break;
+        }
+      if (++it == running.end ())
+        {
+          usleep (1000);
+          it = running.begin ();
+        }
+    }
+
+  uint32_t branch = it->second;
+  running.erase (it);
+  if (WIFEXITED (status))
+    {
+      g_checkpointStatus[branch - 1] = WEXITSTATUS (status);
+    }
+  else if (WIFSIGNALED (status))
+    {
+      g_checkpointStatus[branch - 1] = 128 + WTERMSIG (status);
+    }
+  NS_LOG_LOGIC ("Branch " << branch << " exited with status " << g_checkpointStatus[branch - 1]);
+}
+
+uint32_t
+Checkpoint::Branch (uint32_t branches, uint32_t parallel)
+{
+  NS_LOG_FUNCTION (branches << parallel);
+  NS_ASSERT (parallel > 0);
+
+  g_checkpointStatus.assign (branches, 0);
+  std::map<pid_t, uint32_t> running;
+  for (uint32_t branch = 1; branch <= branches; branch++)
+    {
+      while (running.size () >= parallel)
+        {
+          CheckpointWait (running);
+        }
+
+      // Buffered output would be written by each branch
+      std::cout.flush ();
+      std::cerr.flush ();
+      std::clog.flush ();
+      std::fflush (0);
+
+      pid_t pid = fork ();
+      NS_ABORT_MSG_IF (pid == -1, "Checkpoint: fork failed: " << std::strerror (errno));
+      if (pid == 0)
+        {
+          g_checkpointBranch = branch;
+          g_checkpointStatus.clear ();
+          return branch;
+        }
+      NS_LOG_LOGIC ("Branch " << branch << " is process " << pid);
+      running[pid] = branch;
+    }
+  while (!running.empty ())
+    {
+      CheckpointWait (running);
+    }
+  return 0;
+}
+
+uint32_t
+Checkpoint::GetBranch (void)
+{
+  return g_checkpointBranch;
+}
+
+int
+Checkpoint::GetExitStatus (uint32_t branch)
+{
+  NS_ASSERT_MSG (branch >= 1 && branch <= g_checkpointStatus.size (), "No branch " << branch);
+  return g_checkpointStatus[branch - 1];
+}
+
+} // namespace ns3
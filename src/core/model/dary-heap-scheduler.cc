@@ -0,0 +1,317 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "dary-heap-scheduler.h"
+#include "event-impl.h"
+#include "uinteger.h"
+#include "assert.h"
+#include "fatal-error.h"
+#include "log.h"
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Implementation of ns3::DaryHeapScheduler class.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DaryHeapScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (DaryHeapScheduler);
+
+/** Marks the end of the free slot list. */
+static const uint32_t NO_SLOT = 0xffffffff;
+
+TypeId
+DaryHeapScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DaryHeapScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<DaryHeapScheduler> ()
+    .AddAttribute ("Arity",
+                   "The number of children of each node of the heap, "
+                   "a power of two.",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&DaryHeapScheduler::SetArity,
+                                         &DaryHeapScheduler::GetArity),
+                   MakeUintegerChecker<uint32_t> (2, 64))
+  ;
+  return tid;
+}
+
+DaryHeapScheduler::DaryHeapScheduler ()
+  : m_freeSlot (NO_SLOT),
+    m_removed (0),
+    m_shift (2)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DaryHeapScheduler::~DaryHeapScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DaryHeapScheduler::SetArity (uint32_t arity)
+{
+  NS_LOG_FUNCTION (this << arity);
+  NS_ASSERT_MSG (m_heap.empty (), "The arity can only be changed while the heap is empty");
+  NS_ASSERT_MSG (arity >= 2 && (arity & (arity - 1)) == 0, "The arity must be a power of two");
+  m_shift = 0;
+  while ((1U << m_shift) < arity)
+    {
+      m_shift++;
+    }
+}
+
+uint32_t
+DaryHeapScheduler::GetArity (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return 1U << m_shift;
+}
+
+bool
+DaryHeapScheduler::IsLess (const Entry &a, const Entry &b)
+{
+  // without branches, which are hard to predict on random keys
+  return (a.m_ts < b.m_ts) | ((a.m_ts == b.m_ts) & (a.m_uid < b.m_uid));
+}
+
+void
+DaryHeapScheduler::SiftUp (uint32_t position)
+{
+  NS_LOG_FUNCTION (this << position);
+  Entry entry = m_heap[position];
+  while (position > 0)
+    {
+      uint32_t parent = (position - 1) >> m_shift;
+      if (!IsLess (entry, m_heap[parent]))
+        {
+          break;
+        }
+      m_heap[position] = m_heap[parent];
+      position = parent;
+    }
+  m_heap[position] = entry;
+}
+
+void
+DaryHeapScheduler::SiftDown (uint32_t position)
+{
+  NS_LOG_FUNCTION (this << position);
+  // Move the hole down to a leaf along the smallest children, then
+  // sift the entry up from there: the entry moved into the hole is
+  // taken from the bottom of the heap, so it usually belongs near it.
+  uint32_t size = m_heap.size ();
+  Entry entry = m_heap[position];
+  uint32_t start = position;
+  while (true)
+    {
+      uint32_t first = (position << m_shift) + 1;
+      if (first >= size)
+        {
+          break;
+        }
+      uint32_t last = first + (1U << m_shift);
+      if (last > size)
+        {
+          last = size;
+        }
+      uint32_t smallest = first;
+      for (uint32_t child = first + 1; child < last; child++)
+        {
+          smallest = IsLess (m_heap[child], m_heap[smallest]) ? child : smallest;
+        }
+      m_heap[position] = m_heap[smallest];
+      position = smallest;
+    }
+  while (position > start)
+    {
+      uint32_t parent = (position - 1) >> m_shift;
+      if (!IsLess (entry, m_heap[parent]))
+        {
+          break;
+        }
+      m_heap[position] = m_heap[parent];
+      position = parent;
+    }
+  m_heap[position] = entry;
+}
+
+void
+DaryHeapScheduler::PopRoot (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t slot = m_heap.front ().m_slot;
+  m_slots[slot].m_impl = 0;
+  m_slots[slot].m_context = m_freeSlot;
+  m_freeSlot = slot;
+
+  Entry last = m_heap.back ();
+  m_heap.pop_back ();
+  if (!m_heap.empty ())
+    {
+      m_heap.front () = last;
+      SiftDown (0);
+    }
+}
+
+void
+DaryHeapScheduler::PopRemoved (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_heap.empty () && m_slots[m_heap.front ().m_slot].m_impl == 0)
+    {
+      PopRoot ();
+      m_removed--;
+    }
+}
+
+void
+DaryHeapScheduler::Compact (void)
+{
+  NS_LOG_FUNCTION (this << m_removed << m_heap.size ());
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < m_heap.size (); i++)
+    {
+      uint32_t slot = m_heap[i].m_slot;
+      if (m_slots[slot].m_impl == 0)
+        {
+          m_slots[slot].m_context = m_freeSlot;
+          m_freeSlot = slot;
+        }
+      else
+        {
+          m_heap[size++] = m_heap[i];
+        }
+    }
+  m_heap.resize (size);
+  m_removed = 0;
+  if (size > 1)
+    {
+      // heapify bottom-up from the last parent
+      for (uint32_t i = ((size - 2) >> m_shift) + 1; i > 0; i--)
+        {
+          SiftDown (i - 1);
+        }
+    }
+}
+
+void
+DaryHeapScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint32_t slot = m_freeSlot;
+  if (slot == NO_SLOT)
+    {
+      NS_ASSERT_MSG (m_slots.size () < NO_SLOT, "Too many events");
+      slot = m_slots.size ();
+      m_slots.push_back (Slot ());
+    }
+  else
+    {
+      m_freeSlot = m_slots[slot].m_context;
+    }
+  m_slots[slot].m_impl = ev.impl;
+  m_slots[slot].m_context = ev.key.m_context;
+  m_slots[slot].m_uid = ev.key.m_uid;
+  ev.impl->SetSchedulerHandle (slot);
+
+  Entry entry;
+  entry.m_ts = ev.key.m_ts;
+  entry.m_uid = ev.key.m_uid;
+  entry.m_slot = slot;
+  m_heap.push_back (entry);
+  SiftUp (m_heap.size () - 1);
+}
+
+bool
+DaryHeapScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  // the root is never a removed entry
+  return m_heap.empty ();
+}
+
+Scheduler::Event
+DaryHeapScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  const Entry &entry = m_heap.front ();
+  const Slot &slot = m_slots[entry.m_slot];
+  Event ev;
+  ev.impl = slot.m_impl;
+  ev.key.m_ts = entry.m_ts;
+  ev.key.m_uid = entry.m_uid;
+  ev.key.m_context = slot.m_context;
+  return ev;
+}
+
+Scheduler::Event
+DaryHeapScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  Event ev = PeekNext ();
+  PopRoot ();
+  PopRemoved ();
+  return ev;
+}
+
+uint32_t
+DaryHeapScheduler::Find (const Event &ev) const
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_uid);
+  uint32_t slot = ev.impl->GetSchedulerHandle ();
+  if (slot < m_slots.size ()
+      && m_slots[slot].m_impl == ev.impl
+      && m_slots[slot].m_uid == ev.key.m_uid)
+    {
+      return slot;
+    }
+  // The same EventImpl was inserted more than once: search by uid.
+  for (uint32_t i = 0; i < m_heap.size (); i++)
+    {
+      slot = m_heap[i].m_slot;
+      if (m_heap[i].m_uid == ev.key.m_uid && m_slots[slot].m_impl == ev.impl)
+        {
+          return slot;
+        }
+    }
+  NS_FATAL_ERROR ("Event not found");
+  return 0;
+}
+
+void
+DaryHeapScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (!IsEmpty ());
+  m_slots[Find (ev)].m_impl = 0;
+  m_removed++;
+  PopRemoved ();
+  if (m_removed > m_heap.size () / 2)
+    {
+      Compact ();
+    }
+}
+
+} // namespace ns3
@@ -19,7 +19,11 @@
  */
 
 #include "event-impl.h"
+#include "global-value.h"
+#include "boolean.h"
+#include "per-thread.h"
 #include "log.h"
+#include <new>
 
 /**
  * \file
@@ -31,13 +35,78 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("EventImpl");
 
+/**
+ * \ingroup events
+ * Whether the memory of the events is recycled.
+ *
+ * Each thread reads it when it creates or destroys its first event.
+ */
+static GlobalValue g_eventImplPool = GlobalValue ("EventImplPool",
+                                                  "Recycle the memory of the events through per thread free lists",
+                                                  BooleanValue (true),
+                                                  MakeBooleanChecker ());
+
+namespace {
+
+/** Size granularity of the event pool. */
+const std::size_t EVENT_POOL_GRANULARITY = 16;
+/** Number of size classes of the event pool, larger events are not pooled. */
+const std::size_t EVENT_POOL_CLASSES = 16;
+/** Maximum number of free blocks kept by a thread in a size class. */
+const uint32_t EVENT_POOL_MAX_FREE = 4096;
+
+/**
+ * \ingroup events
+ * Free lists of event memory of a thread.
+ */
+struct EventPool
+{
+  FreeList free[EVENT_POOL_CLASSES];   /**< Free blocks per size class. */
+  bool enabled;                        /**< Whether freed blocks are recycled. */
+
+  /** \returns A new event pool, enabled by EventImplPool. */
+  static EventPool *Create (void);
+  /**
+   * Delete an event pool and its free blocks.
+   * \param pool The event pool.
+   */
+  static void Release (EventPool *pool);
+};
+
+EventPool *
+EventPool::Create (void)
+{
+  EventPool *pool = new EventPool ();
+  BooleanValue enabled;
+  g_eventImplPool.GetValue (enabled);
+  pool->enabled = enabled.Get ();
+  return pool;
+}
+
+void
+EventPool::Release (EventPool *pool)
+{
+  for (std::size_t i = 0; i < EVENT_POOL_CLASSES; i++)
+    {
+      void *block;
+      while ((block = pool->free[i].Pop ()) != 0)
+        {
+          ::operator delete (block);
+        }
+    }
+  delete pool;
+}
+
+} // unnamed namespace
+
 EventImpl::~EventImpl ()
 {
   NS_LOG_FUNCTION (this);
 }
 
 EventImpl::EventImpl ()
-  : m_cancel (false)
+  : m_cancel (false),
+    m_schedulerHandle (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -66,4 +135,53 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+void
+EventImpl::SetSchedulerHandle (uint32_t handle)
+{
+  NS_LOG_FUNCTION (this << handle);
+  m_schedulerHandle = handle;
+}
+
+uint32_t
+EventImpl::GetSchedulerHandle (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_schedulerHandle;
+}
+
+// Logging is avoided below, events are created and destroyed too often.
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+  std::size_t sizeClass = (size - 1) / EVENT_POOL_GRANULARITY;
+  if (sizeClass < EVENT_POOL_CLASSES)
+    {
+      EventPool *pool = PerThread<EventPool>::Get ();
+      void *block = pool != 0 ? pool->free[sizeClass].Pop () : 0;
+      if (block != 0)
+        {
+          return block;
+        }
+      // round up, so the block can later be recycled by any thread
+      size = (sizeClass + 1) * EVENT_POOL_GRANULARITY;
+    }
+  return ::operator new (size);
+}
+
+void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+  std::size_t sizeClass = (size - 1) / EVENT_POOL_GRANULARITY;
+  if (sizeClass < EVENT_POOL_CLASSES)
+    {
+      EventPool *pool = PerThread<EventPool>::Get ();
+      if (pool != 0 && pool->enabled && pool->free[sizeClass].Push (p, EVENT_POOL_MAX_FREE))
+        {
+          return;
+        }
+    }
+  ::operator delete (p);
+}
+
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 /**
@@ -65,6 +66,41 @@ public:
    * Checked by the simulation engine before calling Invoke().
    */
   bool IsCancelled (void);
+  /**
+   * Set the handle of this event in the event list.
+   *
+   * A scheduler may record where it stored the event when it is
+   * inserted, to locate it again in Scheduler::Remove without a search.
+   * The handle is only meaningful to the scheduler which set it.
+   *
+   * \param [in] handle The scheduler specific handle.
+   */
+  void SetSchedulerHandle (uint32_t handle);
+  /**
+   * \returns The handle last set by SetSchedulerHandle().
+   */
+  uint32_t GetSchedulerHandle (void) const;
+
+  /**
+   * Allocate the memory of an event.
+   *
+   * Events are created and destroyed at a high rate, so unless the
+   * EventImplPool global value is false, their memory is recycled through
+   * per thread free lists, one per size class. An event may be destroyed
+   * by another thread than the one which created it: its memory then goes
+   * to the free list of the destroying thread.
+   *
+   * \param [in] size The size of the event object.
+   * \returns The memory of the event.
+   */
+  static void * operator new (std::size_t size);
+  /**
+   * Release the memory of an event.
+   *
+   * \param [in] p The memory of the event.
+   * \param [in] size The size of the event object.
+   */
+  static void operator delete (void *p, std::size_t size);
 
 protected:
   /**
@@ -77,6 +113,7 @@ protected:
 
 private:
   bool m_cancel;  /**< Has this event been cancelled. */
+  uint32_t m_schedulerHandle;  /**< Location of this event in the event list. */
 };
 
 } // namespace ns3
@@ -0,0 +1,463 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "uinteger.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Implementation of ns3::LadderScheduler class.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+namespace {
+
+/**
+ * \ingroup scheduler
+ * Compare (greater than) two events, to keep the next event at the top
+ * of the Bottom heap.
+ *
+ * \param [in] a The first event.
+ * \param [in] b The second event.
+ * \returns \c true if \c a is after \c b
+ */
+bool
+IsLater (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key > b.key;
+}
+
+} // unnamed namespace
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<LadderScheduler> ()
+    .AddAttribute ("Threshold",
+                   "The largest number of events of a bucket sorted into the "
+                   "Bottom, larger buckets are spread on a new rung.",
+                   UintegerValue (50),
+                   MakeUintegerAccessor (&LadderScheduler::m_threshold),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("MaxRungs",
+                   "The maximum number of rungs of the ladder.",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&LadderScheduler::m_maxRungs),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TopSize",
+                   "The number of events in the Top.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetTopSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LadderSize",
+                   "The number of events in the rungs of the ladder.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetLadderSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BottomSize",
+                   "The number of events in the Bottom.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetBottomSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Rungs",
+                   "The number of rungs in use.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetNRungs),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxRungsUsed",
+                   "The largest number of rungs used at once.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetMaxRungsUsed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BucketWidth",
+                   "The bucket width of the lowest rung in time steps, "
+                   "0 without rungs.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetBucketWidth),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("Transfers",
+                   "The number of transfers of the Top to the ladder.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetNTransfers),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("Spawns",
+                   "The number of rungs created from a bucket or the Bottom.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LadderScheduler::GetNSpawns),
+                   MakeUintegerChecker<uint64_t> ())
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_threshold (50),
+    m_maxRungs (8),
+    m_topStart (0),
+    m_topMin (std::numeric_limits<uint64_t>::max ()),
+    m_topMax (0),
+    m_nRungs (0),
+    m_ladderCount (0),
+    m_bottomInserts (0),
+    m_maxRungsUsed (0),
+    m_nTransfers (0),
+    m_nSpawns (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint64_t
+LadderScheduler::GetCurrentStart (const Rung &rung)
+{
+  return rung.m_start + rung.m_current * rung.m_width;
+}
+
+uint32_t
+LadderScheduler::FindRung (uint64_t ts) const
+{
+  NS_LOG_FUNCTION (this << ts);
+  uint32_t i = 0;
+  while (i < m_nRungs && ts < GetCurrentStart (m_rungs[i]))
+    {
+      i++;
+    }
+  return i;
+}
+
+void
+LadderScheduler::MakeBottom (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::make_heap (m_bottom.begin (), m_bottom.end (), &IsLater);
+  m_bottomInserts = 0;
+}
+
+uint64_t
+LadderScheduler::SpawnRung (Bucket &events, uint64_t start, uint64_t span, uint32_t nBuckets)
+{
+  NS_LOG_FUNCTION (this << events.size () << start << span << nBuckets);
+  NS_ASSERT (span > 0 && nBuckets > 0);
+  uint64_t width = (span + nBuckets - 1) / nBuckets;
+  if (m_nRungs == m_rungs.size ())
+    {
+      m_rungs.push_back (Rung ());
+    }
+  Rung &rung = m_rungs[m_nRungs++];
+  m_maxRungsUsed = std::max (m_maxRungsUsed, m_nRungs);
+  // the buckets of a reused rung are all empty
+  rung.m_start = start;
+  rung.m_width = width;
+  rung.m_current = 0;
+  rung.m_count = events.size ();
+  rung.m_buckets.resize (nBuckets);
+  for (Bucket::const_iterator i = events.begin (); i != events.end (); i++)
+    {
+      uint64_t index = (i->key.m_ts - start) / width;
+      NS_ASSERT (index < nBuckets);
+      rung.m_buckets[index].push_back (*i);
+    }
+  m_ladderCount += events.size ();
+  events.clear ();
+  return width;
+}
+
+void
+LadderScheduler::TransferTop (void)
+{
+  NS_LOG_FUNCTION (this << m_top.size ());
+  NS_ASSERT (m_nRungs == 0 && m_bottom.empty ());
+  if (!m_topRemoved.empty ())
+    {
+      uint32_t n = 0;
+      for (uint32_t i = 0; i < m_top.size (); i++)
+        {
+          if (m_topRemoved.erase (m_top[i].key.m_uid) == 0)
+            {
+              m_top[n++] = m_top[i];
+            }
+        }
+      m_top.resize (n);
+      NS_ASSERT (m_topRemoved.empty ());
+    }
+  // the bounds may be loose after a Remove
+  uint64_t min = m_topMin;
+  uint64_t max = m_topMax;
+  m_topMin = std::numeric_limits<uint64_t>::max ();
+  m_topMax = 0;
+  if (m_top.empty ())
+    {
+      return;
+    }
+  m_nTransfers++;
+  if (m_top.size () <= m_threshold || min == max)
+    {
+      m_bottom.swap (m_top);
+      MakeBottom ();
+      m_topStart = max + 1;
+    }
+  else
+    {
+      uint32_t n = m_top.size ();
+      uint64_t width = SpawnRung (m_top, min, max - min + 1, n);
+      m_topStart = min + width * n;
+    }
+}
+
+void
+LadderScheduler::Prepare (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          if (m_top.empty ())
+            {
+              return;
+            }
+          TransferTop ();
+          continue;
+        }
+      Rung &rung = m_rungs[m_nRungs - 1];
+      if (rung.m_count == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung.m_buckets[rung.m_current].empty ())
+        {
+          rung.m_current++;
+        }
+      uint32_t index = rung.m_current++;
+      Bucket &bucket = rung.m_buckets[index];
+      rung.m_count -= bucket.size ();
+      m_ladderCount -= bucket.size ();
+      if (bucket.size () > m_threshold && rung.m_width > 1 && m_nRungs < m_maxRungs)
+        {
+          uint64_t start = rung.m_start + index * rung.m_width;
+          uint64_t width = rung.m_width;
+          m_spare.swap (bucket);
+          m_nSpawns++;
+          SpawnRung (m_spare, start, width, m_threshold);
+        }
+      else
+        {
+          m_bottom.swap (bucket);
+          MakeBottom ();
+        }
+    }
+}
+
+void
+LadderScheduler::InsertInBottom (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.key.m_ts << ev.key.m_uid);
+  m_bottom.push_back (ev);
+  std::push_heap (m_bottom.begin (), m_bottom.end (), &IsLater);
+  m_bottomInserts++;
+  if (m_bottomInserts > m_threshold && m_nRungs < m_maxRungs
+      && m_bottom.front ().key.m_ts != ev.key.m_ts)
+    {
+      uint64_t start = m_bottom.front ().key.m_ts;
+      uint64_t end = m_nRungs > 0 ? GetCurrentStart (m_rungs[m_nRungs - 1]) : m_topStart;
+      m_nSpawns++;
+      SpawnRung (m_bottom, start, end - start, m_threshold);
+      m_bottomInserts = 0;
+    }
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      m_top.push_back (ev);
+      m_topMin = std::min (m_topMin, ts);
+      m_topMax = std::max (m_topMax, ts);
+    }
+  else
+    {
+      uint32_t i = FindRung (ts);
+      if (i < m_nRungs)
+        {
+          Rung &rung = m_rungs[i];
+          uint64_t index = (ts - rung.m_start) / rung.m_width;
+          NS_ASSERT (index < rung.m_buckets.size ());
+          rung.m_buckets[index].push_back (ev);
+          rung.m_count++;
+          m_ladderCount++;
+        }
+      else
+        {
+          InsertInBottom (ev);
+        }
+    }
+  Prepare ();
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  // the Bottom is only empty with the rest of the queue
+  return m_bottom.empty ();
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  return m_bottom.front ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  Event ev = m_bottom.front ();
+  std::pop_heap (m_bottom.begin (), m_bottom.end (), &IsLater);
+  m_bottom.pop_back ();
+  Prepare ();
+  return ev;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      m_topRemoved.insert (ev.key.m_uid);
+      return;
+    }
+  uint32_t i = FindRung (ts);
+  if (i < m_nRungs)
+    {
+      Rung &rung = m_rungs[i];
+      Bucket &bucket = rung.m_buckets[(ts - rung.m_start) / rung.m_width];
+      for (Bucket::iterator j = bucket.begin (); j != bucket.end (); j++)
+        {
+          if (j->key.m_uid == ev.key.m_uid)
+            {
+              NS_ASSERT (j->impl == ev.impl);
+              *j = bucket.back ();
+              bucket.pop_back ();
+              rung.m_count--;
+              m_ladderCount--;
+              Prepare ();
+              return;
+            }
+        }
+    }
+  else
+    {
+      for (Bucket::iterator j = m_bottom.begin (); j != m_bottom.end (); j++)
+        {
+          if (j->key.m_uid == ev.key.m_uid)
+            {
+              NS_ASSERT (j->impl == ev.impl);
+              *j = m_bottom.back ();
+              m_bottom.pop_back ();
+              std::make_heap (m_bottom.begin (), m_bottom.end (), &IsLater);
+              Prepare ();
+              return;
+            }
+        }
+    }
+  NS_ASSERT_MSG (false, "Event not found");
+}
+
+uint32_t
+LadderScheduler::GetTopSize (void) const
+{
+  return m_top.size () - m_topRemoved.size ();
+}
+
+uint32_t
+LadderScheduler::GetLadderSize (void) const
+{
+  return m_ladderCount;
+}
+
+uint32_t
+LadderScheduler::GetBottomSize (void) const
+{
+  return m_bottom.size ();
+}
+
+uint32_t
+LadderScheduler::GetNRungs (void) const
+{
+  return m_nRungs;
+}
+
+uint32_t
+LadderScheduler::GetMaxRungsUsed (void) const
+{
+  return m_maxRungsUsed;
+}
+
+uint64_t
+LadderScheduler::GetBucketWidth (void) const
+{
+  return m_nRungs > 0 ? m_rungs[m_nRungs - 1].m_width : 0;
+}
+
+uint64_t
+LadderScheduler::GetNTransfers (void) const
+{
+  return m_nTransfers;
+}
+
+uint64_t
+LadderScheduler::GetNSpawns (void) const
+{
+  return m_nSpawns;
+}
+
+} // namespace ns3
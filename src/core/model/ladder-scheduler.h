@@ -0,0 +1,183 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+#include <unordered_set>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Declaration of ns3::LadderScheduler class.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a Ladder Queue event scheduler
+ *
+ * This is the Ladder Queue of W. T. Tang, R. S. M. Goh and I. L.-J. Thng,
+ * "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation", ACM TOMACS 15(3), 2005. Like the
+ * CalendarScheduler it sorts the events into buckets, but the bucket
+ * width is not a single global parameter fixed at resize time: it is
+ * chosen from the events themselves, and refined where they are dense.
+ * A mix of events a few ms apart and timers hundreds of s away keeps
+ * its O(1) amortized cost.
+ *
+ * The events are held in three tiers:
+ *  - Top, an unsorted list of the events later than all the others,
+ *    which are only looked at once the rest of the queue is empty.
+ *  - The ladder, a stack of rungs of buckets, each an unsorted list.
+ *    When the ladder and the bottom are empty, the Top is spread on a
+ *    first rung with as many buckets as events. Buckets are taken in
+ *    order from the lowest rung; one with more than Threshold events is
+ *    spread on a new, finer, rung of Threshold buckets.
+ *  - Bottom, the next events. The paper sorts it in a list, it is a
+ *    binary heap here: many events at the same time may be inserted in
+ *    it when no finer rung can be spawned, and the sorted insertion
+ *    would then be O(n).
+ * The Bottom is respread on a new rung when more than Threshold events
+ * were inserted in it since it was filled.
+ *
+ * The queue shape is exposed as read only attributes (TopSize,
+ * LadderSize, BottomSize, Rungs, ...), to check how a workload uses the
+ * ladder and compare it with the other schedulers.
+ *
+ * Remove() of an event in the Top only records its uid, the event is
+ * dropped when the Top is transferred to the ladder. Other events are
+ * searched in their bucket or in the Bottom.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  LadderScheduler ();
+  /** Destructor. */
+  virtual ~LadderScheduler ();
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+  /** \returns The number of events in the Top. */
+  uint32_t GetTopSize (void) const;
+  /** \returns The number of events in the rungs. */
+  uint32_t GetLadderSize (void) const;
+  /** \returns The number of events in the Bottom. */
+  uint32_t GetBottomSize (void) const;
+  /** \returns The number of rungs in use. */
+  uint32_t GetNRungs (void) const;
+  /** \returns The largest number of rungs used at once. */
+  uint32_t GetMaxRungsUsed (void) const;
+  /** \returns The bucket width of the lowest rung, 0 without rungs. */
+  uint64_t GetBucketWidth (void) const;
+  /** \returns The number of transfers of the Top to the ladder. */
+  uint64_t GetNTransfers (void) const;
+  /** \returns The number of rungs created from a bucket or the Bottom. */
+  uint64_t GetNSpawns (void) const;
+
+private:
+  /** A bucket, or the Top: an unsorted list of events. */
+  typedef std::vector<Scheduler::Event> Bucket;
+  /** A rung of the ladder. */
+  struct Rung
+  {
+    uint64_t m_start;              /**< Start time of the first bucket. */
+    uint64_t m_width;              /**< Width of the buckets. */
+    uint32_t m_current;            /**< First bucket not yet dequeued. */
+    uint32_t m_count;              /**< Number of events in the buckets. */
+    std::vector<Bucket> m_buckets; /**< The buckets. */
+  };
+
+  /**
+   * Get the start time of the current bucket of a rung: events before it
+   * belong to the lower rungs or to the Bottom.
+   *
+   * \param [in] rung The rung.
+   * \returns The start time of the current bucket.
+   */
+  static uint64_t GetCurrentStart (const Rung &rung);
+  /**
+   * Find the rung an event belongs to.
+   *
+   * \param [in] ts The time stamp of the event, before the Top start.
+   * \returns The index of the rung, or the number of rungs for the Bottom.
+   */
+  uint32_t FindRung (uint64_t ts) const;
+  /**
+   * Insert an event in the Bottom, respreading it when it grows too large.
+   *
+   * \param [in] ev The event.
+   */
+  void InsertInBottom (const Scheduler::Event &ev);
+  /**
+   * Spread events on a new lowest rung.
+   *
+   * \param [in,out] events The events, cleared.
+   * \param [in] start The start time of the rung.
+   * \param [in] span The time span of the events from \p start.
+   * \param [in] nBuckets The number of buckets.
+   * \returns The bucket width of the rung.
+   */
+  uint64_t SpawnRung (Bucket &events, uint64_t start, uint64_t span, uint32_t nBuckets);
+  /** Move the events of the Top to the ladder or the Bottom. */
+  void TransferTop (void);
+  /** Refill the Bottom from the ladder or the Top when it is empty. */
+  void Prepare (void);
+  /** Arrange the events in the Bottom as a heap. */
+  void MakeBottom (void);
+
+  uint32_t m_threshold;              /**< Largest bucket sorted into the Bottom. */
+  uint32_t m_maxRungs;               /**< Maximum number of rungs. */
+
+  Bucket m_top;                      /**< The Top. */
+  uint64_t m_topStart;               /**< Events at or after this time go to the Top. */
+  uint64_t m_topMin;                 /**< Earliest time stamp in the Top. */
+  uint64_t m_topMax;                 /**< Latest time stamp in the Top. */
+  std::unordered_set<uint32_t> m_topRemoved; /**< Uids of the events removed from the Top. */
+
+  std::vector<Rung> m_rungs;         /**< The rungs, reused once allocated. */
+  uint32_t m_nRungs;                 /**< Number of rungs in use. */
+  uint32_t m_ladderCount;            /**< Number of events in the rungs. */
+  Bucket m_spare;                    /**< Scratch bucket to spawn a rung. */
+
+  Bucket m_bottom;                   /**< The Bottom, a heap of the next events. */
+  uint32_t m_bottomInserts;          /**< Events inserted in the Bottom since it was filled. */
+
+  uint32_t m_maxRungsUsed;           /**< Largest number of rungs used at once. */
+  uint64_t m_nTransfers;             /**< Number of transfers of the Top. */
+  uint64_t m_nSpawns;                /**< Number of rungs spawned. */
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -0,0 +1,239 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PER_THREAD_H
+#define PER_THREAD_H
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup core
+ * ns3::PerThread and ns3::FreeList declarations, to recycle memory
+ * through per thread free lists.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ * \brief An object of each thread, created on demand and released
+ * when the thread exits.
+ *
+ * The object is created by the first call to Get in a thread, with
+ * \c T::Create (), and released with \c T::Release (object) when the
+ * thread exits. Get returns 0 once the object was released, so the
+ * memory freed by the thread_local and static destructors which run
+ * later, e.g., in packets or events still referenced at exit, must
+ * then go to the heap.
+ *
+ * Unlike a thread_local object of class type, Get can be called before
+ * any constructor ran, from the static constructors of the program, and
+ * it costs a single test once the object exists.
+ *
+ * \tparam T \explicit The type of the object, which provides
+ *         <tt>static T *Create (void)</tt> and
+ *         <tt>static void Release (T *object)</tt>.
+ */
+template <typename T>
+class PerThread
+{
+public:
+  /**
+   * \returns The object of this thread, created if needed, or 0 once
+   *          released.
+   */
+  static T *Get (void);
+  /**
+   * \returns The object of this thread, or 0 if it was not created yet
+   *          or was released.
+   */
+  static T *Peek (void);
+  /**
+   * \returns Whether the object of this thread was released.
+   */
+  static bool IsReleased (void);
+
+private:
+  /** Create the object of this thread. */
+  static void Create (void);
+
+  /** Releases the object of a thread when it exits. */
+  struct Releaser
+  {
+    ~Releaser ();
+  };
+
+  /**
+   * The object of this thread. Being a pointer initialized to 0, it is
+   * zero before any constructor runs.
+   */
+  static thread_local T *g_object;
+  /** Whether the object of this thread was released. */
+  static thread_local bool g_released;
+  /**
+   * Releases the object. A thread_local object of class type is only
+   * constructed, and thus destroyed with its thread, once used by the
+   * thread, which Create does.
+   */
+  static thread_local Releaser g_releaser;
+};
+
+/**
+ * \ingroup core
+ * \brief A list of free memory blocks, to keep in a PerThread object.
+ *
+ * The blocks hold the link of the list while free, so they must be at
+ * least as large as a pointer. The list is not thread-safe.
+ */
+class FreeList
+{
+public:
+  FreeList ();
+  /**
+   * \returns A block of the list, or 0 if it is empty.
+   */
+  inline void *Pop (void);
+  /**
+   * Keep a block in the list, unless it is full.
+   *
+   * \param [in] block The block.
+   * \param [in] max The maximum number of blocks of the list.
+   * \returns Whether the block was kept, the caller frees it otherwise.
+   */
+  inline bool Push (void *block, uint32_t max);
+  /**
+   * \returns Whether the list is empty.
+   */
+  inline bool IsEmpty (void) const;
+
+private:
+  /** A free block. */
+  struct Block
+  {
+    Block *next;  /**< Next free block. */
+  };
+  Block *m_head;   //!< The first free block, or 0
+  uint32_t m_size; //!< The number of free blocks
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the templates declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+template <typename T>
+thread_local T *PerThread<T>::g_object = 0;
+
+template <typename T>
+thread_local bool PerThread<T>::g_released = false;
+
+template <typename T>
+thread_local typename PerThread<T>::Releaser PerThread<T>::g_releaser;
+
+template <typename T>
+PerThread<T>::Releaser::~Releaser ()
+{
+  if (g_object != 0)
+    {
+      // What the release frees must not come back to the object
+      T *object = g_object;
+      g_object = 0;
+      g_released = true;
+      T::Release (object);
+    }
+}
+
+template <typename T>
+T *
+PerThread<T>::Get (void)
+{
+  if (g_object == 0 && !g_released)
+    {
+      Create ();
+    }
+  return g_object;
+}
+
+template <typename T>
+T *
+PerThread<T>::Peek (void)
+{
+  return g_object;
+}
+
+template <typename T>
+bool
+PerThread<T>::IsReleased (void)
+{
+  return g_released;
+}
+
+template <typename T>
+void
+PerThread<T>::Create (void)
+{
+  g_object = T::Create ();
+  // Construct the releaser of this thread
+  (void)&g_releaser;
+}
+
+inline
+FreeList::FreeList ()
+  : m_head (0),
+    m_size (0)
+{
+}
+
+void *
+FreeList::Pop (void)
+{
+  Block *block = m_head;
+  if (block != 0)
+    {
+      m_head = block->next;
+      m_size--;
+    }
+  return block;
+}
+
+bool
+FreeList::Push (void *block, uint32_t max)
+{
+  if (m_size >= max)
+    {
+      return false;
+    }
+  Block *free = static_cast<Block *> (block);
+  free->next = m_head;
+  m_head = free;
+  m_size++;
+  return true;
+}
+
+bool
+FreeList::IsEmpty (void) const
+{
+  return m_head == 0;
+}
+
+} // namespace ns3
+
+#endif /* PER_THREAD_H */
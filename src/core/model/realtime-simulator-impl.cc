@@ -34,6 +34,7 @@
 
 
 #include <cmath>
+#include <algorithm>
 
 
 /**
@@ -90,6 +91,7 @@ RealtimeSimulatorImpl::RealtimeSimulatorImpl ()
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
+  m_eventsWithContext.store (0);
 
   m_main = SystemThread::Self();
 
@@ -107,6 +109,7 @@ void
 RealtimeSimulatorImpl::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  ProcessEventsWithContext ();
   while (!m_events->IsEmpty ())
     {
       Scheduler::Event next = m_events->RemoveNext ();
@@ -221,6 +224,15 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
         NS_ASSERT_MSG (m_synchronizer->Realtime (), 
                        "RealtimeSimulatorImpl::ProcessOneEvent (): Synchronizer reports not Realtime ()");
 
+        //
+        // This resets the synchronizer so that any future event will cause it
+        // to interrupt.  It must be done before looking at the events scheduled
+        // by other threads: a thread pushing on the empty stack after we take
+        // it signals the synchronizer, and that signal must not be lost.
+        //
+        m_synchronizer->SetCondition (false);
+        ProcessEventsWithContext ();
+
         //
         // tsNow is set to the normalized current real time.  When the simulation was
         // started, the current real time was effectively set to zero; so tsNow is
@@ -253,10 +265,9 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
         // We've figured out how long we need to delay in order to pace the 
         // simulation time with the real time.  We're going to sleep, but need
         // to work with the synchronizer to make sure we're awakened if something 
-        // external happens (like a packet is received).  This next line resets
-        // the synchronizer so that any future event will cause it to interrupt.
+        // external happens (like a packet is received).  The condition of the
+        // synchronizer was reset above for this purpose.
         //
-        m_synchronizer->SetCondition (false);
       }
 
       //
@@ -393,6 +404,45 @@ RealtimeSimulatorImpl::ProcessOneEvent (void)
   event->Unref ();
 }
 
+void
+RealtimeSimulatorImpl::ProcessEventsWithContext (void)
+{
+  if (m_eventsWithContext.load (std::memory_order_relaxed) == 0)
+    {
+      return;
+    }
+
+  // take the whole stack and reverse it to schedule in order
+  EventWithContext *stack = m_eventsWithContext.exchange (0, std::memory_order_acquire);
+  EventWithContext *events = 0;
+  while (stack != 0)
+    {
+      EventWithContext *next = stack->next;
+      stack->next = events;
+      events = stack;
+      stack = next;
+    }
+  while (events != 0)
+    {
+      EventWithContext *event = events;
+      events = event->next;
+      //
+      // The realtime clock was read by the other thread before the main
+      // thread could move m_currentTs past it.  Such an event is late and
+      // runs now.
+      //
+      Scheduler::Event ev;
+      ev.impl = event->event;
+      ev.key.m_ts = std::max (event->timestamp, m_currentTs);
+      ev.key.m_context = event->context;
+      ev.key.m_uid = m_uid;
+      m_uid++;
+      m_unscheduledEvents++;
+      m_events->Insert (ev);
+      delete event;
+    }
+}
+
 bool 
 RealtimeSimulatorImpl::IsFinished (void) const
 {
@@ -442,6 +492,7 @@ RealtimeSimulatorImpl::Run (void)
       {
         CriticalSection cs (m_mutex);
 
+        ProcessEventsWithContext ();
         if (!m_events->IsEmpty ())
           {
             process = true;
@@ -543,23 +594,38 @@ RealtimeSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay,
 {
   NS_LOG_FUNCTION (this << context << delay << impl);
 
+  if (m_running && !SystemThread::Equals (m_main))
+    {
+      //
+      // We're pacing and have a meaningful realtime clock.  Do not contend
+      // for the critical section with the main thread, push the event on the
+      // lock-free stack it drains before looking at the event list.
+      //
+      EventWithContext *ev = new EventWithContext;
+      ev->context = context;
+      ev->timestamp = m_synchronizer->GetCurrentRealtime () + delay.GetTimeStep ();
+      ev->event = impl;
+      ev->next = m_eventsWithContext.load (std::memory_order_relaxed);
+      while (!m_eventsWithContext.compare_exchange_weak (ev->next, ev,
+                                                         std::memory_order_release,
+                                                         std::memory_order_relaxed))
+        {
+        }
+      // The main thread was told when the stack became non-empty
+      if (ev->next == 0)
+        {
+          m_synchronizer->Signal ();
+        }
+      return;
+    }
+
   {
     CriticalSection cs (m_mutex);
-    uint64_t ts;
-
-    if (SystemThread::Equals (m_main))
-      {
-        ts = m_currentTs + delay.GetTimeStep ();
-      }
-    else
-      {
-        //
-        // If the simulator is running, we're pacing and have a meaningful 
-        // realtime clock.  If we're not, then m_currentTs is where we stopped.
-        // 
-        ts = m_running ? m_synchronizer->GetCurrentRealtime () : m_currentTs;
-        ts += delay.GetTimeStep ();
-      }
+    //
+    // In the main thread, or in another thread while the simulator is not
+    // running, m_currentTs is the current time or where we stopped.
+    //
+    uint64_t ts = m_currentTs + delay.GetTimeStep ();
 
     NS_ASSERT_MSG (ts >= m_currentTs, "RealtimeSimulatorImpl::ScheduleRealtime(): schedule for time < m_currentTs");
     Scheduler::Event ev;
@@ -32,6 +32,7 @@
 #include "system-mutex.h"
 
 #include <list>
+#include <atomic>
 
 /**
  * \file
@@ -172,6 +173,11 @@ private:
   uint64_t NextTs (void) const;
   /** Process the next event. */
   void ProcessOneEvent (void);
+  /**
+   * Move the events scheduled by other threads into the event list.
+   * Should be called with the critical section locked.
+   */
+  void ProcessEventsWithContext (void);
   /** Destructor implementation. */
   virtual void DoDispose (void);
 
@@ -182,7 +188,22 @@ private:
   /** Has the stopping condition been reached? */
   bool m_stop;
   /** Is the simulator currently running. */
-  bool m_running;
+  std::atomic<bool> m_running;
+
+  /** An event scheduled with a context by another thread. */
+  struct EventWithContext
+  {
+    uint32_t context;        //!< the event context
+    uint64_t timestamp;      //!< the event timestamp
+    EventImpl *event;        //!< the event implementation
+    EventWithContext *next;  //!< the event scheduled before this one
+  };
+  /**
+   * The events scheduled with a context by other threads while the
+   * simulator runs, a lock-free stack in reverse order of scheduling.
+   * Only the thread pushing on an empty stack signals the synchronizer.
+   */
+  std::atomic<EventWithContext *> m_eventsWithContext;
 
   /**
    * \name Mutex-protected variables.
@@ -0,0 +1,225 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "replication-runner.h"
+#include "checkpoint.h"
+#include "rng-seed-manager.h"
+#include "log.h"
+#include "assert.h"
+#include "abort.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * \file
+ * \ingroup simulator
+ * Implementation of class ns3::ReplicationRunner.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReplicationRunner");
+
+/** Whether the process runs a replication. */
+static bool g_replicationActive = false;
+/** The results recorded by the replication of the process. */
+static std::vector<std::pair<std::string, double> > g_replicationRecords;
+
+ReplicationRunner::ReplicationRunner ()
+  : m_firstRun (0),
+    m_firstRunSet (false)
+{
+  long cores = sysconf (_SC_NPROCESSORS_ONLN);
+  m_workers = cores > 0 ? cores : 1;
+}
+
+void
+ReplicationRunner::SetWorkers (uint32_t workers)
+{
+  NS_ASSERT (workers > 0);
+  m_workers = workers;
+}
+
+uint32_t
+ReplicationRunner::GetWorkers (void) const
+{
+  return m_workers;
+}
+
+void
+ReplicationRunner::SetFirstRun (uint64_t run)
+{
+  m_firstRun = run;
+  m_firstRunSet = true;
+}
+
+uint64_t
+ReplicationRunner::GetFirstRun (void) const
+{
+  return m_firstRunSet ? m_firstRun : RngSeedManager::GetRun ();
+}
+
+uint32_t
+ReplicationRunner::Run (uint32_t replications, Callback<void, uint64_t> replicate)
+{
+  NS_LOG_FUNCTION (this << replications << m_workers);
+  NS_ABORT_MSG_IF (g_replicationActive, "Replications can not be nested");
+
+  m_firstRun = GetFirstRun ();
+  m_firstRunSet = true;
+  m_status.clear ();
+  m_results.clear ();
+
+  // The replications append their results to a single file, one write each
+  std::FILE *results = std::tmpfile ();
+  NS_ABORT_MSG_IF (results == 0, "ReplicationRunner: can not create the results file: " << std::strerror (errno));
+  int fd = fileno (results);
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_APPEND);
+
+  uint32_t branch = Checkpoint::Branch (replications, m_workers);
+  if (branch != 0)
+    {
+      uint32_t replication = branch - 1;
+      uint64_t run = m_firstRun + replication;
+      NS_LOG_LOGIC ("Replication " << replication << " with run " << run);
+      RngSeedManager::SetRun (run);
+      g_replicationActive = true;
+      g_replicationRecords.clear ();
+
+      replicate (run);
+
+      std::ostringstream oss;
+      oss.precision (17);
+      for (std::vector<std::pair<std::string, double> >::const_iterator i = g_replicationRecords.begin ();
+           i != g_replicationRecords.end (); ++i)
+        {
+          oss << replication << '\t' << i->first << '\t' << i->second << '\n';
+        }
+      std::string buffer = oss.str ();
+      ssize_t written = write (fd, buffer.data (), buffer.size ());
+      std::cout.flush ();
+      std::cerr.flush ();
+      std::fflush (0);
+      // Leave the rest of the program to the calling process
+      _exit (written == static_cast<ssize_t> (buffer.size ()) ? 0 : 1);
+    }
+
+  uint32_t failed = 0;
+  m_status.resize (replications);
+  for (uint32_t i = 0; i < replications; i++)
+    {
+      m_status[i] = Checkpoint::GetExitStatus (i + 1);
+      if (m_status[i] != 0)
+        {
+          NS_LOG_WARN ("Replication " << i << " with run " << m_firstRun + i << " failed with status " << m_status[i]);
+          failed++;
+        }
+    }
+
+  // Lines are not bounded: the names of the results may be long
+  std::rewind (results);
+  std::string contents;
+  char chunk[4096];
+  std::size_t n;
+  while ((n = std::fread (chunk, 1, sizeof (chunk), results)) > 0)
+    {
+      contents.append (chunk, n);
+    }
+  std::istringstream lines (contents);
+  std::string line;
+  while (std::getline (lines, line))
+    {
+      std::string::size_type name = line.find ('\t');
+      std::string::size_type value = name != std::string::npos ? line.find ('\t', name + 1) : std::string::npos;
+      if (value == std::string::npos)
+        {
+          continue;
+        }
+      uint32_t replication = std::strtoul (line.c_str (), 0, 10);
+      if (replication < replications && m_status[replication] == 0)
+        {
+          m_results[line.substr (name + 1, value - name - 1)][replication] = std::strtod (line.c_str () + value + 1, 0);
+        }
+    }
+  std::fclose (results);
+  return failed;
+}
+
+void
+ReplicationRunner::Record (const std::string &name, double value)
+{
+  NS_LOG_FUNCTION (name << value);
+  NS_ASSERT_MSG (name.find_first_of ("\t\n") == std::string::npos, "Bad result name " << name);
+  if (g_replicationActive)
+    {
+      g_replicationRecords.push_back (std::make_pair (name, value));
+    }
+}
+
+uint32_t
+ReplicationRunner::GetReplications (void) const
+{
+  return m_status.size ();
+}
+
+uint64_t
+ReplicationRunner::GetRun (uint32_t replication) const
+{
+  return GetFirstRun () + replication;
+}
+
+int
+ReplicationRunner::GetExitStatus (uint32_t replication) const
+{
+  NS_ASSERT (replication < m_status.size ());
+  return m_status[replication];
+}
+
+std::vector<std::string>
+ReplicationRunner::GetNames (void) const
+{
+  std::vector<std::string> names;
+  for (std::map<std::string, std::map<uint32_t, double> >::const_iterator i = m_results.begin ();
+       i != m_results.end (); ++i)
+    {
+      names.push_back (i->first);
+    }
+  return names;
+}
+
+std::vector<double>
+ReplicationRunner::GetValues (const std::string &name) const
+{
+  std::vector<double> values;
+  std::map<std::string, std::map<uint32_t, double> >::const_iterator i = m_results.find (name);
+  if (i != m_results.end ())
+    {
+      for (std::map<uint32_t, double>::const_iterator j = i->second.begin (); j != i->second.end (); ++j)
+        {
+          values.push_back (j->second);
+        }
+    }
+  return values;
+}
+
+} // namespace ns3
@@ -27,6 +27,9 @@
 #include "assert.h"
 #include <stdint.h>
 #include <limits>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 /**
  * \file
@@ -100,7 +103,11 @@ public:
   inline void Ref (void) const
   {
     NS_ASSERT (m_count < std::numeric_limits<uint32_t>::max());
+#ifdef NS3_MTP
+    m_count.fetch_add (1, std::memory_order_relaxed);
+#else
     m_count++;
+#endif
   }
   /**
    * Decrement the reference count. This method should not be called
@@ -110,11 +117,18 @@ public:
    */
   inline void Unref (void) const
   {
+#ifdef NS3_MTP
+    if (m_count.fetch_sub (1, std::memory_order_acq_rel) == 1)
+      {
+        DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
+      }
+#else
     m_count--;
     if (m_count == 0)
       {
         DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
       }
+#endif
   }
 
   /**
@@ -138,9 +152,14 @@ private:
    *
    * \internal
    * Note we make this mutable so that the const methods can still
-   * change it.
+   * change it. With NS3_MTP, references may be taken and released by
+   * the threads of a MultithreadedSimulatorImpl, so the count is atomic.
    */
+#ifdef NS3_MTP
+  mutable std::atomic<uint32_t> m_count;
+#else
   mutable uint32_t m_count;
+#endif
 };
 
 } // namespace ns3
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/checkpoint.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+/**
+ * \ingroup tests
+ *
+ * \brief Check that the branches of a checkpoint continue its state
+ *
+ * The branches check their own state and report it through their exit
+ * status, the original process must be left unchanged by them. A child
+ * of the original process which is not a branch must be left for it to
+ * wait for.
+ */
+class CheckpointBranchTestCase : public TestCase
+{
+public:
+  CheckpointBranchTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /** Count an event */
+  void Count (void);
+  uint32_t m_count; //!< number of events run
+};
+
+CheckpointBranchTestCase::CheckpointBranchTestCase ()
+  : TestCase ("Check that the branches of a checkpoint continue the simulation")
+{
+}
+
+void
+CheckpointBranchTestCase::Count (void)
+{
+  m_count++;
+}
+
+void
+CheckpointBranchTestCase::DoRun (void)
+{
+  m_count = 0;
+  for (uint32_t i = 1; i <= 10; i++)
+    {
+      Simulator::Schedule (Seconds (i), &CheckpointBranchTestCase::Count, this);
+    }
+  Simulator::Stop (Seconds (5.5));
+  Simulator::Run ();
+
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+  rng->SetStream (1);
+  Ptr<UniformRandomVariable> reference = CreateObject<UniformRandomVariable> ();
+  reference->SetStream (1);
+  rng->GetValue ();
+  reference->GetValue ();
+
+  pid_t child = fork ();
+  if (child == 0)
+    {
+      _exit (7);
+    }
+
+  uint32_t branch = Checkpoint::Branch (4, 2);
+  if (branch != 0)
+    {
+      bool ok = Checkpoint::GetBranch () == branch
+        && m_count == 5
+        && Simulator::Now () == Seconds (5.5)
+        && rng->GetValue () == reference->GetValue ();
+      Simulator::Run ();
+      ok = ok && m_count == 10;
+      Simulator::Destroy ();
+      // Leave the test runner to the original process
+      _exit (ok ? 10 + branch : 1);
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (Checkpoint::GetBranch (), 0, "Not the original process");
+  int status = 0;
+  NS_TEST_EXPECT_MSG_EQ (waitpid (child, &status, 0), child, "The other child was reaped by the checkpoint");
+  NS_TEST_EXPECT_MSG_EQ (WEXITSTATUS (status), 7, "Bad status of the other child");
+  for (uint32_t i = 1; i <= 4; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (Checkpoint::GetExitStatus (i), static_cast<int> (10 + i), "Bad state in branch " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_count, 5, "The branches changed the original process");
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), Seconds (5.5), "The branches changed the original process");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_count, 10, "The original process did not continue");
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup tests
+ *
+ * \brief Checkpoint test suite
+ */
+class CheckpointTestSuite : public TestSuite
+{
+public:
+  CheckpointTestSuite ();
+};
+
+CheckpointTestSuite::CheckpointTestSuite ()
+  : TestSuite ("checkpoint", UNIT)
+{
+  AddTestCase (new CheckpointBranchTestCase, TestCase::QUICK);
+}
+
+static CheckpointTestSuite g_checkpointTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/per-thread.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace ns3;
+
+namespace {
+
+/** Number of objects created, by all the threads */
+std::atomic<uint32_t> g_created (0);
+/** Number of objects released, by all the threads */
+std::atomic<uint32_t> g_released (0);
+
+/**
+ * \ingroup tests
+ * An object of each thread, counting its creations and releases.
+ */
+struct Counted
+{
+  FreeList free;  //!< a free list, left full at exit
+
+  /** \returns a new object */
+  static Counted *Create (void)
+  {
+    g_created++;
+    return new Counted ();
+  }
+  /**
+   * Delete an object
+   * \param object the object
+   */
+  static void Release (Counted *object)
+  {
+    g_released++;
+    void *block;
+    while ((block = object->free.Pop ()) != 0)
+      {
+        ::operator delete (block);
+      }
+    delete object;
+  }
+};
+
+} // unnamed namespace
+
+/**
+ * \ingroup tests
+ *
+ * \brief Check that each thread gets its own object, released when the
+ * thread exits
+ */
+class PerThreadTestCase : public TestCase
+{
+public:
+  PerThreadTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /** Use the object of a thread, and a free list */
+  static void UseObject (void);
+  static std::atomic<bool> g_ok; //!< whether the threads found what they expected
+};
+
+std::atomic<bool> PerThreadTestCase::g_ok (true);
+
+PerThreadTestCase::PerThreadTestCase ()
+  : TestCase ("Check that each thread gets its own object, released at exit")
+{
+}
+
+void
+PerThreadTestCase::UseObject (void)
+{
+  bool ok = PerThread<Counted>::Peek () == 0 && !PerThread<Counted>::IsReleased ();
+  Counted *object = PerThread<Counted>::Get ();
+  ok = ok && object != 0 && PerThread<Counted>::Get () == object && PerThread<Counted>::Peek () == object;
+
+  void *a = ::operator new (16);
+  void *b = ::operator new (16);
+  void *c = ::operator new (16);
+  ok = ok && object->free.IsEmpty () && object->free.Pop () == 0;
+  ok = ok && object->free.Push (a, 2) && object->free.Push (b, 2) && !object->free.Push (c, 2);
+  ok = ok && object->free.Pop () == b && !object->free.IsEmpty ();
+  ok = ok && object->free.Push (b, 2);
+  ::operator delete (c);
+  if (!ok)
+    {
+      g_ok = false;
+    }
+}
+
+void
+PerThreadTestCase::DoRun (void)
+{
+  g_created = 0;
+  g_released = 0;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      std::thread thread (&PerThreadTestCase::UseObject);
+      thread.join ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (g_ok.load (), true, "Wrong object or free list in a thread");
+  NS_TEST_EXPECT_MSG_EQ (g_created.load (), 3, "Not one object per thread");
+  NS_TEST_EXPECT_MSG_EQ (g_released.load (), 3, "The objects were not released with their threads");
+  NS_TEST_EXPECT_MSG_EQ ((PerThread<Counted>::Peek () == 0), true, "The threads created the object of this thread");
+}
+
+/**
+ * \ingroup tests
+ *
+ * \brief PerThread test suite
+ */
+class PerThreadTestSuite : public TestSuite
+{
+public:
+  PerThreadTestSuite ();
+};
+
+PerThreadTestSuite::PerThreadTestSuite ()
+  : TestSuite ("per-thread", UNIT)
+{
+  AddTestCase (new PerThreadTestCase, TestCase::QUICK);
+}
+
+static PerThreadTestSuite g_perThreadTestSuite; //!< Static variable for test initialization
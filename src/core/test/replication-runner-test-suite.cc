@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/replication-runner.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <unistd.h>
+
+using namespace ns3;
+
+/**
+ * \ingroup tests
+ *
+ * \brief Check the run numbers and the results of the replications
+ */
+class ReplicationRunnerTestCase : public TestCase
+{
+public:
+  ReplicationRunnerTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * A replication drawing a random number at the end of a simulation
+   * \param run the run number
+   */
+  void Replicate (uint64_t run);
+  /** Draw a random number */
+  void Draw (void);
+  Ptr<UniformRandomVariable> m_rng; //!< the random variable
+  double m_value;                   //!< the value drawn
+};
+
+ReplicationRunnerTestCase::ReplicationRunnerTestCase ()
+  : TestCase ("Check the run numbers and the results of the replications")
+{
+}
+
+void
+ReplicationRunnerTestCase::Draw (void)
+{
+  m_value = m_rng->GetValue ();
+}
+
+void
+ReplicationRunnerTestCase::Replicate (uint64_t run)
+{
+  if (run == 13)
+    {
+      // A failed replication
+      _exit (3);
+    }
+  m_rng = CreateObject<UniformRandomVariable> ();
+  m_rng->SetStream (7);
+  Simulator::Schedule (Seconds (1), &ReplicationRunnerTestCase::Draw, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  ReplicationRunner::Record ("run", run);
+  ReplicationRunner::Record ("value", m_value);
+  // A name longer than any fixed line buffer
+  ReplicationRunner::Record (std::string (4000, 'n'), run);
+}
+
+void
+ReplicationRunnerTestCase::DoRun (void)
+{
+  uint64_t run = RngSeedManager::GetRun ();
+
+  ReplicationRunner runner;
+  runner.SetWorkers (3);
+  runner.SetFirstRun (10);
+  uint32_t failed = runner.Run (6, MakeCallback (&ReplicationRunnerTestCase::Replicate, this));
+
+  NS_TEST_EXPECT_MSG_EQ (failed, 1, "Wrong number of failed replications");
+  NS_TEST_EXPECT_MSG_EQ (runner.GetReplications (), 6, "Wrong number of replications");
+  NS_TEST_EXPECT_MSG_EQ (runner.GetExitStatus (3), 3, "Wrong exit status");
+  NS_TEST_EXPECT_MSG_EQ (RngSeedManager::GetRun (), run, "The run number of the calling process changed");
+  NS_TEST_ASSERT_MSG_EQ (runner.GetNames ().size (), 3, "Wrong number of results");
+  bool longName = runner.GetValues (std::string (4000, 'n')) == runner.GetValues ("run");
+  NS_TEST_EXPECT_MSG_EQ (longName, true, "Wrong results with a long name");
+
+  std::vector<double> runs = runner.GetValues ("run");
+  std::vector<double> values = runner.GetValues ("value");
+  NS_TEST_ASSERT_MSG_EQ (runs.size (), 5, "Wrong number of results");
+  NS_TEST_ASSERT_MSG_EQ (values.size (), 5, "Wrong number of results");
+  for (uint32_t i = 0; i < runs.size (); i++)
+    {
+      uint64_t expected = 10 + i + (i >= 3 ? 1 : 0);
+      NS_TEST_EXPECT_MSG_EQ (runs[i], expected, "Wrong run number");
+
+      // The same draw in the calling process
+      RngSeedManager::SetRun (expected);
+      m_rng = CreateObject<UniformRandomVariable> ();
+      m_rng->SetStream (7);
+      NS_TEST_EXPECT_MSG_EQ (values[i], m_rng->GetValue (), "Wrong value for run " << expected);
+    }
+  RngSeedManager::SetRun (run);
+  m_rng = 0;
+}
+
+/**
+ * \ingroup tests
+ *
+ * \brief ReplicationRunner test suite
+ */
+class ReplicationRunnerTestSuite : public TestSuite
+{
+public:
+  ReplicationRunnerTestSuite ();
+};
+
+ReplicationRunnerTestSuite::ReplicationRunnerTestSuite ()
+  : TestSuite ("replication-runner", UNIT)
+{
+  AddTestCase (new ReplicationRunnerTestCase, TestCase::QUICK);
+}
+
+static ReplicationRunnerTestSuite g_replicationRunnerTestSuite; //!< Static variable for test initialization
@@ -23,6 +23,14 @@
 #include "ns3/heap-scheduler.h"
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
+#include "ns3/dary-heap-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/make-event.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
+#include <vector>
+#include <algorithm>
 
 using namespace ns3;
 
@@ -459,6 +467,169 @@ SimulatorTemplateTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+  ObjectFactory m_schedulerFactory;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check the order of the events and Remove in " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+static bool
+IsEventBefore (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key < b.key;
+}
+
+void
+SchedulerOrderTestCase::DoRun (void)
+{
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  std::vector<Scheduler::Event> events;
+  // many timestamps are shared, to check the order of the uids
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      Scheduler::Event ev;
+      ev.impl = MakeEvent (&foo0);
+      ev.key.m_ts = (i * 7919) % 500;
+      ev.key.m_uid = i + 4;
+      ev.key.m_context = i;
+      scheduler->Insert (ev);
+      events.push_back (ev);
+    }
+  // remove two events out of three, including the first and the last ones
+  std::vector<Scheduler::Event> expected;
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      if (i % 3 != 1)
+        {
+          scheduler->Remove (events[i]);
+          events[i].impl->Unref ();
+        }
+      else
+        {
+          expected.push_back (events[i]);
+        }
+    }
+  std::sort (expected.begin (), expected.end (), &IsEventBefore);
+  for (uint32_t i = 0; i < expected.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), false, "Missing events");
+      NS_TEST_EXPECT_MSG_EQ (scheduler->PeekNext ().key.m_uid, expected[i].key.m_uid, "Bad next event");
+      Scheduler::Event next = scheduler->RemoveNext ();
+      NS_TEST_EXPECT_MSG_EQ (next.key.m_uid, expected[i].key.m_uid, "Bad event order");
+      NS_TEST_EXPECT_MSG_EQ (next.key.m_ts, expected[i].key.m_ts, "Bad event time stamp");
+      NS_TEST_EXPECT_MSG_EQ (next.key.m_context, expected[i].key.m_context, "Bad event context");
+      NS_TEST_EXPECT_MSG_EQ (next.impl, expected[i].impl, "Bad event");
+      next.impl->Unref ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (scheduler->IsEmpty (), true, "Too many events");
+}
+
+class EventPoolTestCase : public TestCase
+{
+public:
+  EventPoolTestCase ();
+  virtual void DoRun (void);
+};
+
+EventPoolTestCase::EventPoolTestCase ()
+  : TestCase ("Check that the memory of the events is recycled")
+{
+}
+
+void
+EventPoolTestCase::DoRun (void)
+{
+  BooleanValue enabled;
+  GlobalValue::GetValueByName ("EventImplPool", enabled);
+
+  EventImpl *a = MakeEvent (&foo0);
+  EventImpl *b = MakeEvent (&foo5, 1, 2, 3, 4, 5);
+  void *freed = a;
+  a->Unref ();
+  EventImpl *c = MakeEvent (&foo0);
+  if (enabled.Get ())
+    {
+      NS_TEST_EXPECT_MSG_EQ (c, freed, "The memory of the event was not recycled");
+    }
+  NS_TEST_EXPECT_MSG_NE (c, b, "Events share their memory");
+  c->Invoke ();
+  b->Invoke ();
+  c->Unref ();
+  b->Unref ();
+}
+
+class LadderSchedulerSkewTestCase : public TestCase
+{
+public:
+  LadderSchedulerSkewTestCase ();
+  virtual void DoRun (void);
+};
+
+LadderSchedulerSkewTestCase::LadderSchedulerSkewTestCase ()
+  : TestCase ("Check the LadderScheduler with events 1 ms and 100 s apart")
+{
+}
+
+void
+LadderSchedulerSkewTestCase::DoRun (void)
+{
+  Ptr<LadderScheduler> scheduler = CreateObject<LadderScheduler> ();
+  uint32_t uid = 4;
+  uint32_t count = 0;
+  // 1000 flows of 1 ms periodic events and 1000 timers of about 100 s
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      Scheduler::Event ev;
+      ev.impl = MakeEvent (&foo0);
+      ev.key.m_ts = i < 1000 ? 1000000 + i : 100000000000ULL + i * 7919;
+      ev.key.m_uid = uid++;
+      ev.key.m_context = i;
+      scheduler->Insert (ev);
+      count++;
+    }
+  Scheduler::EventKey last = { 0, 0, 0};
+  bool ordered = true;
+  uint32_t maxBottom = 0;
+  for (uint32_t i = 0; i < 200000; i++)
+    {
+      Scheduler::Event ev = scheduler->RemoveNext ();
+      ordered &= last < ev.key;
+      last = ev.key;
+      maxBottom = std::max (maxBottom, scheduler->GetBottomSize ());
+      // the periodic events are rescheduled, the timers are restarted
+      ev.key.m_ts += ev.key.m_context < 1000 ? 1000000 : 100000000000ULL;
+      ev.key.m_uid = uid++;
+      scheduler->Insert (ev);
+
+      UintegerValue top, ladder, bottom;
+      scheduler->GetAttribute ("TopSize", top);
+      scheduler->GetAttribute ("LadderSize", ladder);
+      scheduler->GetAttribute ("BottomSize", bottom);
+      if (top.Get () + ladder.Get () + bottom.Get () != count)
+        {
+          NS_TEST_ASSERT_MSG_EQ (top.Get () + ladder.Get () + bottom.Get (), count, "Events lost in the queue");
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (ordered, true, "Bad event order");
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (scheduler->GetMaxRungsUsed (), 8, "Too many rungs");
+  NS_TEST_EXPECT_MSG_GT (scheduler->GetNTransfers (), 0, "The Top was never transferred");
+  // the 1 ms events must not pile up in the Bottom behind the 100 s timers
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (maxBottom, 1000, "The Bottom is not refined");
+  while (!scheduler->IsEmpty ())
+    {
+      scheduler->RemoveNext ().impl->Unref ();
+    }
+}
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -475,5 +646,31 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (DaryHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.Set ("Arity", UintegerValue (2));
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.Set ("Arity", UintegerValue (8));
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory = ObjectFactory ();
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (ListScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (CalendarScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (DaryHeapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.Set ("Threshold", UintegerValue (4));
+    factory.Set ("MaxRungs", UintegerValue (3));
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    AddTestCase (new LadderSchedulerSkewTestCase (), TestCase::QUICK);
+    AddTestCase (new EventPoolTestCase (), TestCase::QUICK);
   }
 } g_simulatorTestSuite;
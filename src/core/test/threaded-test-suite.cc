@@ -26,10 +26,15 @@
 #include "ns3/config.h"
 #include "ns3/string.h"
 #include "ns3/system-thread.h"
+#include "ns3/global-value.h"
+#include "ns3/boolean.h"
+#include "ns3/make-event.h"
 
 #include <ctime>
 #include <list>
+#include <set>
 #include <utility>
+#include <vector>
 
 using namespace ns3;
 
@@ -225,6 +230,161 @@ ThreadedSimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_a, m_d, "Bad scheduling");
 }
 
+static void
+EventPoolNothing (void)
+{
+}
+
+class EventPoolThreadTestCase : public TestCase
+{
+public:
+  EventPoolThreadTestCase ();
+  virtual void DoRun (void);
+  void CreateEvents (void);
+  std::vector<EventImpl *> m_events;
+};
+
+EventPoolThreadTestCase::EventPoolThreadTestCase ()
+  : TestCase ("Check that events created by a thread are recycled by the thread destroying them")
+{
+}
+
+void
+EventPoolThreadTestCase::CreateEvents (void)
+{
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      m_events.push_back (MakeEvent (&EventPoolNothing));
+    }
+}
+
+void
+EventPoolThreadTestCase::DoRun (void)
+{
+  Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&EventPoolThreadTestCase::CreateEvents, this));
+  thread->Start ();
+  thread->Join ();
+  NS_TEST_ASSERT_MSG_EQ (m_events.size (), 100, "The thread did not create the events");
+
+  std::set<EventImpl *> freed;
+  for (uint32_t i = 0; i < m_events.size (); i++)
+    {
+      freed.insert (m_events[i]);
+      m_events[i]->Unref ();
+    }
+  m_events.clear ();
+
+  BooleanValue enabled;
+  GlobalValue::GetValueByName ("EventImplPool", enabled);
+  uint32_t recycled = 0;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      EventImpl *event = MakeEvent (&EventPoolNothing);
+      recycled += freed.count (event);
+      event->Invoke ();
+      m_events.push_back (event);
+    }
+  for (uint32_t i = 0; i < m_events.size (); i++)
+    {
+      m_events[i]->Unref ();
+    }
+  m_events.clear ();
+  if (enabled.Get ())
+    {
+      NS_TEST_EXPECT_MSG_EQ (recycled, 100, "The memory of the events was not recycled");
+    }
+}
+
+class ThreadedScheduleOrderTestCase : public TestCase
+{
+public:
+  ThreadedScheduleOrderTestCase (const std::string &simulatorType);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+  static void Schedule (std::pair<ThreadedScheduleOrderTestCase *, uint32_t> context);
+  void Receive (uint32_t threadno, uint32_t seq);
+  void KeepAlive (void);
+  std::string m_simulatorType;
+  std::vector<uint32_t> m_next;
+  uint32_t m_received;
+  bool m_ordered;
+};
+
+static const uint32_t ORDER_THREADS = 4;
+static const uint32_t ORDER_EVENTS = 20000;
+
+ThreadedScheduleOrderTestCase::ThreadedScheduleOrderTestCase (const std::string &simulatorType)
+  : TestCase ("Check that the events scheduled by a thread run in order in " + simulatorType),
+    m_simulatorType (simulatorType)
+{
+}
+
+void
+ThreadedScheduleOrderTestCase::Schedule (std::pair<ThreadedScheduleOrderTestCase *, uint32_t> context)
+{
+  for (uint32_t i = 0; i < ORDER_EVENTS; i++)
+    {
+      Simulator::ScheduleWithContext (context.second, Seconds (0),
+                                      &ThreadedScheduleOrderTestCase::Receive, context.first, context.second, i);
+    }
+}
+
+void
+ThreadedScheduleOrderTestCase::Receive (uint32_t threadno, uint32_t seq)
+{
+  if (seq != m_next[threadno] || Simulator::GetContext () != threadno)
+    {
+      m_ordered = false;
+    }
+  m_next[threadno] = seq + 1;
+  if (++m_received == ORDER_THREADS * ORDER_EVENTS)
+    {
+      Simulator::Stop ();
+    }
+}
+
+void
+ThreadedScheduleOrderTestCase::KeepAlive (void)
+{
+  Simulator::Schedule (MicroSeconds (10), &ThreadedScheduleOrderTestCase::KeepAlive, this);
+}
+
+void
+ThreadedScheduleOrderTestCase::DoRun (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue (m_simulatorType));
+  m_next.assign (ORDER_THREADS, 0);
+  m_received = 0;
+  m_ordered = true;
+
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < ORDER_THREADS; i++)
+    {
+      threads.push_back (Create<SystemThread> (MakeBoundCallback (&ThreadedScheduleOrderTestCase::Schedule,
+                                                           std::pair<ThreadedScheduleOrderTestCase *, uint32_t> (this, i))));
+    }
+  Simulator::Schedule (MicroSeconds (10), &ThreadedScheduleOrderTestCase::KeepAlive, this);
+  for (uint32_t i = 0; i < ORDER_THREADS; i++)
+    {
+      threads[i]->Start ();
+    }
+  Simulator::Run ();
+  for (uint32_t i = 0; i < ORDER_THREADS; i++)
+    {
+      threads[i]->Join ();
+    }
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_received, ORDER_THREADS * ORDER_EVENTS, "Events lost");
+  NS_TEST_EXPECT_MSG_EQ (m_ordered, true, "The events of a thread did not run in order");
+}
+
+void
+ThreadedScheduleOrderTestCase::DoTeardown (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
 class ThreadedSimulatorTestSuite : public TestSuite
 {
 public:
@@ -241,7 +401,9 @@ public:
       "ns3::ListScheduler",
       "ns3::HeapScheduler",
       "ns3::MapScheduler",
-      "ns3::CalendarScheduler"
+      "ns3::CalendarScheduler",
+      "ns3::DaryHeapScheduler",
+      "ns3::LadderScheduler"
     };
     unsigned int threadcounts[] = {
       0,
@@ -262,5 +424,10 @@ public:
               }
           }
       }
+    for (unsigned int i=0; i < (sizeof(simulatorTypes) / sizeof(simulatorTypes[0])); ++i) 
+      {
+        AddTestCase (new ThreadedScheduleOrderTestCase (simulatorTypes[i]), TestCase::QUICK);
+      }
+    AddTestCase (new EventPoolThreadTestCase (), TestCase::QUICK);
   }
 } g_threadedSimulatorTestSuite;
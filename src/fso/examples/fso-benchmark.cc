@@ -0,0 +1,291 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/laser-antenna-model.h"
+#include "ns3/optical-rx-antenna-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/fso-channel.h"
+#include "ns3/fso-phy.h"
+#include "ns3/fso-error-model.h"
+#include "ns3/fso-stage-timer.h"
+#include "ns3/fso-free-space-loss-model.h"
+#include "ns3/fso-down-link-scintillation-index-model.h"
+#include "ns3/fso-mean-irradiance-model.h"
+
+using namespace ns3;
+
+// Micro-benchmark of the transmission path of the fso module
+//
+// A satellite sends back to back packets to a number of ground stations.
+// Each packet goes through FsoPhy::Transmit, FsoChannel::Send (loss models
+// and scheduling of the receptions), FsoPhy::Receive and the packet success
+// rate of the FsoDownLinkErrorModel of each receiver. For each receiver count
+// and bit rate, the benchmark reports the simulated events per second of wall
+// clock time, the mean time of each stage (see FsoStageTimer) and the number
+// of heap allocations per transmitted packet.
+//
+// ./waf --run "fso-benchmark --receivers=1,10,100 --bitRates=1e6,1e9 --packets=1000"
+
+#define LOG(x)   std::cout << x << std::endl
+
+// Heap allocations, counted by the replacement operator new below
+static std::atomic<uint64_t> g_allocations (0);
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+/**
+ * \param list a comma separated list of values
+ * \return the values
+ */
+static std::vector<double>
+ParseList (const std::string &list)
+{
+  std::vector<double> values;
+  std::istringstream iss (list);
+  std::string item;
+  while (std::getline (iss, item, ','))
+    {
+      if (!item.empty ())
+        {
+          values.push_back (std::atof (item.c_str ()));
+        }
+    }
+  return values;
+}
+
+/**
+ * Sends the packets back to back from the transmitter
+ */
+class FsoBenchmarkSender
+{
+public:
+  /**
+   * \param phy the transmitter
+   * \param size the packet size (bytes)
+   * \param packets the number of packets to send
+   */
+  FsoBenchmarkSender (Ptr<FsoPhy> phy, uint32_t size, uint32_t packets)
+    : m_phy (phy),
+      m_packet (Create<Packet> (size)),
+      m_remaining (packets)
+  {
+    //The Phy is idle again one time step after the end of the transmission
+    m_interval = Seconds (size*8/phy->GetBitRate ()) + NanoSeconds (1);
+  }
+
+  /**
+   * Send a packet and schedule the next one
+   */
+  void Send ()
+  {
+    m_phy->Transmit (m_packet);
+    if (--m_remaining > 0)
+      {
+        Simulator::Schedule (m_interval, &FsoBenchmarkSender::Send, this);
+      }
+  }
+
+private:
+  Ptr<FsoPhy> m_phy;       //!< the transmitter
+  Ptr<Packet> m_packet;    //!< the packet sent
+  uint32_t m_remaining;    //!< packets left to send
+  Time m_interval;         //!< time between the start of two packets
+};
+
+/**
+ * Run a configuration of the benchmark and print its results
+ *
+ * \param receivers the number of ground stations
+ * \param bitRate the bit rate (bps)
+ * \param packets the number of packets sent
+ * \param size the packet size (bytes)
+ */
+static void
+RunBenchmark (uint32_t receivers, double bitRate, uint32_t packets, uint32_t size)
+{
+  Ptr<FsoChannel> channel = CreateObject<FsoChannel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+
+  Ptr<FsoFreeSpaceLossModel> freeSpaceLoss = CreateObject<FsoFreeSpaceLossModel> ();
+  Ptr<FsoDownLinkScintillationIndexModel> scintIndexModel = CreateObject<FsoDownLinkScintillationIndexModel> ();
+  scintIndexModel->SetRmsWindSpeed (21.0);
+  scintIndexModel->SetGndRefractiveIdx (1.7e-14);
+  freeSpaceLoss->SetNext (scintIndexModel);
+  scintIndexModel->SetNext (CreateObject<FsoMeanIrradianceModel> ());
+  channel->AddFsoPropagationLossModel (freeSpaceLoss);
+
+  Ptr<MobilityModel> txMobility = CreateObject<ConstantPositionMobilityModel> ();
+  txMobility->SetPosition (Vector (0.0, 0.0, 707000));
+  Ptr<LaserAntennaModel> laser = CreateObject<LaserAntennaModel> ();
+  laser->SetBeamwidth (0.06);
+  laser->SetTxPower (-10.0);
+  laser->SetGain (116.0);
+  laser->SetWavelength (847e-9);
+
+  Ptr<FsoPhy> txPhy = CreateObject<FsoPhy> ();
+  txPhy->SetMobility (txMobility);
+  txPhy->SetChannel (channel);
+  txPhy->SetAntennas (laser, 0);
+  txPhy->SetBitRate (bitRate);
+  txPhy->SetStageTimersEnabled (true);
+  channel->Add (txPhy);
+
+  std::vector<Ptr<FsoPhy> > rxPhys;
+  for (uint32_t i = 0; i < receivers; i++)
+    {
+      //Ground stations 10 meters apart
+      Ptr<MobilityModel> rxMobility = CreateObject<ConstantPositionMobilityModel> ();
+      rxMobility->SetPosition (Vector (10.0*i, 0.0, 0.0));
+      Ptr<OpticalRxAntennaModel> antenna = CreateObject<OpticalRxAntennaModel> ();
+      antenna->SetAttribute ("ReceiverGain", DoubleValue (121.4));
+      antenna->SetAttribute ("ApertureDiameter", DoubleValue (0.318));
+
+      Ptr<FsoDownLinkErrorModel> errorModel = CreateObject<FsoDownLinkErrorModel> ();
+      Ptr<FsoPhy> rxPhy = CreateObject<FsoPhy> ();
+      rxPhy->SetMobility (rxMobility);
+      rxPhy->SetChannel (channel);
+      rxPhy->SetAntennas (0, antenna);
+      rxPhy->SetErrorModel (errorModel);
+      rxPhy->SetBitRate (bitRate);
+      rxPhy->SetErrorMode (FsoPhy::ERROR_PER_PACKET);
+      rxPhy->SetStageTimersEnabled (true);
+      errorModel->SetPhy (rxPhy);
+      channel->Add (rxPhy);
+      rxPhys.push_back (rxPhy);
+    }
+
+  FsoBenchmarkSender sender (txPhy, size, packets);
+  Simulator::Schedule (Seconds (1.0), &FsoBenchmarkSender::Send, &sender);
+
+  uint64_t allocations = g_allocations.load ();
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  int64_t elapsed = clock.End ();
+  allocations = g_allocations.load () - allocations;
+
+  //One send and one end of transmission per packet, plus the receptions
+  double events = static_cast<double> (packets)*(2 + receivers);
+  FsoStageTimer &txTimer = txPhy->GetStageTimer ();
+  uint64_t rxTotal = 0;
+  uint64_t rxCount = 0;
+  uint64_t errTotal = 0;
+  uint64_t errCount = 0;
+  for (std::vector<Ptr<FsoPhy> >::const_iterator i = rxPhys.begin (); i != rxPhys.end (); i++)
+    {
+      FsoStageTimer &rxTimer = (*i)->GetStageTimer ();
+      rxTotal += rxTimer.GetTotal (FsoStageTimer::RECEIVE);
+      rxCount += rxTimer.GetCount (FsoStageTimer::RECEIVE);
+      errTotal += rxTimer.GetTotal (FsoStageTimer::ERROR_MODEL);
+      errCount += rxTimer.GetCount (FsoStageTimer::ERROR_MODEL);
+    }
+
+  LOG (std::setw (9) << receivers
+       << std::setw (12) << bitRate
+       << std::setw (14) << (elapsed > 0 ? events*1000/elapsed : 0.0)
+       << std::setw (12) << txTimer.GetMean (FsoStageTimer::TRANSMIT)
+       << std::setw (12) << txTimer.GetMean (FsoStageTimer::LOSS_CHAIN)
+       << std::setw (12) << txTimer.GetMean (FsoStageTimer::SCHEDULE)
+       << std::setw (12) << (rxCount > 0 ? static_cast<double> (rxTotal)/rxCount : 0.0)
+       << std::setw (12) << (errCount > 0 ? static_cast<double> (errTotal)/errCount : 0.0)
+       << std::setw (12) << static_cast<double> (allocations)/packets);
+
+  Simulator::Destroy ();
+  //Break the reference cycles between the channel and the Phys
+  channel->Dispose ();
+  txPhy->Dispose ();
+  for (std::vector<Ptr<FsoPhy> >::const_iterator i = rxPhys.begin (); i != rxPhys.end (); i++)
+    {
+      (*i)->Dispose ();
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string receivers = "1,10,100";
+  std::string bitRates = "1e6,49.3724e6,1e9";
+  uint32_t packets = 1000;
+  uint32_t size = 1024;
+  uint32_t threads = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("receivers", "Comma separated receiver counts", receivers);
+  cmd.AddValue ("bitRates", "Comma separated bit rates (bps)", bitRates);
+  cmd.AddValue ("packets", "Number of packets sent per configuration", packets);
+  cmd.AddValue ("size", "Packet size (bytes)", size);
+  cmd.AddValue ("threads", "Threads evaluating the propagation loss models", threads);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::FsoChannel::LossEvaluationThreads", UintegerValue (threads));
+
+  LOG ("packets: " << packets << ", size: " << size << " bytes, loss threads: " << threads);
+  LOG ("Mean stage times in ns, per transmission (tx stages) or per received packet (rx stages)");
+  LOG (std::setw (9) << "receivers"
+       << std::setw (12) << "bit rate"
+       << std::setw (14) << "events/s"
+       << std::setw (12) << "transmit"
+       << std::setw (12) << "loss chain"
+       << std::setw (12) << "schedule"
+       << std::setw (12) << "receive"
+       << std::setw (12) << "error model"
+       << std::setw (12) << "allocs/pkt");
+
+  std::vector<double> receiverCounts = ParseList (receivers);
+  std::vector<double> rates = ParseList (bitRates);
+  for (std::vector<double>::const_iterator r = receiverCounts.begin (); r != receiverCounts.end (); r++)
+    {
+      for (std::vector<double>::const_iterator b = rates.begin (); b != rates.end (); b++)
+        {
+          RunBenchmark (static_cast<uint32_t> (*r), *b, packets, size);
+        }
+    }
+  return 0;
+}
@@ -27,10 +27,13 @@
 #include "ns3/node.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
 #include "ns3/object-factory.h"
 #include "fso-channel.h"
 #include "ns3/propagation-delay-model.h"
 #include <cstdlib>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -53,11 +56,34 @@ FsoChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&FsoChannel::m_loss),
                    MakePointerChecker<FsoPropagationLossModel> ())
+    .AddAttribute ("LossEvaluationThreads",
+                   "The number of threads, including the simulator thread, evaluating the propagation "
+                   "loss models of the receivers of a transmission. 1 evaluates them serially. "
+                   "The loss and mobility models must support concurrent evaluation.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&FsoChannel::m_lossThreads),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ParallelThreshold",
+                   "The minimum number of receivers for which the propagation loss models are evaluated in parallel.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&FsoChannel::m_parallelThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SpatialIndexCellSize",
+                   "The edge (meters) of the cells of the spatial index used to find the receivers "
+                   "illuminated by pointed lasers, 0 scans every receiver.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoChannel::SetSpatialIndexCellSize,
+                                       &FsoChannel::GetSpatialIndexCellSize),
+                   MakeDoubleChecker<double> (0.0))
   ;
   return tid;
 }
 
 FsoChannel::FsoChannel ()
+  : m_lossThreads (1),
+    m_parallelThreshold (16),
+    m_indexCellSize (0.0),
+    m_indexValid (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -68,6 +94,25 @@ FsoChannel::~FsoChannel ()
   m_phyList.clear ();
 }
 
+void
+FsoChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_pool = 0;
+  m_rxJobs.clear ();
+  for (std::map<const MobilityModel *, Ptr<MobilityModel> >::iterator it = m_tracked.begin (); it != m_tracked.end (); ++it)
+    {
+      it->second->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&FsoChannel::NotifyCourseChange, this));
+    }
+  m_tracked.clear ();
+  m_index.Clear ();
+  m_indexValid = false;
+  m_phyList.clear ();
+  m_loss = 0;
+  m_delay = 0;
+  Channel::DoDispose ();
+}
+
 void
 FsoChannel::AddFsoPropagationLossModel (Ptr<FsoPropagationLossModel> loss)
 {
@@ -85,41 +130,240 @@ FsoChannel::SetPropagationDelayModel (Ptr<PropagationDelayModel> delay)
 void
 FsoChannel::Send (Ptr<FsoPhy> sender, Ptr<const Packet> packet,
                        Ptr<FsoSignalParameters> fsoSignalParams, Time duration)
+{
+  FsoStageTimer &timer = sender->GetStageTimer ();
+  uint64_t start = timer.Start ();
+  PrepareReceivers (sender, fsoSignalParams);
+  timer.Stop (FsoStageTimer::LOSS_CHAIN, start);
+
+  start = timer.Start ();
+  for (std::vector<RxJob>::const_iterator i = m_rxJobs.begin (); i != m_rxJobs.end (); i++)
+    {
+      Ptr<Packet> copy = packet->Copy ();
+      NS_LOG_DEBUG ("Scheduling Packet: " << packet->GetSize() << " bytes");
+      Simulator::ScheduleWithContext (GetReceiverContext (i->phy),
+                                      i->delay, &FsoPhy::Receive, i->phy,
+                                      copy, i->params);
+    }
+  timer.Stop (FsoStageTimer::SCHEDULE, start);
+
+  m_rxJobs.clear ();
+  m_senderMobility = 0;
+}
+
+void
+FsoChannel::SendBurst (Ptr<FsoPhy> sender, Ptr<const PacketBurst> burst,
+                       Ptr<FsoSignalParameters> fsoSignalParams, Time duration)
+{
+  FsoStageTimer &timer = sender->GetStageTimer ();
+  uint64_t start = timer.Start ();
+  PrepareReceivers (sender, fsoSignalParams);
+  timer.Stop (FsoStageTimer::LOSS_CHAIN, start);
+
+  start = timer.Start ();
+  for (std::vector<RxJob>::const_iterator i = m_rxJobs.begin (); i != m_rxJobs.end (); i++)
+    {
+      Ptr<PacketBurst> copy = burst->Copy ();
+      NS_LOG_DEBUG ("Scheduling Burst: " << burst->GetNPackets () << " packets, " << burst->GetSize () << " bytes");
+      Simulator::ScheduleWithContext (GetReceiverContext (i->phy),
+                                      i->delay, &FsoPhy::ReceiveBurst, i->phy,
+                                      copy, i->params);
+    }
+  timer.Stop (FsoStageTimer::SCHEDULE, start);
+
+  m_rxJobs.clear ();
+  m_senderMobility = 0;
+}
+
+void
+FsoChannel::PrepareReceivers (Ptr<FsoPhy> sender, Ptr<FsoSignalParameters> fsoSignalParams)
 {
   Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
   NS_ASSERT (senderMobility != 0);
-  uint32_t j = 0;
-  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
+  m_senderMobility = senderMobility;
+  Vector txPosition = senderMobility->GetPosition ();
+  m_senderPosition = txPosition;
+
+  //Only pointed lasers restrict the receivers
+  bool pointed = sender->GetNTxAntennas () > 0;
+  for (uint32_t b = 0; b < sender->GetNTxAntennas (); b++)
+    {
+      pointed = pointed && sender->GetTxAntenna (b)->IsPointed ();
+    }
+  if (pointed)
+    {
+      FindCandidates (sender, txPosition);
+    }
+  uint32_t n = pointed ? m_candidates.size () : m_phyList.size ();
+
+  bool parallel = m_lossThreads > 1 && n > m_parallelThreshold;
+
+  //Reference counting, random variables and mobility models stay on the
+  //simulator thread, the loss models only read the positions of the jobs
+  m_rxJobs.clear ();
+  m_rxJobs.reserve (n);
+  for (uint32_t k = 0; k < n; k++)
+    {
+      Ptr<FsoPhy> phy = m_phyList[pointed ? m_candidates[k] : k];
+      if (sender == phy)
+        {
+          continue;
+        }
+      Ptr<MobilityModel> receiverMobility = phy->GetMobility ()->GetObject<MobilityModel> ();
+      Ptr<LaserAntennaModel> beam = FindBeam (sender, txPosition, receiverMobility);
+      if (beam == 0 && sender->GetNTxAntennas () > 0)
+        {
+          continue;
+        }
+
+      RxJob job;
+      job.phy = phy;
+      job.mobility = receiverMobility;
+      job.position = receiverMobility->GetPosition ();
+      job.params = fsoSignalParams->Copy ();
+      if (beam != 0 && beam != fsoSignalParams->txAntenna)
+        {
+          //The signal parameters of the sender are those of its first laser
+          job.params->power = beam->GetTxPower () + beam->GetGain ();
+          job.params->txBeamwidth = beam->GetBeamwidth ();
+          job.params->txAntenna = beam;
+          job.params->wavelength = beam->GetWavelength ();
+          job.params->frequency = 3e8/beam->GetWavelength ();
+        }
+      job.delay = m_delay->GetDelay (senderMobility, receiverMobility);
+      m_loss->PrepareLink (senderMobility, receiverMobility);
+      m_rxJobs.push_back (job);
+    }
+
+  if (parallel)
+    {
+      if (m_pool == 0 || m_pool->GetNThreads () != m_lossThreads)
+        {
+          m_pool = Create<FsoThreadPool> (m_lossThreads);
+        }
+      m_pool->Run (m_rxJobs.size (), MakeCallback (&FsoChannel::EvaluateLoss, this));
+    }
+  else
+    {
+      for (uint32_t i = 0; i < m_rxJobs.size (); i++)
+        {
+          EvaluateLoss (i);
+        }
+    }
+
+  double txPower = fsoSignalParams->power;
+  for (std::vector<RxJob>::const_iterator i = m_rxJobs.begin (); i != m_rxJobs.end (); i++)
     {
-      if (sender != (*i))
+      NS_LOG_DEBUG ("Signal Channel: txPower=" << txPower << "db, distance=" << senderMobility->GetDistanceFrom (i->mobility) << "m, delay=" << i->delay << ", Scint Index=" << i->params->scintillationIndex << ", mean irradiance=" << i->params->meanIrradiance << "W/m^2, path loss=" << i->params->pathLoss <<"db, power after FSPL" << i->params->power << "dB");
+    }
+}
+
+uint32_t
+FsoChannel::GetReceiverContext (Ptr<FsoPhy> phy) const
+{
+  Ptr<FsoNetDevice> dstNetDevice = phy->GetFsoDevice ();
+  if (dstNetDevice == 0)
+    {
+      return 0xffffffff;
+    }
+  return dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
+}
+
+Ptr<LaserAntennaModel>
+FsoChannel::FindBeam (Ptr<FsoPhy> sender, const Vector &txPosition, Ptr<MobilityModel> receiverMobility) const
+{
+  for (uint32_t b = 0; b < sender->GetNTxAntennas (); b++)
+    {
+      Ptr<LaserAntennaModel> beam = sender->GetTxAntenna (b);
+      if (!beam->IsPointed () || beam->Illuminates (txPosition, receiverMobility->GetPosition ()))
         {
+          return beam;
+        }
+    }
+  return 0;
+}
+
+void
+FsoChannel::FindCandidates (Ptr<FsoPhy> sender, const Vector &txPosition)
+{
+  m_candidates.clear ();
+  if (m_indexCellSize > 0.0)
+    {
+      if (!m_indexValid)
+        {
+          BuildIndex ();
+        }
+      for (uint32_t b = 0; b < sender->GetNTxAntennas (); b++)
+        {
+          Ptr<LaserAntennaModel> beam = sender->GetTxAntenna (b);
+          m_index.QueryCone (txPosition, beam->GetBeamAxis (txPosition), 0.5*beam->GetDivergence (), m_beamCandidates);
+          m_candidates.insert (m_candidates.end (), m_beamCandidates.begin (), m_beamCandidates.end ());
+        }
+      m_candidates.insert (m_candidates.end (), m_mobilePhys.begin (), m_mobilePhys.end ());
+      std::sort (m_candidates.begin (), m_candidates.end ());
+      m_candidates.erase (std::unique (m_candidates.begin (), m_candidates.end ()), m_candidates.end ());
+      NS_LOG_LOGIC ("Spatial index: " << m_candidates.size () << " candidate receivers out of " << m_phyList.size ());
+      return;
+    }
+  for (uint32_t i = 0; i < m_phyList.size (); i++)
+    {
+      m_candidates.push_back (i);
+    }
+}
 
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
-          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
-          double txPower = fsoSignalParams->power;
-
-          m_loss->UpdateSignalParams (fsoSignalParams, senderMobility, receiverMobility);  
-
-          NS_LOG_DEBUG ("Signal Channel: txPower=" << txPower << "db, distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay << ", Scint Index=" << fsoSignalParams->scintillationIndex << ", mean irradiance=" << fsoSignalParams->meanIrradiance << "W/m^2, path loss=" << fsoSignalParams->pathLoss <<"db, power after FSPL" << fsoSignalParams->power << "dB");
-
-          Ptr<Packet> copy = packet->Copy ();
-          Ptr<FsoNetDevice> dstNetDevice = m_phyList[j]->GetFsoDevice ();
-          uint32_t dstNode;
-          if (dstNetDevice == 0)
-            {
-              dstNode = 0xffffffff;
-            }
-          else
-            {
-              dstNode = dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
-            }
-
-          NS_LOG_DEBUG ("Scheduling Packet: " << packet->GetSize() << " bytes"); 
-          Simulator::ScheduleWithContext (dstNode,
-                                          delay, &FsoPhy::Receive, m_phyList[j],
-                                          copy, fsoSignalParams);                 
+void
+FsoChannel::BuildIndex ()
+{
+  NS_LOG_FUNCTION (this);
+  m_index.SetCellSize (m_indexCellSize);
+  m_mobilePhys.clear ();
+  for (uint32_t i = 0; i < m_phyList.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[i]->GetMobility ()->GetObject<MobilityModel> ();
+      if (m_tracked.find (PeekPointer (mobility)) == m_tracked.end ())
+        {
+          mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&FsoChannel::NotifyCourseChange, this));
+          m_tracked[PeekPointer (mobility)] = mobility;
+        }
+      Vector velocity = mobility->GetVelocity ();
+      if (velocity.x != 0.0 || velocity.y != 0.0 || velocity.z != 0.0)
+        {
+          m_mobilePhys.push_back (i);
+        }
+      else
+        {
+          m_index.Insert (i, mobility->GetPosition ());
         }
     }
+  m_indexValid = true;
+}
+
+void
+FsoChannel::NotifyCourseChange (Ptr<const MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << mobility);
+  m_indexValid = false;
+}
+
+void
+FsoChannel::SetSpatialIndexCellSize (double size)
+{
+  NS_LOG_FUNCTION (this << size);
+  m_indexCellSize = size;
+  m_indexValid = false;
+}
+
+double
+FsoChannel::GetSpatialIndexCellSize () const
+{
+  return m_indexCellSize;
+}
+
+void
+FsoChannel::EvaluateLoss (uint32_t i)
+{
+  RxJob &job = m_rxJobs[i];
+  m_loss->UpdateSignalParams (job.params, m_senderMobility, job.mobility, m_senderPosition, job.position);
 }
 
 std::size_t
@@ -140,6 +384,7 @@ void
 FsoChannel::Add (Ptr<FsoPhy> phy)
 {
   m_phyList.push_back (phy);
+  m_indexValid = false;
 }
 
 int64_t
@@ -24,18 +24,24 @@
 #define FSO_CHANNEL_H
 
 #include <vector>
+#include <map>
 #include <stdint.h>
 #include "ns3/packet.h"
+#include "ns3/packet-burst.h"
 #include "ns3/channel.h"
 #include "fso-signal-parameters.h"
 #include "fso-propagation-loss-model.h"
 #include "fso-phy.h"
+#include "fso-thread-pool.h"
+#include "fso-spatial-index.h"
 #include "ns3/nstime.h"
 
 namespace ns3 {
 
 class NetDevice;
 class PropagationDelayModel;
+class MobilityModel;
+class LaserAntennaModel;
 
 /**
  * \brief A free space optics channel
@@ -45,6 +51,20 @@ class PropagationDelayModel;
  * class and contains a list of ns3::FsoPropagationLossModel and a single ns3::PropagationDelayModel.
  * By default, no propagation models are set so, it is the caller's responsibility
  * to set them before using the channel.
+ *
+ * Every receiver gets its own copy of the signal parameters. When the
+ * LossEvaluationThreads attribute is larger than one, the propagation loss
+ * chain is evaluated for the receivers in parallel, the receptions are then
+ * scheduled by the simulator thread in the order of the PHY list.
+ *
+ * A transmission only reaches the receivers illuminated by one of the
+ * lasers of the sender (see LaserAntennaModel::Illuminates), each receiver
+ * getting the power and beamwidth of the first of them. When all the
+ * lasers are pointed and SpatialIndexCellSize is positive, the candidate
+ * receivers are found with a FsoSpatialIndex of the receiver positions
+ * instead of scanning the PHY list. The index is rebuilt when a PHY is
+ * added or a mobility model notifies a course change. Receivers moving at
+ * a non zero velocity when the index is built are always candidates.
  */
 class FsoChannel : public Channel
 {
@@ -76,7 +96,8 @@ public:
 
   /**
    * Sends a packet to all the FsoPhys attached to the channel and schedules the
-   * receive. 
+   * receive. Each receiver is given a copy of fsoSignalParams updated by the
+   * propagation loss models.
    *
    * \param sender the device from which the packet is originating.
    * \param packet the packet to send
@@ -86,6 +107,18 @@ public:
   void Send (Ptr<FsoPhy> sender, Ptr<const Packet> packet,
              Ptr<FsoSignalParameters> fsoSignalParams, Time duration);
 
+  /**
+   * Sends a burst of packets to all the FsoPhys attached to the channel and
+   * schedules a single receive of the whole burst per receiver.
+   *
+   * \param sender the device from which the burst is originating.
+   * \param burst the packets to send, back to back
+   * \param fsoSignalParams the struct containing all the signal parameters
+   * \param duration the transmission duration of the whole burst
+   */
+  void SendBurst (Ptr<FsoPhy> sender, Ptr<const PacketBurst> burst,
+                  Ptr<FsoSignalParameters> fsoSignalParams, Time duration);
+
   /**
    * Assign a fixed random variable stream number to the random variables
    * used by this model.  Return the number of streams (possibly zero) that
@@ -97,7 +130,86 @@ public:
    */
   int64_t AssignStreams (int64_t stream);
 
+  /**
+   * \param size the edge (m) of the cells of the spatial index of the
+   *        receivers, 0 disables the index
+   */
+  void SetSpatialIndexCellSize (double size);
+
+  /**
+   * \return the edge (m) of the cells of the spatial index of the receivers
+   */
+  double GetSpatialIndexCellSize () const;
+
+protected:
+  virtual void DoDispose (void);
+
 private:
+  /**
+   * Per receiver state of a transmission
+   */
+  struct RxJob
+  {
+    Ptr<FsoPhy> phy;                   //!< the receiver
+    Ptr<const MobilityModel> mobility; //!< mobility of the receiver
+    Vector position;                   //!< position of the receiver
+    Ptr<FsoSignalParameters> params;   //!< signal parameters of this receiver
+    Time delay;                        //!< propagation delay
+  };
+
+  /**
+   * Fill m_rxJobs with the receivers of a transmission, their propagation
+   * delays and their signal parameters updated by the loss models
+   *
+   * \param sender the transmitting FsoPhy
+   * \param fsoSignalParams the signal parameters of the transmitter
+   */
+  void PrepareReceivers (Ptr<FsoPhy> sender, Ptr<FsoSignalParameters> fsoSignalParams);
+
+  /**
+   * \param phy a receiver
+   * \return the id of the node of the receiver, the context of its receive events
+   */
+  uint32_t GetReceiverContext (Ptr<FsoPhy> phy) const;
+
+  /**
+   * Apply the propagation loss models to the signal parameters of a receiver
+   *
+   * \param i the index of the job in m_rxJobs
+   */
+  void EvaluateLoss (uint32_t i);
+
+  /**
+   * \param sender the transmitting FsoPhy
+   * \param txPosition the position of the sender
+   * \param receiverMobility the mobility model of a receiver
+   * \return the first laser of the sender illuminating the receiver, 0 if
+   *         none does or if the sender has no laser
+   */
+  Ptr<LaserAntennaModel> FindBeam (Ptr<FsoPhy> sender, const Vector &txPosition, Ptr<MobilityModel> receiverMobility) const;
+
+  /**
+   * Fill m_candidates with the sorted indices in the PHY list of the
+   * receivers which may be illuminated by the pointed lasers of the sender
+   *
+   * \param sender the transmitting FsoPhy
+   * \param txPosition the position of the sender
+   */
+  void FindCandidates (Ptr<FsoPhy> sender, const Vector &txPosition);
+
+  /**
+   * Index the positions of the static receivers
+   */
+  void BuildIndex ();
+
+  /**
+   * Invalidate the spatial index
+   *
+   * \param mobility the mobility model that changed course
+   */
+  void NotifyCourseChange (Ptr<const MobilityModel> mobility);
+
+
   /**
    * A vector of pointers to FsoPhy.
    */
@@ -106,6 +218,21 @@ private:
   PhyList m_phyList;                   //!< List of FsoPhys connected to this FsoChannel
   Ptr<FsoPropagationLossModel> m_loss; //!< Ptr to fso propagation loss model
   Ptr<PropagationDelayModel> m_delay;  //!< Propagation delay model
+
+  uint32_t m_lossThreads;              //!< number of threads evaluating the loss models
+  uint32_t m_parallelThreshold;        //!< minimum number of receivers evaluated in parallel
+  Ptr<FsoThreadPool> m_pool;           //!< workers evaluating the loss models
+  std::vector<RxJob> m_rxJobs;         //!< receivers of the current transmission
+  Ptr<const MobilityModel> m_senderMobility; //!< mobility of the current sender
+  Vector m_senderPosition;             //!< position of the current sender
+
+  double m_indexCellSize;              //!< edge of the cells of the spatial index, 0 if disabled
+  FsoSpatialIndex m_index;             //!< positions of the static receivers
+  bool m_indexValid;                   //!< whether m_index matches the receivers
+  std::vector<uint32_t> m_mobilePhys;  //!< receivers left out of the index because they move
+  std::vector<uint32_t> m_candidates;  //!< receivers of the current transmission
+  std::vector<uint32_t> m_beamCandidates; //!< receivers returned by a query of the index
+  std::map<const MobilityModel *, Ptr<MobilityModel> > m_tracked; //!< mobility models listened to
 };
 
 
@@ -20,7 +20,9 @@
 
 
 #include "fso-down-link-scintillation-index-model.h"
+#include "fso-link-geometry.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 #include <ns3/math.h>
 #include <ns3/log.h>
 #include <utility>
@@ -32,6 +34,7 @@ NS_LOG_COMPONENT_DEFINE ("FsoDownLinkScintillationIndexModel");
 NS_OBJECT_ENSURE_REGISTERED (FsoDownLinkScintillationIndexModel);
 
 FsoDownLinkScintillationIndexModel::FsoDownLinkScintillationIndexModel ()
+  : m_hvIntegral (&HVIntegralFunction, 1e-18, 1e-10)
 {
 }
 
@@ -42,13 +45,13 @@ FsoDownLinkScintillationIndexModel::~FsoDownLinkScintillationIndexModel ()
 void
 FsoDownLinkScintillationIndexModel::DoDispose ()
 {
-  
+  m_linkCache.Clear ();
 }
 
 TypeId
 FsoDownLinkScintillationIndexModel::GetTypeId (void)
 {
-  static TypeId tid = TypeId ("ns3::FsoDownLinkScintillationIndexModel")
+  static TypeId tid = FsoTurbulenceIntegral::AddAttributes<FsoDownLinkScintillationIndexModel> (TypeId ("ns3::FsoDownLinkScintillationIndexModel"))
     .SetParent<Object> ()
     .SetGroupName ("Fso")
     .AddConstructor<FsoDownLinkScintillationIndexModel> ()
@@ -65,6 +68,20 @@ FsoDownLinkScintillationIndexModel::GetTypeId (void)
                    MakeDoubleAccessor (&FsoDownLinkScintillationIndexModel::SetGndRefractiveIdx,
                                        &FsoDownLinkScintillationIndexModel::GetGndRefractiveIdx),
                    MakeDoubleChecker<double> (0, 1))
+
+    .AddAttribute ("LinkCache",
+                   "Cache the result of the model for each (transmitter, receiver) link until an end point moves or changes course",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FsoDownLinkScintillationIndexModel::SetLinkCache,
+                                        &FsoDownLinkScintillationIndexModel::GetLinkCache),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LinkCachePositionThreshold",
+                   "The distance (meters) an end point may move before the cached state of its links is recomputed, "
+                   "0 only reuses the state of links whose end points have not moved",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoDownLinkScintillationIndexModel::SetLinkCachePositionThreshold,
+                                       &FsoDownLinkScintillationIndexModel::GetLinkCachePositionThreshold),
+                   MakeDoubleChecker<double> (0.0))
   ;
   return tid;
 }
@@ -75,18 +92,33 @@ FsoDownLinkScintillationIndexModel::DoAssignStreams (int64_t stream)
   return 0.0;
 }
 
+void
+FsoDownLinkScintillationIndexModel::DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b)
+{
+  m_linkCache.Listen (a);
+  m_linkCache.Listen (b);
+}
+
 void 
-FsoDownLinkScintillationIndexModel::DoUpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, Ptr<const MobilityModel> a, Ptr<const MobilityModel> b)
+FsoDownLinkScintillationIndexModel::DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                                          const Vector &positionA, const Vector &positionB)
 {
   NS_LOG_FUNCTION (this);
-  NS_ASSERT (a->GetPosition().z >= b->GetPosition().z);
-  
-  double heightTx = (a->GetPosition().z);
-  double heightRx = (b->GetPosition().z);  
-
-  double zenith = 30.0*(M_PI/180.0);//MDP - This is fixed for now, Satellite mobility model should provide an elevation or zenith angle
-
-  fsoSignalParams->scintillationIndex = CalculateScintillationIdx (fsoSignalParams->frequency, heightTx, heightRx, zenith);
+  LinkState state;
+  if (!m_linkCache.Lookup (a, b, positionA, positionB, state) || state.frequency != fsoSignalParams->frequency)
+    {
+      double heightTx = FsoLinkGeometry::GetAltitude (positionA);
+      double heightRx = FsoLinkGeometry::GetAltitude (positionB);
+      NS_ASSERT (heightTx >= heightRx);
+
+      double zenith = FsoLinkGeometry::GetZenithAngle (positionA, positionB);
+      NS_LOG_DEBUG ("ScintillationIndex: zenith=" << zenith*180.0/M_PI << " degrees");
+
+      state.frequency = fsoSignalParams->frequency;
+      state.scintillationIndex = CalculateScintillationIdx (fsoSignalParams->frequency, heightTx, heightRx, zenith);
+      m_linkCache.Add (a, b, positionA, positionB, state);
+    }
+  fsoSignalParams->scintillationIndex = state.scintillationIndex;
 
 }
 
@@ -95,34 +127,11 @@ FsoDownLinkScintillationIndexModel::CalculateScintillationIdx (double f, double
 {
   NS_LOG_FUNCTION (this);
 
-  double result = 0.0;
-  double error = 0.0;
-
-  HVFunctionParameters params;
-  params.A = m_groundRefractiveIdx;
-  params.v = m_rmsWindSpeed;
-  params.hgs = hRx;
-
-  gsl_integration_workspace * w = gsl_integration_workspace_alloc (10000);
-
-  gsl_function F;
-  F.function = &HVIntegralFunction;
-  F.params = &params;
-
-  //If the transmitter is higher than 20km, limit the integration to 20km
-  //20km is the effective height of the turbulence (constant beyond 20km)
-  if (hTx > 20000.0)
-   {
-     hTx = 20000.0;
-   }
- 
-  gsl_integration_qags (&F, hRx, hTx, 1e-18, 1e-10, 10000, w, &result, &error);
+  double result = m_hvIntegral.Integrate (hTx, hRx, m_rmsWindSpeed, m_groundRefractiveIdx);
   NS_LOG_DEBUG ("RESULT=" << result);
-  NS_LOG_DEBUG ("ERROR=" << error);
   double wavelength = 3.0e8/f;
   double k = (2*M_PI)/wavelength;//Wave number - 2*pi/wavelength
-   
-  gsl_integration_workspace_free (w);
+
   return (2.25*std::pow(k, 7.0/6.0)*std::pow((1.0/cos(zenith)), 11.0/6.0))*result;
 }
 
@@ -131,6 +140,7 @@ FsoDownLinkScintillationIndexModel::SetRmsWindSpeed (double rmsWindSpeed)
 {
   NS_LOG_FUNCTION (this);
   m_rmsWindSpeed = rmsWindSpeed;
+  m_linkCache.Clear ();
 }
 
 double 
@@ -144,6 +154,7 @@ FsoDownLinkScintillationIndexModel::SetGndRefractiveIdx (double gndRefractiveIdx
 {
   NS_LOG_FUNCTION (this);
   m_groundRefractiveIdx = gndRefractiveIdx;
+  m_linkCache.Clear ();
 }
 
 double 
@@ -152,7 +163,48 @@ FsoDownLinkScintillationIndexModel::GetGndRefractiveIdx () const
   return m_groundRefractiveIdx;
 }
 
-#ifdef HAVE_GSL
+void
+FsoDownLinkScintillationIndexModel::SetCacheAltitudeResolution (double resolution)
+{
+  NS_LOG_FUNCTION (this << resolution);
+  m_hvIntegral.SetAltitudeResolution (resolution);
+  m_linkCache.Clear ();
+}
+
+double
+FsoDownLinkScintillationIndexModel::GetCacheAltitudeResolution () const
+{
+  return m_hvIntegral.GetAltitudeResolution ();
+}
+
+void
+FsoDownLinkScintillationIndexModel::SetCacheParameterTolerance (double tolerance)
+{
+  NS_LOG_FUNCTION (this << tolerance);
+  m_hvIntegral.SetParameterTolerance (tolerance);
+  m_linkCache.Clear ();
+}
+
+double
+FsoDownLinkScintillationIndexModel::GetCacheParameterTolerance () const
+{
+  return m_hvIntegral.GetParameterTolerance ();
+}
+
+void
+FsoDownLinkScintillationIndexModel::SetProfileTableStep (double step)
+{
+  NS_LOG_FUNCTION (this << step);
+  m_hvIntegral.SetProfileStep (step);
+  m_linkCache.Clear ();
+}
+
+double
+FsoDownLinkScintillationIndexModel::GetProfileTableStep () const
+{
+  return m_hvIntegral.GetProfileStep ();
+}
+
 double
 HVIntegralFunction (double h, void *params)
 {
@@ -163,6 +215,31 @@ HVIntegralFunction (double h, void *params)
 
   return IntegralFunction;
 }
-#endif
+
+void
+FsoDownLinkScintillationIndexModel::SetLinkCache (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_linkCache.SetEnabled (enabled);
+}
+
+bool
+FsoDownLinkScintillationIndexModel::GetLinkCache () const
+{
+  return m_linkCache.IsEnabled ();
+}
+
+void
+FsoDownLinkScintillationIndexModel::SetLinkCachePositionThreshold (double threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+  m_linkCache.SetPositionThreshold (threshold);
+}
+
+double
+FsoDownLinkScintillationIndexModel::GetLinkCachePositionThreshold () const
+{
+  return m_linkCache.GetPositionThreshold ();
+}
 
 } // namespace ns3
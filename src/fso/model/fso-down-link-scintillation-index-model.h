@@ -26,6 +26,8 @@
 #include <ns3/mobility-model.h>
 #include "fso-signal-parameters.h"
 #include "fso-propagation-loss-model.h"
+#include "fso-link-cache.h"
+#include "fso-turbulence-integral.h"
 #ifdef HAVE_GSL
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_integration.h>
@@ -35,16 +37,9 @@
 
 namespace ns3 {
 
-#ifdef HAVE_GSL
-typedef struct HVFunctionParameterType
-{
-  double A;
-  double v;
-  double hgs;
-} HVFunctionParameters;
+typedef FsoTurbulenceParameters HVFunctionParameters;
 
 double HVIntegralFunction (double x, void *params);
-#endif
 
 /**
  * \ingroup fso
@@ -109,6 +104,56 @@ public:
    */
   double GetGndRefractiveIdx () const;
 
+  /**
+   * \param resolution altitude quantization (m) of the cached integrals, 0 disables the cache
+   */
+  void SetCacheAltitudeResolution (double resolution);
+
+  /**
+   * \return altitude quantization (m) of the cached integrals
+   */
+  double GetCacheAltitudeResolution () const;
+
+  /**
+   * \param tolerance relative quantization of the wind speed and ground index of refraction
+   */
+  void SetCacheParameterTolerance (double tolerance);
+
+  /**
+   * \return relative quantization of the wind speed and ground index of refraction
+   */
+  double GetCacheParameterTolerance () const;
+
+  /**
+   * \param step altitude step (m) of the cumulative profile table, 0 disables the table
+   */
+  void SetProfileTableStep (double step);
+
+  /**
+   * \return altitude step (m) of the cumulative profile table
+   */
+  double GetProfileTableStep () const;
+
+  /**
+   * \param enabled whether the state of each (transmitter, receiver) link is cached
+   */
+  void SetLinkCache (bool enabled);
+
+  /**
+   * \return whether the state of each (transmitter, receiver) link is cached
+   */
+  bool GetLinkCache () const;
+
+  /**
+   * \param threshold distance (m) an end point may move before the state of its links is recomputed
+   */
+  void SetLinkCachePositionThreshold (double threshold);
+
+  /**
+   * \return distance (m) an end point may move before the state of its links is recomputed
+   */
+  double GetLinkCachePositionThreshold () const;
+
 protected:
   //Inherited from Object
   virtual void DoDispose ();
@@ -117,9 +162,22 @@ protected:
 private:
   double m_rmsWindSpeed;        //!< The RMS wind speed in m/s
   double m_groundRefractiveIdx; //!< The index of refraction at ground level
+  /**
+   * Scintillation index of a link
+   */
+  struct LinkState
+  {
+    double frequency;          //!< frequency of the signal (Hz)
+    double scintillationIndex; //!< scintillation index
+  };
+
+  mutable FsoTurbulenceIntegral m_hvIntegral; //!< Cached integral of the Hufnagel-Valley profile
+  FsoLinkCache<LinkState> m_linkCache; //!< Scintillation index of the links
 
   //Inherited from FsoPropagationLossModel
-  virtual void DoUpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, Ptr<const MobilityModel> a, Ptr<const MobilityModel> b);
+  virtual void DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                     const Vector &positionA, const Vector &positionB);
+  virtual void DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b);
 
 };
 
@@ -19,9 +19,15 @@
  */
 
 #include "fso-error-model.h"
+#include "fso-link-geometry.h"
 #include <ns3/double.h>
+#include <ns3/enum.h>
+#include <ns3/uinteger.h>
+#include <ns3/boolean.h>
+#include <ns3/simulator.h>
 #include <ns3/log.h>
 #include <cmath>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -30,6 +36,11 @@ NS_LOG_COMPONENT_DEFINE ("FsoErrorModel");
 NS_OBJECT_ENSURE_REGISTERED (FsoErrorModel);
 NS_OBJECT_ENSURE_REGISTERED (FsoDownLinkErrorModel);
 
+//Relative change of the Greenwood time constant below which the time series keeps its time scale
+static const double CORRELATION_TIME_TOLERANCE = 0.01;
+//Lower bound of the sine of the elevation, horizontal links are evaluated as slightly slanted ones
+static const double MIN_ELEVATION_SINE = 1e-3;
+
 
 TypeId FsoErrorModel::GetTypeId (void)
 {
@@ -46,6 +57,12 @@ FsoErrorModel::AssignStreams (int64_t stream)
   return DoAssignStreams (stream);
 }
 
+double
+FsoErrorModel::GetAirtimeSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams, Time start, Time duration)
+{
+  return GetPacketSuccessRate (packet, fsoSignalParams);
+}
+
 void 
 FsoErrorModel::SetPhy (Ptr<FsoPhy> phy)
 {
@@ -55,7 +72,7 @@ FsoErrorModel::SetPhy (Ptr<FsoPhy> phy)
 TypeId 
 FsoDownLinkErrorModel::GetTypeId (void)
 {
-  static TypeId tid = TypeId ("ns3::FsoDownLinkErrorModel")
+  static TypeId tid = FsoTurbulenceIntegral::AddAttributes<FsoDownLinkErrorModel> (TypeId ("ns3::FsoDownLinkErrorModel"))
     .SetParent<FsoErrorModel> ()
     .SetGroupName ("Fso")
     .AddConstructor<FsoDownLinkErrorModel> ()
@@ -70,11 +87,63 @@ FsoDownLinkErrorModel::GetTypeId (void)
                    DoubleValue (1.7e-14),
                    MakeDoubleAccessor (&FsoDownLinkErrorModel::m_groundRefractiveIdx),
                    MakeDoubleChecker<double> (0, 1))
+
+    .AddAttribute ("BerMethod",
+                   "The method used to evaluate the bit error rate",
+                   EnumValue (FsoDownLinkErrorModel::BER_LOOKUP_TABLE),
+                   MakeEnumAccessor (&FsoDownLinkErrorModel::SetBerMethod,
+                                     &FsoDownLinkErrorModel::GetBerMethod),
+                   MakeEnumChecker (FsoDownLinkErrorModel::BER_GSL_INTEGRATION, "GslIntegration",
+                                    FsoDownLinkErrorModel::BER_CLOSED_FORM, "ClosedForm",
+                                    FsoDownLinkErrorModel::BER_LOOKUP_TABLE, "LookupTable"))
+
+    .AddAttribute ("BerTableTolerance",
+                   "The maximum relative error of the bit error rate lookup table",
+                   DoubleValue (1e-6),
+                   MakeDoubleAccessor (&FsoDownLinkErrorModel::SetBerTableTolerance,
+                                       &FsoDownLinkErrorModel::GetBerTableTolerance),
+                   MakeDoubleChecker<double> (1e-12, 1e-1))
+
+    .AddAttribute ("IrradianceModel",
+                   "How the normalized irradiance at the receiver evolves over time",
+                   EnumValue (FsoDownLinkErrorModel::IRRADIANCE_TIME_SERIES),
+                   MakeEnumAccessor (&FsoDownLinkErrorModel::SetIrradianceModel,
+                                     &FsoDownLinkErrorModel::GetIrradianceModel),
+                   MakeEnumChecker (FsoDownLinkErrorModel::IRRADIANCE_TIME_SERIES, "TimeSeries",
+                                    FsoDownLinkErrorModel::IRRADIANCE_INDEPENDENT, "Independent"))
+
+    .AddAttribute ("SamplesPerCorrelationTime",
+                   "The number of samples of the irradiance time series per Greenwood time constant",
+                   UintegerValue (20),
+                   MakeUintegerAccessor (&FsoDownLinkErrorModel::SetSamplesPerCorrelationTime,
+                                         &FsoDownLinkErrorModel::GetSamplesPerCorrelationTime),
+                   MakeUintegerChecker<uint32_t> (1))
+
+    .AddAttribute ("TimeSeriesBlockSize",
+                   "The number of samples of the irradiance time series generated at once",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&FsoDownLinkErrorModel::SetTimeSeriesBlockSize,
+                                         &FsoDownLinkErrorModel::GetTimeSeriesBlockSize),
+                   MakeUintegerChecker<uint32_t> (1))
+
+    .AddAttribute ("ApertureAveraging",
+                   "Whether the scintillation is averaged over the area of each receive aperture",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FsoDownLinkErrorModel::SetApertureAveraging,
+                                        &FsoDownLinkErrorModel::GetApertureAveraging),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
 FsoDownLinkErrorModel::FsoDownLinkErrorModel ()
+  : m_gwIntegral (&GWIntegralFunction, 1e-10, 1e-10),
+    m_apertureIntegral (&ApertureIntegralFunction, 1e-18, 1e-10),
+    m_apertureNormIntegral (&ApertureNormIntegralFunction, 1e-18, 1e-10),
+    m_apertureAveraging (false),
+    m_apertureTxHeight (-1.0),
+    m_apertureRxHeight (-1.0),
+    m_apertureScaleHeight (0.0)
 {
   NS_LOG_FUNCTION (this);
   m_logNormalDist = CreateObject<LogNormalRandomVariable> ();
@@ -82,6 +151,14 @@ FsoDownLinkErrorModel::FsoDownLinkErrorModel ()
   m_groundRefractiveIdx = 1.7e-14;  
   m_rmsWindSpeed = 21.0;
   m_updateIrradiance = true;
+  m_irradianceModel = IRRADIANCE_TIME_SERIES;
+  m_gwTxHeight = -1.0;
+  m_gwRxHeight = -1.0;
+  m_gwElevation = 0.0;
+  m_gwWavelength = 0.0;
+  m_berMethod = BER_LOOKUP_TABLE;
+  m_berTableTolerance = 1e-6;
+  m_berTableStep = 0.0;
 
   m_turbulenceTimer.SetFunction (&FsoDownLinkErrorModel::SetIrradianceUpdate, this);
 }
@@ -95,6 +172,7 @@ void
 FsoDownLinkErrorModel::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  m_turbulenceTimer.Cancel ();
   m_phy = 0;
 }
 
@@ -108,6 +186,22 @@ FsoDownLinkErrorModel::CalculateBer (double rxPower) const
   
   double errorFunctionParam = (rxPower/charPower)/(1 + std::sqrt(1 + formFactor*(rxPower/charPower)))/std::sqrt(2.0);
 
+  switch (m_berMethod)
+    {
+    case BER_GSL_INTEGRATION:
+      return CalculateBerIntegral (errorFunctionParam);
+    case BER_CLOSED_FORM:
+      return CalculateBerClosedForm (errorFunctionParam);
+    case BER_LOOKUP_TABLE:
+    default:
+      return CalculateBerLookup (errorFunctionParam);
+    }
+}
+
+double
+FsoDownLinkErrorModel::CalculateBerIntegral (double q) const
+{
+#ifdef HAVE_GSL
   double result = 0.0;
   double error = 0.0;
 
@@ -117,43 +211,183 @@ FsoDownLinkErrorModel::CalculateBer (double rxPower) const
   F.function = &ErrorFunction;
   F.params = 0;//no parameters passed
   
-  gsl_integration_qagiu (&F, errorFunctionParam, 1e-20, 1e-10, 100000, w, &result, &error);
+  gsl_integration_qagiu (&F, q, 1e-20, 1e-10, 100000, w, &result, &error);
    
   gsl_integration_workspace_free (w);
 
   return (result/(2.0*std::sqrt(2.0*M_PI)));
+#else
+  NS_LOG_WARN ("GSL not available, using the closed form BER");
+  return CalculateBerClosedForm (q);
+#endif
 }
 
 double
-FsoDownLinkErrorModel::CalculateTurbulenceTimeConstant (double hTx, double hRx, double wavelength, double elevation)
+FsoDownLinkErrorModel::CalculateBerClosedForm (double q) const
+{
+  //The integral of exp(-t^2/2) from q to infinity is sqrt(pi/2)*erfc(q/sqrt(2))
+  return 0.25*std::erfc (q/std::sqrt (2.0));
+}
+
+double
+FsoDownLinkErrorModel::CalculateBerLookup (double q) const
+{
+  if (m_berTable.empty ())
+    {
+      BuildBerTable ();
+    }
+
+  double x = q/m_berTableStep;
+  if (q < 0.0 || x >= m_berTable.size () - 1)
+    {
+      //Outside of the table the BER is either ~0.25 or below the smallest double
+      return CalculateBerClosedForm (q);
+    }
+
+  uint32_t i = static_cast<uint32_t> (x);
+  double frac = x - i;
+  return std::exp (m_berTable[i] + frac*(m_berTable[i + 1] - m_berTable[i]));
+}
+
+void
+FsoDownLinkErrorModel::BuildBerTable () const
 {
   NS_LOG_FUNCTION (this);
 
-  double result = 0.0;
-  double error = 0.0;
+  //Beyond this argument the BER underflows a double
+  const double maxParam = 37.5;
 
-  GWFunctionParameters params;
-  params.A = m_groundRefractiveIdx;
-  params.v = m_rmsWindSpeed;
-  params.hgs = hRx;
+  m_berTableStep = std::sqrt (8.0*m_berTableTolerance);
+  uint32_t size = static_cast<uint32_t> (std::ceil (maxParam/m_berTableStep)) + 1;
 
-  //Bound for integration limit, ~20km represents max height of atmospheric turbulence
-  if (hTx > 20000.0)
-   {
-     hTx = 20000.0;
-   }
+  m_berTable.resize (size);
+  for (uint32_t i = 0; i < size; i++)
+    {
+      m_berTable[i] = std::log (CalculateBerClosedForm (i*m_berTableStep));
+    }
+  NS_LOG_DEBUG ("ErrorModel: BER table with " << size << " entries, step=" << m_berTableStep);
+}
 
-  gsl_integration_workspace * w = gsl_integration_workspace_alloc (10000);
+void
+FsoDownLinkErrorModel::SetBerMethod (BerMethod method)
+{
+  NS_LOG_FUNCTION (this << method);
+  m_berMethod = method;
+}
 
-  gsl_function F;
-  F.function = &GWIntegralFunction;
-  F.params = &params;
+FsoDownLinkErrorModel::BerMethod
+FsoDownLinkErrorModel::GetBerMethod () const
+{
+  return m_berMethod;
+}
 
-  gsl_integration_qags (&F, hRx, hTx, 1e-10, 1e-10, 10000, w, &result, &error);
-   
-  gsl_integration_workspace_free (w);
-  
-  return ((2.729*std::pow(10.0,-8.0))*std::pow(wavelength*(1e6), 1.2)*std::pow(std::sin(elevation),0.6))/std::pow(result,0.6);//Should this be stored in a member variable?
+void
+FsoDownLinkErrorModel::SetBerTableTolerance (double tolerance)
+{
+  NS_LOG_FUNCTION (this << tolerance);
+  m_berTableTolerance = tolerance;
+  m_berTable.clear ();
+}
+
+double
+FsoDownLinkErrorModel::GetBerTableTolerance () const
+{
+  return m_berTableTolerance;
+}
+
+void
+FsoDownLinkErrorModel::SetIrradianceModel (IrradianceModel model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_irradianceModel = model;
+  m_updateIrradiance = true;
+}
+
+FsoDownLinkErrorModel::IrradianceModel
+FsoDownLinkErrorModel::GetIrradianceModel () const
+{
+  return m_irradianceModel;
+}
+
+void
+FsoDownLinkErrorModel::SetSamplesPerCorrelationTime (uint32_t samples)
+{
+  NS_LOG_FUNCTION (this << samples);
+  m_timeSeries.SetSamplesPerCorrelationTime (samples);
+}
+
+uint32_t
+FsoDownLinkErrorModel::GetSamplesPerCorrelationTime () const
+{
+  return m_timeSeries.GetSamplesPerCorrelationTime ();
+}
+
+void
+FsoDownLinkErrorModel::SetTimeSeriesBlockSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  m_timeSeries.SetBlockSize (size);
+}
+
+uint32_t
+FsoDownLinkErrorModel::GetTimeSeriesBlockSize () const
+{
+  return m_timeSeries.GetBlockSize ();
+}
+
+void
+FsoDownLinkErrorModel::SetCacheAltitudeResolution (double resolution)
+{
+  NS_LOG_FUNCTION (this << resolution);
+  m_gwIntegral.SetAltitudeResolution (resolution);
+  m_apertureIntegral.SetAltitudeResolution (resolution);
+  m_apertureNormIntegral.SetAltitudeResolution (resolution);
+}
+
+double
+FsoDownLinkErrorModel::GetCacheAltitudeResolution () const
+{
+  return m_gwIntegral.GetAltitudeResolution ();
+}
+
+void
+FsoDownLinkErrorModel::SetCacheParameterTolerance (double tolerance)
+{
+  NS_LOG_FUNCTION (this << tolerance);
+  m_gwIntegral.SetParameterTolerance (tolerance);
+  m_apertureIntegral.SetParameterTolerance (tolerance);
+  m_apertureNormIntegral.SetParameterTolerance (tolerance);
+}
+
+double
+FsoDownLinkErrorModel::GetCacheParameterTolerance () const
+{
+  return m_gwIntegral.GetParameterTolerance ();
+}
+
+void
+FsoDownLinkErrorModel::SetProfileTableStep (double step)
+{
+  NS_LOG_FUNCTION (this << step);
+  m_gwIntegral.SetProfileStep (step);
+  m_apertureIntegral.SetProfileStep (step);
+  m_apertureNormIntegral.SetProfileStep (step);
+}
+
+double
+FsoDownLinkErrorModel::GetProfileTableStep () const
+{
+  return m_gwIntegral.GetProfileStep ();
+}
+
+double
+FsoDownLinkErrorModel::CalculateTurbulenceTimeConstant (double hTx, double hRx, double wavelength, double elevation)
+{
+  NS_LOG_FUNCTION (this);
+
+  double result = m_gwIntegral.Integrate (hTx, hRx, m_rmsWindSpeed, m_groundRefractiveIdx);
+
+  return ((2.729*std::pow(10.0,-8.0))*std::pow(wavelength*(1e6), 1.2)*std::pow(std::max (std::sin(elevation), MIN_ELEVATION_SINE),0.6))/std::pow(result,0.6);//Should this be stored in a member variable?
 }
 
 double 
@@ -165,8 +399,80 @@ FsoDownLinkErrorModel::GetPacketSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalPa
 
   fsoSignalParams->normIrradiance = m_normalizedIrradiance;
 
+  double ber = CalculateBerAtIrradiance (fsoSignalParams, m_normalizedIrradiance);
+  NS_LOG_DEBUG ("ErrorModel: BER=" << ber);
+  
+  double packetLossProbability = CalculatePacketLossProbability (ber, packet->GetSize ()); 
+  NS_LOG_DEBUG ("ErrorModel: PLP=" << packetLossProbability);
+
+  return (1.0 - packetLossProbability);
+}
+
+double
+FsoDownLinkErrorModel::GetAirtimeSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams, Time start, Time duration)
+{
+  NS_LOG_FUNCTION (this << start << duration);
+
+  if (m_irradianceModel != IRRADIANCE_TIME_SERIES || !UpdateCorrelationTime (fsoSignalParams))
+    {
+      return GetPacketSuccessRate (packet, fsoSignalParams);
+    }
+
+  double bits = 8.0*packet->GetSize ();
+  Time end = start + duration;
+  double scintillationIndex = GetScintillationIndex (fsoSignalParams);
+  double sigma = std::sqrt (scintillationIndex);
+
+  m_normalizedIrradiance = std::exp (-0.5*scintillationIndex + sigma*m_timeSeries.GetValue (start));
+  fsoSignalParams->normIrradiance = m_normalizedIrradiance;
+
+  //The irradiance is constant between the samples of the time series
+  double logSuccess = 0.0;
+  uint64_t first = m_timeSeries.GetIndex (start);
+  uint64_t last = m_timeSeries.GetIndex (end);
+  for (uint64_t i = first; i <= last; i++)
+    {
+      double intervalBits = bits;
+      if (duration.IsStrictlyPositive ())
+        {
+          Time from = std::max (start, m_timeSeries.GetSampleTime (i));
+          Time to = std::min (end, m_timeSeries.GetSampleTime (i + 1));
+          if (to <= from)
+            {
+              continue;
+            }
+          intervalBits = bits*(to - from).GetSeconds ()/duration.GetSeconds ();
+        }
+      double irradiance = std::exp (-0.5*scintillationIndex + sigma*m_timeSeries.GetSample (i));
+      double ber = CalculateBerAtIrradiance (fsoSignalParams, irradiance);
+      logSuccess += intervalBits*std::log1p (-ber);
+      NS_LOG_LOGIC ("ErrorModel: interval " << i << " irradiance=" << irradiance << " BER=" << ber << " bits=" << intervalBits);
+      if (!duration.IsStrictlyPositive ())
+        {
+          break;
+        }
+    }
+
+  double successRate = std::exp (logSuccess);
+  NS_LOG_DEBUG ("ErrorModel: " << last - first + 1 << " intervals, success rate=" << successRate);
+  return successRate;
+}
+
+double
+FsoDownLinkErrorModel::CalculateBerAtIrradiance (Ptr<FsoSignalParameters> fsoSignalParams, double normIrradiance) const
+{
+  //Diameter of a single aperture with the area of all the apertures
   double rxApertureDiameter = m_phy->GetRxAntenna ()->GetApertureDiameter ();
-  double rxIrradiance = fsoSignalParams->meanIrradiance*m_normalizedIrradiance;
+  if (m_phy->GetNRxAntennas () > 1)
+    {
+      double sum = 0.0;
+      for (uint32_t i = 0; i < m_phy->GetNRxAntennas (); i++)
+        {
+          sum += std::pow (m_phy->GetRxAntenna (i)->GetApertureDiameter (), 2.0);
+        }
+      rxApertureDiameter = std::sqrt (sum);
+    }
+  double rxIrradiance = fsoSignalParams->meanIrradiance*normIrradiance;
 
   NS_LOG_DEBUG ("ErrorModel: rxPowerdB=" << fsoSignalParams->power);
 
@@ -174,14 +480,7 @@ FsoDownLinkErrorModel::GetPacketSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalPa
   double rxInstantPowerWatts = 0.125*M_PI*std::pow(rxApertureDiameter,2.0)*rxIrradiance;
   NS_LOG_DEBUG ("ErrorModel: rxPower=" << rxInstantPowerWatts);
 
-
-  double ber = CalculateBer(rxInstantPowerWatts*0.01);
-  NS_LOG_DEBUG ("ErrorModel: BER=" << ber);
-  
-  double packetLossProbability = CalculatePacketLossProbability (ber, packet->GetSize ()); 
-  NS_LOG_DEBUG ("ErrorModel: PLP=" << packetLossProbability);
-
-  return (1.0 - packetLossProbability);
+  return CalculateBer(rxInstantPowerWatts*0.01);
 }
 
 void 
@@ -189,13 +488,37 @@ FsoDownLinkErrorModel::CalculateNormRxIrradiance (Ptr<FsoSignalParameters> fsoSi
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_updateIrradiance)
+  bool timeSeries = m_irradianceModel == IRRADIANCE_TIME_SERIES;
+  if (timeSeries && UpdateCorrelationTime (fsoSignalParams))
+    {
+      double x = m_timeSeries.GetValue (Simulator::Now ());
+      double scintillationIndex = GetScintillationIndex (fsoSignalParams);
+      //Log normal with the same parameters as the independent draws
+      m_normalizedIrradiance = std::exp (-0.5*scintillationIndex + std::sqrt (scintillationIndex)*x);
+    }
+  else if (timeSeries)
+    {
+      //Without a correlation time, every packet sees an independent draw
+      double scintillationIndex = GetScintillationIndex (fsoSignalParams);
+      m_normalizedIrradiance = m_logNormalDist->GetValue (-0.5*scintillationIndex, std::sqrt (scintillationIndex));
+    }
+  else if (m_updateIrradiance)
    {
-     m_normalizedIrradiance = m_logNormalDist->GetValue(-0.5*fsoSignalParams->scintillationIndex, std::sqrt(fsoSignalParams->scintillationIndex));
-
-     double greenwoodTimeConstant = CalculateTurbulenceTimeConstant(fsoSignalParams->txPhy->GetMobility()->GetPosition().z, m_phy->GetMobility()->GetPosition().z, fsoSignalParams->wavelength, (60.0*M_PI)/180.0);
+     double scintillationIndex = GetScintillationIndex (fsoSignalParams);
+     m_normalizedIrradiance = m_logNormalDist->GetValue(-0.5*scintillationIndex, std::sqrt(scintillationIndex));
+     m_updateIrradiance = false;
+
+     Vector positionTx = fsoSignalParams->txPhy->GetMobility ()->GetPosition ();
+     Vector positionRx = m_phy->GetMobility ()->GetPosition ();
+     double greenwoodTimeConstant = CalculateTurbulenceTimeConstant (FsoLinkGeometry::GetAltitude (positionTx), FsoLinkGeometry::GetAltitude (positionRx),
+                                                                     fsoSignalParams->wavelength, FsoLinkGeometry::GetElevation (positionTx, positionRx));
      NS_LOG_DEBUG ("ErrorModel: Greenwood Time Constant=" << greenwoodTimeConstant << "s"); 
-     if (m_turbulenceTimer.IsExpired ())
+     if (!(greenwoodTimeConstant > 0.0) || std::isinf (greenwoodTimeConstant))
+      {
+       //No time scale, the next packet draws again
+       m_updateIrradiance = true;
+      }
+     else if (m_turbulenceTimer.IsExpired ())
       { 
        m_turbulenceTimer.SetDelay (Seconds (greenwoodTimeConstant));
        m_turbulenceTimer.Schedule ();
@@ -205,6 +528,107 @@ FsoDownLinkErrorModel::CalculateNormRxIrradiance (Ptr<FsoSignalParameters> fsoSi
   NS_LOG_DEBUG ("ErrorModel: Normalized Irradiance=" << m_normalizedIrradiance);  
 }
 
+bool
+FsoDownLinkErrorModel::UpdateCorrelationTime (Ptr<FsoSignalParameters> fsoSignalParams)
+{
+  Vector positionTx = fsoSignalParams->txPhy->GetMobility ()->GetPosition ();
+  Vector positionRx = m_phy->GetMobility ()->GetPosition ();
+  double hTx = FsoLinkGeometry::GetAltitude (positionTx);
+  double hRx = FsoLinkGeometry::GetAltitude (positionRx);
+  double elevation = FsoLinkGeometry::GetElevation (positionTx, positionRx);
+  if (hTx == m_gwTxHeight && hRx == m_gwRxHeight && elevation == m_gwElevation && fsoSignalParams->wavelength == m_gwWavelength)
+    {
+      return true;
+    }
+
+  double greenwoodTimeConstant = CalculateTurbulenceTimeConstant (hTx, hRx, fsoSignalParams->wavelength, elevation);
+  if (!(greenwoodTimeConstant > 0.0) || std::isinf (greenwoodTimeConstant))
+    {
+      //e.g. no turbulence between the end points
+      NS_LOG_DEBUG ("ErrorModel: no Greenwood Time Constant (" << greenwoodTimeConstant << "s), sampling every packet");
+      return false;
+    }
+  m_gwTxHeight = hTx;
+  m_gwRxHeight = hRx;
+  m_gwElevation = elevation;
+  m_gwWavelength = fsoSignalParams->wavelength;
+  double current = m_timeSeries.GetCorrelationTime ();
+  if (current <= 0.0 || std::abs (greenwoodTimeConstant - current) > CORRELATION_TIME_TOLERANCE*current)
+    {
+      NS_LOG_DEBUG ("ErrorModel: Greenwood Time Constant=" << greenwoodTimeConstant << "s");
+      m_timeSeries.SetCorrelationTime (greenwoodTimeConstant, Simulator::Now ());
+    }
+  return true;
+}
+
+void
+FsoDownLinkErrorModel::SetApertureAveraging (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_apertureAveraging = enabled;
+}
+
+bool
+FsoDownLinkErrorModel::GetApertureAveraging () const
+{
+  return m_apertureAveraging;
+}
+
+double
+FsoDownLinkErrorModel::GetApertureAveragingFactor (Ptr<FsoSignalParameters> fsoSignalParams)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t n = m_phy->GetNRxAntennas ();
+  if (n <= 1 && !m_apertureAveraging)
+    {
+      return 1.0;
+    }
+
+  double scale = 0.0;
+  if (m_apertureAveraging)
+    {
+      Vector positionTx = fsoSignalParams->txPhy->GetMobility ()->GetPosition ();
+      Vector positionRx = m_phy->GetMobility ()->GetPosition ();
+      double hTx = FsoLinkGeometry::GetAltitude (positionTx);
+      double hRx = FsoLinkGeometry::GetAltitude (positionRx);
+      double elevation = FsoLinkGeometry::GetElevation (positionTx, positionRx);
+
+      if (hTx != m_apertureTxHeight || hRx != m_apertureRxHeight)
+        {
+          //Scale height of the turbulence profile above the receiver
+          double moment2 = m_apertureIntegral.Integrate (hTx, hRx, m_rmsWindSpeed, m_groundRefractiveIdx);
+          double moment56 = m_apertureNormIntegral.Integrate (hTx, hRx, m_rmsWindSpeed, m_groundRefractiveIdx);
+          m_apertureScaleHeight = moment56 > 0.0 ? std::pow (moment2/moment56, 6.0/7.0) : 0.0;
+          m_apertureTxHeight = hTx;
+          m_apertureRxHeight = hRx;
+          NS_LOG_DEBUG ("ErrorModel: turbulence scale height=" << m_apertureScaleHeight << "m");
+        }
+      scale = fsoSignalParams->wavelength*m_apertureScaleHeight/std::max (std::sin (elevation), MIN_ELEVATION_SINE);
+    }
+
+  double sumArea = 0.0;
+  double sumSquares = 0.0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double d = m_phy->GetRxAntenna (i)->GetApertureDiameter ();
+      double area = d*d;
+      double averaging = 1.0;
+      if (scale > 0.0)
+        {
+          averaging = 1.0/(1.0 + 1.1*std::pow (area/scale, 7.0/6.0));
+        }
+      sumArea += area;
+      sumSquares += area*area*averaging;
+    }
+  return sumArea > 0.0 ? sumSquares/(sumArea*sumArea) : 1.0;
+}
+
+double
+FsoDownLinkErrorModel::GetScintillationIndex (Ptr<FsoSignalParameters> fsoSignalParams)
+{
+  return fsoSignalParams->scintillationIndex*GetApertureAveragingFactor (fsoSignalParams);
+}
+
 void FsoDownLinkErrorModel::SetIrradianceUpdate ()
 {
   NS_LOG_FUNCTION (this);
@@ -219,7 +643,8 @@ FsoDownLinkErrorModel::DoAssignStreams (int64_t stream)
   NS_LOG_FUNCTION (this);
 
   m_logNormalDist->SetStream (stream);
-  return 1;
+  m_timeSeries.AssignStreams (stream + 1);
+  return 2;
 }
 
 double 
@@ -241,6 +666,32 @@ GWIntegralFunction (double h, void *params)
   return gwIntegralFunction;
 }
 
+double
+ApertureIntegralFunction (double h, void *params)
+{
+  double A = ((FsoTurbulenceParameters *) params)->A;
+  double v = ((FsoTurbulenceParameters *) params)->v;
+  double hgs = ((FsoTurbulenceParameters *) params)->hgs;
+
+  //Hufnagel-Valley profile weighted by the squared height above the receiver
+  double cn2 = A*std::exp(-hgs/700.0)*std::exp(-(h-hgs)/100.0) + (1.0/(27.0*27.0))*std::pow(v,2.0)*(std::pow(h,10.0))*(5.94e-53)*(std::exp(-h/1000.0)) + (2.7e-16)*std::exp(-h/1500.0);
+
+  return cn2*std::pow(h-hgs,2.0);
+}
+
+double
+ApertureNormIntegralFunction (double h, void *params)
+{
+  double A = ((FsoTurbulenceParameters *) params)->A;
+  double v = ((FsoTurbulenceParameters *) params)->v;
+  double hgs = ((FsoTurbulenceParameters *) params)->hgs;
+
+  //Hufnagel-Valley profile weighted by the height above the receiver to the 5/6
+  double cn2 = A*std::exp(-hgs/700.0)*std::exp(-(h-hgs)/100.0) + (1.0/(27.0*27.0))*std::pow(v,2.0)*(std::pow(h,10.0))*(5.94e-53)*(std::exp(-h/1000.0)) + (2.7e-16)*std::exp(-h/1500.0);
+
+  return cn2*std::pow(h-hgs,5.0/6.0);
+}
+
 double
 ErrorFunction (double t, void *params)
 {
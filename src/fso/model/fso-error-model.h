@@ -28,6 +28,9 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/mobility-model.h"
 #include "fso-signal-parameters.h"
+#include "fso-turbulence-integral.h"
+#include "fso-turbulence-time-series.h"
+#include <vector>
 #ifdef HAVE_GSL
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_integration.h>
@@ -36,17 +39,12 @@
 
 namespace ns3 {
 
-#ifdef HAVE_GSL
-typedef struct GWFunctionParameterType
-{
-  double A;
-  double v;
-  double hgs;
-} GWFunctionParameters;
+typedef FsoTurbulenceParameters GWFunctionParameters;
 
 double ErrorFunction (double t, void *params);
 double GWIntegralFunction (double x, void *params);
-#endif
+double ApertureIntegralFunction (double x, void *params);
+double ApertureNormIntegralFunction (double x, void *params);
 
 /**
  * \ingroup fso
@@ -70,6 +68,22 @@ public:
    */
   virtual double GetPacketSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams) = 0;
 
+  /**
+   * This method returns the probability that a packet will be successfully
+   * received, accounting for the variations of the channel during its
+   * airtime. The default implementation evaluates the channel once with
+   * GetPacketSuccessRate ().
+   *
+   * \param packet pointer to the packet
+   * \param fsoSignalParams pointer to the optical signal parameters
+   * \param start the time at which the reception of the packet starts, not
+   *        earlier than now (packets of a burst start after the first one)
+   * \param duration the airtime of the packet
+   *
+   * \return probability of successfully receiving the packet
+   */
+  virtual double GetAirtimeSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams, Time start, Time duration);
+
   /**
    * If the error model uses random variables,
    * set the stream numbers to the integers starting with the offset
@@ -111,8 +125,9 @@ protected:
  * The received irradiance is a random variable from a log normal distribution.   
  *
  * The greenwood time constant (time for which the atmospheric
- * turbulence can be considered constant) is computed to schedule 
- * an update for the received irradiance. 
+ * turbulence can be considered constant) is the correlation time of the
+ * FsoTurbulenceTimeSeries driving the normalized irradiance, or, with the
+ * independent irradiance model, the period at which a new irradiance is drawn.
  */
 class FsoDownLinkErrorModel : public FsoErrorModel
 {
@@ -123,17 +138,166 @@ public:
   FsoDownLinkErrorModel ();
   ~FsoDownLinkErrorModel ();
 
+  /**
+   * The method used to evaluate the Gaussian tail integral of the BER
+   */
+  enum BerMethod
+  {
+    /**
+     * Numerical integration with GSL (reference, slowest)
+     */
+    BER_GSL_INTEGRATION,
+    /**
+     * Closed form evaluation with std::erfc
+     */
+    BER_CLOSED_FORM,
+    /**
+     * Linear interpolation in a precomputed table of ln(BER)
+     */
+    BER_LOOKUP_TABLE
+  };
+
+  /**
+   * How the normalized irradiance evolves over time
+   */
+  enum IrradianceModel
+  {
+    /**
+     * Correlated time series with the Greenwood time constant as correlation time
+     */
+    IRRADIANCE_TIME_SERIES,
+    /**
+     * Independent log normal draws held for a Greenwood time constant
+     */
+    IRRADIANCE_INDEPENDENT
+  };
+
   /**
    * \param rxPower the received power
    * \return the bit error rate
    */
   double CalculateBer (double rxPower) const;
+
+  /**
+   * \param method the method used by CalculateBer
+   */
+  void SetBerMethod (BerMethod method);
+
+  /**
+   * \return the method used by CalculateBer
+   */
+  BerMethod GetBerMethod () const;
+
+  /**
+   * \param tolerance the maximum relative error of the BER lookup table
+   */
+  void SetBerTableTolerance (double tolerance);
+
+  /**
+   * \return the maximum relative error of the BER lookup table
+   */
+  double GetBerTableTolerance () const;
+
+  /**
+   * \param model how the normalized irradiance evolves over time
+   */
+  void SetIrradianceModel (IrradianceModel model);
+
+  /**
+   * \return how the normalized irradiance evolves over time
+   */
+  IrradianceModel GetIrradianceModel () const;
+
+  /**
+   * \param samples the number of samples of the irradiance time series per correlation time
+   */
+  void SetSamplesPerCorrelationTime (uint32_t samples);
+
+  /**
+   * \return the number of samples of the irradiance time series per correlation time
+   */
+  uint32_t GetSamplesPerCorrelationTime () const;
+
+  /**
+   * \param size the number of samples of the irradiance time series generated at once
+   */
+  void SetTimeSeriesBlockSize (uint32_t size);
+
+  /**
+   * \return the number of samples of the irradiance time series generated at once
+   */
+  uint32_t GetTimeSeriesBlockSize () const;
+
+  /**
+   * \param resolution altitude quantization (m) of the cached integrals, 0 disables the cache
+   */
+  void SetCacheAltitudeResolution (double resolution);
+
+  /**
+   * \return altitude quantization (m) of the cached integrals
+   */
+  double GetCacheAltitudeResolution () const;
+
+  /**
+   * \param tolerance relative quantization of the wind speed and ground index of refraction
+   */
+  void SetCacheParameterTolerance (double tolerance);
+
+  /**
+   * \return relative quantization of the wind speed and ground index of refraction
+   */
+  double GetCacheParameterTolerance () const;
+
+  /**
+   * \param step altitude step (m) of the cumulative profile table, 0 disables the table
+   */
+  void SetProfileTableStep (double step);
+
+  /**
+   * \return altitude step (m) of the cumulative profile table
+   */
+  double GetProfileTableStep () const;
+
+  /**
+   * \param enabled whether the scintillation within each receive aperture is averaged
+   */
+  void SetApertureAveraging (bool enabled);
+
+  /**
+   * \return whether the scintillation within each receive aperture is averaged
+   */
+  bool GetApertureAveraging () const;
+
+  /**
+   * \brief Ratio of the scintillation index of the combined receive apertures to that of a point receiver
+   *
+   * The power of the apertures of the Phy is summed. The apertures are
+   * assumed to be further apart than the correlation width of the
+   * irradiance, so their fluctuations are independent and the scintillation
+   * index of the sum is sum (a_i^2 A_i)/(sum a_i)^2, with a_i the area of
+   * aperture i and A_i its aperture averaging factor, e.g. 1/N for N equal
+   * apertures without aperture averaging. With aperture averaging, A_i is
+   * the downlink approximation
+   *
+   *   A = 1/(1 + 1.1 (D^2/(lambda h0 sec (zenith)))^(7/6))
+   *
+   * with h0 the scale height of the Hufnagel-Valley turbulence profile
+   * (Andrews and Phillips, "Laser Beam Propagation Through Random Media",
+   * Section 12.2). The combined irradiance is kept log normal.
+   *
+   * \param fsoSignalParams the signal parameters
+   * \return the factor applied to the scintillation index, 1 for a single
+   *         aperture without aperture averaging
+   */
+  double GetApertureAveragingFactor (Ptr<FsoSignalParameters> fsoSignalParams);
   
   /**
    * \brief Calculate the normalized irradiance at the receiver
    * 
-   * The normalized irradiance is stored in a member variable and is only re-calculated
-   * when the  
+   * The normalized irradiance is stored in a member variable. With the time
+   * series model it is read from the time series at the current time, with
+   * the independent model it is only re-calculated when the Greenwood time
+   * constant has elapsed since the last draw.
    *
    * \param fsoSignalParams the signal parameters
    */
@@ -161,6 +325,24 @@ public:
   
   //inherited from FsoErrorModel
   virtual double GetPacketSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams);
+
+  /**
+   * With the time series irradiance model, the airtime of the packet is
+   * split at the boundaries of the samples of the time series, the
+   * irradiance being constant in between. The success probability is the
+   * product over these intervals of (1 - BER)^n, with n the number of bits
+   * of the packet received during the interval, so that packets overlapping
+   * a fade are lost while the others are not, whatever the bit rate.
+   * With the independent irradiance model, this is GetPacketSuccessRate ().
+   *
+   * \param packet pointer to the packet
+   * \param fsoSignalParams pointer to the optical signal parameters
+   * \param start the time at which the reception of the packet starts
+   * \param duration the airtime of the packet
+   *
+   * \return probability of successfully receiving the packet
+   */
+  virtual double GetAirtimeSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams, Time start, Time duration);
   
   /**
    * \brief When called, the error model will update the irradiance parameters upon the 
@@ -171,11 +353,79 @@ public:
   void SetIrradianceUpdate ();
 
 private:
+  /**
+   * \param q argument of the Gaussian tail integral
+   * \return the bit error rate computed with GSL numerical integration
+   */
+  double CalculateBerIntegral (double q) const;
+
+  /**
+   * \param q argument of the Gaussian tail integral
+   * \return the bit error rate computed with std::erfc
+   */
+  double CalculateBerClosedForm (double q) const;
+
+  /**
+   * \param q argument of the Gaussian tail integral
+   * \return the bit error rate interpolated from the lookup table
+   */
+  double CalculateBerLookup (double q) const;
+
+  /**
+   * Build the table of ln(BER) sampled uniformly over the Gaussian tail
+   * argument. ln(BER) is concave with a second derivative bounded by 1 in
+   * magnitude, so linear interpolation with a step h has an absolute error
+   * on ln(BER) (i.e., a relative error on the BER) of at most h^2/8.
+   */
+  void BuildBerTable () const;
+
+  /**
+   * Update the correlation time of the irradiance time series when the
+   * geometry or the wavelength of the link changed
+   *
+   * \param fsoSignalParams the signal parameters
+   * \return false if the link has no finite Greenwood time constant, the
+   *         packets then see independent irradiance draws
+   */
+  bool UpdateCorrelationTime (Ptr<FsoSignalParameters> fsoSignalParams);
+
+  /**
+   * \param fsoSignalParams the signal parameters
+   * \param normIrradiance the normalized irradiance at the receiver
+   * \return the bit error rate
+   */
+  double CalculateBerAtIrradiance (Ptr<FsoSignalParameters> fsoSignalParams, double normIrradiance) const;
+
+  /**
+   * \param fsoSignalParams the signal parameters
+   * \return the scintillation index of the combined receive apertures
+   */
+  double GetScintillationIndex (Ptr<FsoSignalParameters> fsoSignalParams);
+
   Ptr<LogNormalRandomVariable> m_logNormalDist; //!< Pointer to the log normal random variable
 
+  BerMethod m_berMethod;        //!< Method used to compute the bit error rate
+  double m_berTableTolerance;   //!< Maximum relative error of the BER lookup table
+  mutable std::vector<double> m_berTable; //!< ln(BER) sampled every m_berTableStep, built on first use
+  mutable double m_berTableStep;//!< Step of the BER lookup table
+
   double m_groundRefractiveIdx; //!< Index of refraction at ground level
   double m_rmsWindSpeed;        //!< The RMS wind speed in m/s
   double m_normalizedIrradiance;//!< The normalized irradiance at the receiver (unitless) 
+  FsoTurbulenceIntegral m_gwIntegral; //!< Cached integral for the Greenwood time constant
+  FsoTurbulenceIntegral m_apertureIntegral;     //!< Cached second moment of the profile for the scale height
+  FsoTurbulenceIntegral m_apertureNormIntegral; //!< Cached 5/6 moment of the profile for the scale height
+  bool m_apertureAveraging;     //!< Whether the scintillation is averaged over each aperture
+  double m_apertureTxHeight;    //!< Transmitter height of the last turbulence scale height
+  double m_apertureRxHeight;    //!< Receiver height of the last turbulence scale height
+  double m_apertureScaleHeight; //!< Scale height (m) of the turbulence profile
+
+  IrradianceModel m_irradianceModel; //!< How the normalized irradiance evolves over time
+  FsoTurbulenceTimeSeries m_timeSeries; //!< Log-amplitude fluctuations at the receiver
+  double m_gwTxHeight;          //!< Transmitter height of the last Greenwood time constant
+  double m_gwRxHeight;          //!< Receiver height of the last Greenwood time constant
+  double m_gwElevation;         //!< Elevation of the last Greenwood time constant
+  double m_gwWavelength;        //!< Wavelength of the last Greenwood time constant
 
   bool m_updateIrradiance;      //!< Denotes if the irradiance at the receiver should be updated
   Timer m_turbulenceTimer;      //!< Timer related to the greenwood constant for irradiance calculation
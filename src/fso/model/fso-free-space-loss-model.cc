@@ -23,6 +23,7 @@
 #include <ns3/math.h>
 #include <ns3/log.h>
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 
 namespace ns3 {
 
@@ -41,7 +42,7 @@ FsoFreeSpaceLossModel::~FsoFreeSpaceLossModel ()
 void
 FsoFreeSpaceLossModel::DoDispose ()
 {
-  
+  m_linkCache.Clear ();
 }
 
 TypeId
@@ -50,7 +51,21 @@ FsoFreeSpaceLossModel::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::FsoFreeSpaceLossModel")
     .SetParent<Object> ()
     .SetGroupName ("Fso")
-    .AddConstructor<FsoFreeSpaceLossModel> ();
+    .AddConstructor<FsoFreeSpaceLossModel> ()
+    .AddAttribute ("LinkCache",
+                   "Cache the result of the model for each (transmitter, receiver) link until an end point moves or changes course",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FsoFreeSpaceLossModel::SetLinkCache,
+                                        &FsoFreeSpaceLossModel::GetLinkCache),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LinkCachePositionThreshold",
+                   "The distance (meters) an end point may move before the cached state of its links is recomputed, "
+                   "0 only reuses the state of links whose end points have not moved",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoFreeSpaceLossModel::SetLinkCachePositionThreshold,
+                                       &FsoFreeSpaceLossModel::GetLinkCachePositionThreshold),
+                   MakeDoubleChecker<double> (0.0))
+  ;
 
   return tid;
 }
@@ -62,12 +77,27 @@ FsoFreeSpaceLossModel::DoAssignStreams (int64_t stream)
 }
 
 void
-FsoFreeSpaceLossModel::DoUpdateSignalParams(Ptr<FsoSignalParameters> fsoSignalParams, Ptr<const MobilityModel> a, Ptr<const MobilityModel> b)
+FsoFreeSpaceLossModel::DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b)
 {
-  double distance = a->GetDistanceFrom (b);
-  fsoSignalParams->pathLoss = CalculateFreeSpaceLoss(distance, fsoSignalParams->wavelength);
+  m_linkCache.Listen (a);
+  m_linkCache.Listen (b);
+}
+
+void
+FsoFreeSpaceLossModel::DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                             const Vector &positionA, const Vector &positionB)
+{
+  LinkState state;
+  if (!m_linkCache.Lookup (a, b, positionA, positionB, state) || state.wavelength != fsoSignalParams->wavelength)
+    {
+      double distance = CalculateDistance (positionA, positionB);
+      state.wavelength = fsoSignalParams->wavelength;
+      state.pathLoss = CalculateFreeSpaceLoss(distance, fsoSignalParams->wavelength);
+      m_linkCache.Add (a, b, positionA, positionB, state);
+      NS_LOG_DEBUG ("FreeSpaceLoss: distance=" << distance << "m, frequency=" << fsoSignalParams->frequency << "Hz, loss=" << state.pathLoss << "dB");
+    }
+  fsoSignalParams->pathLoss = state.pathLoss;
   fsoSignalParams->power -= fsoSignalParams->pathLoss;
-  NS_LOG_DEBUG ("FreeSpaceLoss: distance=" << distance << "m, frequency=" << fsoSignalParams->frequency << "Hz, loss=" << fsoSignalParams->pathLoss << "dB");
 }
 
 
@@ -79,4 +109,30 @@ FsoFreeSpaceLossModel::CalculateFreeSpaceLoss (double d, double wavelength)
 
 
 
+void
+FsoFreeSpaceLossModel::SetLinkCache (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_linkCache.SetEnabled (enabled);
+}
+
+bool
+FsoFreeSpaceLossModel::GetLinkCache () const
+{
+  return m_linkCache.IsEnabled ();
+}
+
+void
+FsoFreeSpaceLossModel::SetLinkCachePositionThreshold (double threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+  m_linkCache.SetPositionThreshold (threshold);
+}
+
+double
+FsoFreeSpaceLossModel::GetLinkCachePositionThreshold () const
+{
+  return m_linkCache.GetPositionThreshold ();
+}
+
 } // namespace ns3
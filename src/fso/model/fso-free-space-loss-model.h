@@ -26,6 +26,7 @@
 #include <ns3/mobility-model.h>
 #include "fso-signal-parameters.h"
 #include "fso-propagation-loss-model.h"
+#include "fso-link-cache.h"
 
 namespace ns3 {
 
@@ -67,12 +68,46 @@ public:
   double CalculateFreeSpaceLoss (double d, double wavelength);
 
 
+  /**
+   * \param enabled whether the state of each (transmitter, receiver) link is cached
+   */
+  void SetLinkCache (bool enabled);
+
+  /**
+   * \return whether the state of each (transmitter, receiver) link is cached
+   */
+  bool GetLinkCache () const;
+
+  /**
+   * \param threshold distance (m) an end point may move before the state of its links is recomputed
+   */
+  void SetLinkCachePositionThreshold (double threshold);
+
+  /**
+   * \return distance (m) an end point may move before the state of its links is recomputed
+   */
+  double GetLinkCachePositionThreshold () const;
+
 protected:
   //Inherited from Object
   virtual void DoDispose ();
 
   //Inherited from FsoPropagationLossModel
-  virtual void DoUpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, Ptr<const MobilityModel> a, Ptr<const MobilityModel> b);
+  virtual void DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                     const Vector &positionA, const Vector &positionB);
+  virtual void DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b);
+
+private:
+  /**
+   * Free space loss of a link
+   */
+  struct LinkState
+  {
+    double wavelength; //!< wavelength of the signal (m)
+    double pathLoss;   //!< free space loss (dB)
+  };
+
+  FsoLinkCache<LinkState> m_linkCache; //!< Free space loss of the links
 };
 
 
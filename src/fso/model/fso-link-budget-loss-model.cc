@@ -0,0 +1,273 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "fso-link-budget-loss-model.h"
+#include "fso-link-geometry.h"
+#include "fso-satellite-mobility-model.h"
+#include "ns3/simulator.h"
+#include "ns3/pointer.h"
+#include "ns3/log.h"
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsoLinkBudgetLossModel");
+
+NS_OBJECT_ENSURE_REGISTERED (FsoLinkBudgetLossModel);
+
+FsoLinkBudgetLossModel::FsoLinkBudgetLossModel ()
+{
+}
+
+FsoLinkBudgetLossModel::~FsoLinkBudgetLossModel ()
+{
+}
+
+void
+FsoLinkBudgetLossModel::DoDispose ()
+{
+  m_tables.clear ();
+  m_lossModel = 0;
+  FsoPropagationLossModel::DoDispose ();
+}
+
+TypeId
+FsoLinkBudgetLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FsoLinkBudgetLossModel")
+    .SetParent<FsoPropagationLossModel> ()
+    .SetGroupName ("Fso")
+    .AddConstructor<FsoLinkBudgetLossModel> ()
+    .AddAttribute ("LossModel",
+                   "The chain of loss models tabulated, and used for the links that are not tabulated",
+                   PointerValue (),
+                   MakePointerAccessor (&FsoLinkBudgetLossModel::SetLossModel,
+                                        &FsoLinkBudgetLossModel::GetLossModel),
+                   MakePointerChecker<FsoPropagationLossModel> ())
+    .AddAttribute ("Resolution",
+                   "The time between two samples of the tables computed by Precompute",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&FsoLinkBudgetLossModel::SetResolution,
+                                     &FsoLinkBudgetLossModel::GetResolution),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+int64_t
+FsoLinkBudgetLossModel::DoAssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+void
+FsoLinkBudgetLossModel::SetLossModel (Ptr<FsoPropagationLossModel> model)
+{
+  m_lossModel = model;
+}
+
+Ptr<FsoPropagationLossModel>
+FsoLinkBudgetLossModel::GetLossModel () const
+{
+  return m_lossModel;
+}
+
+void
+FsoLinkBudgetLossModel::SetResolution (Time resolution)
+{
+  NS_ASSERT (resolution.IsStrictlyPositive ());
+  m_resolution = resolution;
+}
+
+Time
+FsoLinkBudgetLossModel::GetResolution () const
+{
+  return m_resolution;
+}
+
+Vector
+FsoLinkBudgetLossModel::GetPositionAt (const Ptr<const MobilityModel> &mobility, Time t)
+{
+  Ptr<const FsoSatelliteMobilityModel> satellite = DynamicCast<const FsoSatelliteMobilityModel> (mobility);
+  if (satellite != 0)
+    {
+      return satellite->GetPositionAt (t);
+    }
+  return mobility->GetPosition ();
+}
+
+void
+FsoLinkBudgetLossModel::Precompute (Ptr<MobilityModel> a, Ptr<MobilityModel> b, Ptr<FsoSignalParameters> fsoSignalParams,
+                                    Time start, Time stop)
+{
+  NS_LOG_FUNCTION (this << a << b << start << stop);
+  NS_ASSERT_MSG (m_lossModel != 0, "No loss model to tabulate");
+  NS_ASSERT (stop >= start);
+
+  Table table;
+  table.a = a;
+  table.b = b;
+  table.start = start;
+  table.resolution = m_resolution;
+  table.wavelength = fsoSignalParams->wavelength;
+  table.txBeamwidth = fsoSignalParams->txBeamwidth;
+
+  //The loss models see the end points at their future positions
+  Ptr<const MobilityModel> constA = a;
+  Ptr<const MobilityModel> constB = b;
+  m_lossModel->PrepareLink (constA, constB);
+
+  uint64_t n = static_cast<uint64_t> (std::ceil ((stop - start).GetSeconds ()/m_resolution.GetSeconds ())) + 1;
+  table.samples.reserve (n);
+  for (uint64_t i = 0; i < n; i++)
+    {
+      Time t = start + m_resolution*static_cast<int64_t> (i);
+      Vector positionA = GetPositionAt (a, t);
+      Vector positionB = GetPositionAt (b, t);
+
+      Ptr<FsoSignalParameters> params = fsoSignalParams->Copy ();
+      m_lossModel->UpdateSignalParams (params, constA, constB, positionA, positionB);
+
+      Sample sample;
+      sample.elevation = FsoLinkGeometry::GetElevation (positionA, positionB);
+      sample.range = CalculateDistance (positionA, positionB);
+      sample.delay = sample.range/FsoLinkGeometry::SPEED_OF_LIGHT;
+      sample.pathLoss = params->pathLoss;
+      sample.powerChange = params->power - fsoSignalParams->power;
+      sample.meanIrradiance = params->meanIrradiance;
+      sample.scintillationIndex = params->scintillationIndex;
+      sample.rxPhaseFrontRadius = params->rxPhaseFrontRadius;
+      table.samples.push_back (sample);
+    }
+  NS_LOG_DEBUG ("LinkBudget: " << n << " samples from " << start.GetSeconds () << "s");
+
+  m_tables[std::make_pair (PeekPointer (a), PeekPointer (b))] = table;
+}
+
+bool
+FsoLinkBudgetLossModel::GetSample (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b, Time t, Sample &sample) const
+{
+  TableMap::const_iterator it = m_tables.find (std::make_pair (PeekPointer (a), PeekPointer (b)));
+  if (it == m_tables.end ())
+    {
+      return false;
+    }
+  const Table &table = it->second;
+  double x = (t - table.start).GetSeconds ()/table.resolution.GetSeconds ();
+  if (x < 0.0 || x > table.samples.size () - 1)
+    {
+      return false;
+    }
+
+  std::size_t i = static_cast<std::size_t> (x);
+  if (i + 1 >= table.samples.size ())
+    {
+      sample = table.samples.back ();
+      return true;
+    }
+  double w = x - i;
+  const Sample &s0 = table.samples[i];
+  const Sample &s1 = table.samples[i + 1];
+  sample.elevation = s0.elevation + w*(s1.elevation - s0.elevation);
+  sample.range = s0.range + w*(s1.range - s0.range);
+  sample.delay = s0.delay + w*(s1.delay - s0.delay);
+  sample.pathLoss = s0.pathLoss + w*(s1.pathLoss - s0.pathLoss);
+  sample.powerChange = s0.powerChange + w*(s1.powerChange - s0.powerChange);
+  sample.meanIrradiance = s0.meanIrradiance + w*(s1.meanIrradiance - s0.meanIrradiance);
+  sample.scintillationIndex = s0.scintillationIndex + w*(s1.scintillationIndex - s0.scintillationIndex);
+  sample.rxPhaseFrontRadius = s0.rxPhaseFrontRadius + w*(s1.rxPhaseFrontRadius - s0.rxPhaseFrontRadius);
+  return true;
+}
+
+std::vector<std::pair<Time, Time> >
+FsoLinkBudgetLossModel::GetPasses (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                   double minElevation) const
+{
+  std::vector<std::pair<Time, Time> > passes;
+  TableMap::const_iterator it = m_tables.find (std::make_pair (PeekPointer (a), PeekPointer (b)));
+  if (it == m_tables.end ())
+    {
+      return passes;
+    }
+  const Table &table = it->second;
+  bool visible = false;
+  for (uint64_t i = 0; i < table.samples.size (); i++)
+    {
+      Time t = table.start + table.resolution*static_cast<int64_t> (i);
+      if (table.samples[i].elevation >= minElevation)
+        {
+          if (!visible)
+            {
+              passes.push_back (std::make_pair (t, t));
+            }
+          passes.back ().second = t;
+          visible = true;
+        }
+      else
+        {
+          visible = false;
+        }
+    }
+  return passes;
+}
+
+void
+FsoLinkBudgetLossModel::Clear ()
+{
+  NS_LOG_FUNCTION (this);
+  m_tables.clear ();
+}
+
+void
+FsoLinkBudgetLossModel::DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b)
+{
+  if (m_lossModel != 0)
+    {
+      m_lossModel->PrepareLink (a, b);
+    }
+}
+
+void
+FsoLinkBudgetLossModel::DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams,
+                                              const Ptr<const MobilityModel> &a,
+                                              const Ptr<const MobilityModel> &b,
+                                              const Vector &positionA,
+                                              const Vector &positionB)
+{
+  NS_LOG_FUNCTION (this);
+  Sample sample;
+  TableMap::const_iterator it = m_tables.find (std::make_pair (PeekPointer (a), PeekPointer (b)));
+  if (it != m_tables.end ()
+      && it->second.wavelength == fsoSignalParams->wavelength
+      && it->second.txBeamwidth == fsoSignalParams->txBeamwidth
+      && GetSample (a, b, Simulator::Now (), sample))
+    {
+      fsoSignalParams->pathLoss = sample.pathLoss;
+      fsoSignalParams->power += sample.powerChange;
+      fsoSignalParams->meanIrradiance = sample.meanIrradiance;
+      fsoSignalParams->scintillationIndex = sample.scintillationIndex;
+      fsoSignalParams->rxPhaseFrontRadius = sample.rxPhaseFrontRadius;
+      return;
+    }
+
+  if (m_lossModel != 0)
+    {
+      m_lossModel->UpdateSignalParams (fsoSignalParams, a, b, positionA, positionB);
+    }
+}
+
+} // namespace ns3
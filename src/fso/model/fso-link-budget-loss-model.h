@@ -0,0 +1,185 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef FSO_LINK_BUDGET_LOSS_MODEL_H
+#define FSO_LINK_BUDGET_LOSS_MODEL_H
+
+#include <map>
+#include <vector>
+#include <utility>
+#include "ns3/nstime.h"
+#include "ns3/mobility-model.h"
+#include "fso-signal-parameters.h"
+#include "fso-propagation-loss-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Propagation loss model replaying a link budget tabulated in advance
+ *
+ * Precompute () evaluates a chain of loss models (the LossModel attribute)
+ * over a time interval, typically a satellite pass, at the positions the
+ * end points will have every Resolution. The positions of an
+ * FsoSatelliteMobilityModel are given by its orbit, other mobility models
+ * are assumed not to move during the interval. The table holds the
+ * elevation, range, propagation delay, path loss, mean irradiance and
+ * scintillation index of the link.
+ *
+ * During the simulation, the signal parameters of a tabulated link are
+ * interpolated linearly in the table at the current time, instead of
+ * evaluating the loss models and the geometry for every packet. Links which
+ * are not tabulated, signals of another wavelength or beamwidth, and times
+ * outside of the table fall back to the LossModel chain.
+ *
+ * The table also gives the schedule of the link: GetPasses () returns the
+ * intervals during which the transmitter is above an elevation.
+ */
+class FsoLinkBudgetLossModel : public FsoPropagationLossModel
+{
+public:
+  FsoLinkBudgetLossModel ();
+  virtual ~FsoLinkBudgetLossModel ();
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * State of a link at a given time
+   */
+  struct Sample
+  {
+    double elevation;          //!< elevation of the transmitter seen from the receiver (rad)
+    double range;              //!< distance between the end points (m)
+    double delay;              //!< propagation delay (s)
+    double pathLoss;           //!< path loss (dB)
+    double powerChange;        //!< change of the signal power through the loss models (dB)
+    double meanIrradiance;     //!< mean irradiance at the receiver (W/m^2)
+    double scintillationIndex; //!< scintillation index
+    double rxPhaseFrontRadius; //!< phase front radius of curvature at the receiver (m)
+  };
+
+  /**
+   * \param model the chain of loss models tabulated, and used for the links
+   *        that are not tabulated
+   */
+  void SetLossModel (Ptr<FsoPropagationLossModel> model);
+
+  /**
+   * \return the chain of loss models tabulated
+   */
+  Ptr<FsoPropagationLossModel> GetLossModel () const;
+
+  /**
+   * \param resolution the time between two samples of a table
+   */
+  void SetResolution (Time resolution);
+
+  /**
+   * \return the time between two samples of a table
+   */
+  Time GetResolution () const;
+
+  /**
+   * Tabulate the link from a to b between start and stop, replacing a
+   * previous table of the link
+   *
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param fsoSignalParams the signal parameters of the transmitter
+   * \param start the start of the table
+   * \param stop the end of the table
+   */
+  void Precompute (Ptr<MobilityModel> a, Ptr<MobilityModel> b, Ptr<FsoSignalParameters> fsoSignalParams,
+                   Time start, Time stop);
+
+  /**
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param t the time
+   * \param sample receives the state of the link interpolated at time t
+   * \return true if the link is tabulated at time t
+   */
+  bool GetSample (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b, Time t, Sample &sample) const;
+
+  /**
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param minElevation the minimum elevation of the transmitter (rad)
+   * \return the (start, stop) intervals of the table during which the
+   *         transmitter is at least minElevation above the horizon of the receiver
+   */
+  std::vector<std::pair<Time, Time> > GetPasses (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                                 double minElevation) const;
+
+  /**
+   * Discard all the tables
+   */
+  void Clear ();
+
+  /**
+   * \param mobility a mobility model
+   * \param t the time
+   * \return the position of the mobility model at time t, the current one
+   *         unless it is an FsoSatelliteMobilityModel
+   */
+  static Vector GetPositionAt (const Ptr<const MobilityModel> &mobility, Time t);
+
+  //Inherited from FsoPropagationLossModel
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+protected:
+  //Inherited from Object
+  virtual void DoDispose ();
+
+private:
+  virtual void DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams,
+                                     const Ptr<const MobilityModel> &a,
+                                     const Ptr<const MobilityModel> &b,
+                                     const Vector &positionA,
+                                     const Vector &positionB);
+  virtual void DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b);
+
+  /**
+   * Tabulated link
+   */
+  struct Table
+  {
+    Ptr<MobilityModel> a;      //!< transmitter mobility, keeps the key alive
+    Ptr<MobilityModel> b;      //!< receiver mobility, keeps the key alive
+    Time start;                //!< time of the first sample
+    Time resolution;           //!< time between two samples
+    double wavelength;         //!< wavelength of the tabulated signal (m)
+    double txBeamwidth;        //!< beamwidth of the tabulated signal (m)
+    std::vector<Sample> samples; //!< samples of the link
+  };
+
+  /// Tables indexed by (transmitter, receiver)
+  typedef std::map<std::pair<const MobilityModel *, const MobilityModel *>, Table> TableMap;
+
+  Ptr<FsoPropagationLossModel> m_lossModel; //!< chain of loss models tabulated
+  Time m_resolution;                        //!< time between two samples of new tables
+  TableMap m_tables;                        //!< tabulated links
+};
+
+} // namespace ns3
+
+#endif /* FSO_LINK_BUDGET_LOSS_MODEL_H */
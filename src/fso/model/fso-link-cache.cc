@@ -0,0 +1,168 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "fso-link-cache.h"
+#include "ns3/log.h"
+#include "ns3/callback.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsoLinkCache");
+
+FsoLinkCacheBase::FsoLinkCacheBase ()
+  : m_enabled (true),
+    m_hits (0),
+    m_misses (0),
+    m_positionThreshold (0.0)
+{
+}
+
+FsoLinkCacheBase::~FsoLinkCacheBase ()
+{
+  //The derived entries are already destroyed, only disconnect the trace sources
+  for (std::unordered_map<const MobilityModel *, Tracked>::iterator it = m_tracked.begin (); it != m_tracked.end (); ++it)
+    {
+      it->second.mobility->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&FsoLinkCacheBase::NotifyCourseChange, this));
+    }
+}
+
+void
+FsoLinkCacheBase::SetPositionThreshold (double threshold)
+{
+  m_positionThreshold = threshold;
+  Clear ();
+}
+
+double
+FsoLinkCacheBase::GetPositionThreshold () const
+{
+  return m_positionThreshold;
+}
+
+void
+FsoLinkCacheBase::SetEnabled (bool enabled)
+{
+  m_enabled = enabled;
+  Clear ();
+}
+
+bool
+FsoLinkCacheBase::IsEnabled () const
+{
+  return m_enabled;
+}
+
+uint64_t
+FsoLinkCacheBase::GetHits () const
+{
+  return m_hits;
+}
+
+uint64_t
+FsoLinkCacheBase::GetMisses () const
+{
+  return m_misses;
+}
+
+void
+FsoLinkCacheBase::Clear ()
+{
+  NS_LOG_FUNCTION (this);
+#ifdef HAVE_PTHREAD_H
+  CriticalSection cs (m_mutex);
+#endif
+  DoClearLinks ();
+  for (std::unordered_map<const MobilityModel *, Tracked>::iterator it = m_tracked.begin (); it != m_tracked.end (); ++it)
+    {
+      it->second.mobility->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&FsoLinkCacheBase::NotifyCourseChange, this));
+    }
+  m_tracked.clear ();
+}
+
+bool
+FsoLinkCacheBase::IsValid (const LinkState &state, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                           const Vector &positionA, const Vector &positionB)
+{
+  uint32_t epochA;
+  uint32_t epochB;
+  if (!GetEpoch (a, epochA) || !GetEpoch (b, epochB)
+      || state.epochA != epochA || state.epochB != epochB)
+    {
+      return false;
+    }
+  if (m_positionThreshold <= 0.0)
+    {
+      return positionA.x == state.positionA.x && positionA.y == state.positionA.y && positionA.z == state.positionA.z
+             && positionB.x == state.positionB.x && positionB.y == state.positionB.y && positionB.z == state.positionB.z;
+    }
+  return CalculateDistance (positionA, state.positionA) <= m_positionThreshold
+         && CalculateDistance (positionB, state.positionB) <= m_positionThreshold;
+}
+
+bool
+FsoLinkCacheBase::Track (LinkState &state, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                         const Vector &positionA, const Vector &positionB)
+{
+  state.positionA = positionA;
+  state.positionB = positionB;
+  return GetEpoch (a, state.epochA) && GetEpoch (b, state.epochB);
+}
+
+bool
+FsoLinkCacheBase::GetEpoch (const Ptr<const MobilityModel> &mobility, uint32_t &epoch) const
+{
+  std::unordered_map<const MobilityModel *, Tracked>::const_iterator it = m_tracked.find (PeekPointer (mobility));
+  if (it == m_tracked.end ())
+    {
+      return false;
+    }
+  epoch = it->second.epoch;
+  return true;
+}
+
+void
+FsoLinkCacheBase::Listen (const Ptr<const MobilityModel> &mobility)
+{
+#ifdef HAVE_PTHREAD_H
+  CriticalSection cs (m_mutex);
+#endif
+  if (!m_enabled || m_tracked.find (PeekPointer (mobility)) != m_tracked.end ())
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Listening to the course changes of " << PeekPointer (mobility));
+  Tracked tracked;
+  tracked.mobility = ConstCast<MobilityModel> (mobility);
+  tracked.epoch = 0;
+  tracked.mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&FsoLinkCacheBase::NotifyCourseChange, this));
+  m_tracked.insert (std::make_pair (PeekPointer (mobility), tracked));
+}
+
+void
+FsoLinkCacheBase::NotifyCourseChange (Ptr<const MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << mobility);
+#ifdef HAVE_PTHREAD_H
+  CriticalSection cs (m_mutex);
+#endif
+  std::unordered_map<const MobilityModel *, Tracked>::iterator it = m_tracked.find (PeekPointer (mobility));
+  if (it != m_tracked.end ())
+    {
+      it->second.epoch++;
+    }
+}
+
+} // namespace ns3
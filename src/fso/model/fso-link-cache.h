@@ -0,0 +1,315 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FSO_LINK_CACHE_H
+#define FSO_LINK_CACHE_H
+
+#include <stdint.h>
+#include <functional>
+#include <unordered_map>
+#include "ns3/core-config.h"
+#include "ns3/ptr.h"
+#include "ns3/vector.h"
+#include "ns3/mobility-model.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-mutex.h"
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Bookkeeping shared by the link caches of the fso propagation loss models
+ *
+ * Links are identified by the (transmitter, receiver) pair of mobility
+ * models. The cached state of a link stays valid while both end points are
+ * within a position threshold of where they were when it was computed and
+ * neither mobility model has notified a course change since. A threshold
+ * of 0 only reuses the state of links whose end points have not moved.
+ *
+ * The caches may be used concurrently by the receivers of a transmission
+ * (see FsoChannel). The simulator thread listens to the course changes of
+ * the end points with Listen () beforehand, the other threads only read the
+ * number of course changes; links with an end point that is not listened
+ * to are not cached.
+ */
+class FsoLinkCacheBase
+{
+public:
+  FsoLinkCacheBase ();
+  virtual ~FsoLinkCacheBase ();
+
+  /**
+   * \param threshold the distance (m) an end point may move before the
+   *        state of its links is recomputed
+   */
+  void SetPositionThreshold (double threshold);
+
+  /**
+   * \return the distance (m) an end point may move before the state of its
+   *         links is recomputed
+   */
+  double GetPositionThreshold () const;
+
+  /**
+   * \param enabled whether link states are cached
+   */
+  void SetEnabled (bool enabled);
+
+  /**
+   * \return whether link states are cached
+   */
+  bool IsEnabled () const;
+
+  /**
+   * \return the number of link states served from the cache
+   */
+  uint64_t GetHits () const;
+
+  /**
+   * \return the number of link states computed
+   */
+  uint64_t GetMisses () const;
+
+  /**
+   * Discard all link states and stop listening to the mobility models
+   */
+  void Clear ();
+
+  /**
+   * Listen to the course changes of a mobility model, so that the links
+   * it is an end point of can be cached. Must be called by the simulator
+   * thread.
+   *
+   * \param mobility a mobility model
+   */
+  void Listen (const Ptr<const MobilityModel> &mobility);
+
+protected:
+  /**
+   * Identifies a link by its end points
+   */
+  struct LinkKey
+  {
+    const MobilityModel *a; //!< transmitter mobility
+    const MobilityModel *b; //!< receiver mobility
+
+    /**
+     * \param o the other key
+     * \return true if both keys identify the same link
+     */
+    bool operator == (const LinkKey &o) const
+    {
+      return a == o.a && b == o.b;
+    }
+  };
+
+  /**
+   * Hash of a LinkKey
+   */
+  struct LinkKeyHash
+  {
+    /**
+     * \param k the key
+     * \return the hash of the key
+     */
+    std::size_t operator () (const LinkKey &k) const
+    {
+      std::size_t h = std::hash<const void *> () (k.a);
+      return h ^ (std::hash<const void *> () (k.b) + 0x9e3779b9 + (h << 6) + (h >> 2));
+    }
+  };
+
+  /**
+   * Geometry of a link when its state was computed
+   */
+  struct LinkState
+  {
+    Vector positionA;  //!< transmitter position
+    Vector positionB;  //!< receiver position
+    uint32_t epochA;   //!< course changes of the transmitter
+    uint32_t epochB;   //!< course changes of the receiver
+  };
+
+  /**
+   * Must be called with m_mutex held
+   *
+   * \param state the cached geometry of the link
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param positionA transmitter position
+   * \param positionB receiver position
+   * \return true if the cached state of the link may be reused
+   */
+  bool IsValid (const LinkState &state, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                const Vector &positionA, const Vector &positionB);
+
+  /**
+   * Record the geometry of a link. Must be called with m_mutex held.
+   *
+   * \param state the geometry to fill
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param positionA transmitter position
+   * \param positionB receiver position
+   * \return false if an end point is not listened to, the link must then
+   *         not be cached
+   */
+  bool Track (LinkState &state, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+              const Vector &positionA, const Vector &positionB);
+
+  /**
+   * Discard the link states of the derived class, called with m_mutex held
+   */
+  virtual void DoClearLinks () = 0;
+
+#ifdef HAVE_PTHREAD_H
+  SystemMutex m_mutex;     //!< protects the cache
+#endif
+  bool m_enabled;          //!< whether link states are cached
+  uint64_t m_hits;         //!< number of link states served from the cache
+  uint64_t m_misses;       //!< number of link states computed
+
+private:
+  /**
+   * Invalidate the links of a mobility model
+   *
+   * \param mobility the mobility model that changed course
+   */
+  void NotifyCourseChange (Ptr<const MobilityModel> mobility);
+
+  /**
+   * Must be called with m_mutex held
+   *
+   * \param mobility a mobility model
+   * \param epoch receives the number of course changes notified by the
+   *        mobility model
+   * \return false if the mobility model is not listened to
+   */
+  bool GetEpoch (const Ptr<const MobilityModel> &mobility, uint32_t &epoch) const;
+
+  /**
+   * Course change bookkeeping of a mobility model
+   */
+  struct Tracked
+  {
+    Ptr<MobilityModel> mobility; //!< keeps the key alive and allows disconnecting
+    uint32_t epoch;              //!< number of course changes
+  };
+
+  double m_positionThreshold;  //!< allowed displacement (m) of an end point
+  std::unordered_map<const MobilityModel *, Tracked> m_tracked; //!< mobility models listened to
+};
+
+/**
+ * \ingroup fso
+ *
+ * \brief Per (transmitter, receiver) cache of the state computed by a propagation loss model
+ *
+ * T holds the inputs the state was computed from along with the results,
+ * so that a model can check that a cached state matches the signal.
+ */
+template <class T>
+class FsoLinkCache : public FsoLinkCacheBase
+{
+public:
+  /**
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param positionA transmitter position
+   * \param positionB receiver position
+   * \param data receives the cached state of the link if it is valid
+   * \return true if a valid state was found
+   */
+  bool Lookup (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+               const Vector &positionA, const Vector &positionB, T &data)
+  {
+#ifdef HAVE_PTHREAD_H
+    CriticalSection cs (m_mutex);
+#endif
+    if (!m_enabled)
+      {
+        return false;
+      }
+    LinkKey key;
+    key.a = PeekPointer (a);
+    key.b = PeekPointer (b);
+    typename EntryMap::const_iterator it = m_entries.find (key);
+    if (it == m_entries.end () || !IsValid (it->second.link, a, b, positionA, positionB))
+      {
+        m_misses++;
+        return false;
+      }
+    m_hits++;
+    data = it->second.data;
+    return true;
+  }
+
+  /**
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param positionA transmitter position the state was computed at
+   * \param positionB receiver position the state was computed at
+   * \param data the state of the link
+   */
+  void Add (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+            const Vector &positionA, const Vector &positionB, const T &data)
+  {
+#ifdef HAVE_PTHREAD_H
+    CriticalSection cs (m_mutex);
+#endif
+    if (!m_enabled)
+      {
+        return;
+      }
+    LinkKey key;
+    key.a = PeekPointer (a);
+    key.b = PeekPointer (b);
+    LinkState link;
+    if (!Track (link, a, b, positionA, positionB))
+      {
+        return;
+      }
+    Entry &entry = m_entries[key];
+    entry.link = link;
+    entry.data = data;
+  }
+
+private:
+  virtual void DoClearLinks ()
+  {
+    m_entries.clear ();
+  }
+
+  /**
+   * A cached link
+   */
+  struct Entry
+  {
+    LinkState link; //!< geometry of the link
+    T data;         //!< state computed by the model
+  };
+
+  /// Cached links
+  typedef std::unordered_map<LinkKey, Entry, LinkKeyHash> EntryMap;
+
+  EntryMap m_entries; //!< cached links
+};
+
+} // namespace ns3
+
+#endif /* FSO_LINK_CACHE_H */
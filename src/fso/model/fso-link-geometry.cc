@@ -0,0 +1,55 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "fso-link-geometry.h"
+#include <cmath>
+#include <algorithm>
+
+namespace ns3 {
+
+const double FsoLinkGeometry::EARTH_RADIUS = 6371000.0;
+const double FsoLinkGeometry::SPEED_OF_LIGHT = 299792458.0;
+
+double
+FsoLinkGeometry::GetAltitude (const Vector &position)
+{
+  double z = position.z + EARTH_RADIUS;
+  return std::sqrt (position.x*position.x + position.y*position.y + z*z) - EARTH_RADIUS;
+}
+
+double
+FsoLinkGeometry::GetElevation (const Vector &tx, const Vector &rx)
+{
+  //The local vertical of the receiver points away from the center of the earth
+  Vector up (rx.x, rx.y, rx.z + EARTH_RADIUS);
+  Vector d (tx.x - rx.x, tx.y - rx.y, tx.z - rx.z);
+  double norm = std::sqrt ((up.x*up.x + up.y*up.y + up.z*up.z)*(d.x*d.x + d.y*d.y + d.z*d.z));
+  if (norm <= 0.0)
+    {
+      return M_PI/2.0;
+    }
+  double sine = (up.x*d.x + up.y*d.y + up.z*d.z)/norm;
+  return std::asin (std::max (-1.0, std::min (1.0, sine)));
+}
+
+double
+FsoLinkGeometry::GetZenithAngle (const Vector &tx, const Vector &rx)
+{
+  return M_PI/2.0 - GetElevation (tx, rx);
+}
+
+} // namespace ns3
@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef FSO_LINK_GEOMETRY_H
+#define FSO_LINK_GEOMETRY_H
+
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Geometry of an optical link over a spherical earth
+ *
+ * Positions are expressed in a local frame tangent to the earth at the
+ * origin, with the z axis pointing up: the center of the earth is at
+ * (0, 0, -EARTH_RADIUS). Near the origin, z is the altitude, so that
+ * scenarios placing a ground station at the origin and a satellite right
+ * above it keep their meaning. FsoSatelliteMobilityModel reports the
+ * positions of satellites in this frame.
+ */
+class FsoLinkGeometry
+{
+public:
+  static const double EARTH_RADIUS;  //!< mean radius of the earth (m)
+  static const double SPEED_OF_LIGHT; //!< speed of light in vacuum (m/s)
+
+  /**
+   * \param position a position in the local frame
+   * \return the altitude above the earth surface (m)
+   */
+  static double GetAltitude (const Vector &position);
+
+  /**
+   * \param tx the position of the transmitter
+   * \param rx the position of the receiver
+   * \return the elevation of the transmitter above the local horizon of
+   *         the receiver (rad), negative when it is below the horizon
+   */
+  static double GetElevation (const Vector &tx, const Vector &rx);
+
+  /**
+   * \param tx the position of the transmitter
+   * \param rx the position of the receiver
+   * \return the zenith angle of the transmitter seen from the receiver (rad)
+   */
+  static double GetZenithAngle (const Vector &tx, const Vector &rx);
+};
+
+} // namespace ns3
+
+#endif /* FSO_LINK_GEOMETRY_H */
@@ -163,6 +163,25 @@ FsoMac::ForwardDown ()
   return 0;
 }
 
+Ptr<PacketBurst>
+FsoMac::ForwardDownBurst (uint32_t maxPackets, uint64_t maxBytes)
+{
+  NS_LOG_FUNCTION (this << maxPackets << maxBytes);
+  Ptr<PacketBurst> burst = CreateObject<PacketBurst> ();
+  uint64_t bytes = 0;
+  while (burst->GetNPackets () < maxPackets && !m_txQueue->IsEmpty ())
+    {
+      uint32_t size = m_txQueue->Peek ()->GetSize ();
+      if (burst->GetNPackets () > 0 && bytes + size > maxBytes)
+        {
+          break;
+        }
+      bytes += size;
+      burst->AddPacket (m_txQueue->Dequeue ());
+    }
+  return burst;
+}
+
 
 } // namespace ns3
 
@@ -27,6 +27,7 @@
 #include "ns3/packet.h"
 #include "ns3/mac48-address.h"
 #include "ns3/drop-tail-queue.h"
+#include "ns3/packet-burst.h"
 //#include "ns3/mac-low.h"
 #include "fso-phy.h"
 //#include "ns3/ssid.h"
@@ -164,6 +165,16 @@ public:
    */
   Ptr<Packet> ForwardDown ();
 
+  /**
+   * Dequeue packets for a burst transmission. The first packet is always
+   * dequeued, the following ones while the burst holds at most maxBytes.
+   *
+   * \param maxPackets the maximum number of packets in the burst
+   * \param maxBytes the maximum size of the burst in bytes
+   * \return the packets in queue order, an empty burst if the queue is empty
+   */
+  Ptr<PacketBurst> ForwardDownBurst (uint32_t maxPackets, uint64_t maxBytes);
+
 protected:
   Mac48Address m_address;        //!< Address of MAC
   Ptr<DropTailQueue<Packet>>  m_txQueue;  //!< Queue for outgoing packets
@@ -23,6 +23,7 @@
 #include <ns3/math.h>
 #include <ns3/log.h>
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 
 namespace ns3 {
 
@@ -41,7 +42,7 @@ FsoMeanIrradianceModel::~FsoMeanIrradianceModel ()
 void
 FsoMeanIrradianceModel::DoDispose ()
 {
-  
+  m_linkCache.Clear ();
 }
 
 TypeId
@@ -50,7 +51,21 @@ FsoMeanIrradianceModel::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::FsoMeanIrradianceModel")
     .SetParent<Object> ()
     .SetGroupName ("Fso")
-    .AddConstructor<FsoMeanIrradianceModel> ();
+    .AddConstructor<FsoMeanIrradianceModel> ()
+    .AddAttribute ("LinkCache",
+                   "Cache the result of the model for each (transmitter, receiver) link until an end point moves or changes course",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FsoMeanIrradianceModel::SetLinkCache,
+                                        &FsoMeanIrradianceModel::GetLinkCache),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LinkCachePositionThreshold",
+                   "The distance (meters) an end point may move before the cached state of its links is recomputed, "
+                   "0 only reuses the state of links whose end points have not moved",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoMeanIrradianceModel::SetLinkCachePositionThreshold,
+                                       &FsoMeanIrradianceModel::GetLinkCachePositionThreshold),
+                   MakeDoubleChecker<double> (0.0))
+  ;
 
   return tid;
 }
@@ -62,17 +77,34 @@ FsoMeanIrradianceModel::DoAssignStreams (int64_t stream)
 }
 
 void
-FsoMeanIrradianceModel::DoUpdateSignalParams(Ptr<FsoSignalParameters> fsoSignalParams, Ptr<const MobilityModel> a, Ptr<const MobilityModel> b)
+FsoMeanIrradianceModel::DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b)
 {
-  double distance = a->GetDistanceFrom (b);
-  fsoSignalParams->rxPhaseFrontRadius = distance;//The radius of curvature at the RX can be approximated by the distance for long links
+  m_linkCache.Listen (a);
+  m_linkCache.Listen (b);
+}
 
+void
+FsoMeanIrradianceModel::DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                              const Vector &positionA, const Vector &positionB)
+{
+  LinkState state;
+  if (!m_linkCache.Lookup (a, b, positionA, positionB, state) || state.frequency != fsoSignalParams->frequency
+      || state.txBeamwidth != fsoSignalParams->txBeamwidth)
+    {
+      double distance = CalculateDistance (positionA, positionB);
+      state.frequency = fsoSignalParams->frequency;
+      state.txBeamwidth = fsoSignalParams->txBeamwidth;
+      state.rxPhaseFrontRadius = distance;//The radius of curvature at the RX can be approximated by the distance for long links
 
-  NS_LOG_DEBUG ("MeanIrradiance: distance=" << distance << "m, frequency=" << fsoSignalParams->frequency << "Hz, beamwidth=" << fsoSignalParams->txBeamwidth << "m, phase front radius=" << fsoSignalParams->rxPhaseFrontRadius); 
+      NS_LOG_DEBUG ("MeanIrradiance: distance=" << distance << "m, frequency=" << state.frequency << "Hz, beamwidth=" << state.txBeamwidth << "m, phase front radius=" << state.rxPhaseFrontRadius);
 
-  double rxDiffractiveBeamRadius = CalculateDiffractiveBeamRadius(distance, fsoSignalParams->frequency, fsoSignalParams->txBeamwidth, fsoSignalParams->rxPhaseFrontRadius);
+      double rxDiffractiveBeamRadius = CalculateDiffractiveBeamRadius(distance, state.frequency, state.txBeamwidth, state.rxPhaseFrontRadius);
 
-  fsoSignalParams->meanIrradiance = CalculateMeanIrradiance(fsoSignalParams->txBeamwidth, rxDiffractiveBeamRadius);
+      state.meanIrradiance = CalculateMeanIrradiance(state.txBeamwidth, rxDiffractiveBeamRadius);
+      m_linkCache.Add (a, b, positionA, positionB, state);
+    }
+  fsoSignalParams->rxPhaseFrontRadius = state.rxPhaseFrontRadius;
+  fsoSignalParams->meanIrradiance = state.meanIrradiance;
 
   NS_LOG_DEBUG ("MeanIrradiance: result=" << fsoSignalParams->meanIrradiance);
 }
@@ -101,4 +133,30 @@ FsoMeanIrradianceModel::CalculateDiffractiveBeamRadius (double d, double f, doub
 
 
 
+void
+FsoMeanIrradianceModel::SetLinkCache (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_linkCache.SetEnabled (enabled);
+}
+
+bool
+FsoMeanIrradianceModel::GetLinkCache () const
+{
+  return m_linkCache.IsEnabled ();
+}
+
+void
+FsoMeanIrradianceModel::SetLinkCachePositionThreshold (double threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+  m_linkCache.SetPositionThreshold (threshold);
+}
+
+double
+FsoMeanIrradianceModel::GetLinkCachePositionThreshold () const
+{
+  return m_linkCache.GetPositionThreshold ();
+}
+
 } // namespace ns3
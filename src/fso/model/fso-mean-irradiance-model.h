@@ -26,6 +26,7 @@
 #include <ns3/mobility-model.h>
 #include "fso-signal-parameters.h"
 #include "fso-propagation-loss-model.h"
+#include "fso-link-cache.h"
 
 namespace ns3 {
 
@@ -75,13 +76,48 @@ public:
   double CalculateDiffractiveBeamRadius (double d, double f, double txBeamRadius, double rxPhaseFrontRadius);
 
 
+  /**
+   * \param enabled whether the state of each (transmitter, receiver) link is cached
+   */
+  void SetLinkCache (bool enabled);
+
+  /**
+   * \return whether the state of each (transmitter, receiver) link is cached
+   */
+  bool GetLinkCache () const;
+
+  /**
+   * \param threshold distance (m) an end point may move before the state of its links is recomputed
+   */
+  void SetLinkCachePositionThreshold (double threshold);
+
+  /**
+   * \return distance (m) an end point may move before the state of its links is recomputed
+   */
+  double GetLinkCachePositionThreshold () const;
+
 protected:
   //Inherited from Object
   virtual void DoDispose ();
 
 private:
+  /**
+   * Mean irradiance of a link
+   */
+  struct LinkState
+  {
+    double frequency;          //!< frequency of the signal (Hz)
+    double txBeamwidth;        //!< beamwidth at the transmitter (m)
+    double rxPhaseFrontRadius; //!< phase front radius of curvature at the receiver (m)
+    double meanIrradiance;     //!< mean irradiance at the receiver (W/m^2)
+  };
+
+  FsoLinkCache<LinkState> m_linkCache; //!< Mean irradiance of the links
+
   //Inherited from FsoPropagationLossModel
-  virtual void DoUpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, Ptr<const MobilityModel> a, Ptr<const MobilityModel> b);
+  virtual void DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b,
+                                     const Vector &positionA, const Vector &positionB);
+  virtual void DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b);
 
 };
 
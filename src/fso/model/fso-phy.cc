@@ -35,6 +35,7 @@
 #include "ns3/boolean.h"
 #include "ns3/node.h"
 #include <cmath>
+#include <limits>
 
 namespace ns3 {
 
@@ -55,13 +56,48 @@ FsoPhy::GetTypeId (void)
                    MakeDoubleAccessor (&FsoPhy::SetBitRate,
                                        &FsoPhy::GetBitRate),
                    MakeDoubleChecker<double> ())
+    .AddAttribute ("ErrorMode",
+                   "How the packet success rate of the error model is applied to received packets",
+                   EnumValue (FsoPhy::ERROR_NONE),
+                   MakeEnumAccessor (&FsoPhy::SetErrorMode,
+                                     &FsoPhy::GetErrorMode),
+                   MakeEnumChecker (FsoPhy::ERROR_NONE, "None",
+                                    FsoPhy::ERROR_PER_PACKET, "PerPacket",
+                                    FsoPhy::ERROR_FADE, "Fade"))
+    .AddAttribute ("MaxBurstPackets",
+                   "The maximum number of queued packets sent back to back in a single transmission",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&FsoPhy::SetMaxBurstPackets,
+                                         &FsoPhy::GetMaxBurstPackets),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxBurstDuration",
+                   "The maximum airtime of a burst, 0 for no limit",
+                   TimeValue (Seconds (0.0)),
+                   MakeTimeAccessor (&FsoPhy::SetMaxBurstDuration,
+                                     &FsoPhy::GetMaxBurstDuration),
+                   MakeTimeChecker ())
+    .AddAttribute ("StageTimers",
+                   "Measure the wall clock time spent in the transmission and reception stages",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FsoPhy::SetStageTimersEnabled,
+                                        &FsoPhy::GetStageTimersEnabled),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("PacketTxBegin",
+                     "A packet starts being transmitted, alone or in a burst",
+                     MakeTraceSourceAccessor (&FsoPhy::m_packetTxBeginTrace),
+                     "ns3::FsoPhy::PacketTimeTracedCallback")
+    .AddTraceSource ("PacketRxEnd",
+                     "The reception of a packet ends, alone or in a burst, whether or not it is received correctly",
+                     MakeTraceSourceAccessor (&FsoPhy::m_packetRxEndTrace),
+                     "ns3::FsoPhy::PacketTimeTracedCallback")
   ;
   return tid;
 }
 
-FsoPhy::FsoPhy () : m_txState (State::IDLE)
+FsoPhy::FsoPhy () : m_txState (State::IDLE), m_errorMode (ERROR_NONE), m_maxBurstPackets (1)
 {
   NS_LOG_FUNCTION (this);
+  m_errorRv = CreateObject<UniformRandomVariable> ();
   m_txDurationTimer.SetFunction (&FsoPhy::SwitchToIdle, this);
 }
 
@@ -78,6 +114,8 @@ FsoPhy::DoDispose (void)
   m_device = 0;
   m_mobility = 0;
   m_errorModel = 0;
+  m_txAntennas.clear ();
+  m_rxAntennas.clear ();
 }
 
 void 
@@ -161,20 +199,87 @@ FsoPhy::GetChannel () const
 Ptr<LaserAntennaModel> 
 FsoPhy::GetTxAntenna () const
 {
-  return m_txAntenna;
+  return m_txAntennas.empty () ? 0 : m_txAntennas.front ();
 }
   
 Ptr<OpticalRxAntennaModel> 
 FsoPhy::GetRxAntenna () const
 {
-  return m_rxAntenna;
+  return m_rxAntennas.empty () ? 0 : m_rxAntennas.front ();
 }
 
 void 
 FsoPhy::SetAntennas (Ptr<LaserAntennaModel> txAntenna, Ptr<OpticalRxAntennaModel> rxAntenna)
 {
-  m_txAntenna = txAntenna;
-  m_rxAntenna = rxAntenna;
+  m_txAntennas.clear ();
+  m_rxAntennas.clear ();
+  if (txAntenna != 0)
+    {
+      m_txAntennas.push_back (txAntenna);
+    }
+  if (rxAntenna != 0)
+    {
+      m_rxAntennas.push_back (rxAntenna);
+    }
+}
+
+void
+FsoPhy::AddTxAntenna (Ptr<LaserAntennaModel> txAntenna)
+{
+  NS_LOG_FUNCTION (this << txAntenna);
+  NS_ASSERT (txAntenna != 0);
+  m_txAntennas.push_back (txAntenna);
+}
+
+uint32_t
+FsoPhy::GetNTxAntennas () const
+{
+  return m_txAntennas.size ();
+}
+
+Ptr<LaserAntennaModel>
+FsoPhy::GetTxAntenna (uint32_t i) const
+{
+  NS_ASSERT (i < m_txAntennas.size ());
+  return m_txAntennas[i];
+}
+
+void
+FsoPhy::AddRxAntenna (Ptr<OpticalRxAntennaModel> rxAntenna)
+{
+  NS_LOG_FUNCTION (this << rxAntenna);
+  NS_ASSERT (rxAntenna != 0);
+  m_rxAntennas.push_back (rxAntenna);
+}
+
+uint32_t
+FsoPhy::GetNRxAntennas () const
+{
+  return m_rxAntennas.size ();
+}
+
+Ptr<OpticalRxAntennaModel>
+FsoPhy::GetRxAntenna (uint32_t i) const
+{
+  NS_ASSERT (i < m_rxAntennas.size ());
+  return m_rxAntennas[i];
+}
+
+double
+FsoPhy::GetRxGain () const
+{
+  NS_ASSERT (!m_rxAntennas.empty ());
+  if (m_rxAntennas.size () == 1)
+    {
+      return m_rxAntennas.front ()->GetGain ();
+    }
+  //The apertures collect their power independently
+  double gain = 0.0;
+  for (std::vector<Ptr<OpticalRxAntennaModel> >::const_iterator i = m_rxAntennas.begin (); i != m_rxAntennas.end (); i++)
+    {
+      gain += std::pow (10.0, (*i)->GetGain ()/10.0);
+    }
+  return 10.0*std::log10 (gain);
 }
 
 void 
@@ -195,6 +300,65 @@ FsoPhy::GetBitRate () const
   return m_bitRate;
 }
 
+void
+FsoPhy::SetErrorMode (ErrorMode mode)
+{
+  NS_LOG_FUNCTION (this << mode);
+  m_errorMode = mode;
+}
+
+FsoPhy::ErrorMode
+FsoPhy::GetErrorMode () const
+{
+  return m_errorMode;
+}
+
+void
+FsoPhy::SetMaxBurstPackets (uint32_t packets)
+{
+  NS_LOG_FUNCTION (this << packets);
+  NS_ASSERT (packets > 0);
+  m_maxBurstPackets = packets;
+}
+
+uint32_t
+FsoPhy::GetMaxBurstPackets () const
+{
+  return m_maxBurstPackets;
+}
+
+void
+FsoPhy::SetMaxBurstDuration (Time duration)
+{
+  NS_LOG_FUNCTION (this << duration);
+  m_maxBurstDuration = duration;
+}
+
+Time
+FsoPhy::GetMaxBurstDuration () const
+{
+  return m_maxBurstDuration;
+}
+
+void
+FsoPhy::SetStageTimersEnabled (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_stageTimer.SetEnabled (enabled);
+}
+
+bool
+FsoPhy::GetStageTimersEnabled () const
+{
+  return m_stageTimer.IsEnabled ();
+}
+
+FsoStageTimer &
+FsoPhy::GetStageTimer ()
+{
+  return m_stageTimer;
+}
+
 void 
 FsoPhy::SwitchToTx (Time duration)
 {
@@ -212,7 +376,32 @@ FsoPhy::RequestPacket ()
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_txState == State::IDLE);
+  if (m_device == 0)
+    {
+      //Transmissions are driven directly, without a device (examples, benchmarks)
+      return;
+    }
   Ptr<FsoMac> mac = m_device->GetMac ();
+
+  if (m_maxBurstPackets > 1)
+    {
+      uint64_t maxBytes = std::numeric_limits<uint64_t>::max ();
+      if (m_maxBurstDuration.IsStrictlyPositive ())
+        {
+          maxBytes = static_cast<uint64_t> (m_maxBurstDuration.GetSeconds ()*m_bitRate/8.0);
+        }
+      Ptr<PacketBurst> burst = mac->ForwardDownBurst (m_maxBurstPackets, maxBytes);
+      if (burst->GetNPackets () == 1)
+        {
+          Transmit (*burst->Begin ());
+        }
+      else if (burst->GetNPackets () > 1)
+        {
+          TransmitBurst (burst);
+        }
+      return;
+    }
+
   Ptr<Packet> packet = mac->ForwardDown ();
   
   if (packet != 0)
@@ -249,26 +438,66 @@ FsoPhy::Transmit (Ptr<const Packet> packet)
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_txState == State::IDLE);
+  uint64_t start = m_stageTimer.Start ();
 
-  //Is this going to cause memory problems if we create a new FsoSignalParameters each transmit?
-  //Should they be released upon reception? Or should we re-use the same fso params?***
-  Ptr<FsoSignalParameters> fsoSignalParams = Create<FsoSignalParameters> ();
-
-  fsoSignalParams->power                = m_txAntenna->GetTxPower () + m_txAntenna->GetGain ();  
-  fsoSignalParams->txBeamwidth          = m_txAntenna->GetBeamwidth ();
-  fsoSignalParams->txPhy                = this;
-  fsoSignalParams->txAntenna            = m_txAntenna;
-  fsoSignalParams->symbolPeriod         = 1.0/m_bitRate;
-  fsoSignalParams->wavelength           = m_txAntenna->GetWavelength ();
-  fsoSignalParams->frequency            = 3e8/(m_txAntenna->GetWavelength ());
+  Ptr<FsoSignalParameters> fsoSignalParams = CreateSignalParameters ();
 
   Time txDuration = CalculateTxDuration (packet->GetSize (), fsoSignalParams);
+  fsoSignalParams->duration = txDuration;
 
   SwitchToTx (txDuration);
+  m_packetTxBeginTrace (packet, Simulator::Now ());
   
   NS_LOG_DEBUG ("PhySend: power=" << fsoSignalParams->power << "dB"); 
   m_channel->Send (this, packet, fsoSignalParams, txDuration);
+  m_stageTimer.Stop (FsoStageTimer::TRANSMIT, start);
+}
+
+void
+FsoPhy::TransmitBurst (Ptr<const PacketBurst> burst)
+{
+  NS_LOG_FUNCTION (this << burst->GetNPackets ());
+  NS_ASSERT (m_txState == State::IDLE);
+  uint64_t start = m_stageTimer.Start ();
+
+  Ptr<FsoSignalParameters> fsoSignalParams = CreateSignalParameters ();
+
+  Time txDuration = CalculateTxDuration (burst->GetSize (), fsoSignalParams);
+  fsoSignalParams->duration = txDuration;
+
+  SwitchToTx (txDuration);
+
+  //The packets are sent back to back
+  uint32_t bytes = 0;
+  for (std::list<Ptr<Packet> >::const_iterator i = burst->Begin (); i != burst->End (); i++)
+    {
+      m_packetTxBeginTrace (*i, Simulator::Now () + CalculateTxDuration (bytes, fsoSignalParams));
+      bytes += (*i)->GetSize ();
+    }
+
+  NS_LOG_DEBUG ("PhySend: burst of " << burst->GetNPackets () << " packets, power=" << fsoSignalParams->power << "dB");
+  m_channel->SendBurst (this, burst, fsoSignalParams, txDuration);
+  m_stageTimer.Stop (FsoStageTimer::TRANSMIT, start);
+}
+
+Ptr<FsoSignalParameters>
+FsoPhy::CreateSignalParameters ()
+{
+  //Is this going to cause memory problems if we create a new FsoSignalParameters each transmit?
+  //Should they be released upon reception? Or should we re-use the same fso params?***
+  Ptr<FsoSignalParameters> fsoSignalParams = Create<FsoSignalParameters> ();
+  Ptr<LaserAntennaModel> txAntenna = GetTxAntenna ();
+  NS_ASSERT (txAntenna != 0);
 
+  //Parameters of the first beam, the channel applies those of the other beams
+  fsoSignalParams->power                = txAntenna->GetTxPower () + txAntenna->GetGain ();  
+  fsoSignalParams->txBeamwidth          = txAntenna->GetBeamwidth ();
+  fsoSignalParams->txPhy                = this;
+  fsoSignalParams->txAntenna            = txAntenna;
+  fsoSignalParams->symbolPeriod         = 1.0/m_bitRate;
+  fsoSignalParams->wavelength           = txAntenna->GetWavelength ();
+  fsoSignalParams->frequency            = 3e8/(txAntenna->GetWavelength ());
+  return fsoSignalParams;
 }
    
 void 
@@ -276,11 +505,59 @@ FsoPhy::Receive (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams)
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_errorModel != 0);
+  uint64_t start = m_stageTimer.Start ();
+
+  fsoSignalParams->power += GetRxGain ();
+
+  ReceivePacket (packet, fsoSignalParams, Seconds (0.0), fsoSignalParams->duration);
+  m_stageTimer.Stop (FsoStageTimer::RECEIVE, start);
+}
+
+void
+FsoPhy::ReceiveBurst (Ptr<PacketBurst> burst, Ptr<FsoSignalParameters> fsoSignalParams)
+{
+  NS_LOG_FUNCTION (this << burst->GetNPackets ());
+  NS_ASSERT (m_errorModel != 0);
+  uint64_t start = m_stageTimer.Start ();
 
-  fsoSignalParams->power += m_rxAntenna->GetGain ();
+  fsoSignalParams->power += GetRxGain ();
 
-  double packetSuccessRate = m_errorModel->GetPacketSuccessRate(packet, fsoSignalParams);
+  uint32_t bytes = 0;
+  for (std::list<Ptr<Packet> >::const_iterator i = burst->Begin (); i != burst->End (); i++)
+    {
+      Time offset = CalculateTxDuration (bytes, fsoSignalParams);
+      bytes += (*i)->GetSize ();
+      Time duration = CalculateTxDuration (bytes, fsoSignalParams) - offset;
+      ReceivePacket (*i, fsoSignalParams, offset, duration);
+    }
+  m_stageTimer.Stop (FsoStageTimer::RECEIVE, start);
+}
+
+void
+FsoPhy::ReceivePacket (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams, Time offset, Time duration)
+{
+  NS_LOG_FUNCTION (this << packet << offset << duration);
+
+  uint64_t start = m_stageTimer.Start ();
+  double packetSuccessRate;
+  if (m_errorMode == ERROR_FADE)
+    {
+      packetSuccessRate = m_errorModel->GetAirtimeSuccessRate (packet, fsoSignalParams, Simulator::Now () + offset, duration);
+    }
+  else
+    {
+      packetSuccessRate = m_errorModel->GetPacketSuccessRate (packet, fsoSignalParams);
+    }
+  m_stageTimer.Stop (FsoStageTimer::ERROR_MODEL, start);
   NS_LOG_DEBUG ("PhyReceive: packet success rate=" << packetSuccessRate);
+  m_packetRxEndTrace (packet, Simulator::Now () + offset + duration);
+
+  if (m_errorMode != ERROR_NONE && m_errorRv->GetValue () >= packetSuccessRate)
+    {
+      NS_LOG_DEBUG ("PhyReceive: packet dropped");
+      SwitchFromRxEndError (packet, 0.0);
+      return;
+    }
 
   SwitchFromRxEndOk(packet, 0.0, fsoSignalParams);//should provide SNR once the SNR function is implemented, 0.0 placeholder
 }
@@ -291,7 +568,7 @@ FsoPhy::CalculateTxDuration (uint32_t size, Ptr<FsoSignalParameters> fsoSignalPa
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("PhyTransmit: symbol period=" << fsoSignalParams->symbolPeriod << "s"); 
   NS_ASSERT (fsoSignalParams->symbolPeriod > 0.0);
-  return NanoSeconds (size * 8 * fsoSignalParams->symbolPeriod);
+  return Seconds (size * 8 * fsoSignalParams->symbolPeriod);
 }
 
 int64_t
@@ -299,6 +576,8 @@ FsoPhy::AssignStreams (int64_t stream)
 {
   int64_t currentStream = stream;
   currentStream += m_errorModel->AssignStreams (stream);
+  m_errorRv->SetStream (currentStream);
+  currentStream++;
   return (currentStream - stream);
 }
 
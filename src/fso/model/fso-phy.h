@@ -27,14 +27,19 @@
 #include <ns3/object.h>
 #include <ns3/nstime.h>
 #include "ns3/timer.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
 #include <ns3/packet.h>
+#include "ns3/packet-burst.h"
 #include "fso-net-device.h"
 
 #include "fso-error-model.h"
 #include "fso-signal-parameters.h"
 #include "fso-channel.h"
+#include "fso-stage-timer.h"
 #include "optical-rx-antenna-model.h"
 #include "laser-antenna-model.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -77,6 +82,25 @@ public:
 
   FsoPhy::State GetTxState ();
 
+  /**
+   * How the packet success rate of the error model is applied to received packets
+   */
+  enum ErrorMode
+  {
+    /**
+     * Every packet is delivered, the success rate is only computed
+     */
+    ERROR_NONE,
+    /**
+     * Packets are dropped with the success rate at the start of the reception
+     */
+    ERROR_PER_PACKET,
+    /**
+     * Packets are dropped with the success rate integrated over their airtime
+     */
+    ERROR_FADE
+  };
+
   /**
    * arg1: packet received successfully
    * arg2: snr of packet 
@@ -89,6 +113,15 @@ public:
    */
   typedef Callback<void, Ptr<Packet>, double> RxErrorCallback;
 
+  /**
+   * TracedCallback signature for the per packet timestamps
+   *
+   * \param packet the packet
+   * \param time the time at which its transmission starts, or at which its
+   *        reception ends
+   */
+  typedef void (* PacketTimeTracedCallback)(Ptr<const Packet> packet, Time time);
+
   /**
    * Switch from RX after the reception was successful.
    *
@@ -173,11 +206,61 @@ public:
    */
   virtual Ptr<LaserAntennaModel> GetTxAntenna () const;
 
+  /**
+   * Add a transmit beam. A transmission goes out on all the beams, each
+   * receiver gets the signal of the first beam illuminating it.
+   *
+   * \param txAntenna the laser of the beam
+   */
+  void AddTxAntenna (Ptr<LaserAntennaModel> txAntenna);
+
+  /**
+   * \return the number of transmit beams
+   */
+  uint32_t GetNTxAntennas () const;
+
+  /**
+   * \param i the index of the beam
+   * \return the laser of the beam
+   */
+  Ptr<LaserAntennaModel> GetTxAntenna (uint32_t i) const;
+
+  /**
+   * Add a receive aperture. The power collected by the apertures is
+   * combined (see FsoDownLinkErrorModel::GetApertureAveragingFactor).
+   *
+   * \param rxAntenna the receiver of the aperture
+   */
+  void AddRxAntenna (Ptr<OpticalRxAntennaModel> rxAntenna);
+
+  /**
+   * \return the number of receive apertures
+   */
+  uint32_t GetNRxAntennas () const;
+
+  /**
+   * \param i the index of the aperture
+   * \return the receiver of the aperture
+   */
+  Ptr<OpticalRxAntennaModel> GetRxAntenna (uint32_t i) const;
+
+  /**
+   * \return the gain (dB) of the combined receive apertures
+   */
+  double GetRxGain () const;
+
   /**
    * \param packet the packet to send
    */
   virtual void Transmit (Ptr<const Packet> packet);
 
+  /**
+   * Send the packets of a burst back to back in a single transmission
+   *
+   * \param burst the packets to send
+   */
+  virtual void TransmitBurst (Ptr<const PacketBurst> burst);
+
 
   /**
    * Starting receiving the payload of a packet (i.e. the first bit of the packet has arrived).
@@ -187,20 +270,30 @@ public:
    */
   virtual void Receive (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams);
 
+  /**
+   * Receive the packets of a burst. The packets are received back to back
+   * from now, each one is checked by the error model over its own airtime.
+   *
+   * \param burst the received packets
+   * \param fsoSignalParams pointer to the optical signal parameters
+   */
+  virtual void ReceiveBurst (Ptr<PacketBurst> burst, Ptr<FsoSignalParameters> fsoSignalParams);
+
 
   /**
    * Calculate how long the transmit time will be (size * symbol period)
    *
-   * \param size the size of the packet in bits
+   * \param size the size of the packet in bytes
    * \param fsoSignalParams pointer to the optical signal parameters
    */
   virtual Time CalculateTxDuration (uint32_t size, Ptr<FsoSignalParameters> fsoSignalParams) const;
 
   /**
-   * Assign the receiver and transmitter antennas to this Phy
+   * Assign the receiver and transmitter antennas to this Phy, replacing
+   * the beams and apertures added before
    *
-   * \param txAnntenna pointer to the transmitter antenna
-   * \param txAnntenna pointer to the receiver antenna
+   * \param txAntenna pointer to the transmitter antenna, may be null
+   * \param rxAntenna pointer to the receiver antenna, may be null
    */
   virtual void SetAntennas (Ptr<LaserAntennaModel> txAntenna, Ptr<OpticalRxAntennaModel> rxAntenna);
 
@@ -237,6 +330,58 @@ public:
    */
   virtual double GetBitRate () const;
 
+  /**
+   * \param packets the maximum number of packets sent in a burst, 1 sends
+   *        every packet in its own transmission
+   */
+  void SetMaxBurstPackets (uint32_t packets);
+
+  /**
+   * \return the maximum number of packets sent in a burst
+   */
+  uint32_t GetMaxBurstPackets () const;
+
+  /**
+   * \param duration the maximum airtime of a burst, 0 for no limit. A burst
+   *        always holds at least one packet.
+   */
+  void SetMaxBurstDuration (Time duration);
+
+  /**
+   * \return the maximum airtime of a burst
+   */
+  Time GetMaxBurstDuration () const;
+
+  /**
+   * \param mode how the packet success rate is applied to received packets
+   */
+  void SetErrorMode (ErrorMode mode);
+
+  /**
+   * \return how the packet success rate is applied to received packets
+   */
+  ErrorMode GetErrorMode () const;
+
+  /**
+   * \param enabled whether the wall clock time of the transmission and
+   *        reception stages is measured
+   */
+  void SetStageTimersEnabled (bool enabled);
+
+  /**
+   * \return whether the wall clock time of the transmission and reception
+   *         stages is measured
+   */
+  bool GetStageTimersEnabled () const;
+
+  /**
+   * The channel accounts for the loss models and the scheduling of the
+   * receptions in the timer of the transmitting Phy.
+   *
+   * \return the stage timer of this Phy
+   */
+  FsoStageTimer &GetStageTimer ();
+
   /**
    * Request a packet from MAC layer
    */
@@ -255,8 +400,8 @@ private:
   Ptr<FsoChannel>               m_channel;        //!< FsoChannel that this FsoPhy is connected to
   Ptr<FsoNetDevice>             m_device;         //!< Pointer to the device
   Ptr<MobilityModel>            m_mobility;       //!< Pointer to the mobility model
-  Ptr<LaserAntennaModel>        m_txAntenna;      //!< Pointer to the TX antenna model
-  Ptr<OpticalRxAntennaModel>    m_rxAntenna;      //!< Pointer to the RX antenna model
+  std::vector<Ptr<LaserAntennaModel> > m_txAntennas;     //!< TX antenna models, one per beam
+  std::vector<Ptr<OpticalRxAntennaModel> > m_rxAntennas; //!< RX antenna models, one per aperture
   Ptr<FsoErrorModel>            m_errorModel;     //!< Pointer to the error model
   
   State                         m_txState;        //!< transmit state of the Phy
@@ -266,6 +411,29 @@ private:
   RxErrorCallback               m_rxErrorCallback;//!< Callback for received packet with packet error
   
   double                        m_bitRate;        //!< bit rate associated with the Phy
+  ErrorMode                     m_errorMode;      //!< how the packet success rate is applied
+  Ptr<UniformRandomVariable>    m_errorRv;        //!< decides whether packets are received
+  uint32_t                      m_maxBurstPackets;//!< maximum number of packets in a burst
+  Time                          m_maxBurstDuration;//!< maximum airtime of a burst
+  FsoStageTimer                 m_stageTimer;     //!< wall clock time of the stages
+
+  TracedCallback<Ptr<const Packet>, Time> m_packetTxBeginTrace;//!< start of transmission of each packet
+  TracedCallback<Ptr<const Packet>, Time> m_packetRxEndTrace;  //!< end of reception of each packet
+
+  /**
+   * \return the signal parameters of a transmission from this Phy
+   */
+  Ptr<FsoSignalParameters> CreateSignalParameters ();
+
+  /**
+   * Apply the error model to a received packet and forward it
+   *
+   * \param packet the received packet
+   * \param fsoSignalParams pointer to the optical signal parameters
+   * \param offset the time from now at which the reception of the packet starts
+   * \param duration the airtime of the packet
+   */
+  void ReceivePacket (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams, Time offset, Time duration);
 
   /**
    * Set Phy state to TX and schedule switch back to IDLE
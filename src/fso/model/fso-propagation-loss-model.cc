@@ -65,17 +65,43 @@ FsoPropagationLossModel::GetNext ()
 }
 
 void
-FsoPropagationLossModel::UpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, 
-                           Ptr<const MobilityModel> a, 
-                           Ptr<const MobilityModel> b)
+FsoPropagationLossModel::UpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, 
+                           const Ptr<const MobilityModel> &a, 
+                           const Ptr<const MobilityModel> &b)
 {
-  DoUpdateSignalParams (fsoSignalParams, a, b);
+  PrepareLink (a, b);
+  UpdateSignalParams (fsoSignalParams, a, b, a->GetPosition (), b->GetPosition ());
+}
+
+void
+FsoPropagationLossModel::UpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, 
+                           const Ptr<const MobilityModel> &a, 
+                           const Ptr<const MobilityModel> &b,
+                           const Vector &positionA,
+                           const Vector &positionB)
+{
+  DoUpdateSignalParams (fsoSignalParams, a, b, positionA, positionB);
   if (m_next != 0)
     {
-      m_next->UpdateSignalParams (fsoSignalParams, a, b);
+      m_next->UpdateSignalParams (fsoSignalParams, a, b, positionA, positionB);
     }
 }
 
+void
+FsoPropagationLossModel::PrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b)
+{
+  DoPrepareLink (a, b);
+  if (m_next != 0)
+    {
+      m_next->PrepareLink (a, b);
+    }
+}
+
+void
+FsoPropagationLossModel::DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b)
+{
+}
+
 
 int64_t
 FsoPropagationLossModel::AssignStreams (int64_t stream)
@@ -81,13 +81,47 @@ public:
    * Updates the signal parameters taking into account all the FsoPropagatinLossModel(s)
    * chained to the current one.
    *
+   * FsoChannel may evaluate the chain for several receivers concurrently,
+   * each with its own copy of the signal parameters. Implementations must
+   * therefore not copy the Ptr arguments (reference counts are not atomic)
+   * and must protect any state they cache across calls.
+   *
+   * \param fsoSignalParams is the signal parameters for the optical beam
+   * \param a sender mobility
+   * \param b receiver mobility
+   */
+  void UpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, 
+                           const Ptr<const MobilityModel> &a, 
+                           const Ptr<const MobilityModel> &b);
+
+  /**
+   * Same as above, with the positions of the end points read beforehand.
+   * The models only use the mobility models to identify the link, so this
+   * is the variant to call from threads other than the simulator thread,
+   * once PrepareLink () was called for the same end points.
+   *
    * \param fsoSignalParams is the signal parameters for the optical beam
    * \param a sender mobility
    * \param b receiver mobility
+   * \param positionA sender position
+   * \param positionB receiver position
+   */
+  void UpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, 
+                           const Ptr<const MobilityModel> &a, 
+                           const Ptr<const MobilityModel> &b,
+                           const Vector &positionA,
+                           const Vector &positionB);
+
+  /**
+   * Prepare the models of the chain to evaluate the link between a and b,
+   * e.g. listen to the course changes of its end points. Must be called by
+   * the simulator thread; the models do not cache the state of links that
+   * were not prepared.
+   *
+   * \param a sender mobility
+   * \param b receiver mobility
    */
-  void UpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, 
-                           Ptr<const MobilityModel> a, 
-                           Ptr<const MobilityModel> b);
+  void PrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b);
 
   /**
    * If this loss model uses objects of type RandomVariableStream,
@@ -120,11 +154,23 @@ private:
    * \param fsoSignalParams is the signal parameters for the optical beam
    * \param a sender mobility
    * \param b receiver mobility
+   * \param positionA sender position
+   * \param positionB receiver position
+   *
+   */
+  virtual void DoUpdateSignalParams (const Ptr<FsoSignalParameters> &fsoSignalParams, 
+                                     const Ptr<const MobilityModel> &a, 
+                                     const Ptr<const MobilityModel> &b,
+                                     const Vector &positionA,
+                                     const Vector &positionB) = 0;
+
+  /**
+   * Prepare the model to evaluate a link, does nothing by default
    *
+   * \param a sender mobility
+   * \param b receiver mobility
    */
-  virtual void DoUpdateSignalParams (Ptr<FsoSignalParameters> fsoSignalParams, 
-                                     Ptr<const MobilityModel> a, 
-                                     Ptr<const MobilityModel> b) = 0;
+  virtual void DoPrepareLink (const Ptr<const MobilityModel> &a, const Ptr<const MobilityModel> &b);
 
 protected:
   //Inherited from Object
@@ -0,0 +1,230 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "fso-satellite-mobility-model.h"
+#include "fso-link-geometry.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/log.h"
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsoSatelliteMobilityModel");
+
+NS_OBJECT_ENSURE_REGISTERED (FsoSatelliteMobilityModel);
+
+static const double EARTH_MU = 3.986004418e14;         //!< gravitational parameter of the earth (m^3/s^2)
+static const double EARTH_J2 = 1.08262668e-3;          //!< second zonal harmonic of the earth
+static const double EARTH_EQUATORIAL_RADIUS = 6378137.0; //!< equatorial radius of the earth (m), reference of J2
+static const double EARTH_ROTATION_RATE = 7.2921159e-5; //!< sidereal rotation rate of the earth (rad/s)
+
+TypeId
+FsoSatelliteMobilityModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FsoSatelliteMobilityModel")
+    .SetParent<MobilityModel> ()
+    .SetGroupName ("Fso")
+    .AddConstructor<FsoSatelliteMobilityModel> ()
+    .AddAttribute ("SemiMajorAxis",
+                   "The semi-major axis of the orbit (m)",
+                   DoubleValue (6921000.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_semiMajorAxis),
+                   MakeDoubleChecker<double> (FsoLinkGeometry::EARTH_RADIUS))
+    .AddAttribute ("Eccentricity",
+                   "The eccentricity of the orbit",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_eccentricity),
+                   MakeDoubleChecker<double> (0.0, 0.99))
+    .AddAttribute ("Inclination",
+                   "The inclination of the orbit (degrees)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_inclination),
+                   MakeDoubleChecker<double> (0.0, 180.0))
+    .AddAttribute ("RightAscension",
+                   "The right ascension of the ascending node at time 0 (degrees)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_rightAscension),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("ArgumentOfPerigee",
+                   "The argument of perigee at time 0 (degrees)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_argumentOfPerigee),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("MeanAnomaly",
+                   "The mean anomaly at time 0 (degrees)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_meanAnomaly),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("J2",
+                   "Whether the node and the perigee drift with the oblateness of the earth",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FsoSatelliteMobilityModel::m_j2),
+                   MakeBooleanChecker ())
+    .AddAttribute ("EarthRotation",
+                   "Whether the earth, and the ground station, rotate under the orbit",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FsoSatelliteMobilityModel::m_earthRotation),
+                   MakeBooleanChecker ())
+    .AddAttribute ("StationLatitude",
+                   "The latitude of the ground station at the origin of the frame (degrees)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_stationLatitude),
+                   MakeDoubleChecker<double> (-90.0, 90.0))
+    .AddAttribute ("StationLongitude",
+                   "The longitude of the ground station at the origin of the frame (degrees)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FsoSatelliteMobilityModel::m_stationLongitude),
+                   MakeDoubleChecker<double> ())
+  ;
+  return tid;
+}
+
+FsoSatelliteMobilityModel::FsoSatelliteMobilityModel ()
+{
+}
+
+FsoSatelliteMobilityModel::~FsoSatelliteMobilityModel ()
+{
+}
+
+double
+FsoSatelliteMobilityModel::GetPeriod (void) const
+{
+  return 2.0*M_PI*std::sqrt (std::pow (m_semiMajorAxis, 3.0)/EARTH_MU);
+}
+
+Vector
+FsoSatelliteMobilityModel::GetPositionAt (Time t) const
+{
+  Vector position;
+  Vector velocity;
+  Propagate (t, position, velocity);
+  return position;
+}
+
+Vector
+FsoSatelliteMobilityModel::GetVelocityAt (Time t) const
+{
+  Vector position;
+  Vector velocity;
+  Propagate (t, position, velocity);
+  return velocity;
+}
+
+Vector
+FsoSatelliteMobilityModel::DoGetPosition (void) const
+{
+  return GetPositionAt (Simulator::Now ());
+}
+
+void
+FsoSatelliteMobilityModel::DoSetPosition (const Vector &position)
+{
+  NS_LOG_WARN ("The position of a satellite is given by its orbit, ignoring " << position);
+}
+
+Vector
+FsoSatelliteMobilityModel::DoGetVelocity (void) const
+{
+  return GetVelocityAt (Simulator::Now ());
+}
+
+void
+FsoSatelliteMobilityModel::Propagate (Time t, Vector &position, Vector &velocity) const
+{
+  double deg = M_PI/180.0;
+  double seconds = t.GetSeconds ();
+  double a = m_semiMajorAxis;
+  double e = m_eccentricity;
+  double inc = m_inclination*deg;
+  double n = std::sqrt (EARTH_MU/(a*a*a));
+  double p = a*(1.0 - e*e);
+
+  double raan = m_rightAscension*deg;
+  double perigee = m_argumentOfPerigee*deg;
+  if (m_j2)
+    {
+      //Secular rates of the node and of the perigee
+      double factor = 1.5*n*EARTH_J2*std::pow (EARTH_EQUATORIAL_RADIUS/p, 2.0);
+      raan -= factor*std::cos (inc)*seconds;
+      perigee += 0.5*factor*(5.0*std::cos (inc)*std::cos (inc) - 1.0)*seconds;
+    }
+
+  //Kepler's equation by Newton's method
+  double meanAnomaly = std::fmod (m_meanAnomaly*deg + n*seconds, 2.0*M_PI);
+  double eccentricAnomaly = e < 0.8 ? meanAnomaly : M_PI;
+  for (uint32_t i = 0; i < 30; i++)
+    {
+      double delta = (eccentricAnomaly - e*std::sin (eccentricAnomaly) - meanAnomaly)/(1.0 - e*std::cos (eccentricAnomaly));
+      eccentricAnomaly -= delta;
+      if (std::abs (delta) < 1e-12)
+        {
+          break;
+        }
+    }
+  double trueAnomaly = 2.0*std::atan2 (std::sqrt (1.0 + e)*std::sin (eccentricAnomaly/2.0),
+                                       std::sqrt (1.0 - e)*std::cos (eccentricAnomaly/2.0));
+  double r = a*(1.0 - e*std::cos (eccentricAnomaly));
+
+  //Perifocal position and velocity
+  double rp = r*std::cos (trueAnomaly);
+  double rq = r*std::sin (trueAnomaly);
+  double vScale = std::sqrt (EARTH_MU/p);
+  double vp = -vScale*std::sin (trueAnomaly);
+  double vq = vScale*(e + std::cos (trueAnomaly));
+
+  //Perifocal to inertial
+  double cO = std::cos (raan);
+  double sO = std::sin (raan);
+  double cw = std::cos (perigee);
+  double sw = std::sin (perigee);
+  double ci = std::cos (inc);
+  double si = std::sin (inc);
+  Vector pAxis (cO*cw - sO*sw*ci, sO*cw + cO*sw*ci, sw*si);
+  Vector qAxis (-cO*sw - sO*cw*ci, -sO*sw + cO*cw*ci, cw*si);
+  Vector rEci (rp*pAxis.x + rq*qAxis.x, rp*pAxis.y + rq*qAxis.y, rp*pAxis.z + rq*qAxis.z);
+  Vector vEci (vp*pAxis.x + vq*qAxis.x, vp*pAxis.y + vq*qAxis.y, vp*pAxis.z + vq*qAxis.z);
+
+  //Inertial to earth fixed
+  double omega = m_earthRotation ? EARTH_ROTATION_RATE : 0.0;
+  double theta = omega*seconds;
+  double cT = std::cos (theta);
+  double sT = std::sin (theta);
+  Vector rEcef (cT*rEci.x + sT*rEci.y, -sT*rEci.x + cT*rEci.y, rEci.z);
+  Vector vEcef (cT*vEci.x + sT*vEci.y + omega*rEcef.y, -sT*vEci.x + cT*vEci.y - omega*rEcef.x, vEci.z);
+
+  //Earth fixed to the east, north, up frame of the ground station
+  double lat = m_stationLatitude*deg;
+  double lon = m_stationLongitude*deg;
+  double cLat = std::cos (lat);
+  double sLat = std::sin (lat);
+  double cLon = std::cos (lon);
+  double sLon = std::sin (lon);
+  double re = FsoLinkGeometry::EARTH_RADIUS;
+  Vector d (rEcef.x - re*cLat*cLon, rEcef.y - re*cLat*sLon, rEcef.z - re*sLat);
+
+  position.x = -sLon*d.x + cLon*d.y;
+  position.y = -sLat*cLon*d.x - sLat*sLon*d.y + cLat*d.z;
+  position.z = cLat*cLon*d.x + cLat*sLon*d.y + sLat*d.z;
+  velocity.x = -sLon*vEcef.x + cLon*vEcef.y;
+  velocity.y = -sLat*cLon*vEcef.x - sLat*sLon*vEcef.y + cLat*vEcef.z;
+  velocity.z = cLat*cLon*vEcef.x + cLat*sLon*vEcef.y + sLat*vEcef.z;
+}
+
+} // namespace ns3
@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef FSO_SATELLITE_MOBILITY_MODEL_H
+#define FSO_SATELLITE_MOBILITY_MODEL_H
+
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/mobility-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Mobility model of a satellite on a Keplerian orbit
+ *
+ * The orbit is given by its classical elements at time 0: semi-major axis,
+ * eccentricity, inclination, right ascension of the ascending node,
+ * argument of perigee and mean anomaly. The position is propagated by
+ * solving Kepler's equation, optionally with the secular drift of the node
+ * and of the perigee due to the oblateness of the earth (J2).
+ *
+ * Positions are reported in the local frame of a ground station (x east,
+ * y north, z up, see FsoLinkGeometry) located on a spherical earth at the
+ * StationLatitude and StationLongitude attributes, the earth rotating
+ * under the orbit unless EarthRotation is false. The inertial and earth
+ * fixed frames coincide at time 0. Ground stations of this frame are
+ * modeled with a ConstantPositionMobilityModel at (0, 0, 0).
+ *
+ * The position is a pure function of the time, so it may be queried from
+ * several threads and at any time with GetPositionAt (), which is used to
+ * tabulate a pass in advance (see FsoLinkBudgetLossModel).
+ */
+class FsoSatelliteMobilityModel : public MobilityModel
+{
+public:
+  /**
+   * Register this type with the TypeId system.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  FsoSatelliteMobilityModel ();
+  virtual ~FsoSatelliteMobilityModel ();
+
+  /**
+   * \param t the time
+   * \return the position of the satellite at time t
+   */
+  Vector GetPositionAt (Time t) const;
+
+  /**
+   * \param t the time
+   * \return the velocity of the satellite at time t, relative to the
+   *         ground station
+   */
+  Vector GetVelocityAt (Time t) const;
+
+  /**
+   * \return the orbital period (s)
+   */
+  double GetPeriod (void) const;
+
+private:
+  virtual Vector DoGetPosition (void) const;
+  virtual void DoSetPosition (const Vector &position);
+  virtual Vector DoGetVelocity (void) const;
+
+  /**
+   * \param t the time
+   * \param position receives the position at time t
+   * \param velocity receives the velocity at time t
+   */
+  void Propagate (Time t, Vector &position, Vector &velocity) const;
+
+  double m_semiMajorAxis;     //!< semi-major axis (m)
+  double m_eccentricity;      //!< eccentricity
+  double m_inclination;       //!< inclination (degrees)
+  double m_rightAscension;    //!< right ascension of the ascending node (degrees)
+  double m_argumentOfPerigee; //!< argument of perigee (degrees)
+  double m_meanAnomaly;       //!< mean anomaly at time 0 (degrees)
+  bool m_j2;                  //!< whether the J2 secular drift is applied
+  bool m_earthRotation;       //!< whether the earth rotates under the orbit
+  double m_stationLatitude;   //!< latitude of the ground station (degrees)
+  double m_stationLongitude;  //!< longitude of the ground station (degrees)
+};
+
+} // namespace ns3
+
+#endif /* FSO_SATELLITE_MOBILITY_MODEL_H */
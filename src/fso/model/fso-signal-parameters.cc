@@ -24,6 +24,7 @@
 #include <ns3/fso-signal-parameters.h>
 #include <ns3/fso-phy.h>
 #include <ns3/log.h>
+#include <ns3/per-thread.h>
 #include <ns3/antenna-model.h>
 
 
@@ -31,8 +32,46 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("FsoSignalParameters");
 
+namespace {
 
-FsoSignalParameters::FsoSignalParameters () : duration (NanoSeconds (0.0)), txPhy (0), txAntenna (0), wavelength (0.0), frequency (0.0), symbolPeriod (0.0), power (0.0), txBeamwidth (0.0), rxPhaseFrontRadius (0.0), scintillationIndex (0.0), meanIrradiance (0.0), pathLoss (0.0)
+/// Maximum number of blocks kept in the free list of a thread
+const uint32_t g_fsoSignalParametersPoolMax = 4096;
+
+/**
+ * Free list of recycled FsoSignalParameters of a thread. The channel
+ * copies the parameters for every receiver of every transmission and
+ * drops the copies once received, both on the thread which runs the
+ * channel, so the list of that thread serves most allocations; the loss
+ * chain workers only update the copies. The blocks come from the global
+ * allocator, so one freed by another thread simply joins its list.
+ */
+struct FsoSignalParametersPool
+{
+  FreeList free; //!< the free blocks
+
+  /** \returns a new, empty, pool */
+  static FsoSignalParametersPool *Create (void)
+  {
+    return new FsoSignalParametersPool ();
+  }
+  /**
+   * Delete a pool and its free blocks
+   * \param pool the pool
+   */
+  static void Release (FsoSignalParametersPool *pool)
+  {
+    void *block;
+    while ((block = pool->free.Pop ()) != 0)
+      {
+        ::operator delete (block);
+      }
+    delete pool;
+  }
+};
+
+} // unnamed namespace
+
+FsoSignalParameters::FsoSignalParameters () : duration (NanoSeconds (0.0)), txPhy (0), txAntenna (0), wavelength (0.0), frequency (0.0), symbolPeriod (0.0), power (0.0), txBeamwidth (0.0), rxPhaseFrontRadius (0.0), scintillationIndex (0.0), meanIrradiance (0.0), normIrradiance (0.0), pathLoss (0.0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -54,6 +93,7 @@ FsoSignalParameters::FsoSignalParameters (const FsoSignalParameters& p)
   rxPhaseFrontRadius = p.rxPhaseFrontRadius;
   scintillationIndex = p.scintillationIndex;
   meanIrradiance = p.meanIrradiance;
+  normIrradiance = p.normIrradiance;
   pathLoss = p.pathLoss;
 
   txPhy = p.txPhy;
@@ -67,6 +107,35 @@ FsoSignalParameters::Copy ()
   return Create<FsoSignalParameters> (*this);
 }
 
+void*
+FsoSignalParameters::operator new (std::size_t size)
+{
+  FsoSignalParametersPool *pool = PerThread<FsoSignalParametersPool>::Peek ();
+  void *block = size == sizeof (FsoSignalParameters) && pool != 0 ? pool->free.Pop () : 0;
+  if (block != 0)
+    {
+      return block;
+    }
+  return ::operator new (size);
+}
+
+void
+FsoSignalParameters::operator delete (void *p, std::size_t size)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  if (size == sizeof (FsoSignalParameters))
+    {
+      FsoSignalParametersPool *pool = PerThread<FsoSignalParametersPool>::Get ();
+      if (pool != 0 && pool->free.Push (p, g_fsoSignalParametersPoolMax))
+        {
+          return;
+        }
+    }
+  ::operator delete (p);
+}
 
 
 } // namespace ns3
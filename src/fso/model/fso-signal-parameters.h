@@ -27,6 +27,7 @@
 #include <ns3/simple-ref-count.h>
 #include <ns3/ptr.h>
 #include <ns3/nstime.h>
+#include <cstddef>
 
 namespace ns3 {
 
@@ -71,6 +72,25 @@ struct FsoSignalParameters : public SimpleRefCount<FsoSignalParameters>
    */
   virtual Ptr<FsoSignalParameters> Copy ();
 
+  /**
+   * Allocate from a free list of recycled FsoSignalParameters, since a copy
+   * is made for every receiver of every transmission. Derived classes of a
+   * different size use the global allocator. Every thread has its own free
+   * list, so parameters can be created and released by any thread.
+   *
+   * \param size the size of the object
+   * \return the allocated memory
+   */
+  static void* operator new (std::size_t size);
+
+  /**
+   * Return the memory to the free list
+   *
+   * \param p the memory to release
+   * \param size the size of the object
+   */
+  static void operator delete (void *p, std::size_t size);
+
   /**
    * The duration of the packet transmission.
    */
@@ -97,7 +117,7 @@ struct FsoSignalParameters : public SimpleRefCount<FsoSignalParameters>
   double frequency;
 
   /**
-   * The symbol period (ns)
+   * The symbol period (s)
    */
   double symbolPeriod;
 
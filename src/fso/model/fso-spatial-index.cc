@@ -0,0 +1,211 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "fso-spatial-index.h"
+#include "ns3/assert.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+FsoSpatialIndex::FsoSpatialIndex ()
+  : m_cellSize (1000.0),
+    m_n (0)
+{
+}
+
+void
+FsoSpatialIndex::SetCellSize (double size)
+{
+  NS_ASSERT (size > 0.0);
+  m_cellSize = size;
+  Clear ();
+}
+
+double
+FsoSpatialIndex::GetCellSize () const
+{
+  return m_cellSize;
+}
+
+void
+FsoSpatialIndex::Clear ()
+{
+  m_cells.clear ();
+  m_n = 0;
+}
+
+int64_t
+FsoSpatialIndex::GetCell (double x) const
+{
+  return static_cast<int64_t> (std::floor (x/m_cellSize));
+}
+
+void
+FsoSpatialIndex::Insert (uint32_t id, const Vector &position)
+{
+  CellKey key;
+  key.x = GetCell (position.x);
+  key.y = GetCell (position.y);
+  key.z = GetCell (position.z);
+  m_cells[key].push_back (id);
+
+  if (m_n == 0)
+    {
+      m_min = position;
+      m_max = position;
+    }
+  else
+    {
+      m_min = Vector (std::min (m_min.x, position.x), std::min (m_min.y, position.y), std::min (m_min.z, position.z));
+      m_max = Vector (std::max (m_max.x, position.x), std::max (m_max.y, position.y), std::max (m_max.z, position.z));
+    }
+  m_n++;
+}
+
+uint32_t
+FsoSpatialIndex::GetN () const
+{
+  return m_n;
+}
+
+void
+FsoSpatialIndex::QueryCone (const Vector &apex, const Vector &axis, double halfAngle, std::vector<uint32_t> &ids) const
+{
+  NS_ASSERT (halfAngle < 0.5*M_PI);
+  ids.clear ();
+  if (m_n == 0)
+    {
+      return;
+    }
+  if (!WalkCone (apex, axis, std::tan (halfAngle), ids))
+    {
+      ids.clear ();
+      ScanCone (apex, axis, halfAngle, ids);
+    }
+  std::sort (ids.begin (), ids.end ());
+  ids.erase (std::unique (ids.begin (), ids.end ()), ids.end ());
+}
+
+bool
+FsoSpatialIndex::WalkCone (const Vector &apex, const Vector &axis, double slope, std::vector<uint32_t> &ids) const
+{
+  //The points in the cone are at most as far along the axis as the farthest
+  //corner of their bounding box, and within far*slope of the axis
+  double far = 0.0;
+  for (uint32_t c = 0; c < 8; c++)
+    {
+      Vector corner ((c & 1) ? m_max.x : m_min.x, (c & 2) ? m_max.y : m_min.y, (c & 4) ? m_max.z : m_min.z);
+      far = std::max (far, CalculateDistance (apex, corner));
+    }
+  double margin = far*slope;
+
+  //Interval of the axis within the bounding box expanded by the margin
+  double origin[3] = {apex.x, apex.y, apex.z};
+  double direction[3] = {axis.x, axis.y, axis.z};
+  double lower[3] = {m_min.x - margin, m_min.y - margin, m_min.z - margin};
+  double upper[3] = {m_max.x + margin, m_max.y + margin, m_max.z + margin};
+  double s0 = 0.0;
+  double s1 = far;
+  for (uint32_t k = 0; k < 3; k++)
+    {
+      if (std::abs (direction[k]) < 1e-12)
+        {
+          if (origin[k] < lower[k] || origin[k] > upper[k])
+            {
+              return true;
+            }
+          continue;
+        }
+      double a = (lower[k] - origin[k])/direction[k];
+      double b = (upper[k] - origin[k])/direction[k];
+      s0 = std::max (s0, std::min (a, b));
+      s1 = std::min (s1, std::max (a, b));
+    }
+  if (s0 > s1)
+    {
+      return true;
+    }
+
+  //Walk the axis one cell at a time, collecting the cells overlapping the
+  //bounding box of the section of the cone
+  uint64_t budget = m_cells.size ();
+  uint64_t visited = 0;
+  for (double s = s0; ; s += m_cellSize)
+    {
+      double e = std::min (s + m_cellSize, s1);
+      double r = e*slope;
+      Vector a (apex.x + axis.x*s, apex.y + axis.y*s, apex.z + axis.z*s);
+      Vector b (apex.x + axis.x*e, apex.y + axis.y*e, apex.z + axis.z*e);
+      Vector low (std::max (std::min (a.x, b.x) - r, m_min.x), std::max (std::min (a.y, b.y) - r, m_min.y), std::max (std::min (a.z, b.z) - r, m_min.z));
+      Vector high (std::min (std::max (a.x, b.x) + r, m_max.x), std::min (std::max (a.y, b.y) + r, m_max.y), std::min (std::max (a.z, b.z) + r, m_max.z));
+      if (++visited > budget)
+        {
+          return false;
+        }
+      if (low.x <= high.x && low.y <= high.y && low.z <= high.z)
+        {
+          CellKey key;
+          for (key.x = GetCell (low.x); key.x <= GetCell (high.x); key.x++)
+            {
+              for (key.y = GetCell (low.y); key.y <= GetCell (high.y); key.y++)
+                {
+                  for (key.z = GetCell (low.z); key.z <= GetCell (high.z); key.z++)
+                    {
+                      if (++visited > budget)
+                        {
+                          return false;
+                        }
+                      CellMap::const_iterator it = m_cells.find (key);
+                      if (it != m_cells.end ())
+                        {
+                          ids.insert (ids.end (), it->second.begin (), it->second.end ());
+                        }
+                    }
+                }
+            }
+        }
+      if (e >= s1)
+        {
+          return true;
+        }
+    }
+}
+
+void
+FsoSpatialIndex::ScanCone (const Vector &apex, const Vector &axis, double halfAngle, std::vector<uint32_t> &ids) const
+{
+  //A cell overlaps the cone if its bounding sphere does
+  double radius = 0.5*std::sqrt (3.0)*m_cellSize;
+  for (CellMap::const_iterator it = m_cells.begin (); it != m_cells.end (); ++it)
+    {
+      Vector d ((it->first.x + 0.5)*m_cellSize - apex.x, (it->first.y + 0.5)*m_cellSize - apex.y, (it->first.z + 0.5)*m_cellSize - apex.z);
+      double distance = std::sqrt (d.x*d.x + d.y*d.y + d.z*d.z);
+      if (distance > radius)
+        {
+          double along = (d.x*axis.x + d.y*axis.y + d.z*axis.z)/distance;
+          double angle = std::acos (std::max (-1.0, std::min (1.0, along)));
+          if (angle > halfAngle + std::asin (radius/distance))
+            {
+              continue;
+            }
+        }
+      ids.insert (ids.end (), it->second.begin (), it->second.end ());
+    }
+}
+
+} // namespace ns3
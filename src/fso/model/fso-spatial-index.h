@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef FSO_SPATIAL_INDEX_H
+#define FSO_SPATIAL_INDEX_H
+
+#include <stdint.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Uniform grid of points answering which of them may lie in a cone
+ *
+ * Used by the FsoChannel to find the receivers illuminated by a pointed
+ * laser without scanning every receiver. Points are identified by an
+ * index given by the caller. A query walks the beam axis through the
+ * bounding box of the points and collects the points of the cells
+ * overlapping the cone, which the caller then tests exactly. When the walk
+ * would visit more cells than there are non empty cells (wide beams, or
+ * points spread over a long stretch of the axis), the non empty cells are
+ * tested against the cone instead, so a query never costs more than twice
+ * a scan of the cells.
+ */
+class FsoSpatialIndex
+{
+public:
+  FsoSpatialIndex ();
+
+  /**
+   * \param size the edge (m) of the cubic cells, must be positive
+   */
+  void SetCellSize (double size);
+
+  /**
+   * \return the edge (m) of the cubic cells
+   */
+  double GetCellSize () const;
+
+  /**
+   * Remove all the points
+   */
+  void Clear ();
+
+  /**
+   * \param id the identifier of the point
+   * \param position the position of the point
+   */
+  void Insert (uint32_t id, const Vector &position);
+
+  /**
+   * \return the number of points
+   */
+  uint32_t GetN () const;
+
+  /**
+   * Collect the points of the cells overlapping a cone. The identifiers
+   * are sorted and unique.
+   *
+   * \param apex the apex of the cone
+   * \param axis the unit vector of the axis of the cone
+   * \param halfAngle the half angle (radians) of the cone, below pi/2
+   * \param ids receives the identifiers of the candidate points
+   */
+  void QueryCone (const Vector &apex, const Vector &axis, double halfAngle, std::vector<uint32_t> &ids) const;
+
+private:
+  /**
+   * Integer coordinates of a cell
+   */
+  struct CellKey
+  {
+    int64_t x; //!< cell index along x
+    int64_t y; //!< cell index along y
+    int64_t z; //!< cell index along z
+
+    /**
+     * \param o the other key
+     * \return true if both keys identify the same cell
+     */
+    bool operator == (const CellKey &o) const
+    {
+      return x == o.x && y == o.y && z == o.z;
+    }
+  };
+
+  /**
+   * Hash of a CellKey
+   */
+  struct CellKeyHash
+  {
+    /**
+     * \param k the key
+     * \return the hash of the key
+     */
+    std::size_t operator () (const CellKey &k) const
+    {
+      std::size_t h = std::hash<int64_t> () (k.x);
+      h ^= std::hash<int64_t> () (k.y) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      h ^= std::hash<int64_t> () (k.z) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  /**
+   * \param x a coordinate
+   * \return the index of the cell containing the coordinate
+   */
+  int64_t GetCell (double x) const;
+
+  /**
+   * Walk the axis of a cone, collecting the points of the cells overlapping it
+   *
+   * \param apex the apex of the cone
+   * \param axis the unit vector of the axis of the cone
+   * \param slope the tangent of the half angle of the cone
+   * \param ids receives the identifiers of the candidate points
+   * \return false if the walk visited more cells than there are non empty cells
+   */
+  bool WalkCone (const Vector &apex, const Vector &axis, double slope, std::vector<uint32_t> &ids) const;
+
+  /**
+   * Test every non empty cell against a cone, collecting their points
+   *
+   * \param apex the apex of the cone
+   * \param axis the unit vector of the axis of the cone
+   * \param halfAngle the half angle (radians) of the cone
+   * \param ids receives the identifiers of the candidate points
+   */
+  void ScanCone (const Vector &apex, const Vector &axis, double halfAngle, std::vector<uint32_t> &ids) const;
+
+  /// Points of each non empty cell
+  typedef std::unordered_map<CellKey, std::vector<uint32_t>, CellKeyHash> CellMap;
+
+  double m_cellSize;   //!< edge of the cells (m)
+  CellMap m_cells;     //!< points of each non empty cell
+  uint32_t m_n;        //!< number of points
+  Vector m_min;        //!< lower corner of the bounding box of the points
+  Vector m_max;        //!< upper corner of the bounding box of the points
+};
+
+} // namespace ns3
+
+#endif /* FSO_SPATIAL_INDEX_H */
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "fso-stage-timer.h"
+#include "ns3/assert.h"
+#include <chrono>
+#include <iomanip>
+
+namespace ns3 {
+
+FsoStageTimer::FsoStageTimer ()
+  : m_enabled (false)
+{
+  Reset ();
+}
+
+void
+FsoStageTimer::SetEnabled (bool enabled)
+{
+  m_enabled = enabled;
+}
+
+bool
+FsoStageTimer::IsEnabled () const
+{
+  return m_enabled;
+}
+
+uint64_t
+FsoStageTimer::GetClock ()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+uint64_t
+FsoStageTimer::Start () const
+{
+  return m_enabled ? GetClock () : 0;
+}
+
+void
+FsoStageTimer::Stop (Stage stage, uint64_t start)
+{
+  if (!m_enabled || start == 0)
+    {
+      return;
+    }
+  NS_ASSERT (stage < N_STAGES);
+  m_count[stage]++;
+  m_total[stage] += GetClock () - start;
+}
+
+uint64_t
+FsoStageTimer::GetCount (Stage stage) const
+{
+  NS_ASSERT (stage < N_STAGES);
+  return m_count[stage];
+}
+
+uint64_t
+FsoStageTimer::GetTotal (Stage stage) const
+{
+  NS_ASSERT (stage < N_STAGES);
+  return m_total[stage];
+}
+
+double
+FsoStageTimer::GetMean (Stage stage) const
+{
+  NS_ASSERT (stage < N_STAGES);
+  return m_count[stage] == 0 ? 0.0 : static_cast<double> (m_total[stage])/m_count[stage];
+}
+
+void
+FsoStageTimer::Reset ()
+{
+  for (uint32_t i = 0; i < N_STAGES; i++)
+    {
+      m_count[i] = 0;
+      m_total[i] = 0;
+    }
+}
+
+void
+FsoStageTimer::Print (std::ostream &os) const
+{
+  for (uint32_t i = 0; i < N_STAGES; i++)
+    {
+      Stage stage = static_cast<Stage> (i);
+      os << std::left << std::setw (12) << GetStageName (stage)
+         << " count=" << m_count[i]
+         << " total=" << m_total[i] << "ns"
+         << " mean=" << GetMean (stage) << "ns" << std::endl;
+    }
+}
+
+std::string
+FsoStageTimer::GetStageName (Stage stage)
+{
+  switch (stage)
+    {
+    case TRANSMIT:
+      return "Transmit";
+    case LOSS_CHAIN:
+      return "LossChain";
+    case SCHEDULE:
+      return "Schedule";
+    case RECEIVE:
+      return "Receive";
+    case ERROR_MODEL:
+      return "ErrorModel";
+    default:
+      return "Unknown";
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef FSO_STAGE_TIMER_H
+#define FSO_STAGE_TIMER_H
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Wall clock time spent in the stages of the transmission and reception of packets
+ *
+ * Each FsoPhy owns a timer, enabled with its StageTimers attribute. The
+ * transmitting Phy accounts for the transmission, the evaluation of the
+ * loss models and the scheduling of the receptions by the FsoChannel, and
+ * each receiving Phy for the reception and the error model (which include
+ * the GSL integrations). When disabled, a stage costs a single test.
+ *
+ * Timers are not thread safe, they are used by the simulator thread only.
+ */
+class FsoStageTimer
+{
+public:
+  /**
+   * The timed stages
+   */
+  enum Stage
+  {
+    TRANSMIT,    //!< FsoPhy::Transmit, including the channel
+    LOSS_CHAIN,  //!< evaluation of the propagation loss models by the channel
+    SCHEDULE,    //!< copies of the packets and scheduling of the receptions
+    RECEIVE,     //!< FsoPhy::Receive, including the error model
+    ERROR_MODEL, //!< packet success rate of the error model
+    N_STAGES     //!< number of stages
+  };
+
+  FsoStageTimer ();
+
+  /**
+   * \param enabled whether the stages are timed
+   */
+  void SetEnabled (bool enabled);
+
+  /**
+   * \return whether the stages are timed
+   */
+  bool IsEnabled () const;
+
+  /**
+   * \return the current time of the wall clock (ns), 0 if disabled
+   */
+  uint64_t Start () const;
+
+  /**
+   * Account for a stage started at start
+   *
+   * \param stage the stage
+   * \param start the value returned by Start () at the beginning of the stage
+   */
+  void Stop (Stage stage, uint64_t start);
+
+  /**
+   * \param stage the stage
+   * \return the number of times the stage was timed
+   */
+  uint64_t GetCount (Stage stage) const;
+
+  /**
+   * \param stage the stage
+   * \return the total time spent in the stage (ns)
+   */
+  uint64_t GetTotal (Stage stage) const;
+
+  /**
+   * \param stage the stage
+   * \return the mean time spent in the stage (ns), 0 if it was never timed
+   */
+  double GetMean (Stage stage) const;
+
+  /**
+   * Clear the counters
+   */
+  void Reset ();
+
+  /**
+   * Print the count, total and mean time of the stages
+   *
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+
+  /**
+   * \param stage the stage
+   * \return the name of the stage
+   */
+  static std::string GetStageName (Stage stage);
+
+private:
+  /**
+   * \return the current time of the wall clock (ns)
+   */
+  static uint64_t GetClock ();
+
+  bool m_enabled;                 //!< whether the stages are timed
+  uint64_t m_count[N_STAGES];     //!< number of times each stage was timed
+  uint64_t m_total[N_STAGES];     //!< total time of each stage (ns)
+};
+
+} // namespace ns3
+
+#endif /* FSO_STAGE_TIMER_H */
@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "fso-thread-pool.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsoThreadPool");
+
+#ifdef HAVE_PTHREAD_H
+//Waiting threads poll at this period in case a wake up was missed
+static const uint64_t IDLE_WAIT_NS = 1000000;
+#endif
+
+FsoThreadPool::FsoThreadPool (uint32_t nThreads)
+  : m_nThreads (nThreads),
+    m_nJobs (0),
+    m_nextJob (0),
+    m_chunk (1)
+#ifdef HAVE_PTHREAD_H
+  , m_generation (0),
+    m_busy (0),
+    m_stop (false)
+#endif
+{
+  NS_LOG_FUNCTION (this << nThreads);
+  NS_ASSERT (nThreads > 0);
+#ifdef HAVE_PTHREAD_H
+  for (uint32_t i = 1; i < m_nThreads; i++)
+    {
+      Worker *worker = new Worker;
+      worker->pool = this;
+      worker->generation = m_generation;
+      worker->thread = Create<SystemThread> (MakeCallback (&Worker::Loop, worker));
+      m_workers.push_back (worker);
+      worker->thread->Start ();
+    }
+#else
+  m_nThreads = 1;
+#endif
+}
+
+FsoThreadPool::~FsoThreadPool ()
+{
+  NS_LOG_FUNCTION (this);
+#ifdef HAVE_PTHREAD_H
+  {
+    CriticalSection cs (m_mutex);
+    m_stop = true;
+  }
+  for (std::vector<Worker *>::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+    {
+      (*i)->wakeup.SetCondition (true);
+      (*i)->wakeup.Signal ();
+    }
+  for (std::vector<Worker *>::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+    {
+      (*i)->thread->Join ();
+      delete *i;
+    }
+  m_workers.clear ();
+#endif
+}
+
+uint32_t
+FsoThreadPool::GetNThreads () const
+{
+  return m_nThreads;
+}
+
+void
+FsoThreadPool::Run (uint32_t nJobs, Callback<void, uint32_t> job)
+{
+  NS_LOG_FUNCTION (this << nJobs);
+
+#ifdef HAVE_PTHREAD_H
+  {
+    CriticalSection cs (m_mutex);
+    m_job = job;
+    m_nJobs = nJobs;
+    m_nextJob = 0;
+    //A few chunks per thread balance the load without contending on the mutex
+    m_chunk = std::max<uint32_t> (1, nJobs/(4*m_nThreads));
+    m_generation++;
+  }
+  for (std::vector<Worker *>::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+    {
+      (*i)->wakeup.SetCondition (true);
+      (*i)->wakeup.Signal ();
+    }
+
+  RunJobs ();
+
+  //All jobs are claimed, wait for the workers still running theirs
+  while (true)
+    {
+      //Reset before checking, so that the signal of the last worker is not
+      //missed
+      m_done.SetCondition (false);
+      {
+        CriticalSection cs (m_mutex);
+        if (m_busy == 0)
+          {
+            m_job = MakeNullCallback<void, uint32_t> ();
+            break;
+          }
+      }
+      m_done.TimedWait (IDLE_WAIT_NS);
+    }
+#else
+  for (uint32_t i = 0; i < nJobs; i++)
+    {
+      job (i);
+    }
+#endif
+}
+
+void
+FsoThreadPool::RunJobs ()
+{
+#ifdef HAVE_PTHREAD_H
+  while (true)
+    {
+      uint32_t begin;
+      uint32_t end;
+      {
+        CriticalSection cs (m_mutex);
+        if (m_nextJob >= m_nJobs)
+          {
+            return;
+          }
+        begin = m_nextJob;
+        end = std::min (m_nJobs, begin + m_chunk);
+        m_nextJob = end;
+      }
+      for (uint32_t i = begin; i < end; i++)
+        {
+          m_job (i);
+        }
+    }
+#endif
+}
+
+#ifdef HAVE_PTHREAD_H
+void
+FsoThreadPool::WorkerLoop (Worker *worker)
+{
+  while (true)
+    {
+      //Reset before checking, so that a run started after the check is not
+      //missed
+      worker->wakeup.SetCondition (false);
+      bool run = false;
+      {
+        CriticalSection cs (m_mutex);
+        if (m_stop)
+          {
+            return;
+          }
+        if (m_generation != worker->generation)
+          {
+            worker->generation = m_generation;
+            m_busy++;
+            run = true;
+          }
+      }
+      if (!run)
+        {
+          worker->wakeup.TimedWait (IDLE_WAIT_NS);
+          continue;
+        }
+      RunJobs ();
+      bool last;
+      {
+        CriticalSection cs (m_mutex);
+        m_busy--;
+        last = m_busy == 0;
+      }
+      if (last)
+        {
+          m_done.SetCondition (true);
+          m_done.Signal ();
+        }
+    }
+}
+#endif
+
+} // namespace ns3
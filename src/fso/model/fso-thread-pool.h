@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FSO_THREAD_POOL_H
+#define FSO_THREAD_POOL_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/core-config.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/callback.h"
+#include "ns3/ptr.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/system-condition.h"
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief A fixed set of worker threads running indexed jobs in parallel
+ *
+ * Run () calls a job callback once for every index in [0, nJobs) and
+ * returns when all of them have completed. The calling thread takes part in
+ * the work. The jobs must not create or release Ptr references to objects
+ * shared with other jobs, since reference counts are not atomic.
+ *
+ * Without threading support the jobs are run serially by the caller.
+ */
+class FsoThreadPool : public SimpleRefCount<FsoThreadPool>
+{
+public:
+  /**
+   * \param nThreads the number of threads running jobs, including the caller
+   */
+  FsoThreadPool (uint32_t nThreads);
+  ~FsoThreadPool ();
+
+  /**
+   * \param nJobs the number of jobs
+   * \param job the callback invoked with the index of each job
+   */
+  void Run (uint32_t nJobs, Callback<void, uint32_t> job);
+
+  /**
+   * \return the number of threads running jobs, including the caller
+   */
+  uint32_t GetNThreads () const;
+
+private:
+  /**
+   * Claim and run chunks of jobs until none is left
+   */
+  void RunJobs ();
+
+  uint32_t m_nThreads;               //!< number of threads including the caller
+  Callback<void, uint32_t> m_job;    //!< the current job
+  uint32_t m_nJobs;                  //!< number of jobs of the current run
+  uint32_t m_nextJob;                //!< index of the next unclaimed job
+  uint32_t m_chunk;                  //!< number of jobs claimed at once
+
+#ifdef HAVE_PTHREAD_H
+  /**
+   * A worker thread and the state it waits on
+   */
+  struct Worker
+  {
+    FsoThreadPool *pool;              //!< the pool
+    Ptr<SystemThread> thread;         //!< the thread
+    SystemCondition wakeup;           //!< signaled when a run starts
+    uint64_t generation;              //!< the last run joined
+    /**
+     * Entry point of the thread
+     */
+    void Loop (void)
+    {
+      pool->WorkerLoop (this);
+    }
+  };
+
+  /**
+   * Join the runs until the pool is destroyed
+   *
+   * \param worker the worker of the calling thread
+   */
+  void WorkerLoop (Worker *worker);
+
+  std::vector<Worker *> m_workers;   //!< the worker threads
+  SystemMutex m_mutex;               //!< protects the job state
+  SystemCondition m_done;            //!< signaled by the last busy worker
+  uint64_t m_generation;             //!< incremented by every run
+  uint32_t m_busy;                   //!< number of workers inside RunJobs
+  bool m_stop;                       //!< set when the pool is destroyed
+#endif
+};
+
+} // namespace ns3
+
+#endif /* FSO_THREAD_POOL_H */
@@ -0,0 +1,289 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "fso-turbulence-integral.h"
+#include <ns3/log.h>
+#include <ns3/fatal-error.h>
+#include <cmath>
+#include <limits>
+#ifdef HAVE_GSL
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_integration.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsoTurbulenceIntegral");
+
+const double FsoTurbulenceIntegral::MAX_TURBULENCE_HEIGHT = 20000.0;
+const double FsoTurbulenceIntegral::DEFAULT_ALTITUDE_RESOLUTION = 1.0;
+const double FsoTurbulenceIntegral::DEFAULT_PARAMETER_TOLERANCE = 1e-6;
+const double FsoTurbulenceIntegral::DEFAULT_PROFILE_STEP = 0.0;
+
+//Upper bound on the number of memoized integrals, the cache is flushed when reached
+static const std::size_t MAX_CACHE_SIZE = 65536;
+
+bool
+FsoTurbulenceIntegral::Key::operator < (const Key &o) const
+{
+  if (hTx != o.hTx)
+    {
+      return hTx < o.hTx;
+    }
+  if (hRx != o.hRx)
+    {
+      return hRx < o.hRx;
+    }
+  if (v != o.v)
+    {
+      return v < o.v;
+    }
+  return A < o.A;
+}
+
+FsoTurbulenceIntegral::FsoTurbulenceIntegral (Integrand integrand, double epsAbs, double epsRel)
+  : m_integrand (integrand),
+    m_epsAbs (epsAbs),
+    m_epsRel (epsRel),
+    m_altitudeResolution (DEFAULT_ALTITUDE_RESOLUTION),
+    m_parameterTolerance (DEFAULT_PARAMETER_TOLERANCE),
+    m_profileStep (DEFAULT_PROFILE_STEP),
+    m_hits (0),
+    m_misses (0)
+{
+}
+
+double
+FsoTurbulenceIntegral::Integrate (double hTx, double hRx, double windSpeed, double gndRefractiveIdx)
+{
+  NS_LOG_FUNCTION (this << hTx << hRx << windSpeed << gndRefractiveIdx);
+
+  //20km is the effective height of the turbulence (constant beyond 20km)
+  if (hTx > MAX_TURBULENCE_HEIGHT)
+    {
+      hTx = MAX_TURBULENCE_HEIGHT;
+    }
+
+  FsoTurbulenceParameters params;
+  params.A = gndRefractiveIdx;
+  params.v = windSpeed;
+  params.hgs = hRx;
+
+#ifdef HAVE_PTHREAD_H
+  CriticalSection cs (m_mutex);
+#endif
+
+  if (m_altitudeResolution <= 0.0)
+    {
+      m_misses++;
+      return Solve (hRx, hTx, params);
+    }
+
+  Key key;
+  key.hTx = 0;
+  key.hRx = QuantizeAltitude (hRx);
+  key.v = QuantizeParameter (windSpeed);
+  key.A = QuantizeParameter (gndRefractiveIdx);
+
+  if (m_profileStep > 0.0 && hTx >= hRx)
+    {
+      std::map<Key, Profile>::iterator it = m_profiles.find (key);
+      if (it == m_profiles.end ())
+        {
+          m_misses++;
+          Profile profile;
+          profile.params = params;
+          BuildProfile (profile);
+          it = m_profiles.insert (std::make_pair (key, profile)).first;
+        }
+      else
+        {
+          m_hits++;
+        }
+      return InterpolateProfile (it->second, hTx);
+    }
+
+  key.hTx = QuantizeAltitude (hTx);
+  std::map<Key, double>::const_iterator it = m_cache.find (key);
+  if (it != m_cache.end ())
+    {
+      m_hits++;
+      return it->second;
+    }
+
+  m_misses++;
+  double result = Solve (hRx, hTx, params);
+  if (m_cache.size () >= MAX_CACHE_SIZE)
+    {
+      NS_LOG_DEBUG ("Turbulence integral cache full, flushing " << m_cache.size () << " entries");
+      m_cache.clear ();
+    }
+  m_cache[key] = result;
+  return result;
+}
+
+double
+FsoTurbulenceIntegral::Solve (double a, double b, FsoTurbulenceParameters params) const
+{
+  double result = 0.0;
+#ifdef HAVE_GSL
+  double error = 0.0;
+
+  gsl_integration_workspace * w = gsl_integration_workspace_alloc (10000);
+
+  gsl_function F;
+  F.function = m_integrand;
+  F.params = &params;
+
+  gsl_integration_qags (&F, a, b, m_epsAbs, m_epsRel, 10000, w, &result, &error);
+  NS_LOG_DEBUG ("RESULT=" << result);
+  NS_LOG_DEBUG ("ERROR=" << error);
+
+  gsl_integration_workspace_free (w);
+#else
+  NS_FATAL_ERROR ("The turbulence integrals require GSL");
+#endif
+  return result;
+}
+
+void
+FsoTurbulenceIntegral::BuildProfile (Profile &profile) const
+{
+  NS_LOG_FUNCTION (this);
+
+  double hRx = profile.params.hgs;
+  uint32_t bins = 0;
+  if (MAX_TURBULENCE_HEIGHT > hRx)
+    {
+      bins = static_cast<uint32_t> (std::ceil ((MAX_TURBULENCE_HEIGHT - hRx)/m_profileStep));
+    }
+
+  profile.cumulative.resize (bins + 1);
+  profile.integrand.resize (bins + 1);
+  profile.cumulative[0] = 0.0;
+  profile.integrand[0] = m_integrand (hRx, &profile.params);
+  for (uint32_t i = 1; i <= bins; i++)
+    {
+      double lower = hRx + (i - 1)*m_profileStep;
+      double upper = std::min (hRx + i*m_profileStep, MAX_TURBULENCE_HEIGHT);
+      profile.cumulative[i] = profile.cumulative[i - 1] + Solve (lower, upper, profile.params);
+      profile.integrand[i] = m_integrand (upper, &profile.params);
+    }
+  NS_LOG_DEBUG ("Turbulence profile from " << hRx << "m with " << bins << " bins");
+}
+
+double
+FsoTurbulenceIntegral::InterpolateProfile (const Profile &profile, double hTx) const
+{
+  double hRx = profile.params.hgs;
+  uint32_t bins = profile.cumulative.size () - 1;
+  double x = (hTx - hRx)/m_profileStep;
+  if (x <= 0.0)
+    {
+      return 0.0;
+    }
+  if (x >= bins)
+    {
+      return profile.cumulative[bins];
+    }
+
+  //Cubic Hermite interpolation, the derivative of the cumulative integral is the integrand
+  uint32_t i = static_cast<uint32_t> (x);
+  double lower = hRx + i*m_profileStep;
+  double width = std::min (lower + m_profileStep, MAX_TURBULENCE_HEIGHT) - lower;
+  double t = (hTx - lower)/width;
+  double t2 = t*t;
+  double t3 = t2*t;
+
+  return (2*t3 - 3*t2 + 1)*profile.cumulative[i] + (t3 - 2*t2 + t)*width*profile.integrand[i]
+         + (-2*t3 + 3*t2)*profile.cumulative[i + 1] + (t3 - t2)*width*profile.integrand[i + 1];
+}
+
+int64_t
+FsoTurbulenceIntegral::QuantizeAltitude (double h) const
+{
+  return static_cast<int64_t> (std::floor (h/m_altitudeResolution + 0.5));
+}
+
+int64_t
+FsoTurbulenceIntegral::QuantizeParameter (double x) const
+{
+  if (x <= 0.0)
+    {
+      return std::numeric_limits<int64_t>::min ();
+    }
+  return static_cast<int64_t> (std::floor (std::log (x)/std::log1p (m_parameterTolerance) + 0.5));
+}
+
+void
+FsoTurbulenceIntegral::SetAltitudeResolution (double resolution)
+{
+  m_altitudeResolution = resolution;
+  Clear ();
+}
+
+double
+FsoTurbulenceIntegral::GetAltitudeResolution () const
+{
+  return m_altitudeResolution;
+}
+
+void
+FsoTurbulenceIntegral::SetParameterTolerance (double tolerance)
+{
+  m_parameterTolerance = tolerance;
+  Clear ();
+}
+
+double
+FsoTurbulenceIntegral::GetParameterTolerance () const
+{
+  return m_parameterTolerance;
+}
+
+void
+FsoTurbulenceIntegral::SetProfileStep (double step)
+{
+  m_profileStep = step;
+  m_profiles.clear ();
+}
+
+double
+FsoTurbulenceIntegral::GetProfileStep () const
+{
+  return m_profileStep;
+}
+
+void
+FsoTurbulenceIntegral::Clear ()
+{
+  m_cache.clear ();
+  m_profiles.clear ();
+}
+
+uint64_t
+FsoTurbulenceIntegral::GetHits () const
+{
+  return m_hits;
+}
+
+uint64_t
+FsoTurbulenceIntegral::GetMisses () const
+{
+  return m_misses;
+}
+
+} // namespace ns3
@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FSO_TURBULENCE_INTEGRAL_H
+#define FSO_TURBULENCE_INTEGRAL_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ns3/core-config.h"
+#include "ns3/type-id.h"
+#include "ns3/double.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-mutex.h"
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * Parameters of the Hufnagel-Valley index of refraction profile passed
+ * to the altitude integrands.
+ */
+typedef struct FsoTurbulenceParameterType
+{
+  double A;   //!< index of refraction at ground level
+  double v;   //!< RMS wind speed in m/s
+  double hgs; //!< altitude of the ground station in meters
+} FsoTurbulenceParameters;
+
+/**
+ * \ingroup fso
+ *
+ * \brief Memoizes integrals of a turbulence profile over altitude
+ *
+ * The integrals of the Hufnagel-Valley profile used by the scintillation
+ * index and the Greenwood time constant only depend on the transmitter and
+ * receiver altitudes, the wind speed and the index of refraction at ground
+ * level. Results are cached with keys quantized by an altitude resolution
+ * and a relative parameter tolerance, so that a static or slowly moving link
+ * only runs the GSL solver once.
+ *
+ * Optionally, a cumulative table of the integral from the receiver altitude
+ * up to the top of the turbulent atmosphere is built for each (hRx, v, A), so
+ * that any transmitter altitude is served by an O(1) cubic Hermite
+ * interpolation.
+ *
+ * Integrate () may be called concurrently, the cache is protected by a mutex.
+ *
+ * The models using the integrals expose these settings as attributes
+ * declared by AddAttributes (), so that they share the same defaults.
+ */
+class FsoTurbulenceIntegral
+{
+public:
+  /**
+   * Integrand of the altitude integral
+   *
+   * arg1: altitude in meters
+   * arg2: pointer to a FsoTurbulenceParameters struct
+   */
+  typedef double (*Integrand)(double, void *);
+
+  /**
+   * \param integrand the function to integrate over altitude
+   * \param epsAbs the absolute error limit of the numerical integration
+   * \param epsRel the relative error limit of the numerical integration
+   */
+  FsoTurbulenceIntegral (Integrand integrand, double epsAbs, double epsRel);
+
+  /**
+   * Integrate from hRx to hTx (limited to the top of the turbulent atmosphere)
+   *
+   * \param hTx height of transmitter in meters
+   * \param hRx height of receiver in meters
+   * \param windSpeed the RMS wind speed in m/s
+   * \param gndRefractiveIdx the index of refraction at ground level
+   * \return the integral
+   */
+  double Integrate (double hTx, double hRx, double windSpeed, double gndRefractiveIdx);
+
+  /**
+   * \param resolution the altitude quantization of the cache keys in meters,
+   *        0 disables the cache
+   */
+  void SetAltitudeResolution (double resolution);
+
+  /**
+   * \return the altitude quantization of the cache keys in meters
+   */
+  double GetAltitudeResolution () const;
+
+  /**
+   * \param tolerance the relative quantization of the wind speed and ground
+   *        index of refraction in the cache keys
+   */
+  void SetParameterTolerance (double tolerance);
+
+  /**
+   * \return the relative quantization of the wind speed and ground index of refraction
+   */
+  double GetParameterTolerance () const;
+
+  /**
+   * \param step the altitude step of the cumulative profile table in meters,
+   *        0 disables the table
+   */
+  void SetProfileStep (double step);
+
+  /**
+   * \return the altitude step of the cumulative profile table in meters
+   */
+  double GetProfileStep () const;
+
+  /**
+   * Declare the CacheAltitudeResolution, CacheParameterTolerance and
+   * ProfileTableStep attributes of a model using turbulence integrals.
+   * T must provide SetCacheAltitudeResolution, SetCacheParameterTolerance,
+   * SetProfileTableStep and the matching getters.
+   *
+   * \param tid the TypeId of T
+   * \return tid with the attributes added
+   */
+  template <class T>
+  static TypeId AddAttributes (TypeId tid);
+
+  /**
+   * Discard all cached integrals and profile tables
+   */
+  void Clear ();
+
+  /**
+   * \return the number of integrals served from the cache or a profile table
+   */
+  uint64_t GetHits () const;
+
+  /**
+   * \return the number of integrals computed with the numerical solver
+   */
+  uint64_t GetMisses () const;
+
+  /**
+   * Altitude (m) above which the turbulence is negligible
+   */
+  static const double MAX_TURBULENCE_HEIGHT;
+
+  static const double DEFAULT_ALTITUDE_RESOLUTION; //!< default altitude quantization (m)
+  static const double DEFAULT_PARAMETER_TOLERANCE; //!< default relative parameter quantization
+  static const double DEFAULT_PROFILE_STEP;        //!< default profile table step (m), no table
+
+private:
+  /**
+   * Quantized cache key
+   */
+  struct Key
+  {
+    int64_t hTx; //!< quantized transmitter altitude
+    int64_t hRx; //!< quantized receiver altitude
+    int64_t v;   //!< quantized wind speed
+    int64_t A;   //!< quantized index of refraction at ground level
+
+    /**
+     * \param o the other key
+     * \return true if this key is ordered before o
+     */
+    bool operator < (const Key &o) const;
+  };
+
+  /**
+   * Cumulative integral from hRx sampled every m_profileStep
+   */
+  struct Profile
+  {
+    FsoTurbulenceParameters params;  //!< profile parameters
+    std::vector<double> cumulative;  //!< integral from hRx to each node
+    std::vector<double> integrand;   //!< integrand at each node
+  };
+
+  /**
+   * \param h the altitude
+   * \return the quantized altitude
+   */
+  int64_t QuantizeAltitude (double h) const;
+
+  /**
+   * \param x the wind speed or index of refraction
+   * \return the quantized parameter
+   */
+  int64_t QuantizeParameter (double x) const;
+
+  /**
+   * \param a lower integration limit
+   * \param b upper integration limit
+   * \param params the profile parameters
+   * \return the integral computed by the numerical solver
+   */
+  double Solve (double a, double b, FsoTurbulenceParameters params) const;
+
+  /**
+   * \param profile the profile to fill, params must be set
+   */
+  void BuildProfile (Profile &profile) const;
+
+  /**
+   * \param profile the profile table
+   * \param hTx height of transmitter in meters
+   * \return the interpolated integral
+   */
+  double InterpolateProfile (const Profile &profile, double hTx) const;
+
+  Integrand m_integrand;          //!< the function to integrate
+  double m_epsAbs;                //!< absolute error limit of the solver
+  double m_epsRel;                //!< relative error limit of the solver
+
+  double m_altitudeResolution;    //!< altitude quantization (m)
+  double m_parameterTolerance;    //!< relative quantization of v and A
+  double m_profileStep;           //!< altitude step of the profile tables (m)
+
+  std::map<Key, double> m_cache;        //!< memoized integrals
+  std::map<Key, Profile> m_profiles;    //!< profile tables, keyed with hTx = 0
+
+  uint64_t m_hits;                //!< number of cached results
+  uint64_t m_misses;              //!< number of solver calls
+
+#ifdef HAVE_PTHREAD_H
+  SystemMutex m_mutex;            //!< protects the cache and the counters
+#endif
+};
+
+template <class T>
+TypeId
+FsoTurbulenceIntegral::AddAttributes (TypeId tid)
+{
+  return tid
+    .AddAttribute ("CacheAltitudeResolution",
+                   "The altitude quantization (meters) of the cached turbulence integrals, 0 disables the cache",
+                   DoubleValue (DEFAULT_ALTITUDE_RESOLUTION),
+                   MakeDoubleAccessor (&T::SetCacheAltitudeResolution,
+                                       &T::GetCacheAltitudeResolution),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("CacheParameterTolerance",
+                   "The relative quantization of the wind speed and ground index of refraction of the cached turbulence integrals",
+                   DoubleValue (DEFAULT_PARAMETER_TOLERANCE),
+                   MakeDoubleAccessor (&T::SetCacheParameterTolerance,
+                                       &T::GetCacheParameterTolerance),
+                   MakeDoubleChecker<double> (1e-12, 1.0))
+    .AddAttribute ("ProfileTableStep",
+                   "The altitude step (meters) of the cumulative turbulence profile table, 0 disables the table",
+                   DoubleValue (DEFAULT_PROFILE_STEP),
+                   MakeDoubleAccessor (&T::SetProfileTableStep,
+                                       &T::GetProfileTableStep),
+                   MakeDoubleChecker<double> (0.0));
+}
+
+} // namespace ns3
+
+#endif /* FSO_TURBULENCE_INTEGRAL_H */
@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "fso-turbulence-time-series.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <cmath>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsoTurbulenceTimeSeries");
+
+FsoTurbulenceTimeSeries::FsoTurbulenceTimeSeries ()
+  : m_correlationTime (0.0),
+    m_samplesPerCorrelation (20),
+    m_blockSize (1024),
+    m_interval (0.0),
+    m_origin (Seconds (0.0)),
+    m_firstIndex (0),
+    m_started (false),
+    m_value (0.0),
+    m_derivative (0.0)
+{
+  m_normal = CreateObject<NormalRandomVariable> ();
+}
+
+void
+FsoTurbulenceTimeSeries::SetCorrelationTime (double correlationTime, Time now)
+{
+  NS_LOG_FUNCTION (this << correlationTime << now);
+  NS_ASSERT (correlationTime > 0.0);
+
+  if (m_started && m_correlationTime > 0.0)
+    {
+      //Bring the state to the current time before changing the time scale
+      uint64_t last = m_firstIndex + m_samples.size () - 1;
+      double elapsed = (now - GetSampleTime (last)).GetSeconds ();
+      if (elapsed > 0.0)
+        {
+          Advance (ComputeTransition (elapsed));
+        }
+      //The derivative has a standard deviation of 1/T
+      m_derivative *= m_correlationTime/correlationTime;
+    }
+
+  m_correlationTime = correlationTime;
+  m_interval = m_correlationTime/m_samplesPerCorrelation;
+  m_step = ComputeTransition (m_interval);
+  m_origin = now;
+  m_firstIndex = 0;
+  m_samples.clear ();
+  if (m_started)
+    {
+      m_samples.push_back (m_value);
+    }
+}
+
+double
+FsoTurbulenceTimeSeries::GetCorrelationTime () const
+{
+  return m_correlationTime;
+}
+
+void
+FsoTurbulenceTimeSeries::SetSamplesPerCorrelationTime (uint32_t samples)
+{
+  NS_ASSERT (samples > 0);
+  m_samplesPerCorrelation = samples;
+  if (m_correlationTime > 0.0)
+    {
+      m_interval = m_correlationTime/m_samplesPerCorrelation;
+      m_step = ComputeTransition (m_interval);
+    }
+  Clear ();
+}
+
+uint32_t
+FsoTurbulenceTimeSeries::GetSamplesPerCorrelationTime () const
+{
+  return m_samplesPerCorrelation;
+}
+
+void
+FsoTurbulenceTimeSeries::SetBlockSize (uint32_t size)
+{
+  NS_ASSERT (size > 0);
+  m_blockSize = size;
+}
+
+uint32_t
+FsoTurbulenceTimeSeries::GetBlockSize () const
+{
+  return m_blockSize;
+}
+
+int64_t
+FsoTurbulenceTimeSeries::AssignStreams (int64_t stream)
+{
+  m_normal->SetStream (stream);
+  return 1;
+}
+
+double
+FsoTurbulenceTimeSeries::GetValue (Time t)
+{
+  return GetSample (GetIndex (t));
+}
+
+uint64_t
+FsoTurbulenceTimeSeries::GetIndex (Time t) const
+{
+  NS_ASSERT_MSG (m_correlationTime > 0.0, "The correlation time is not set");
+  double x = (t - m_origin).GetSeconds ()/m_interval;
+  if (x <= 0.0)
+    {
+      return 0;
+    }
+  return static_cast<uint64_t> (x);
+}
+
+double
+FsoTurbulenceTimeSeries::GetSample (uint64_t index)
+{
+  Start ();
+  if (index < m_firstIndex)
+    {
+      NS_LOG_WARN ("Sample " << index << " is no longer available, using sample " << m_firstIndex);
+      return m_samples.front ();
+    }
+  Generate (index);
+  return m_samples[index - m_firstIndex];
+}
+
+Time
+FsoTurbulenceTimeSeries::GetSampleTime (uint64_t index) const
+{
+  return m_origin + Seconds (index*m_interval);
+}
+
+double
+FsoTurbulenceTimeSeries::GetSampleInterval () const
+{
+  return m_interval;
+}
+
+void
+FsoTurbulenceTimeSeries::Clear ()
+{
+  NS_LOG_FUNCTION (this);
+  m_samples.clear ();
+  m_firstIndex = 0;
+  m_started = false;
+}
+
+FsoTurbulenceTimeSeries::Transition
+FsoTurbulenceTimeSeries::ComputeTransition (double step) const
+{
+  double lambda = 1.0/m_correlationTime;
+  double lambda2 = lambda*lambda;
+  double e = std::exp (-lambda*step);
+
+  Transition tr;
+  tr.a11 = e*(1.0 + lambda*step);
+  tr.a12 = e*step;
+  tr.a21 = -e*lambda2*step;
+  tr.a22 = e*(1.0 - lambda*step);
+
+  //The process noise covariance is P - A P A' with the stationary covariance P = diag (1, 1/T^2)
+  double q11 = 1.0 - (tr.a11*tr.a11 + tr.a12*tr.a12*lambda2);
+  double q12 = -(tr.a11*tr.a21 + tr.a12*tr.a22*lambda2);
+  double q22 = lambda2 - (tr.a21*tr.a21 + tr.a22*tr.a22*lambda2);
+
+  tr.l11 = std::sqrt (std::max (q11, 0.0));
+  tr.l21 = tr.l11 > 0.0 ? q12/tr.l11 : 0.0;
+  tr.l22 = std::sqrt (std::max (q22 - tr.l21*tr.l21, 0.0));
+  return tr;
+}
+
+void
+FsoTurbulenceTimeSeries::Advance (const Transition &tr)
+{
+  double z1 = m_normal->GetValue ();
+  double z2 = m_normal->GetValue ();
+  double value = tr.a11*m_value + tr.a12*m_derivative + tr.l11*z1;
+  m_derivative = tr.a21*m_value + tr.a22*m_derivative + tr.l21*z1 + tr.l22*z2;
+  m_value = value;
+}
+
+void
+FsoTurbulenceTimeSeries::Start ()
+{
+  if (m_started)
+    {
+      return;
+    }
+  NS_ASSERT_MSG (m_correlationTime > 0.0, "The correlation time is not set");
+  m_value = m_normal->GetValue ();
+  m_derivative = m_normal->GetValue ()/m_correlationTime;
+  m_samples.assign (1, m_value);
+  m_firstIndex = 0;
+  m_started = true;
+}
+
+void
+FsoTurbulenceTimeSeries::Generate (uint64_t index)
+{
+  uint64_t last = m_firstIndex + m_samples.size () - 1;
+  if (index <= last)
+    {
+      return;
+    }
+
+  if (index > last + m_blockSize)
+    {
+      //Jump over the idle period in a single exact step
+      NS_LOG_LOGIC ("Skipping " << index - last << " samples");
+      Advance (ComputeTransition ((index - last)*m_interval));
+      m_samples.assign (1, m_value);
+      m_firstIndex = index;
+      return;
+    }
+
+  while (index > last)
+    {
+      //Retain one block of history for packets spanning a block boundary
+      if (m_samples.size () > m_blockSize)
+        {
+          std::size_t drop = m_samples.size () - m_blockSize;
+          m_samples.erase (m_samples.begin (), m_samples.begin () + drop);
+          m_firstIndex += drop;
+        }
+      for (uint32_t i = 0; i < m_blockSize; i++)
+        {
+          Advance (m_step);
+          m_samples.push_back (m_value);
+        }
+      last += m_blockSize;
+    }
+}
+
+} // namespace ns3
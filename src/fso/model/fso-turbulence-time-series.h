@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FSO_TURBULENCE_TIME_SERIES_H
+#define FSO_TURBULENCE_TIME_SERIES_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup fso
+ *
+ * \brief Correlated Gaussian process driving the scintillation of a receiver
+ *
+ * The log-amplitude fluctuations are modeled as a stationary zero mean, unit
+ * variance Gaussian process X(t) with the autocorrelation
+ *
+ *   R(tau) = (1 + |tau|/T) exp (-|tau|/T)
+ *
+ * where T is the correlation time (the Greenwood time constant). The process
+ * is differentiable, so its level crossing rate is finite: the number of
+ * downward crossings of a level u per second is exp (-u^2/2)/(2 pi T)
+ * (Rice), which is the fade statistics of the weak turbulence log-normal
+ * model (see CalcNumFades.m and CalcFadeDuration.m in test/references).
+ *
+ * The process is sampled every T/SamplesPerCorrelationTime with the exact
+ * discretization of its two dimensional (value, derivative) state, in blocks
+ * of samples generated on demand. Between samples the process is held
+ * constant. Gaps longer than a block are skipped exactly in a single step.
+ */
+class FsoTurbulenceTimeSeries
+{
+public:
+  FsoTurbulenceTimeSeries ();
+
+  /**
+   * Set the correlation time. The process keeps its current state and is
+   * resampled with the new correlation time from time now.
+   *
+   * \param correlationTime the correlation time in seconds
+   * \param now the current time
+   */
+  void SetCorrelationTime (double correlationTime, Time now);
+
+  /**
+   * \return the correlation time in seconds, 0 if not set
+   */
+  double GetCorrelationTime () const;
+
+  /**
+   * \param samples the number of samples per correlation time
+   */
+  void SetSamplesPerCorrelationTime (uint32_t samples);
+
+  /**
+   * \return the number of samples per correlation time
+   */
+  uint32_t GetSamplesPerCorrelationTime () const;
+
+  /**
+   * \param size the number of samples generated at once
+   */
+  void SetBlockSize (uint32_t size);
+
+  /**
+   * \return the number of samples generated at once
+   */
+  uint32_t GetBlockSize () const;
+
+  /**
+   * \param stream the stream index of the normal random variable
+   * \return the number of streams assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \param t the time, not earlier than the last call to SetCorrelationTime
+   * \return the value of the process at time t
+   */
+  double GetValue (Time t);
+
+  /**
+   * \param t the time, not earlier than the last call to SetCorrelationTime
+   * \return the index of the sample holding at time t
+   */
+  uint64_t GetIndex (Time t) const;
+
+  /**
+   * \param index the index of a sample, samples more than a block older than
+   *        the latest generated one are no longer available
+   * \return the value of the sample
+   */
+  double GetSample (uint64_t index);
+
+  /**
+   * \param index the index of a sample
+   * \return the time at which the sample starts holding
+   */
+  Time GetSampleTime (uint64_t index) const;
+
+  /**
+   * \return the time between two samples in seconds
+   */
+  double GetSampleInterval () const;
+
+  /**
+   * Discard the samples, the process restarts from its stationary distribution
+   */
+  void Clear ();
+
+private:
+  /**
+   * Exact transition of the (value, derivative) state over a time step
+   */
+  struct Transition
+  {
+    double a11; //!< value from value
+    double a12; //!< value from derivative
+    double a21; //!< derivative from value
+    double a22; //!< derivative from derivative
+    double l11; //!< Cholesky factor of the process noise
+    double l21; //!< Cholesky factor of the process noise
+    double l22; //!< Cholesky factor of the process noise
+  };
+
+  /**
+   * \param step the time step in seconds
+   * \return the transition of the state over the step
+   */
+  Transition ComputeTransition (double step) const;
+
+  /**
+   * Advance the state by one transition
+   *
+   * \param tr the transition
+   */
+  void Advance (const Transition &tr);
+
+  /**
+   * Generate samples until the index is available
+   *
+   * \param index the index of the sample needed
+   */
+  void Generate (uint64_t index);
+
+  /**
+   * Start the process from its stationary distribution if needed
+   */
+  void Start ();
+
+  double m_correlationTime;          //!< correlation time (s)
+  uint32_t m_samplesPerCorrelation;  //!< samples per correlation time
+  uint32_t m_blockSize;              //!< samples generated at once
+  double m_interval;                 //!< time between samples (s)
+  Transition m_step;                 //!< transition over one sample interval
+
+  Ptr<NormalRandomVariable> m_normal; //!< source of the process noise
+
+  Time m_origin;                     //!< time of the sample with index 0
+  uint64_t m_firstIndex;             //!< index of m_samples[0]
+  std::vector<double> m_samples;     //!< retained samples of the process
+  bool m_started;                    //!< whether the state is initialized
+  double m_value;                    //!< value of the last generated sample
+  double m_derivative;               //!< derivative of the last generated sample
+};
+
+} // namespace ns3
+
+#endif /* FSO_TURBULENCE_TIME_SERIES_H */
@@ -23,6 +23,7 @@
 
 #include <ns3/log.h>
 #include <ns3/double.h>
+#include <ns3/assert.h>
 #include <cmath>
 
 #include "laser-antenna-model.h"
@@ -72,10 +73,30 @@ LaserAntennaModel::GetTypeId ()
                    MakeDoubleAccessor (&LaserAntennaModel::SetGain,
                                        &LaserAntennaModel::GetGain),
                    MakeDoubleChecker<double> ())
+    .AddAttribute ("Divergence",
+                   "The full angle (radians) of the cone illuminated by the laser when it is pointed, 0 illuminates every receiver.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&LaserAntennaModel::SetDivergence,
+                                       &LaserAntennaModel::GetDivergence),
+                   MakeDoubleChecker<double> (0.0, 2*M_PI))
   ;
   return tid;
 }
 
+LaserAntennaModel::LaserAntennaModel ()
+  : m_divergence (0.0),
+    m_pointingDirection (Vector (0.0, 0.0, -1.0)),
+    m_hasPointingDirection (false)
+{
+}
+
+void
+LaserAntennaModel::DoDispose ()
+{
+  m_pointingTarget = 0;
+  AntennaModel::DoDispose ();
+}
+
 void 
 LaserAntennaModel::SetBeamwidth (double beamwidthMeters)
 { 
@@ -167,5 +188,76 @@ LaserAntennaModel::GetGainDb (Angles a)
 }
 
 
+void
+LaserAntennaModel::SetDivergence (double divergence)
+{
+  NS_LOG_FUNCTION (this << divergence);
+  m_divergence = divergence;
+}
+
+double
+LaserAntennaModel::GetDivergence () const
+{
+  return m_divergence;
+}
+
+void
+LaserAntennaModel::SetPointingTarget (Ptr<MobilityModel> target)
+{
+  NS_LOG_FUNCTION (this << target);
+  m_pointingTarget = target;
+}
+
+Ptr<MobilityModel>
+LaserAntennaModel::GetPointingTarget () const
+{
+  return m_pointingTarget;
 }
 
+void
+LaserAntennaModel::SetPointingDirection (Vector direction)
+{
+  NS_LOG_FUNCTION (this << direction);
+  double norm = std::sqrt (direction.x*direction.x + direction.y*direction.y + direction.z*direction.z);
+  NS_ASSERT_MSG (norm > 0.0, "The pointing direction must not be null");
+  m_pointingDirection = Vector (direction.x/norm, direction.y/norm, direction.z/norm);
+  m_hasPointingDirection = true;
+}
+
+bool
+LaserAntennaModel::IsPointed () const
+{
+  return m_divergence > 0.0 && m_divergence < M_PI && (m_pointingTarget != 0 || m_hasPointingDirection);
+}
+
+Vector
+LaserAntennaModel::GetBeamAxis (const Vector &txPosition) const
+{
+  if (m_pointingTarget != 0)
+    {
+      Vector target = m_pointingTarget->GetPosition ();
+      Vector d = Vector (target.x - txPosition.x, target.y - txPosition.y, target.z - txPosition.z);
+      double norm = std::sqrt (d.x*d.x + d.y*d.y + d.z*d.z);
+      if (norm > 0.0)
+        {
+          return Vector (d.x/norm, d.y/norm, d.z/norm);
+        }
+    }
+  return m_pointingDirection;
+}
+
+bool
+LaserAntennaModel::Illuminates (const Vector &txPosition, const Vector &rxPosition) const
+{
+  if (!IsPointed ())
+    {
+      return true;
+    }
+  Vector axis = GetBeamAxis (txPosition);
+  Vector d = Vector (rxPosition.x - txPosition.x, rxPosition.y - txPosition.y, rxPosition.z - txPosition.z);
+  double range = std::sqrt (d.x*d.x + d.y*d.y + d.z*d.z);
+  double along = d.x*axis.x + d.y*axis.y + d.z*axis.z;
+  return along > 0.0 && along >= range*std::cos (0.5*m_divergence);
+}
+
+}
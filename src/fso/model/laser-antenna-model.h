@@ -26,6 +26,8 @@
 
 #include <ns3/object.h>
 #include <ns3/antenna-model.h>
+#include <ns3/vector.h>
+#include <ns3/mobility-model.h>
 
 namespace ns3 {
 
@@ -34,6 +36,9 @@ namespace ns3 {
  * Laser model based on the parameters needed for the optical signal
  * to be transmitted
  *
+ * A laser with a non zero divergence is pointed, at a target mobility model
+ * or in a fixed direction, and only illuminates the receivers within the
+ * cone of its divergence. Otherwise it illuminates every receiver.
  */
 class LaserAntennaModel : public AntennaModel
 {
@@ -42,6 +47,8 @@ public:
   // inherited from Object
   static TypeId GetTypeId ();
 
+  LaserAntennaModel ();
+
   // inherited from AntennaModel
   virtual double GetGainDb (Angles a);
 
@@ -58,6 +65,58 @@ public:
   void SetWavelength (double wavelength);
   double GetWavelength () const;
 
+  /**
+   * \param divergence the full angle (radians) of the cone illuminated by
+   *        a pointed laser, 0 illuminates every receiver
+   */
+  void SetDivergence (double divergence);
+
+  /**
+   * \return the full angle (radians) of the cone illuminated by a pointed laser
+   */
+  double GetDivergence () const;
+
+  /**
+   * Point the laser at a mobility model, followed as it moves
+   *
+   * \param target the mobility model of the target
+   */
+  void SetPointingTarget (Ptr<MobilityModel> target);
+
+  /**
+   * \return the mobility model the laser is pointed at, if any
+   */
+  Ptr<MobilityModel> GetPointingTarget () const;
+
+  /**
+   * Point the laser in a fixed direction, used when no target is set
+   *
+   * \param direction the direction of the beam axis, need not be normalized
+   */
+  void SetPointingDirection (Vector direction);
+
+  /**
+   * \return true if the laser only illuminates the receivers within its divergence
+   */
+  bool IsPointed () const;
+
+  /**
+   * \param txPosition the position of the laser
+   * \return the unit vector of the beam axis
+   */
+  Vector GetBeamAxis (const Vector &txPosition) const;
+
+  /**
+   * \param txPosition the position of the laser
+   * \param rxPosition the position of a receiver
+   * \return true if the receiver is within the cone of the beam
+   */
+  bool Illuminates (const Vector &txPosition, const Vector &rxPosition) const;
+
+protected:
+  // inherited from Object
+  virtual void DoDispose ();
+
 private:
 
   double m_beamwidthMeters; //!< diameter of the beam in meters
@@ -69,6 +128,14 @@ private:
   double m_gain; //!< Gain in dB
 
   double m_wavelength; //!< wavelength of light in meters
+
+  double m_divergence; //!< full angle of the beam cone in radians, 0 if not pointed
+
+  Ptr<MobilityModel> m_pointingTarget; //!< mobility model the beam follows
+
+  Vector m_pointingDirection; //!< unit vector of the fixed beam axis
+
+  bool m_hasPointingDirection; //!< whether a fixed direction was set
 };
 
 
@@ -0,0 +1,484 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
+#include "ns3/fso-channel.h"
+#include "ns3/fso-phy.h"
+#include "ns3/fso-signal-parameters.h"
+#include "ns3/fso-error-model.h"
+#include "ns3/optical-rx-antenna-model.h"
+#include "ns3/laser-antenna-model.h"
+#include "ns3/packet-burst.h"
+#include "ns3/fso-free-space-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/fso-stage-timer.h"
+#include "ns3/boolean.h"
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FsoChannelTest");
+
+/**
+ * \ingroup fso
+ *
+ * \brief FsoPhy recording the signal parameters it receives
+ */
+class FsoRecordingPhy : public FsoPhy
+{
+public:
+  virtual void Receive (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams)
+  {
+    m_received.push_back (fsoSignalParams);
+  }
+
+  virtual void ReceiveBurst (Ptr<PacketBurst> burst, Ptr<FsoSignalParameters> fsoSignalParams)
+  {
+    m_received.push_back (fsoSignalParams);
+    m_burstSizes.push_back (burst->GetNPackets ());
+  }
+
+  std::vector<Ptr<FsoSignalParameters> > m_received;//!< the received signal parameters
+  std::vector<uint32_t> m_burstSizes;//!< the number of packets of the received bursts
+};
+
+/**
+ * \ingroup fso
+ *
+ * \brief Error model receiving every packet
+ */
+class FsoNoErrorModel : public FsoErrorModel
+{
+public:
+  virtual double GetPacketSuccessRate (Ptr<Packet> packet, Ptr<FsoSignalParameters> fsoSignalParams)
+  {
+    return 1.0;
+  }
+
+private:
+  virtual int64_t DoAssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+
+  virtual void DoDispose ()
+  {
+  }
+};
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the per receiver signal parameters of the channel
+ *
+ * A transmitter sends to receivers at different distances. Each receiver
+ * must get its own signal parameters with the free space loss of its link,
+ * whether the loss models are evaluated serially or in parallel.
+ */
+class FsoChannelPerReceiverTestCase : public TestCase
+{
+public:
+  FsoChannelPerReceiverTestCase ();//!< default constructor
+  virtual ~FsoChannelPerReceiverTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+
+  /**
+   * \param threads the number of threads evaluating the loss models
+   */
+  void RunChannel (uint32_t threads);
+};
+
+FsoChannelPerReceiverTestCase::FsoChannelPerReceiverTestCase ()
+  : TestCase ("Check that every receiver gets its own signal parameters")
+{
+}
+
+FsoChannelPerReceiverTestCase::~FsoChannelPerReceiverTestCase ()
+{
+}
+
+void
+FsoChannelPerReceiverTestCase::RunChannel (uint32_t threads)
+{
+  Ptr<FsoChannel> channel = CreateObject<FsoChannel> ();
+  channel->SetAttribute ("LossEvaluationThreads", UintegerValue (threads));
+  channel->SetAttribute ("ParallelThreshold", UintegerValue (0));
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  Ptr<FsoFreeSpaceLossModel> lossModel = CreateObject<FsoFreeSpaceLossModel> ();
+  channel->AddFsoPropagationLossModel (lossModel);
+
+  Ptr<FsoRecordingPhy> sender = CreateObject<FsoRecordingPhy> ();
+  Ptr<ConstantPositionMobilityModel> senderMobility = CreateObject<ConstantPositionMobilityModel> ();
+  senderMobility->SetPosition (Vector (0.0, 0.0, 0.0));
+  sender->SetMobility (senderMobility);
+  channel->Add (sender);
+
+  std::vector<Ptr<FsoRecordingPhy> > receivers;
+  for (uint32_t i = 0; i < 40; i++)
+    {
+      Ptr<FsoRecordingPhy> phy = CreateObject<FsoRecordingPhy> ();
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (1000.0*(i + 1), 0.0, 0.0));
+      phy->SetMobility (mobility);
+      channel->Add (phy);
+      receivers.push_back (phy);
+    }
+
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->wavelength = 847e-9;
+  params->power = 0.0;
+
+  channel->Send (sender, Create<Packet> (100), params, Seconds (0.0));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (sender->m_received.size (), 0, "The sender received its own transmission");
+  NS_TEST_EXPECT_MSG_EQ (params->pathLoss, 0.0, "The parameters of the transmitter were modified");
+  for (uint32_t i = 0; i < receivers.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (receivers[i]->m_received.size (), 1, "Receiver " << i << " did not receive the transmission");
+      Ptr<FsoSignalParameters> rx = receivers[i]->m_received[0];
+      double expected = lossModel->CalculateFreeSpaceLoss (1000.0*(i + 1), 847e-9);
+      NS_TEST_EXPECT_MSG_NE (rx, params, "Receiver " << i << " shares the parameters of the transmitter");
+      NS_TEST_EXPECT_MSG_EQ_TOL (rx->pathLoss, expected, 1e-9, "Wrong path loss at receiver " << i << " with " << threads << " threads");
+      NS_TEST_EXPECT_MSG_EQ_TOL (rx->power, -expected, 1e-9, "Wrong power at receiver " << i << " with " << threads << " threads");
+    }
+
+  Simulator::Destroy ();
+}
+
+void
+FsoChannelPerReceiverTestCase::DoRun (void)
+{
+  RunChannel (1);
+  RunChannel (4);
+}
+
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the transmission of bursts of packets
+ *
+ * Each receiver must get a single receive event per burst, and the packets
+ * of the burst must be traced at the end of their own airtime.
+ */
+class FsoChannelBurstTestCase : public TestCase
+{
+public:
+  FsoChannelBurstTestCase ();//!< default constructor
+  virtual ~FsoChannelBurstTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+
+  /**
+   * \param packet the received packet
+   * \param time the end of its reception
+   */
+  void PacketRxEnd (Ptr<const Packet> packet, Time time);
+
+  std::vector<uint32_t> m_sizes;//!< the sizes of the received packets
+  std::vector<Time> m_times;    //!< the end of reception of the packets
+};
+
+FsoChannelBurstTestCase::FsoChannelBurstTestCase ()
+  : TestCase ("Check the transmission of bursts of packets")
+{
+}
+
+FsoChannelBurstTestCase::~FsoChannelBurstTestCase ()
+{
+}
+
+void
+FsoChannelBurstTestCase::PacketRxEnd (Ptr<const Packet> packet, Time time)
+{
+  m_sizes.push_back (packet->GetSize ());
+  m_times.push_back (time);
+}
+
+void
+FsoChannelBurstTestCase::DoRun (void)
+{
+  Ptr<FsoChannel> channel = CreateObject<FsoChannel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->AddFsoPropagationLossModel (CreateObject<FsoFreeSpaceLossModel> ());
+
+  Ptr<FsoRecordingPhy> sender = CreateObject<FsoRecordingPhy> ();
+  Ptr<ConstantPositionMobilityModel> senderMobility = CreateObject<ConstantPositionMobilityModel> ();
+  senderMobility->SetPosition (Vector (0.0, 0.0, 0.0));
+  sender->SetMobility (senderMobility);
+  channel->Add (sender);
+
+  Ptr<FsoRecordingPhy> recorder = CreateObject<FsoRecordingPhy> ();
+  Ptr<ConstantPositionMobilityModel> recorderMobility = CreateObject<ConstantPositionMobilityModel> ();
+  recorderMobility->SetPosition (Vector (1000.0, 0.0, 0.0));
+  recorder->SetMobility (recorderMobility);
+  channel->Add (recorder);
+
+  Ptr<FsoPhy> receiver = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> receiverMobility = CreateObject<ConstantPositionMobilityModel> ();
+  receiverMobility->SetPosition (Vector (299792458.0, 0.0, 0.0));
+  receiver->SetMobility (receiverMobility);
+  receiver->SetAntennas (0, CreateObject<OpticalRxAntennaModel> ());
+  receiver->SetErrorModel (CreateObject<FsoNoErrorModel> ());
+  receiver->TraceConnectWithoutContext ("PacketRxEnd", MakeCallback (&FsoChannelBurstTestCase::PacketRxEnd, this));
+  channel->Add (receiver);
+
+  Ptr<PacketBurst> burst = CreateObject<PacketBurst> ();
+  burst->AddPacket (Create<Packet> (100));
+  burst->AddPacket (Create<Packet> (200));
+  burst->AddPacket (Create<Packet> (300));
+
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->wavelength = 847e-9;
+  params->power = 0.0;
+  params->symbolPeriod = 1e-9;
+  params->duration = NanoSeconds (4800);
+
+  channel->SendBurst (sender, burst, params, params->duration);
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (sender->m_received.size (), 0, "The sender received its own transmission");
+  NS_TEST_ASSERT_MSG_EQ (recorder->m_burstSizes.size (), 1, "The burst was not received in a single event");
+  NS_TEST_EXPECT_MSG_EQ (recorder->m_burstSizes[0], 3, "Packets are missing from the burst");
+
+  //The receiver is one light second away, the packets take 800, 1600 and 2400 ns
+  NS_TEST_ASSERT_MSG_EQ (m_sizes.size (), 3, "Packets are missing from the burst");
+  NS_TEST_EXPECT_MSG_EQ (m_sizes[0], 100, "Packets of the burst out of order");
+  NS_TEST_EXPECT_MSG_EQ (m_sizes[2], 300, "Packets of the burst out of order");
+  NS_TEST_EXPECT_MSG_EQ (m_times[0], Seconds (1.0) + NanoSeconds (800), "Wrong end of reception of the first packet");
+  NS_TEST_EXPECT_MSG_EQ (m_times[1], Seconds (1.0) + NanoSeconds (2400), "Wrong end of reception of the second packet");
+  NS_TEST_EXPECT_MSG_EQ (m_times[2], Seconds (1.0) + NanoSeconds (4800), "Wrong end of reception of the third packet");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the stage timers of the Phys
+ *
+ * The channel accounts for the loss models and the scheduling in the timer
+ * of the sender, and each receiver for its reception and error model.
+ * Disabled timers must not count anything.
+ */
+class FsoChannelStageTimerTestCase : public TestCase
+{
+public:
+  FsoChannelStageTimerTestCase ();//!< default constructor
+  virtual ~FsoChannelStageTimerTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoChannelStageTimerTestCase::FsoChannelStageTimerTestCase ()
+  : TestCase ("Check the stage timers of the transmission path")
+{
+}
+
+FsoChannelStageTimerTestCase::~FsoChannelStageTimerTestCase ()
+{
+}
+
+void
+FsoChannelStageTimerTestCase::DoRun (void)
+{
+  Ptr<FsoChannel> channel = CreateObject<FsoChannel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->AddFsoPropagationLossModel (CreateObject<FsoFreeSpaceLossModel> ());
+
+  Ptr<FsoRecordingPhy> sender = CreateObject<FsoRecordingPhy> ();
+  Ptr<ConstantPositionMobilityModel> senderMobility = CreateObject<ConstantPositionMobilityModel> ();
+  senderMobility->SetPosition (Vector (0.0, 0.0, 0.0));
+  sender->SetMobility (senderMobility);
+  sender->SetAttribute ("StageTimers", BooleanValue (true));
+  channel->Add (sender);
+
+  Ptr<FsoPhy> receiver = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> receiverMobility = CreateObject<ConstantPositionMobilityModel> ();
+  receiverMobility->SetPosition (Vector (1000.0, 0.0, 0.0));
+  receiver->SetMobility (receiverMobility);
+  receiver->SetAntennas (0, CreateObject<OpticalRxAntennaModel> ());
+  receiver->SetErrorModel (CreateObject<FsoNoErrorModel> ());
+  receiver->SetStageTimersEnabled (true);
+  channel->Add (receiver);
+
+  Ptr<FsoPhy> idle = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> idleMobility = CreateObject<ConstantPositionMobilityModel> ();
+  idleMobility->SetPosition (Vector (2000.0, 0.0, 0.0));
+  idle->SetMobility (idleMobility);
+  idle->SetAntennas (0, CreateObject<OpticalRxAntennaModel> ());
+  idle->SetErrorModel (CreateObject<FsoNoErrorModel> ());
+  channel->Add (idle);
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+      params->wavelength = 847e-9;
+      params->power = 0.0;
+      params->symbolPeriod = 1e-9;
+      params->duration = NanoSeconds (800);
+      channel->Send (sender, Create<Packet> (100), params, params->duration);
+    }
+  Simulator::Run ();
+
+  FsoStageTimer &senderTimer = sender->GetStageTimer ();
+  NS_TEST_EXPECT_MSG_EQ (senderTimer.GetCount (FsoStageTimer::LOSS_CHAIN), 2, "Loss chain not timed");
+  NS_TEST_EXPECT_MSG_EQ (senderTimer.GetCount (FsoStageTimer::SCHEDULE), 2, "Scheduling not timed");
+  NS_TEST_EXPECT_MSG_EQ (senderTimer.GetCount (FsoStageTimer::RECEIVE), 0, "The sender timed a reception");
+
+  FsoStageTimer &receiverTimer = receiver->GetStageTimer ();
+  NS_TEST_EXPECT_MSG_EQ (receiverTimer.GetCount (FsoStageTimer::RECEIVE), 2, "Receptions not timed");
+  NS_TEST_EXPECT_MSG_EQ (receiverTimer.GetCount (FsoStageTimer::ERROR_MODEL), 2, "Error model not timed");
+  NS_TEST_EXPECT_MSG_EQ (receiverTimer.GetCount (FsoStageTimer::LOSS_CHAIN), 0, "The receiver timed the loss chain");
+  NS_TEST_EXPECT_MSG_EQ ((receiverTimer.GetMean (FsoStageTimer::RECEIVE) >= receiverTimer.GetMean (FsoStageTimer::ERROR_MODEL)), true,
+                         "The error model took longer than the reception including it");
+
+  NS_TEST_EXPECT_MSG_EQ (idle->GetStageTimer ().GetCount (FsoStageTimer::RECEIVE), 0, "A disabled timer counted a reception");
+
+  receiverTimer.Reset ();
+  NS_TEST_EXPECT_MSG_EQ (receiverTimer.GetCount (FsoStageTimer::RECEIVE), 0, "Timer not reset");
+  NS_TEST_EXPECT_MSG_EQ (receiverTimer.GetTotal (FsoStageTimer::RECEIVE), 0, "Timer not reset");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the receivers reached by pointed lasers
+ *
+ * A satellite has two lasers: one pointed at a ground station, one in a
+ * fixed direction. Only the receivers within the divergence of a laser get
+ * the transmission, with the power of that laser, whether they are found
+ * by scanning the receivers or with the spatial index.
+ */
+class FsoChannelPointedBeamTestCase : public TestCase
+{
+public:
+  FsoChannelPointedBeamTestCase ();//!< default constructor
+  virtual ~FsoChannelPointedBeamTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+
+  /**
+   * \param cellSize the cell size of the spatial index, 0 to scan the receivers
+   */
+  void RunChannel (double cellSize);
+};
+
+FsoChannelPointedBeamTestCase::FsoChannelPointedBeamTestCase ()
+  : TestCase ("Check that pointed lasers only reach the receivers within their divergence")
+{
+}
+
+FsoChannelPointedBeamTestCase::~FsoChannelPointedBeamTestCase ()
+{
+}
+
+void
+FsoChannelPointedBeamTestCase::RunChannel (double cellSize)
+{
+  Ptr<FsoChannel> channel = CreateObject<FsoChannel> ();
+  channel->SetAttribute ("SpatialIndexCellSize", DoubleValue (cellSize));
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->AddFsoPropagationLossModel (CreateObject<FsoFreeSpaceLossModel> ());
+
+  Ptr<FsoPhy> sender = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> senderMobility = CreateObject<ConstantPositionMobilityModel> ();
+  senderMobility->SetPosition (Vector (0.0, 0.0, 700000.0));
+  sender->SetMobility (senderMobility);
+  sender->SetChannel (channel);
+  channel->Add (sender);
+
+  //Ground stations, the first and second within the first beam (350 m
+  //footprint), the third outside of both beams, the fourth in the second beam
+  double positions[4] = {0.0, 300.0, 5000.0, 20000.0};
+  std::vector<Ptr<FsoRecordingPhy> > receivers;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<FsoRecordingPhy> phy = CreateObject<FsoRecordingPhy> ();
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (positions[i], 0.0, 0.0));
+      phy->SetMobility (mobility);
+      channel->Add (phy);
+      receivers.push_back (phy);
+    }
+
+  Ptr<LaserAntennaModel> targeted = CreateObject<LaserAntennaModel> ();
+  targeted->SetAttribute ("Divergence", DoubleValue (1e-3));
+  targeted->SetPointingTarget (receivers[0]->GetMobility ());
+  targeted->SetGain (100.0);
+  Ptr<LaserAntennaModel> fixed = CreateObject<LaserAntennaModel> ();
+  fixed->SetAttribute ("Divergence", DoubleValue (1e-4));
+  fixed->SetPointingDirection (Vector (20000.0, 0.0, -700000.0));
+  fixed->SetGain (110.0);
+  sender->SetAntennas (targeted, 0);
+  sender->AddTxAntenna (fixed);
+
+  sender->Transmit (Create<Packet> (100));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (receivers[0]->m_received.size (), 1, "The target of the first beam was not reached, cell size " << cellSize);
+  NS_TEST_EXPECT_MSG_EQ (receivers[1]->m_received.size (), 1, "A receiver within the first beam was not reached, cell size " << cellSize);
+  NS_TEST_EXPECT_MSG_EQ (receivers[2]->m_received.size (), 0, "A receiver outside of the beams was reached, cell size " << cellSize);
+  NS_TEST_ASSERT_MSG_EQ (receivers[3]->m_received.size (), 1, "The receiver of the second beam was not reached, cell size " << cellSize);
+
+  NS_TEST_EXPECT_MSG_EQ (receivers[0]->m_received[0]->txAntenna, targeted, "Wrong beam for the first receiver");
+  NS_TEST_EXPECT_MSG_EQ (receivers[3]->m_received[0]->txAntenna, fixed, "Wrong beam for the fourth receiver");
+  double loss0 = receivers[0]->m_received[0]->pathLoss;
+  double loss3 = receivers[3]->m_received[0]->pathLoss;
+  NS_TEST_EXPECT_MSG_EQ_TOL (receivers[3]->m_received[0]->power - receivers[0]->m_received[0]->power, 10.0 + loss0 - loss3, 1e-9,
+                             "The second beam does not carry its own power");
+
+  Simulator::Destroy ();
+}
+
+void
+FsoChannelPointedBeamTestCase::DoRun (void)
+{
+  RunChannel (0.0);
+  RunChannel (1000.0);
+  RunChannel (10.0);
+}
+
+
+class FsoChannelTestSuite : public TestSuite
+{
+public:
+  FsoChannelTestSuite ();
+};
+
+FsoChannelTestSuite::FsoChannelTestSuite ()
+  : TestSuite ("fso-channel", UNIT)
+{
+  AddTestCase (new FsoChannelPerReceiverTestCase, TestCase::QUICK);
+  AddTestCase (new FsoChannelBurstTestCase, TestCase::QUICK);
+  AddTestCase (new FsoChannelStageTimerTestCase, TestCase::QUICK);
+  AddTestCase (new FsoChannelPointedBeamTestCase, TestCase::QUICK);
+}
+
+static FsoChannelTestSuite fsoChannelTestSuite;
@@ -0,0 +1,334 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/fso-phy.h"
+#include "ns3/fso-error-model.h"
+#include "ns3/optical-rx-antenna-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include <cmath>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FsoErrorModelTest");
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the bit error rate of the downlink error model
+ *
+ * The closed form and lookup table BER methods are compared with the GSL
+ * numerical integration (when GSL is available, otherwise with the closed form).
+ */
+class FsoDownLinkBerTestCase : public TestCase
+{
+public:
+  FsoDownLinkBerTestCase ();//!< default constructor
+  virtual ~FsoDownLinkBerTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+
+  /**
+   * \param method the BER method of the error model
+   * \param antenna the receiver antenna
+   * \return a downlink error model attached to a phy using the antenna
+   */
+  Ptr<FsoDownLinkErrorModel> CreateErrorModel (FsoDownLinkErrorModel::BerMethod method, Ptr<OpticalRxAntennaModel> antenna);
+};
+
+FsoDownLinkBerTestCase::FsoDownLinkBerTestCase ()
+  : TestCase ("Check that the BER lookup table and closed form match the numerical integration")
+{
+}
+
+FsoDownLinkBerTestCase::~FsoDownLinkBerTestCase ()
+{
+}
+
+Ptr<FsoDownLinkErrorModel>
+FsoDownLinkBerTestCase::CreateErrorModel (FsoDownLinkErrorModel::BerMethod method, Ptr<OpticalRxAntennaModel> antenna)
+{
+  Ptr<FsoDownLinkErrorModel> errorModel = CreateObject<FsoDownLinkErrorModel> ();
+  Ptr<FsoPhy> phy = CreateObject<FsoPhy> ();
+  phy->SetAntennas (0, antenna);
+  phy->SetErrorModel (errorModel);
+  errorModel->SetPhy (phy);
+  errorModel->SetAttribute ("BerMethod", EnumValue (method));
+  return errorModel;
+}
+
+void
+FsoDownLinkBerTestCase::DoRun (void)
+{
+  Ptr<OpticalRxAntennaModel> antenna = CreateObject<OpticalRxAntennaModel> ();
+
+#ifdef HAVE_GSL
+  Ptr<FsoDownLinkErrorModel> reference = CreateErrorModel (FsoDownLinkErrorModel::BER_GSL_INTEGRATION, antenna);
+#else
+  Ptr<FsoDownLinkErrorModel> reference = CreateErrorModel (FsoDownLinkErrorModel::BER_CLOSED_FORM, antenna);
+#endif
+  Ptr<FsoDownLinkErrorModel> closedForm = CreateErrorModel (FsoDownLinkErrorModel::BER_CLOSED_FORM, antenna);
+  Ptr<FsoDownLinkErrorModel> lookup = CreateErrorModel (FsoDownLinkErrorModel::BER_LOOKUP_TABLE, antenna);
+
+  double tolerance = 1e-6;
+  lookup->SetAttribute ("BerTableTolerance", DoubleValue (tolerance));
+
+  //Received powers (Watts) from below the characteristic power to BER ~1e-12,
+  //beyond which the absolute tolerance of the integration dominates
+  for (double rxPower = 1e-10; rxPower < 2.5e-7; rxPower *= 1.07)
+    {
+      double expected = reference->CalculateBer (rxPower);
+
+      NS_TEST_EXPECT_MSG_EQ_TOL (closedForm->CalculateBer (rxPower), expected, expected*1e-7, "Closed form BER differs from the reference at " << rxPower << "W");
+      NS_TEST_EXPECT_MSG_EQ_TOL (lookup->CalculateBer (rxPower), expected, expected*tolerance*1.1, "Lookup table BER differs from the reference at " << rxPower << "W");
+    }
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the packet success rate integrated over the airtime
+ *
+ * A packet shorter than a sample of the irradiance time series has the same
+ * success rate as a single evaluation of the channel. Without scintillation,
+ * the irradiance is constant and the bits of a long packet spread over many
+ * samples must add up to the same success rate.
+ */
+class FsoAirtimeSuccessRateTestCase : public TestCase
+{
+public:
+  FsoAirtimeSuccessRateTestCase ();//!< default constructor
+  virtual ~FsoAirtimeSuccessRateTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoAirtimeSuccessRateTestCase::FsoAirtimeSuccessRateTestCase ()
+  : TestCase ("Check the packet success rate integrated over the airtime of a packet")
+{
+}
+
+FsoAirtimeSuccessRateTestCase::~FsoAirtimeSuccessRateTestCase ()
+{
+}
+
+void
+FsoAirtimeSuccessRateTestCase::DoRun (void)
+{
+  Ptr<FsoPhy> txPhy = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> txMobility = CreateObject<ConstantPositionMobilityModel> ();
+  txMobility->SetPosition (Vector (0.0, 0.0, 36000000.0));
+  txPhy->SetMobility (txMobility);
+
+  Ptr<FsoPhy> rxPhy = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> rxMobility = CreateObject<ConstantPositionMobilityModel> ();
+  rxMobility->SetPosition (Vector (0.0, 0.0, 0.0));
+  rxPhy->SetMobility (rxMobility);
+  rxPhy->SetAntennas (0, CreateObject<OpticalRxAntennaModel> ());
+
+  Ptr<FsoDownLinkErrorModel> errorModel = CreateObject<FsoDownLinkErrorModel> ();
+  rxPhy->SetErrorModel (errorModel);
+  errorModel->SetPhy (rxPhy);
+  errorModel->AssignStreams (1);
+
+  Ptr<Packet> packet = Create<Packet> (1000);
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->txPhy = txPhy;
+  params->wavelength = 847e-9;
+  params->meanIrradiance = 4e-4;
+  params->scintillationIndex = 0.1;
+
+  double expected = errorModel->GetPacketSuccessRate (packet, params);
+  double result = errorModel->GetAirtimeSuccessRate (packet, params, Seconds (0.0), NanoSeconds (1));
+  NS_TEST_EXPECT_MSG_EQ_TOL (result, expected, expected*1e-9, "Success rate of a short packet differs from a single evaluation");
+
+  //Without scintillation, a packet spanning many samples (the Greenwood time constant is a few ms)
+  params->scintillationIndex = 0.0;
+  expected = errorModel->GetPacketSuccessRate (packet, params);
+  NS_TEST_ASSERT_MSG_EQ ((expected > 0.01 && expected < 0.99), true, "The test parameters should give an intermediate success rate");
+  result = errorModel->GetAirtimeSuccessRate (packet, params, Seconds (0.0), Seconds (1.0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (result, expected, expected*1e-9, "Success rate of a long packet at constant irradiance differs from a single evaluation");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the combination of several receive apertures
+ *
+ * N equal independent apertures divide the scintillation index by N. With
+ * aperture averaging, the factor of each aperture follows the downlink
+ * approximation with the scale height of the Hufnagel-Valley 5/7 profile
+ * (7677 m for a ground station, from a numerical integration).
+ */
+class FsoApertureAveragingTestCase : public TestCase
+{
+public:
+  FsoApertureAveragingTestCase ();//!< default constructor
+  virtual ~FsoApertureAveragingTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoApertureAveragingTestCase::FsoApertureAveragingTestCase ()
+  : TestCase ("Check the scintillation index of combined and averaging receive apertures")
+{
+}
+
+FsoApertureAveragingTestCase::~FsoApertureAveragingTestCase ()
+{
+}
+
+void
+FsoApertureAveragingTestCase::DoRun (void)
+{
+  Ptr<FsoPhy> txPhy = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> txMobility = CreateObject<ConstantPositionMobilityModel> ();
+  txMobility->SetPosition (Vector (0.0, 0.0, 707000.0));
+  txPhy->SetMobility (txMobility);
+
+  Ptr<FsoPhy> rxPhy = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> rxMobility = CreateObject<ConstantPositionMobilityModel> ();
+  rxMobility->SetPosition (Vector (0.0, 0.0, 0.0));
+  rxPhy->SetMobility (rxMobility);
+
+  Ptr<FsoDownLinkErrorModel> errorModel = CreateObject<FsoDownLinkErrorModel> ();
+  rxPhy->SetErrorModel (errorModel);
+  errorModel->SetPhy (rxPhy);
+
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->txPhy = txPhy;
+  params->wavelength = 847e-9;
+
+  Ptr<OpticalRxAntennaModel> large = CreateObject<OpticalRxAntennaModel> ();
+  large->SetAttribute ("ApertureDiameter", DoubleValue (0.318));
+  rxPhy->SetAntennas (0, large);
+  NS_TEST_EXPECT_MSG_EQ (errorModel->GetApertureAveragingFactor (params), 1.0, "A single point aperture must not change the scintillation");
+
+  errorModel->SetAttribute ("ApertureAveraging", BooleanValue (true));
+  NS_TEST_EXPECT_MSG_EQ_TOL (errorModel->GetApertureAveragingFactor (params), 0.03568, 0.03568*0.02, "Unexpected aperture averaging factor");
+
+  rxPhy->SetAntennas (0, 0);
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<OpticalRxAntennaModel> small = CreateObject<OpticalRxAntennaModel> ();
+      small->SetAttribute ("ApertureDiameter", DoubleValue (0.05));
+      small->SetAttribute ("ReceiverGain", DoubleValue (20.0));
+      rxPhy->AddRxAntenna (small);
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (rxPhy->GetRxGain (), 20.0 + 10*std::log10 (4.0), 1e-9, "The gains of the apertures are not combined");
+  NS_TEST_EXPECT_MSG_EQ_TOL (errorModel->GetApertureAveragingFactor (params), 0.25*0.7349, 0.25*0.7349*0.02, "Unexpected factor of averaging apertures");
+
+  errorModel->SetAttribute ("ApertureAveraging", BooleanValue (false));
+  NS_TEST_EXPECT_MSG_EQ_TOL (errorModel->GetApertureAveragingFactor (params), 0.25, 1e-12, "Four independent apertures must divide the scintillation index by four");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for a horizontal link
+ *
+ * Two nodes at the same altitude see each other at a zero elevation, where
+ * the Greenwood time constant of a slant path vanishes. The elevation is
+ * bounded, so that the irradiance time series keeps a positive correlation
+ * time.
+ */
+class FsoHorizontalLinkTestCase : public TestCase
+{
+public:
+  FsoHorizontalLinkTestCase ();//!< default constructor
+  virtual ~FsoHorizontalLinkTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoHorizontalLinkTestCase::FsoHorizontalLinkTestCase ()
+  : TestCase ("Check the error model of a link between two nodes at the same altitude")
+{
+}
+
+FsoHorizontalLinkTestCase::~FsoHorizontalLinkTestCase ()
+{
+}
+
+void
+FsoHorizontalLinkTestCase::DoRun (void)
+{
+  Ptr<FsoPhy> txPhy = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> txMobility = CreateObject<ConstantPositionMobilityModel> ();
+  txMobility->SetPosition (Vector (0.0, 0.0, 0.0));
+  txPhy->SetMobility (txMobility);
+
+  Ptr<FsoPhy> rxPhy = CreateObject<FsoPhy> ();
+  Ptr<ConstantPositionMobilityModel> rxMobility = CreateObject<ConstantPositionMobilityModel> ();
+  rxMobility->SetPosition (Vector (1000.0, 0.0, 0.0));
+  rxPhy->SetMobility (rxMobility);
+  rxPhy->SetAntennas (0, CreateObject<OpticalRxAntennaModel> ());
+
+  Ptr<FsoDownLinkErrorModel> errorModel = CreateObject<FsoDownLinkErrorModel> ();
+  rxPhy->SetErrorModel (errorModel);
+  errorModel->SetPhy (rxPhy);
+  errorModel->AssignStreams (1);
+
+  double timeConstant = errorModel->CalculateTurbulenceTimeConstant (0.0, 0.0, 847e-9, 0.0);
+  NS_TEST_EXPECT_MSG_GT (timeConstant, 0.0, "The Greenwood time constant of a horizontal link must be positive");
+
+  Ptr<Packet> packet = Create<Packet> (1000);
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->txPhy = txPhy;
+  params->wavelength = 847e-9;
+  params->meanIrradiance = 4e-4;
+  params->scintillationIndex = 0.1;
+
+  double rate = errorModel->GetAirtimeSuccessRate (packet, params, Seconds (0.0), MicroSeconds (10));
+  NS_TEST_EXPECT_MSG_EQ ((rate >= 0.0 && rate <= 1.0), true, "Unexpected success rate " << rate);
+
+  errorModel->SetAttribute ("IrradianceModel", EnumValue (FsoDownLinkErrorModel::IRRADIANCE_INDEPENDENT));
+  rate = errorModel->GetPacketSuccessRate (packet, params);
+  NS_TEST_EXPECT_MSG_EQ ((rate >= 0.0 && rate <= 1.0), true, "Unexpected success rate " << rate);
+
+  Simulator::Destroy ();
+}
+
+class FsoErrorModelTestSuite : public TestSuite
+{
+public:
+  FsoErrorModelTestSuite ();
+};
+
+FsoErrorModelTestSuite::FsoErrorModelTestSuite ()
+  : TestSuite ("fso-error-model", UNIT)
+{
+  AddTestCase (new FsoDownLinkBerTestCase, TestCase::QUICK);
+  AddTestCase (new FsoAirtimeSuccessRateTestCase, TestCase::QUICK);
+  AddTestCase (new FsoApertureAveragingTestCase, TestCase::QUICK);
+  AddTestCase (new FsoHorizontalLinkTestCase, TestCase::QUICK);
+}
+
+static FsoErrorModelTestSuite fsoErrorModelTestSuite;
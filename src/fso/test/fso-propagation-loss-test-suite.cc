@@ -27,7 +27,9 @@
 #include "ns3/fso-mean-irradiance-model.h"
 #include "ns3/fso-down-link-scintillation-index-model.h"
 #include "ns3/fso-free-space-loss-model.h"
+#include "ns3/boolean.h"
 #include "ns3/constant-position-mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
 #include "ns3/simulator.h"
 #include <cmath>
 
@@ -246,6 +248,171 @@ FsoDownLinkScintillationIndexTestCase::DoRun (void)
     }
 }
 
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the cached turbulence integrals of the scintillation index
+ *
+ * The scintillation index computed with the integral cache and with the
+ * cumulative profile table is compared with the uncached numerical integration.
+ *
+ */
+class FsoTurbulenceIntegralCacheTestCase : public TestCase
+{
+public:
+  FsoTurbulenceIntegralCacheTestCase ();
+  virtual ~FsoTurbulenceIntegralCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FsoTurbulenceIntegralCacheTestCase::FsoTurbulenceIntegralCacheTestCase ()
+  : TestCase ("Check that the cached turbulence integrals match the numerical integration")
+{
+}
+
+FsoTurbulenceIntegralCacheTestCase::~FsoTurbulenceIntegralCacheTestCase ()
+{
+}
+
+void
+FsoTurbulenceIntegralCacheTestCase::DoRun (void)
+{
+  double frequency = 3e8/847e-9;
+  double zenith = (30.0 * M_PI)/180.0;
+
+  Ptr<FsoDownLinkScintillationIndexModel> reference = CreateObject<FsoDownLinkScintillationIndexModel> ();
+  reference->SetAttribute ("CacheAltitudeResolution", DoubleValue (0.0));
+
+  Ptr<FsoDownLinkScintillationIndexModel> cached = CreateObject<FsoDownLinkScintillationIndexModel> ();
+
+  Ptr<FsoDownLinkScintillationIndexModel> table = CreateObject<FsoDownLinkScintillationIndexModel> ();
+  table->SetAttribute ("ProfileTableStep", DoubleValue (10.0));
+
+  double txHeights[] = {1234.5, 12345.6, 707000, 36000000};
+  for (uint32_t i = 0; i < sizeof (txHeights)/sizeof (double); ++i)
+    {
+      double expected = reference->CalculateScintillationIdx (frequency, txHeights[i], 0, zenith);
+
+      //The second call is served from the cache
+      cached->CalculateScintillationIdx (frequency, txHeights[i], 0, zenith);
+      double resultCached = cached->CalculateScintillationIdx (frequency, txHeights[i], 0, zenith);
+      NS_TEST_EXPECT_MSG_EQ_TOL (resultCached, expected, expected*1e-12, "Got unexpected cached scintillation index");
+
+      double resultTable = table->CalculateScintillationIdx (frequency, txHeights[i], 0, zenith);
+      NS_TEST_EXPECT_MSG_EQ_TOL (resultTable, expected, expected*1e-5, "Got unexpected scintillation index from the profile table");
+    }
+
+  //Transmitters above the turbulent atmosphere share the same integral
+  double geo = cached->CalculateScintillationIdx (frequency, 36000000, 0, zenith);
+  double leo = cached->CalculateScintillationIdx (frequency, 707000, 0, zenith);
+  NS_TEST_EXPECT_MSG_EQ (geo, leo, "Integrals above 20km should be identical");
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the link cache of the propagation loss models
+ *
+ * The free space loss of a link must be recomputed when an end point
+ * changes course, or moves further than the position threshold.
+ *
+ */
+class FsoLinkCacheTestCase : public TestCase
+{
+public:
+  FsoLinkCacheTestCase ();
+  virtual ~FsoLinkCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \param model the free space loss model
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \return the path loss (dB) set by the model
+   */
+  double GetPathLoss (Ptr<FsoFreeSpaceLossModel> model, Ptr<MobilityModel> a, Ptr<MobilityModel> b);
+
+  /**
+   * Check the path loss of a moving receiver at the current time
+   *
+   * \param model the free space loss model
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param distance the distance (m) at which the path loss is expected
+   */
+  void CheckMoving (Ptr<FsoFreeSpaceLossModel> model, Ptr<MobilityModel> a, Ptr<MobilityModel> b, double distance);
+};
+
+FsoLinkCacheTestCase::FsoLinkCacheTestCase ()
+  : TestCase ("Check that the link cache follows the mobility of the end points")
+{
+}
+
+FsoLinkCacheTestCase::~FsoLinkCacheTestCase ()
+{
+}
+
+double
+FsoLinkCacheTestCase::GetPathLoss (Ptr<FsoFreeSpaceLossModel> model, Ptr<MobilityModel> a, Ptr<MobilityModel> b)
+{
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->wavelength = 847e-9;
+  params->power = 0.0;
+  model->UpdateSignalParams (params, a, b);
+  return params->pathLoss;
+}
+
+void
+FsoLinkCacheTestCase::CheckMoving (Ptr<FsoFreeSpaceLossModel> model, Ptr<MobilityModel> a, Ptr<MobilityModel> b, double distance)
+{
+  double expected = model->CalculateFreeSpaceLoss (distance, 847e-9);
+  NS_TEST_EXPECT_MSG_EQ_TOL (GetPathLoss (model, a, b), expected, 1e-9, "Got unexpected path loss at " << Simulator::Now ().GetSeconds () << "s");
+}
+
+void
+FsoLinkCacheTestCase::DoRun (void)
+{
+  Ptr<FsoFreeSpaceLossModel> model = CreateObject<FsoFreeSpaceLossModel> ();
+  model->SetAttribute ("LinkCachePositionThreshold", DoubleValue (1e6));
+
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0.0, 0.0, 0.0));
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  b->SetPosition (Vector (1000.0, 0.0, 0.0));
+
+  double loss = GetPathLoss (model, a, b);
+  NS_TEST_EXPECT_MSG_EQ_TOL (loss, model->CalculateFreeSpaceLoss (1000.0, 847e-9), 1e-9, "Got unexpected path loss");
+  NS_TEST_EXPECT_MSG_EQ (GetPathLoss (model, a, b), loss, "Got unexpected cached path loss");
+
+  //Within the threshold, but the course change invalidates the link
+  b->SetPosition (Vector (2000.0, 0.0, 0.0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (GetPathLoss (model, a, b), model->CalculateFreeSpaceLoss (2000.0, 847e-9), 1e-9, "Course change did not invalidate the link");
+
+  //The reverse link is cached separately
+  NS_TEST_EXPECT_MSG_EQ_TOL (GetPathLoss (model, b, a), model->CalculateFreeSpaceLoss (2000.0, 847e-9), 1e-9, "Got unexpected path loss of the reverse link");
+
+  //A constant velocity receiver only notifies a course change when its velocity is set,
+  //the link is recomputed once it moved further than the threshold
+  model->SetAttribute ("LinkCachePositionThreshold", DoubleValue (100.0));
+  Ptr<ConstantVelocityMobilityModel> c = CreateObject<ConstantVelocityMobilityModel> ();
+  c->SetPosition (Vector (1000.0, 0.0, 0.0));
+  c->SetVelocity (Vector (1.0, 0.0, 0.0));
+
+  Simulator::Schedule (Seconds (0.0), &FsoLinkCacheTestCase::CheckMoving, this, model, a, c, 1000.0);
+  Simulator::Schedule (Seconds (50.0), &FsoLinkCacheTestCase::CheckMoving, this, model, a, c, 1000.0);
+  Simulator::Schedule (Seconds (150.0), &FsoLinkCacheTestCase::CheckMoving, this, model, a, c, 1150.0);
+  Simulator::Run ();
+
+  model->SetAttribute ("LinkCache", BooleanValue (false));
+  NS_TEST_EXPECT_MSG_EQ_TOL (GetPathLoss (model, a, c), model->CalculateFreeSpaceLoss (1150.0, 847e-9), 1e-9, "Got unexpected path loss without the cache");
+
+  Simulator::Destroy ();
+}
+
 /**
  * \ingroup fso
  *
@@ -340,7 +507,9 @@ FsoPropagationLossTestSuite::FsoPropagationLossTestSuite ()
 {
   AddTestCase (new FsoMeanIrradianceTestCase, TestCase::QUICK);
   AddTestCase (new FsoDownLinkScintillationIndexTestCase, TestCase::QUICK);
+  AddTestCase (new FsoTurbulenceIntegralCacheTestCase, TestCase::QUICK);
   AddTestCase (new FsoFreeSpaceLossTestCase, TestCase::QUICK);
+  AddTestCase (new FsoLinkCacheTestCase, TestCase::QUICK);
 }
 
 static FsoPropagationLossTestSuite fsoPropagationLossTestSuite;
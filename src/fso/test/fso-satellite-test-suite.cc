@@ -0,0 +1,209 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/fso-satellite-mobility-model.h"
+#include "ns3/fso-link-geometry.h"
+#include "ns3/fso-link-budget-loss-model.h"
+#include "ns3/fso-free-space-loss-model.h"
+#include "ns3/fso-signal-parameters.h"
+#include "ns3/constant-position-mobility-model.h"
+#include <cmath>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FsoSatelliteTest");
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the orbit of the satellite mobility model
+ *
+ * A satellite starting at the perigee right above the ground station must
+ * follow the altitudes and the period of its Keplerian orbit, and its
+ * velocity must be the derivative of its position in the rotating frame
+ * of the ground station.
+ */
+class FsoSatelliteOrbitTestCase : public TestCase
+{
+public:
+  FsoSatelliteOrbitTestCase ();//!< default constructor
+  virtual ~FsoSatelliteOrbitTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoSatelliteOrbitTestCase::FsoSatelliteOrbitTestCase ()
+  : TestCase ("Check the orbit of the satellite mobility model")
+{
+}
+
+FsoSatelliteOrbitTestCase::~FsoSatelliteOrbitTestCase ()
+{
+}
+
+void
+FsoSatelliteOrbitTestCase::DoRun (void)
+{
+  double a = 7000000.0;
+  double e = 0.01;
+  Ptr<FsoSatelliteMobilityModel> satellite = CreateObject<FsoSatelliteMobilityModel> ();
+  satellite->SetAttribute ("SemiMajorAxis", DoubleValue (a));
+  satellite->SetAttribute ("Eccentricity", DoubleValue (e));
+  satellite->SetAttribute ("EarthRotation", BooleanValue (false));
+
+  //Perigee right above the ground station
+  Vector perigee = satellite->GetPositionAt (Seconds (0.0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (perigee.x, 0.0, 1e-3, "The satellite does not start above the ground station");
+  NS_TEST_EXPECT_MSG_EQ_TOL (perigee.y, 0.0, 1e-3, "The satellite does not start above the ground station");
+  NS_TEST_EXPECT_MSG_EQ_TOL (perigee.z, a*(1.0 - e) - FsoLinkGeometry::EARTH_RADIUS, 1e-3, "Wrong altitude at the perigee");
+  NS_TEST_EXPECT_MSG_EQ_TOL (FsoLinkGeometry::GetElevation (perigee, Vector (0.0, 0.0, 0.0)), M_PI/2.0, 1e-9, "Wrong elevation at the perigee");
+
+  //Apogee after half a period, and back after a period
+  double period = satellite->GetPeriod ();
+  Vector apogee = satellite->GetPositionAt (Seconds (period/2.0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (FsoLinkGeometry::GetAltitude (apogee), a*(1.0 + e) - FsoLinkGeometry::EARTH_RADIUS, 1e-2, "Wrong altitude at the apogee");
+  Vector back = satellite->GetPositionAt (Seconds (period));
+  NS_TEST_EXPECT_MSG_EQ_TOL (CalculateDistance (back, perigee), 0.0, 1e-2, "The orbit is not periodic");
+
+  //The velocity is the derivative of the position, also in the rotating frame
+  satellite->SetAttribute ("EarthRotation", BooleanValue (true));
+  satellite->SetAttribute ("Inclination", DoubleValue (53.0));
+  satellite->SetAttribute ("StationLatitude", DoubleValue (45.0));
+  satellite->SetAttribute ("J2", BooleanValue (true));
+  Time t = Seconds (1234.0);
+  Time dt = MilliSeconds (1);
+  Vector before = satellite->GetPositionAt (t - dt);
+  Vector after = satellite->GetPositionAt (t + dt);
+  Vector velocity = satellite->GetVelocityAt (t);
+  NS_TEST_EXPECT_MSG_EQ_TOL (velocity.x, (after.x - before.x)/(2*dt.GetSeconds ()), 1e-2, "Wrong east velocity");
+  NS_TEST_EXPECT_MSG_EQ_TOL (velocity.y, (after.y - before.y)/(2*dt.GetSeconds ()), 1e-2, "Wrong north velocity");
+  NS_TEST_EXPECT_MSG_EQ_TOL (velocity.z, (after.z - before.z)/(2*dt.GetSeconds ()), 1e-2, "Wrong up velocity");
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the link budget tabulated over a satellite pass
+ *
+ * The tabulated path loss must match the loss model at the samples and in
+ * between, the loss model must be used outside of the table, and the pass
+ * must end when the satellite sets below the horizon.
+ */
+class FsoLinkBudgetTestCase : public TestCase
+{
+public:
+  FsoLinkBudgetTestCase ();//!< default constructor
+  virtual ~FsoLinkBudgetTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+
+  /**
+   * Check the path loss given by the link budget at the current time
+   *
+   * \param model the link budget
+   * \param a transmitter mobility
+   * \param b receiver mobility
+   * \param tolerance the tolerance on the path loss (dB)
+   */
+  void CheckPathLoss (Ptr<FsoLinkBudgetLossModel> model, Ptr<FsoSatelliteMobilityModel> a, Ptr<MobilityModel> b, double tolerance);
+};
+
+FsoLinkBudgetTestCase::FsoLinkBudgetTestCase ()
+  : TestCase ("Check the link budget tabulated over a satellite pass")
+{
+}
+
+FsoLinkBudgetTestCase::~FsoLinkBudgetTestCase ()
+{
+}
+
+void
+FsoLinkBudgetTestCase::CheckPathLoss (Ptr<FsoLinkBudgetLossModel> model, Ptr<FsoSatelliteMobilityModel> a, Ptr<MobilityModel> b, double tolerance)
+{
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->wavelength = 847e-9;
+  params->power = 0.0;
+  model->UpdateSignalParams (params, a, b);
+
+  Ptr<FsoFreeSpaceLossModel> freeSpace = CreateObject<FsoFreeSpaceLossModel> ();
+  double expected = freeSpace->CalculateFreeSpaceLoss (CalculateDistance (a->GetPosition (), b->GetPosition ()), 847e-9);
+  NS_TEST_EXPECT_MSG_EQ_TOL (params->pathLoss, expected, tolerance, "Wrong path loss at " << Simulator::Now ().GetSeconds () << "s");
+  NS_TEST_EXPECT_MSG_EQ_TOL (params->power, -expected, tolerance, "Wrong power at " << Simulator::Now ().GetSeconds () << "s");
+}
+
+void
+FsoLinkBudgetTestCase::DoRun (void)
+{
+  Ptr<FsoSatelliteMobilityModel> satellite = CreateObject<FsoSatelliteMobilityModel> ();
+  satellite->SetAttribute ("EarthRotation", BooleanValue (false));
+  Ptr<ConstantPositionMobilityModel> station = CreateObject<ConstantPositionMobilityModel> ();
+  station->SetPosition (Vector (0.0, 0.0, 0.0));
+
+  Ptr<FsoLinkBudgetLossModel> model = CreateObject<FsoLinkBudgetLossModel> ();
+  model->SetLossModel (CreateObject<FsoFreeSpaceLossModel> ());
+  model->SetResolution (Seconds (10.0));
+
+  Ptr<FsoSignalParameters> params = Create<FsoSignalParameters> ();
+  params->wavelength = 847e-9;
+  params->power = 0.0;
+  model->Precompute (satellite, station, params, Seconds (0.0), Seconds (600.0));
+
+  //The satellite sets when the angle from the center of the earth reaches acos (R/a)
+  double a = 6921000.0;
+  double setTime = std::acos (FsoLinkGeometry::EARTH_RADIUS/a)*satellite->GetPeriod ()/(2*M_PI);
+  std::vector<std::pair<Time, Time> > passes = model->GetPasses (satellite, station, 0.0);
+  NS_TEST_ASSERT_MSG_EQ (passes.size (), 1, "Expected a single pass");
+  NS_TEST_EXPECT_MSG_EQ (passes[0].first, Seconds (0.0), "Wrong start of the pass");
+  NS_TEST_EXPECT_MSG_EQ ((passes[0].second.GetSeconds () <= setTime && passes[0].second.GetSeconds () > setTime - 10.0), true,
+                         "Wrong end of the pass " << passes[0].second.GetSeconds () << "s, expected " << setTime << "s");
+
+  FsoLinkBudgetLossModel::Sample sample;
+  NS_TEST_ASSERT_MSG_EQ (model->GetSample (satellite, station, Seconds (0.0), sample), true, "Missing sample");
+  NS_TEST_EXPECT_MSG_EQ_TOL (sample.range, a - FsoLinkGeometry::EARTH_RADIUS, 1e-3, "Wrong range");
+  NS_TEST_EXPECT_MSG_EQ_TOL (sample.delay, sample.range/FsoLinkGeometry::SPEED_OF_LIGHT, 1e-12, "Wrong delay");
+  NS_TEST_EXPECT_MSG_EQ (model->GetSample (satellite, station, Seconds (601.0), sample), false, "Sample beyond the table");
+
+  //Exact at the samples, interpolated in between, computed outside of the table
+  Simulator::Schedule (Seconds (100.0), &FsoLinkBudgetTestCase::CheckPathLoss, this, model, satellite, station, 1e-9);
+  Simulator::Schedule (Seconds (105.0), &FsoLinkBudgetTestCase::CheckPathLoss, this, model, satellite, station, 1e-2);
+  Simulator::Schedule (Seconds (700.0), &FsoLinkBudgetTestCase::CheckPathLoss, this, model, satellite, station, 1e-9);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+
+class FsoSatelliteTestSuite : public TestSuite
+{
+public:
+  FsoSatelliteTestSuite ();
+};
+
+FsoSatelliteTestSuite::FsoSatelliteTestSuite ()
+  : TestSuite ("fso-satellite", UNIT)
+{
+  AddTestCase (new FsoSatelliteOrbitTestCase, TestCase::QUICK);
+  AddTestCase (new FsoLinkBudgetTestCase, TestCase::QUICK);
+}
+
+static FsoSatelliteTestSuite fsoSatelliteTestSuite;
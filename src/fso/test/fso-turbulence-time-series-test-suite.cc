@@ -0,0 +1,168 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include "ns3/nstime.h"
+#include "ns3/fso-turbulence-time-series.h"
+#include <cmath>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FsoTurbulenceTimeSeriesTest");
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the statistics of the turbulence time series
+ *
+ * The samples must be standard normal, and the mean duration of the fades
+ * below a level must match the level crossing rate of the process (see
+ * CalcFadeDuration.m in test/references).
+ */
+class FsoTurbulenceTimeSeriesStatisticsTestCase : public TestCase
+{
+public:
+  FsoTurbulenceTimeSeriesStatisticsTestCase ();//!< default constructor
+  virtual ~FsoTurbulenceTimeSeriesStatisticsTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoTurbulenceTimeSeriesStatisticsTestCase::FsoTurbulenceTimeSeriesStatisticsTestCase ()
+  : TestCase ("Check the distribution and the fade durations of the turbulence time series")
+{
+}
+
+FsoTurbulenceTimeSeriesStatisticsTestCase::~FsoTurbulenceTimeSeriesStatisticsTestCase ()
+{
+}
+
+void
+FsoTurbulenceTimeSeriesStatisticsTestCase::DoRun (void)
+{
+  double correlationTime = 1e-3;
+  FsoTurbulenceTimeSeries series;
+  series.AssignStreams (1);
+  series.SetCorrelationTime (correlationTime, Seconds (0.0));
+
+  double level = -1.0;
+  uint32_t n = 1000000;
+  double sum = 0.0;
+  double sumSquares = 0.0;
+  uint32_t below = 0;
+  uint32_t fades = 0;
+  bool inFade = false;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double x = series.GetSample (i);
+      sum += x;
+      sumSquares += x*x;
+      if (x < level)
+        {
+          below++;
+          if (!inFade)
+            {
+              fades++;
+            }
+        }
+      inFade = x < level;
+    }
+
+  double mean = sum/n;
+  double variance = sumSquares/n - mean*mean;
+  NS_TEST_EXPECT_MSG_EQ_TOL (mean, 0.0, 0.05, "The time series is not zero mean");
+  NS_TEST_EXPECT_MSG_EQ_TOL (variance, 1.0, 0.05, "The time series does not have a unit variance");
+
+  //Probability of fade over the number of fades per second (Rice)
+  double probFade = 0.5*std::erfc (-level/std::sqrt (2.0));
+  double numFades = std::exp (-0.5*level*level)/(2*M_PI*correlationTime);
+  double expected = probFade/numFades;
+  double measured = below*series.GetSampleInterval ()/fades;
+  NS_TEST_EXPECT_MSG_EQ_TOL (measured, expected, expected*0.1, "Unexpected mean fade duration");
+}
+
+/**
+ * \ingroup fso
+ *
+ * \brief Test case for the generation of the turbulence time series in blocks
+ *
+ * The series must not depend on the block size, and must resume after a
+ * long idle period.
+ */
+class FsoTurbulenceTimeSeriesBlockTestCase : public TestCase
+{
+public:
+  FsoTurbulenceTimeSeriesBlockTestCase ();//!< default constructor
+  virtual ~FsoTurbulenceTimeSeriesBlockTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+};
+
+FsoTurbulenceTimeSeriesBlockTestCase::FsoTurbulenceTimeSeriesBlockTestCase ()
+  : TestCase ("Check that the turbulence time series does not depend on the block size")
+{
+}
+
+FsoTurbulenceTimeSeriesBlockTestCase::~FsoTurbulenceTimeSeriesBlockTestCase ()
+{
+}
+
+void
+FsoTurbulenceTimeSeriesBlockTestCase::DoRun (void)
+{
+  FsoTurbulenceTimeSeries small;
+  small.AssignStreams (2);
+  small.SetBlockSize (7);
+  small.SetCorrelationTime (2e-3, Seconds (1.0));
+
+  FsoTurbulenceTimeSeries large;
+  large.AssignStreams (2);
+  large.SetCorrelationTime (2e-3, Seconds (1.0));
+
+  for (uint32_t i = 0; i < 5000; i++)
+    {
+      Time t = Seconds (1.0) + MicroSeconds (7*i);
+      NS_TEST_ASSERT_MSG_EQ (small.GetValue (t), large.GetValue (t), "Series differ at " << t);
+    }
+
+  //Samples are held constant between sample times
+  uint64_t index = large.GetIndex (Seconds (1.0351));
+  NS_TEST_EXPECT_MSG_EQ (large.GetValue (Seconds (1.0351)), large.GetValue (large.GetSampleTime (index)), "Sample not held");
+
+  //An idle period is skipped in one step
+  double x = large.GetValue (Seconds (1000.0));
+  NS_TEST_EXPECT_MSG_EQ ((std::abs (x) < 10.0), true, "Unexpected sample after an idle period");
+  NS_TEST_EXPECT_MSG_EQ (large.GetValue (Seconds (1000.0)), x, "Sample changed");
+}
+
+
+class FsoTurbulenceTimeSeriesTestSuite : public TestSuite
+{
+public:
+  FsoTurbulenceTimeSeriesTestSuite ();
+};
+
+FsoTurbulenceTimeSeriesTestSuite::FsoTurbulenceTimeSeriesTestSuite ()
+  : TestSuite ("fso-turbulence-time-series", UNIT)
+{
+  AddTestCase (new FsoTurbulenceTimeSeriesStatisticsTestCase, TestCase::QUICK);
+  AddTestCase (new FsoTurbulenceTimeSeriesBlockTestCase, TestCase::QUICK);
+}
+
+static FsoTurbulenceTimeSeriesTestSuite fsoTurbulenceTimeSeriesTestSuite;
@@ -0,0 +1,285 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * PHOLD over point-to-point links, with the synchronization algorithm of
+ * the distributed simulator selected on the command line.
+ *
+ * The nodes form a ring, split in equal parts over the ranks. Each node
+ * starts with a number of jobs. A node receiving a job holds it for an
+ * exponential time, then forwards it on one of its two links chosen at
+ * random. The delay of the links is the lookahead of the conservative
+ * algorithms, which synchronize at least once per delay, while the
+ * optimistic simulator does not depend on it.
+ *
+ * With --partition, the ring is split by MpiPartitionHelper instead.
+ *
+ * Each rank prints the number of jobs received by its nodes and a checksum
+ * of their reception times, whose sums over the ranks do not depend on the
+ * algorithm nor on the number of ranks.
+ *
+ *   mpirun -np 2 ./waf --run "phold-distributed --sync=optimistic"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/granted-time-window-mpi-interface.h"
+#include "ns3/optimistic-simulator-impl.h"
+#include "ns3/mpi-partition-helper.h"
+#include "ns3/point-to-point-helper.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PholdDistributed");
+
+/**
+ * A node of the PHOLD model
+ */
+class PholdNode
+{
+public:
+  PholdNode ();
+
+  /**
+   * \param node the node
+   * \param meanHold the mean time a job is held
+   */
+  void Setup (Ptr<Node> node, Time meanHold);
+  /**
+   * \param jobs the number of jobs to start with
+   */
+  void Start (uint32_t jobs);
+  /** \return the number of jobs received */
+  uint64_t GetReceived (void) const;
+  /** \return the checksum of the reception times */
+  uint64_t GetChecksum (void) const;
+
+private:
+  /**
+   * Receive a job
+   * \param device the device
+   * \param packet the job
+   * \param protocol the protocol
+   * \param from the sender
+   * \param to the destination
+   * \param packetType the type of the packet
+   */
+  void Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                const Address &from, const Address &to, NetDevice::PacketType packetType);
+  /** Forward a job on a random link */
+  void Forward (void);
+
+  Ptr<Node> m_node;
+  Ptr<ExponentialRandomVariable> m_hold;
+  Ptr<UniformRandomVariable> m_link;
+  uint64_t m_received;
+  uint64_t m_checksum;
+};
+
+PholdNode::PholdNode ()
+  : m_received (0),
+    m_checksum (0)
+{
+}
+
+void
+PholdNode::Setup (Ptr<Node> node, Time meanHold)
+{
+  m_node = node;
+  m_hold = CreateObject<ExponentialRandomVariable> ();
+  m_hold->SetAttribute ("Mean", DoubleValue (meanHold.GetSeconds ()));
+  m_hold->SetStream (2 * node->GetId ());
+  m_link = CreateObject<UniformRandomVariable> ();
+  m_link->SetStream (2 * node->GetId () + 1);
+  for (uint32_t i = 0; i < node->GetNDevices (); i++)
+    {
+      node->RegisterProtocolHandler (MakeCallback (&PholdNode::Receive, this), 0x0800, node->GetDevice (i));
+    }
+}
+
+void
+PholdNode::Start (uint32_t jobs)
+{
+  for (uint32_t i = 0; i < jobs; i++)
+    {
+      Simulator::ScheduleWithContext (m_node->GetId (), Seconds (m_hold->GetValue ()), &PholdNode::Forward, this);
+    }
+}
+
+void
+PholdNode::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                    const Address &from, const Address &to, NetDevice::PacketType packetType)
+{
+  m_received++;
+  m_checksum += (m_node->GetId () + 1) * static_cast<uint64_t> (Simulator::Now ().GetNanoSeconds ());
+  Simulator::Schedule (Seconds (m_hold->GetValue ()), &PholdNode::Forward, this);
+}
+
+void
+PholdNode::Forward (void)
+{
+  uint32_t i = m_link->GetInteger (0, m_node->GetNDevices () - 1);
+  Ptr<NetDevice> device = m_node->GetDevice (i);
+  device->Send (Create<Packet> (64), device->GetBroadcast (), 0x0800);
+}
+
+uint64_t
+PholdNode::GetReceived (void) const
+{
+  return m_received;
+}
+
+uint64_t
+PholdNode::GetChecksum (void) const
+{
+  return m_checksum;
+}
+
+int
+main (int argc, char *argv[])
+{
+#ifdef NS3_MPI
+  std::string sync = "optimistic";
+  uint32_t nodesPerRank = 8;
+  uint32_t jobs = 4;
+  double stop = 1.0;
+  Time delay = MicroSeconds (10);
+  Time meanHold = MilliSeconds (1);
+  bool partition = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("sync", "Synchronization: optimistic, nullmsg or window", sync);
+  cmd.AddValue ("nodes", "Number of nodes per rank", nodesPerRank);
+  cmd.AddValue ("jobs", "Number of jobs per node", jobs);
+  cmd.AddValue ("stop", "Simulation time in seconds", stop);
+  cmd.AddValue ("delay", "Delay of the links", delay);
+  cmd.AddValue ("hold", "Mean time a job is held by a node", meanHold);
+  cmd.AddValue ("partition", "Assign the nodes to the ranks with MpiPartitionHelper", partition);
+  cmd.Parse (argc, argv);
+
+  if (sync == "optimistic")
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::OptimisticSimulatorImpl"));
+    }
+  else if (sync == "nullmsg")
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::NullMessageSimulatorImpl"));
+    }
+  else
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+    }
+  MpiInterface::Enable (&argc, &argv);
+
+  uint32_t systemId = MpiInterface::GetSystemId ();
+  uint32_t systemCount = MpiInterface::GetSize ();
+  uint32_t n = nodesPerRank * systemCount;
+  NS_ABORT_MSG_IF (n < 3, "The ring needs at least 3 nodes");
+
+  NodeContainer nodes;
+  if (partition)
+    {
+      // Describe the ring before creating its nodes on their ranks
+      MpiPartitionHelper partitioner;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          partitioner.AddNode ();
+        }
+      for (uint32_t i = 0; i < n; i++)
+        {
+          partitioner.AddLink (i, (i + 1) % n, delay);
+        }
+      std::vector<uint32_t> ranks = partitioner.Partition (systemCount);
+      for (uint32_t i = 0; i < n; i++)
+        {
+          nodes.Create (1, ranks[i]);
+        }
+      if (systemId == 0)
+        {
+          std::cout << "partition: " << partitioner.GetCutTraffic (ranks) << " links cut, lookahead "
+                    << partitioner.GetLookahead (ranks).As (Time::US) << std::endl;
+        }
+    }
+  else
+    {
+      for (uint32_t rank = 0; rank < systemCount; rank++)
+        {
+          nodes.Create (nodesPerRank, rank);
+        }
+    }
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", TimeValue (delay));
+  for (uint32_t i = 0; i < n; i++)
+    {
+      p2p.Install (nodes.Get (i), nodes.Get ((i + 1) % n));
+    }
+
+  std::vector<PholdNode> phold (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (nodes.Get (i)->GetSystemId () == systemId)
+        {
+          phold[i].Setup (nodes.Get (i), meanHold);
+          phold[i].Start (jobs);
+        }
+    }
+
+  Simulator::Stop (Seconds (stop));
+  Simulator::Run ();
+
+  uint64_t received = 0;
+  uint64_t checksum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      received += phold[i].GetReceived ();
+      checksum += phold[i].GetChecksum ();
+    }
+  std::cout << "rank " << systemId << ": received " << received
+            << " jobs, checksum " << checksum << std::endl;
+  Ptr<OptimisticSimulatorImpl> impl = DynamicCast<OptimisticSimulatorImpl> (Simulator::GetImplementation ());
+  if (impl)
+    {
+      std::cout << "rank " << systemId << ": " << impl->GetEventCount () << " events, "
+                << impl->GetRollbackCount () << " rollbacks, "
+                << impl->GetRolledBackEventCount () << " events rolled back, "
+                << impl->GetAntiMessageCount () << " anti-messages" << std::endl;
+    }
+
+  if (sync == "window")
+    {
+      for (uint32_t rank = 0; rank < systemCount; rank++)
+        {
+          const GrantedTimeWindowMpiInterface::RankStatistics &stats = GrantedTimeWindowMpiInterface::GetStatistics (rank);
+          if (stats.txPackets > 0)
+            {
+              std::cout << "rank " << systemId << " to rank " << rank << ": " << stats.txPackets
+                        << " packets in " << stats.txMessages << " messages ("
+                        << stats.txSharedMessages << " through shared memory), "
+                        << stats.txBytes << " bytes" << std::endl;
+            }
+        }
+    }
+
+  Simulator::Destroy ();
+  MpiInterface::Disable ();
+  return 0;
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
@@ -0,0 +1,486 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "mpi-partition-helper.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/channel.h"
+#include "ns3/channel-list.h"
+#include "ns3/net-device.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MpiPartitionHelper");
+
+/// Marks a vertex not yet matched or assigned
+static const uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max ();
+/// The coarsening stops at this number of vertices per partition
+static const uint32_t COARSEST_VERTICES_PER_PART = 16;
+/// Maximum number of refinement passes at each level
+static const uint32_t MAX_REFINE_PASSES = 8;
+
+/**
+ * Build the sorted adjacency lists of a graph
+ *
+ * \param vertices the number of vertices
+ * \param traffic the traffic between each pair of vertices, the first
+ *        lower than the second
+ * \return the neighbors of each vertex and the traffic with them
+ */
+static std::vector<std::vector<std::pair<uint32_t, double> > >
+MakeEdges (uint32_t vertices, const std::map<std::pair<uint32_t, uint32_t>, double> &traffic)
+{
+  // Pairs come ordered, so each list is built sorted
+  std::vector<std::vector<std::pair<uint32_t, double> > > edges (vertices);
+  for (std::map<std::pair<uint32_t, uint32_t>, double>::const_iterator it = traffic.begin (); it != traffic.end (); ++it)
+    {
+      edges[it->first.first].push_back (std::make_pair (it->first.second, it->second));
+      edges[it->first.second].push_back (std::make_pair (it->first.first, it->second));
+    }
+  return edges;
+}
+
+/**
+ * \param group the group of each node, updated to shorten the paths
+ * \param node a node
+ * \return the representative of the group of the node
+ */
+static uint32_t
+FindGroup (std::vector<uint32_t> &group, uint32_t node)
+{
+  while (group[node] != node)
+    {
+      group[node] = group[group[node]];
+      node = group[node];
+    }
+  return node;
+}
+
+MpiPartitionHelper::MpiPartitionHelper ()
+  : m_imbalance (0.05),
+    m_minimumLookahead (Seconds (0))
+{
+}
+
+uint32_t
+MpiPartitionHelper::AddNode (double weight)
+{
+  NS_ASSERT (weight >= 0);
+  m_weights.push_back (weight);
+  return m_weights.size () - 1;
+}
+
+void
+MpiPartitionHelper::AddLink (uint32_t a, uint32_t b, Time delay, double traffic)
+{
+  NS_LOG_FUNCTION (this << a << b << delay << traffic);
+  NS_ASSERT_MSG (a < m_weights.size () && b < m_weights.size (), "Link to an unknown node");
+  NS_ASSERT (traffic >= 0);
+  if (a == b)
+    {
+      return;
+    }
+  std::pair<uint32_t, uint32_t> key = std::make_pair (std::min (a, b), std::max (a, b));
+  std::map<std::pair<uint32_t, uint32_t>, Link>::iterator it = m_links.find (key);
+  if (it == m_links.end ())
+    {
+      Link link;
+      link.delay = delay;
+      link.traffic = traffic;
+      m_links.insert (std::make_pair (key, link));
+    }
+  else
+    {
+      it->second.delay = std::min (it->second.delay, delay);
+      it->second.traffic += traffic;
+    }
+}
+
+void
+MpiPartitionHelper::AddTopology (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (!m_weights.empty (), "AddTopology must be called before any node is added");
+
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); i++)
+    {
+      AddNode (1.0);
+    }
+  for (ChannelList::Iterator it = ChannelList::Begin (); it != ChannelList::End (); ++it)
+    {
+      TimeValue delay (Seconds (0));
+      (*it)->GetAttributeFailSafe ("Delay", delay);
+      std::vector<uint32_t> nodes;
+      for (uint32_t i = 0; i < (*it)->GetNDevices (); i++)
+        {
+          Ptr<NetDevice> device = (*it)->GetDevice (i);
+          if (device != 0 && device->GetNode () != 0)
+            {
+              nodes.push_back (device->GetNode ()->GetId ());
+            }
+        }
+      for (uint32_t i = 0; i < nodes.size (); i++)
+        {
+          for (uint32_t j = i + 1; j < nodes.size (); j++)
+            {
+              AddLink (nodes[i], nodes[j], delay.Get ());
+            }
+        }
+    }
+}
+
+uint32_t
+MpiPartitionHelper::GetNNodes (void) const
+{
+  return m_weights.size ();
+}
+
+void
+MpiPartitionHelper::SetImbalance (double imbalance)
+{
+  NS_ASSERT (imbalance >= 0);
+  m_imbalance = imbalance;
+}
+
+void
+MpiPartitionHelper::SetMinimumLookahead (Time lookahead)
+{
+  m_minimumLookahead = lookahead;
+}
+
+std::vector<uint32_t>
+MpiPartitionHelper::Partition (uint32_t parts) const
+{
+  NS_LOG_FUNCTION (this << parts);
+  NS_ABORT_MSG_IF (parts == 0, "Cannot partition into zero ranks");
+
+  uint32_t n = m_weights.size ();
+  std::vector<uint32_t> ranks (n, 0);
+  if (parts == 1 || n == 0)
+    {
+      return ranks;
+    }
+
+  // The nodes linked with less than the minimum lookahead, or without delay,
+  // form a single vertex
+  std::vector<uint32_t> group (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      group[i] = i;
+    }
+  for (std::map<std::pair<uint32_t, uint32_t>, Link>::const_iterator it = m_links.begin (); it != m_links.end (); ++it)
+    {
+      if (!it->second.delay.IsStrictlyPositive () || it->second.delay < m_minimumLookahead)
+        {
+          uint32_t a = FindGroup (group, it->first.first);
+          uint32_t b = FindGroup (group, it->first.second);
+          group[std::max (a, b)] = std::min (a, b);
+        }
+    }
+  std::vector<Graph> levels (1);
+  std::vector<uint32_t> vertex (n, NO_VERTEX);
+  uint32_t vertices = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t root = FindGroup (group, i);
+      if (vertex[root] == NO_VERTEX)
+        {
+          vertex[root] = vertices++;
+        }
+      vertex[i] = vertex[root];
+    }
+  levels[0].weights.assign (vertices, 0);
+  double total = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      levels[0].weights[vertex[i]] += m_weights[i];
+      total += m_weights[i];
+    }
+  std::map<std::pair<uint32_t, uint32_t>, double> traffic;
+  for (std::map<std::pair<uint32_t, uint32_t>, Link>::const_iterator it = m_links.begin (); it != m_links.end (); ++it)
+    {
+      uint32_t a = vertex[it->first.first];
+      uint32_t b = vertex[it->first.second];
+      if (a != b)
+        {
+          traffic[std::make_pair (std::min (a, b), std::max (a, b))] += it->second.traffic;
+        }
+    }
+  levels[0].edges = MakeEdges (vertices, traffic);
+
+  // Coarsen, keeping the merged vertices small enough to balance the partitions
+  while (levels.back ().weights.size () > COARSEST_VERTICES_PER_PART * parts)
+    {
+      Graph coarse = Coarsen (levels.back (), total / (4.0 * parts));
+      if (coarse.weights.empty ())
+        {
+          break;
+        }
+      levels.push_back (coarse);
+    }
+  NS_LOG_LOGIC (levels.size () << " levels, " << levels.back ().weights.size () << " vertices in the coarsest");
+
+  // Split the coarsest graph, then refine the split at each finer level
+  std::vector<uint32_t> partition = Grow (levels.back (), parts);
+  for (uint32_t level = levels.size (); level-- > 0; )
+    {
+      const Graph &graph = levels[level];
+      if (level + 1 < levels.size ())
+        {
+          std::vector<uint32_t> fine (graph.weights.size ());
+          for (uint32_t v = 0; v < fine.size (); v++)
+            {
+              fine[v] = partition[graph.coarse[v]];
+            }
+          partition.swap (fine);
+        }
+      double maxWeight = (1 + m_imbalance) * total / parts;
+      maxWeight = std::max (maxWeight, *std::max_element (graph.weights.begin (), graph.weights.end ()));
+      Refine (graph, parts, maxWeight, partition);
+    }
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      ranks[i] = partition[vertex[i]];
+    }
+  return ranks;
+}
+
+MpiPartitionHelper::Graph
+MpiPartitionHelper::Coarsen (Graph &fine, double maxWeight)
+{
+  // Heavy edge matching: each vertex is merged with the unmatched
+  // neighbor it exchanges the most traffic with
+  uint32_t n = fine.weights.size ();
+  fine.coarse.assign (n, NO_VERTEX);
+  uint32_t vertices = 0;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      if (fine.coarse[v] != NO_VERTEX)
+        {
+          continue;
+        }
+      uint32_t best = NO_VERTEX;
+      double bestTraffic = -1;
+      for (std::vector<std::pair<uint32_t, double> >::const_iterator it = fine.edges[v].begin (); it != fine.edges[v].end (); ++it)
+        {
+          if (fine.coarse[it->first] == NO_VERTEX && it->second > bestTraffic
+              && fine.weights[v] + fine.weights[it->first] <= maxWeight)
+            {
+              best = it->first;
+              bestTraffic = it->second;
+            }
+        }
+      fine.coarse[v] = vertices;
+      if (best != NO_VERTEX)
+        {
+          fine.coarse[best] = vertices;
+        }
+      vertices++;
+    }
+  if (vertices > n - n / 10)
+    {
+      // Too few vertices merge for another level to pay off
+      return Graph ();
+    }
+
+  Graph coarse;
+  coarse.weights.assign (vertices, 0);
+  std::map<std::pair<uint32_t, uint32_t>, double> traffic;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      uint32_t a = fine.coarse[v];
+      coarse.weights[a] += fine.weights[v];
+      for (std::vector<std::pair<uint32_t, double> >::const_iterator it = fine.edges[v].begin (); it != fine.edges[v].end (); ++it)
+        {
+          uint32_t b = fine.coarse[it->first];
+          if (v < it->first && a != b)
+            {
+              traffic[std::make_pair (std::min (a, b), std::max (a, b))] += it->second;
+            }
+        }
+    }
+  coarse.edges = MakeEdges (vertices, traffic);
+  return coarse;
+}
+
+std::vector<uint32_t>
+MpiPartitionHelper::Grow (const Graph &graph, uint32_t parts)
+{
+  uint32_t n = graph.weights.size ();
+  double total = 0;
+  for (uint32_t v = 0; v < n; v++)
+    {
+      total += graph.weights[v];
+    }
+  double target = total / parts;
+
+  std::vector<uint32_t> partition (n, NO_VERTEX);
+  for (uint32_t part = 0; part + 1 < parts; part++)
+    {
+      // Add the vertex most connected to the partition, or the heaviest
+      // one when none is connected, until the partition is full
+      std::vector<double> connection (n, 0);
+      double weight = 0;
+      while (weight < target)
+        {
+          uint32_t best = NO_VERTEX;
+          for (uint32_t v = 0; v < n; v++)
+            {
+              if (partition[v] != NO_VERTEX)
+                {
+                  continue;
+                }
+              if (best == NO_VERTEX || connection[v] > connection[best]
+                  || (connection[v] == connection[best] && graph.weights[v] > graph.weights[best]))
+                {
+                  best = v;
+                }
+            }
+          if (best == NO_VERTEX)
+            {
+              break;
+            }
+          double w = graph.weights[best];
+          if (weight > 0 && weight + w - target > target - weight)
+            {
+              break;
+            }
+          partition[best] = part;
+          weight += w;
+          for (std::vector<std::pair<uint32_t, double> >::const_iterator it = graph.edges[best].begin (); it != graph.edges[best].end (); ++it)
+            {
+              connection[it->first] += it->second;
+            }
+        }
+    }
+  for (uint32_t v = 0; v < n; v++)
+    {
+      if (partition[v] == NO_VERTEX)
+        {
+          partition[v] = parts - 1;
+        }
+    }
+  return partition;
+}
+
+void
+MpiPartitionHelper::Refine (const Graph &graph, uint32_t parts, double maxWeight, std::vector<uint32_t> &partition)
+{
+  uint32_t n = graph.weights.size ();
+  std::vector<double> partWeights (parts, 0);
+  for (uint32_t v = 0; v < n; v++)
+    {
+      partWeights[partition[v]] += graph.weights[v];
+    }
+
+  for (uint32_t pass = 0; pass < MAX_REFINE_PASSES; pass++)
+    {
+      bool moved = false;
+      for (uint32_t v = 0; v < n; v++)
+        {
+          uint32_t from = partition[v];
+          double w = graph.weights[v];
+          std::map<uint32_t, double> connection;
+          for (std::vector<std::pair<uint32_t, double> >::const_iterator it = graph.edges[v].begin (); it != graph.edges[v].end (); ++it)
+            {
+              connection[partition[it->first]] += it->second;
+            }
+          double internal = connection[from];
+          bool overweight = partWeights[from] > maxWeight;
+
+          // Move to the neighbor partition which reduces the cut the most,
+          // or which improves the balance without increasing it, or which
+          // has room for a vertex of an overweight partition
+          uint32_t best = from;
+          double bestGain = 0;
+          for (std::map<uint32_t, double>::const_iterator it = connection.begin (); it != connection.end (); ++it)
+            {
+              uint32_t to = it->first;
+              if (to == from || partWeights[to] + w > maxWeight)
+                {
+                  continue;
+                }
+              double gain = it->second - internal;
+              bool useful = gain > 0 || (gain == 0 && partWeights[to] + w < partWeights[from]) || overweight;
+              if (useful && (best == from || gain > bestGain
+                             || (gain == bestGain && partWeights[to] < partWeights[best])))
+                {
+                  best = to;
+                  bestGain = gain;
+                }
+            }
+          if (best == from && overweight)
+            {
+              uint32_t lightest = std::min_element (partWeights.begin (), partWeights.end ()) - partWeights.begin ();
+              if (lightest != from && partWeights[lightest] + w <= maxWeight)
+                {
+                  best = lightest;
+                }
+            }
+          if (best != from)
+            {
+              partition[v] = best;
+              partWeights[from] -= w;
+              partWeights[best] += w;
+              moved = true;
+            }
+        }
+      if (!moved)
+        {
+          break;
+        }
+    }
+}
+
+double
+MpiPartitionHelper::GetCutTraffic (const std::vector<uint32_t> &ranks) const
+{
+  NS_ASSERT (ranks.size () == m_weights.size ());
+  double cut = 0;
+  for (std::map<std::pair<uint32_t, uint32_t>, Link>::const_iterator it = m_links.begin (); it != m_links.end (); ++it)
+    {
+      if (ranks[it->first.first] != ranks[it->first.second])
+        {
+          cut += it->second.traffic;
+        }
+    }
+  return cut;
+}
+
+Time
+MpiPartitionHelper::GetLookahead (const std::vector<uint32_t> &ranks) const
+{
+  NS_ASSERT (ranks.size () == m_weights.size ());
+  Time lookahead = Time::Max ();
+  for (std::map<std::pair<uint32_t, uint32_t>, Link>::const_iterator it = m_links.begin (); it != m_links.end (); ++it)
+    {
+      if (ranks[it->first.first] != ranks[it->first.second])
+        {
+          lookahead = std::min (lookahead, it->second.delay);
+        }
+    }
+  return lookahead;
+}
+
+} // namespace ns3
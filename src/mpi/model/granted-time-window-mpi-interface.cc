@@ -23,6 +23,8 @@
 #include <iostream>
 #include <iomanip>
 #include <list>
+#include <algorithm>
+#include <cstring>
 
 #include "granted-time-window-mpi-interface.h"
 #include "mpi-receiver.h"
@@ -35,6 +37,9 @@
 #include "ns3/simulator-impl.h"
 #include "ns3/nstime.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/global-value.h"
+#include "ns3/uinteger.h"
 
 #ifdef NS3_MPI
 #include <mpi.h>
@@ -44,6 +49,63 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("GrantedTimeWindowMpiInterface");
 
+/**
+ * \ingroup mpi
+ * Size of the ring buffers between the ranks of the same host.
+ */
+static GlobalValue g_mpiSharedMemorySize = GlobalValue ("MpiSharedMemorySize",
+                                                        "The size in bytes of the ring buffer through which a rank sends "
+                                                        "its messages to another rank of the same host, 0 to only use MPI",
+                                                        UintegerValue (262144),
+                                                        MakeUintegerChecker<uint32_t> ());
+
+/// Maximum number of non-blocking receives posted
+static const uint32_t MAX_MPI_RX_BUFFERS = 16;
+/// Size of the header of a packet in a message: time, node, device and size
+static const uint32_t PACKET_HEADER_SIZE = 20;
+/// Offset of the read position in a ring, written by the reader
+static const uint32_t RING_HEAD = 0;
+/// Offset of the write position in a ring, written by the writer
+static const uint32_t RING_TAIL = 64;
+/// Offset of the data of a ring, the positions have their own cache lines
+static const uint32_t RING_DATA = 128;
+
+/**
+ * Copy data into a ring buffer
+ *
+ * \param base the data of the ring
+ * \param capacity the size of the data of the ring
+ * \param position the position of the data, wrapped around the ring
+ * \param data the data to copy
+ * \param size the size of the data
+ */
+static void
+CopyToRing (uint8_t *base, uint64_t capacity, uint64_t position, const uint8_t *data, uint32_t size)
+{
+  uint64_t offset = position % capacity;
+  uint64_t first = std::min<uint64_t> (size, capacity - offset);
+  std::memcpy (base + offset, data, first);
+  std::memcpy (base, data + first, size - first);
+}
+
+/**
+ * Copy data out of a ring buffer
+ *
+ * \param base the data of the ring
+ * \param capacity the size of the data of the ring
+ * \param position the position of the data, wrapped around the ring
+ * \param data the buffer receiving the data
+ * \param size the size of the data
+ */
+static void
+CopyFromRing (const uint8_t *base, uint64_t capacity, uint64_t position, uint8_t *data, uint32_t size)
+{
+  uint64_t offset = position % capacity;
+  uint64_t first = std::min<uint64_t> (size, capacity - offset);
+  std::memcpy (data, base + offset, first);
+  std::memcpy (data + first, base, size - first);
+}
+
 SentBuffer::SentBuffer ()
 {
   m_buffer = 0;
@@ -81,11 +143,23 @@ bool                  GrantedTimeWindowMpiInterface::m_initialized = false;
 bool                  GrantedTimeWindowMpiInterface::m_enabled = false;
 uint32_t              GrantedTimeWindowMpiInterface::m_rxCount = 0;
 uint32_t              GrantedTimeWindowMpiInterface::m_txCount = 0;
+uint32_t              GrantedTimeWindowMpiInterface::m_rxBufferCount = 0;
 std::list<SentBuffer> GrantedTimeWindowMpiInterface::m_pendingTx;
+std::vector<uint8_t*> GrantedTimeWindowMpiInterface::m_txBuffers;
+std::vector<uint32_t> GrantedTimeWindowMpiInterface::m_txSizes;
+std::vector<uint8_t*> GrantedTimeWindowMpiInterface::m_freeBuffers;
+std::vector<GrantedTimeWindowMpiInterface::RankStatistics> GrantedTimeWindowMpiInterface::m_statistics;
+bool                  GrantedTimeWindowMpiInterface::m_sharedMemory = false;
+uint32_t              GrantedTimeWindowMpiInterface::m_ringSize = 0;
+std::vector<uint8_t*> GrantedTimeWindowMpiInterface::m_txRings;
+std::vector<uint8_t*> GrantedTimeWindowMpiInterface::m_rxRings;
+std::vector<uint8_t>  GrantedTimeWindowMpiInterface::m_ringMessage;
 
 #ifdef NS3_MPI
 MPI_Request* GrantedTimeWindowMpiInterface::m_requests;
 char**       GrantedTimeWindowMpiInterface::m_pRxBuffers;
+MPI_Comm     GrantedTimeWindowMpiInterface::m_hostComm = MPI_COMM_NULL;
+MPI_Win      GrantedTimeWindowMpiInterface::m_hostWindow = MPI_WIN_NULL;
 #endif
 
 TypeId 
@@ -104,14 +178,44 @@ GrantedTimeWindowMpiInterface::Destroy ()
   NS_LOG_FUNCTION (this);
 
 #ifdef NS3_MPI
-  for (uint32_t i = 0; i < GetSize (); ++i)
+  for (uint32_t i = 0; i < m_rxBufferCount; ++i)
     {
+      MPI_Cancel (&m_requests[i]);
+      MPI_Request_free (&m_requests[i]);
       delete [] m_pRxBuffers[i];
     }
   delete [] m_pRxBuffers;
   delete [] m_requests;
+  m_rxBufferCount = 0;
 
   m_pendingTx.clear ();
+  for (uint32_t i = 0; i < m_txBuffers.size (); ++i)
+    {
+      delete [] m_txBuffers[i];
+    }
+  m_txBuffers.clear ();
+  m_txSizes.clear ();
+  for (uint32_t i = 0; i < m_freeBuffers.size (); ++i)
+    {
+      delete [] m_freeBuffers[i];
+    }
+  m_freeBuffers.clear ();
+
+#if MPI_VERSION >= 3
+  if (m_hostWindow != MPI_WIN_NULL)
+    {
+      // All the messages were read before the simulation finished
+      MPI_Win_unlock_all (m_hostWindow);
+      MPI_Win_free (&m_hostWindow);
+    }
+#endif
+  if (m_hostComm != MPI_COMM_NULL)
+    {
+      MPI_Comm_free (&m_hostComm);
+    }
+  m_sharedMemory = false;
+  m_txRings.clear ();
+  m_rxRings.clear ();
 #endif
 }
 
@@ -127,6 +231,13 @@ GrantedTimeWindowMpiInterface::GetTxCount ()
   return m_txCount;
 }
 
+const GrantedTimeWindowMpiInterface::RankStatistics &
+GrantedTimeWindowMpiInterface::GetStatistics (uint32_t rank)
+{
+  NS_ASSERT (rank < m_statistics.size ());
+  return m_statistics[rank];
+}
+
 uint32_t
 GrantedTimeWindowMpiInterface::GetSystemId ()
 {
@@ -173,55 +284,200 @@ GrantedTimeWindowMpiInterface::Enable (int* pargc, char*** pargv)
   MPI_Comm_size (MPI_COMM_WORLD, reinterpret_cast <int *> (&m_size));
   m_enabled = true;
   m_initialized = true;
-  // Post a non-blocking receive for all peers
-  m_pRxBuffers = new char*[m_size];
-  m_requests = new MPI_Request[m_size];
-  for (uint32_t i = 0; i < GetSize (); ++i)
+  // Post a pool of non-blocking receives, each message carries all the
+  // packets sent by a peer during a time window
+  m_rxBufferCount = std::min (m_size, MAX_MPI_RX_BUFFERS);
+  m_pRxBuffers = new char*[m_rxBufferCount];
+  m_requests = new MPI_Request[m_rxBufferCount];
+  for (uint32_t i = 0; i < m_rxBufferCount; ++i)
     {
-      m_pRxBuffers[i] = new char[MAX_MPI_MSG_SIZE];
-      MPI_Irecv (m_pRxBuffers[i], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
+      m_pRxBuffers[i] = new char[MAX_MPI_AGGREGATE_SIZE];
+      MPI_Irecv (m_pRxBuffers[i], MAX_MPI_AGGREGATE_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
                  MPI_COMM_WORLD, &m_requests[i]);
     }
+  m_txBuffers.assign (m_size, 0);
+  m_txSizes.assign (m_size, 0);
+  RankStatistics statistics;
+  std::memset (&statistics, 0, sizeof (statistics));
+  m_statistics.assign (m_size, statistics);
+  EnableSharedMemory ();
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
 }
 
 void
-GrantedTimeWindowMpiInterface::SendPacket (Ptr<Packet> p, const Time& rxTime, uint32_t node, uint32_t dev)
+GrantedTimeWindowMpiInterface::EnableSharedMemory ()
 {
-  NS_LOG_FUNCTION (this << p << rxTime.GetTimeStep () << node << dev);
+  NS_LOG_FUNCTION_NOARGS ();
 
 #ifdef NS3_MPI
-  SentBuffer sendBuf;
-  m_pendingTx.push_back (sendBuf);
-  std::list<SentBuffer>::reverse_iterator i = m_pendingTx.rbegin (); // Points to the last element
+  m_txRings.assign (m_size, 0);
+  m_rxRings.assign (m_size, 0);
+#if MPI_VERSION >= 3
+  UintegerValue ringSize;
+  GlobalValue::GetValueByName ("MpiSharedMemorySize", ringSize);
+  MPI_Comm_split_type (MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &m_hostComm);
+  int hostRank;
+  int hostSize;
+  MPI_Comm_rank (m_hostComm, &hostRank);
+  MPI_Comm_size (m_hostComm, &hostSize);
+  // All the ranks of the host take the same decision
+  if (hostSize < 2 || ringSize.Get () <= RING_DATA + PACKET_HEADER_SIZE)
+    {
+      return;
+    }
+  // Keep the positions of the rings aligned on cache lines
+  m_ringSize = ringSize.Get () & ~(RING_TAIL - 1);
+
+  // The memory of each rank holds the rings written by the other ranks of
+  // the host, the ring written by host rank i is at offset i * ringSize
+  std::vector<int> worldRanks (hostSize);
+  int worldRank = m_sid;
+  MPI_Allgather (&worldRank, 1, MPI_INT, &worldRanks[0], 1, MPI_INT, m_hostComm);
+  MPI_Aint segmentSize = static_cast<MPI_Aint> (m_ringSize) * hostSize;
+  uint8_t *segment;
+  MPI_Win_allocate_shared (segmentSize, 1, MPI_INFO_NULL, m_hostComm, &segment, &m_hostWindow);
+  std::memset (segment, 0, segmentSize);
+  MPI_Win_lock_all (MPI_MODE_NOCHECK, m_hostWindow);
+  MPI_Barrier (m_hostComm);
+
+  for (int i = 0; i < hostSize; ++i)
+    {
+      if (i == hostRank)
+        {
+          continue;
+        }
+      MPI_Aint size;
+      int unit;
+      uint8_t *peerSegment;
+      MPI_Win_shared_query (m_hostWindow, i, &size, &unit, &peerSegment);
+      m_txRings[worldRanks[i]] = peerSegment + static_cast<MPI_Aint> (m_ringSize) * hostRank;
+      m_rxRings[worldRanks[i]] = segment + static_cast<MPI_Aint> (m_ringSize) * i;
+    }
+  m_sharedMemory = true;
+  NS_LOG_LOGIC ("rank " << m_sid << " shares its host with " << hostSize - 1 << " ranks");
+#endif
+#endif
+}
 
-  uint32_t serializedSize = p->GetSerializedSize ();
-  uint8_t* buffer =  new uint8_t[serializedSize + 16];
-  i->SetBuffer (buffer);
-  // Add the time, dest node and dest device
-  uint64_t t = rxTime.GetInteger ();
-  uint64_t* pTime = reinterpret_cast <uint64_t *> (buffer);
-  *pTime++ = t;
-  uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
-  *pData++ = node;
-  *pData++ = dev;
-  // Serialize the packet
-  p->Serialize (reinterpret_cast<uint8_t *> (pData), serializedSize);
+uint8_t*
+GrantedTimeWindowMpiInterface::AllocateBuffer ()
+{
+  if (m_freeBuffers.empty ())
+    {
+      return new uint8_t[MAX_MPI_AGGREGATE_SIZE];
+    }
+  uint8_t *buffer = m_freeBuffers.back ();
+  m_freeBuffers.pop_back ();
+  return buffer;
+}
 
+void
+GrantedTimeWindowMpiInterface::SendPacket (Ptr<Packet> p, const Time& rxTime, uint32_t node, uint32_t dev)
+{
+  NS_LOG_FUNCTION (this << p << rxTime.GetTimeStep () << node << dev);
+
+#ifdef NS3_MPI
   // Find the system id for the destination node
   Ptr<Node> destNode = NodeList::GetNode (node);
   uint32_t nodeSysId = destNode->GetSystemId ();
 
-  MPI_Isend (reinterpret_cast<void *> (i->GetBuffer ()), serializedSize + 16, MPI_CHAR, nodeSysId,
-             0, MPI_COMM_WORLD, (i->GetRequest ()));
+  uint32_t serializedSize = p->GetSerializedSize ();
+  uint32_t recordSize = PACKET_HEADER_SIZE + serializedSize;
+  NS_ABORT_MSG_IF (recordSize > MAX_MPI_AGGREGATE_SIZE,
+                   "Packet of " << serializedSize << " bytes too large for MAX_MPI_AGGREGATE_SIZE");
+  if (m_txSizes[nodeSysId] + recordSize > MAX_MPI_AGGREGATE_SIZE)
+    {
+      Flush (nodeSysId);
+    }
+  if (m_txBuffers[nodeSysId] == 0)
+    {
+      m_txBuffers[nodeSysId] = AllocateBuffer ();
+    }
+
+  // Add the time, dest node, dest device and size, then serialize the
+  // packet in place after the packets already sent in this window
+  uint8_t *buffer = m_txBuffers[nodeSysId] + m_txSizes[nodeSysId];
+  uint64_t t = rxTime.GetInteger ();
+  std::memcpy (buffer, &t, sizeof (t));
+  std::memcpy (buffer + 8, &node, sizeof (node));
+  std::memcpy (buffer + 12, &dev, sizeof (dev));
+  std::memcpy (buffer + 16, &serializedSize, sizeof (serializedSize));
+  p->Serialize (buffer + PACKET_HEADER_SIZE, serializedSize);
+  m_txSizes[nodeSysId] += recordSize;
+
+  m_statistics[nodeSysId].txPackets++;
   m_txCount++;
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
 }
 
+void
+GrantedTimeWindowMpiInterface::FlushSendBuffers ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  for (uint32_t i = 0; i < m_txSizes.size (); ++i)
+    {
+      if (m_txSizes[i] > 0)
+        {
+          Flush (i);
+        }
+    }
+}
+
+void
+GrantedTimeWindowMpiInterface::Flush (uint32_t rank)
+{
+  NS_LOG_FUNCTION (rank << m_txSizes[rank]);
+
+#ifdef NS3_MPI
+  uint32_t size = m_txSizes[rank];
+  if (size == 0)
+    {
+      return;
+    }
+  m_statistics[rank].txMessages++;
+  m_statistics[rank].txBytes += size;
+  m_txSizes[rank] = 0;
+  if (m_txRings[rank] != 0 && WriteRing (rank, m_txBuffers[rank], size))
+    {
+      m_statistics[rank].txSharedMessages++;
+      return;
+    }
+
+  // The buffer is sent as is and replaced by a free one
+  SentBuffer sendBuf;
+  m_pendingTx.push_back (sendBuf);
+  std::list<SentBuffer>::reverse_iterator i = m_pendingTx.rbegin (); // Points to the last element
+  i->SetBuffer (m_txBuffers[rank]);
+  m_txBuffers[rank] = 0;
+  MPI_Isend (reinterpret_cast<void *> (i->GetBuffer ()), size, MPI_CHAR, rank,
+             0, MPI_COMM_WORLD, (i->GetRequest ()));
+#endif
+}
+
+bool
+GrantedTimeWindowMpiInterface::WriteRing (uint32_t rank, const uint8_t *data, uint32_t size)
+{
+  uint8_t *ring = m_txRings[rank];
+  uint64_t capacity = m_ringSize - RING_DATA;
+  uint64_t *head = reinterpret_cast<uint64_t *> (ring + RING_HEAD);
+  uint64_t *tail = reinterpret_cast<uint64_t *> (ring + RING_TAIL);
+  uint64_t start = *tail;
+  if (start + sizeof (size) + size - __atomic_load_n (head, __ATOMIC_ACQUIRE) > capacity)
+    {
+      return false;
+    }
+  CopyToRing (ring + RING_DATA, capacity, start, reinterpret_cast<const uint8_t *> (&size), sizeof (size));
+  CopyToRing (ring + RING_DATA, capacity, start + sizeof (size), data, size);
+  // Publish the message once written
+  __atomic_store_n (tail, start + sizeof (size) + size, __ATOMIC_RELEASE);
+  return true;
+}
+
 void
 GrantedTimeWindowMpiInterface::ReceiveMessages ()
 { 
@@ -235,27 +491,85 @@ GrantedTimeWindowMpiInterface::ReceiveMessages ()
       int index = 0;
       MPI_Status status;
 
-      MPI_Testany (MpiInterface::GetSize (), m_requests, &index, &flag, &status);
+      MPI_Testany (m_rxBufferCount, m_requests, &index, &flag, &status);
       if (!flag)
         {
           break;        // No more messages
         }
       int count;
       MPI_Get_count (&status, MPI_CHAR, &count);
-      m_rxCount++; // Count this receive
+      HandleMessage (status.MPI_SOURCE, reinterpret_cast<uint8_t *> (m_pRxBuffers[index]), count);
 
+      // Re-queue the next read
+      MPI_Irecv (m_pRxBuffers[index], MAX_MPI_AGGREGATE_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
+                 MPI_COMM_WORLD, &m_requests[index]);
+    }
+
+  if (m_sharedMemory)
+    {
+      for (uint32_t i = 0; i < m_rxRings.size (); ++i)
+        {
+          if (m_rxRings[i] != 0)
+            {
+              ReadRing (i);
+            }
+        }
+    }
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+GrantedTimeWindowMpiInterface::ReadRing (uint32_t rank)
+{
+  uint8_t *ring = m_rxRings[rank];
+  uint64_t capacity = m_ringSize - RING_DATA;
+  uint64_t *head = reinterpret_cast<uint64_t *> (ring + RING_HEAD);
+  uint64_t *tail = reinterpret_cast<uint64_t *> (ring + RING_TAIL);
+  uint64_t start = *head;
+  uint64_t end = __atomic_load_n (tail, __ATOMIC_ACQUIRE);
+  while (start != end)
+    {
+      uint32_t size;
+      CopyFromRing (ring + RING_DATA, capacity, start, reinterpret_cast<uint8_t *> (&size), sizeof (size));
+      m_ringMessage.resize (size);
+      CopyFromRing (ring + RING_DATA, capacity, start + sizeof (size), &m_ringMessage[0], size);
+      start += sizeof (size) + size;
+      // Free the space before scheduling the packets
+      __atomic_store_n (head, start, __ATOMIC_RELEASE);
+      HandleMessage (rank, &m_ringMessage[0], size);
+    }
+}
+
+void
+GrantedTimeWindowMpiInterface::HandleMessage (uint32_t source, const uint8_t *data, uint32_t size)
+{
+  NS_LOG_FUNCTION (source << size);
+
+  m_statistics[source].rxMessages++;
+  m_statistics[source].rxBytes += size;
+  const uint8_t *end = data + size;
+  while (data < end)
+    {
       // Get the meta data first
-      uint64_t* pTime = reinterpret_cast<uint64_t *> (m_pRxBuffers[index]);
-      uint64_t time = *pTime++;
-      uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
-      uint32_t node = *pData++;
-      uint32_t dev  = *pData++;
+      uint64_t time;
+      uint32_t node;
+      uint32_t dev;
+      uint32_t count;
+      std::memcpy (&time, data, sizeof (time));
+      std::memcpy (&node, data + 8, sizeof (node));
+      std::memcpy (&dev, data + 12, sizeof (dev));
+      std::memcpy (&count, data + 16, sizeof (count));
+      data += PACKET_HEADER_SIZE;
+      NS_ASSERT (data + count <= end);
+      m_rxCount++; // Count this receive
+      m_statistics[source].rxPackets++;
 
       Time rxTime (time);
 
-      count -= sizeof (time) + sizeof (node) + sizeof (dev);
-
-      Ptr<Packet> p = Create<Packet> (reinterpret_cast<uint8_t *> (pData), count, true);
+      Ptr<Packet> p = Create<Packet> (data, count, true);
+      data += count;
 
       // Find the correct node/device to schedule receive event
       Ptr<Node> pNode = NodeList::GetNode (node);
@@ -276,14 +590,7 @@ GrantedTimeWindowMpiInterface::ReceiveMessages ()
       // Schedule the rx event
       Simulator::ScheduleWithContext (pNode->GetId (), rxTime - Simulator::Now (),
                                       &MpiReceiver::Receive, pMpiRec, p);
-
-      // Re-queue the next read
-      MPI_Irecv (m_pRxBuffers[index], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
-                 MPI_COMM_WORLD, &m_requests[index]);
     }
-#else
-  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
-#endif
 }
 
 void
@@ -301,7 +608,9 @@ GrantedTimeWindowMpiInterface::TestSendComplete ()
       std::list<SentBuffer>::iterator current = i; // Save current for erasing
       i++;                                    // Advance to next
       if (flag)
-        { // This message is complete
+        { // This message is complete, keep its buffer for the next ones
+          m_freeBuffers.push_back (current->GetBuffer ());
+          current->SetBuffer (0);
           m_pendingTx.erase (current);
         }
     }
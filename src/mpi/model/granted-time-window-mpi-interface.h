@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <list>
+#include <vector>
 
 #include "ns3/nstime.h"
 #include "ns3/buffer.h"
@@ -35,6 +36,8 @@
 #include "mpi.h"
 #else
 typedef void* MPI_Request;
+typedef void* MPI_Comm;
+typedef void* MPI_Win;
 #endif
 
 namespace ns3 {
@@ -45,6 +48,12 @@ namespace ns3 {
  */
 const uint32_t MAX_MPI_MSG_SIZE = 2000;
 
+/**
+ * maximum size of the MPI message carrying the packets sent to
+ * a rank during a time window
+ */
+const uint32_t MAX_MPI_AGGREGATE_SIZE = 65536;
+
 /**
  * \ingroup mpi
  *
@@ -87,10 +96,31 @@ class Packet;
  * Implements the interface used by the singleton parallel controller
  * to interface between NS3 and the communications layer being
  * used for inter-task packet transfers.
+ *
+ * The packets sent to a rank are serialized back to back into a single
+ * buffer, which is sent in one message at the end of the time window
+ * (or earlier once MAX_MPI_AGGREGATE_SIZE is reached), and received
+ * into a pool of buffers posted in advance. The ranks running on the
+ * same host exchange these messages through ring buffers in shared
+ * memory, of MpiSharedMemorySize bytes each, when MPI supports it.
  */
 class GrantedTimeWindowMpiInterface : public ParallelCommunicationInterface, Object
 {
 public:
+  /**
+   * \brief Traffic exchanged with another rank
+   */
+  struct RankStatistics
+  {
+    uint64_t txPackets;         //!< packets sent to the rank
+    uint64_t txMessages;        //!< messages sent to the rank
+    uint64_t txBytes;           //!< bytes sent to the rank
+    uint64_t txSharedMessages;  //!< messages sent through shared memory
+    uint64_t rxPackets;         //!< packets received from the rank
+    uint64_t rxMessages;        //!< messages received from the rank
+    uint64_t rxBytes;           //!< bytes received from the rank
+  };
+
   static TypeId GetTypeId (void);
 
   /**
@@ -131,6 +161,11 @@ public:
    * Serialize and send a packet to the specified node and net device
    */
   virtual void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+  /**
+   * Send the packets aggregated for each rank since the last call,
+   * at the end of a time window
+   */
+  static void FlushSendBuffers ();
   /**
    * Check for received messages complete
    */
@@ -147,8 +182,51 @@ public:
    * \return transmitted count in packets
    */
   static uint32_t GetTxCount ();
+  /**
+   * \param rank the other rank
+   * \return the traffic exchanged with the rank
+   */
+  static const RankStatistics & GetStatistics (uint32_t rank);
 
 private:
+  /**
+   * Send the packets aggregated for a rank
+   *
+   * \param rank the destination rank
+   */
+  static void Flush (uint32_t rank);
+  /**
+   * Schedule the reception of the packets of a message
+   *
+   * \param source the source rank
+   * \param data the message
+   * \param size the size of the message
+   */
+  static void HandleMessage (uint32_t source, const uint8_t *data, uint32_t size);
+  /**
+   * \return a buffer of MAX_MPI_AGGREGATE_SIZE bytes
+   */
+  static uint8_t* AllocateBuffer ();
+  /**
+   * Map the shared memory rings of the ranks running on this host
+   */
+  static void EnableSharedMemory ();
+  /**
+   * Write a message into the ring of a rank running on this host
+   *
+   * \param rank the destination rank
+   * \param data the message
+   * \param size the size of the message
+   * \return false if the ring is full
+   */
+  static bool WriteRing (uint32_t rank, const uint8_t *data, uint32_t size);
+  /**
+   * Read the messages written by a rank running on this host
+   *
+   * \param rank the source rank
+   */
+  static void ReadRing (uint32_t rank);
+
   static uint32_t m_sid;
   static uint32_t m_size;
 
@@ -166,8 +244,35 @@ private:
   // Data buffers for non-blocking reads
   static char**   m_pRxBuffers;
 
+  // Number of pending non-blocking receives
+  static uint32_t m_rxBufferCount;
+
   // List of pending non-blocking sends
   static std::list<SentBuffer> m_pendingTx;
+
+  // Packets aggregated for each rank and their size
+  static std::vector<uint8_t*> m_txBuffers;
+  static std::vector<uint32_t> m_txSizes;
+
+  // Buffers of the completed sends, reused
+  static std::vector<uint8_t*> m_freeBuffers;
+
+  // Traffic exchanged with each rank
+  static std::vector<RankStatistics> m_statistics;
+
+  // Ranks running on this host and their shared memory window
+  static MPI_Comm m_hostComm;
+  static MPI_Win  m_hostWindow;
+  static bool     m_sharedMemory;
+  static uint32_t m_ringSize;
+
+  // Ring written by this rank in the memory of each rank of this host,
+  // and ring read by this rank for each rank of this host, or 0
+  static std::vector<uint8_t*> m_txRings;
+  static std::vector<uint8_t*> m_rxRings;
+
+  // Copy of the message read from a ring
+  static std::vector<uint8_t> m_ringMessage;
 };
 
 } // namespace ns3
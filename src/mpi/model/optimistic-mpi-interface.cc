@@ -0,0 +1,229 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "optimistic-mpi-interface.h"
+#include "optimistic-simulator-impl.h"
+
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OptimisticMpiInterface");
+
+uint32_t OptimisticMpiInterface::g_sid = 0;
+uint32_t OptimisticMpiInterface::g_size = 1;
+bool OptimisticMpiInterface::g_enabled = false;
+MPI_Comm OptimisticMpiInterface::g_comm;
+std::list<OptimisticMpiInterface::PendingSend> OptimisticMpiInterface::g_pendingTx;
+MPI_Request OptimisticMpiInterface::g_reduceRequest;
+int64_t OptimisticMpiInterface::g_reduceValue = 0;
+int64_t OptimisticMpiInterface::g_reduceResult = 0;
+
+OptimisticMpiInterface::OptimisticMpiInterface ()
+{
+  NS_LOG_FUNCTION (this);
+
+#ifndef NS3_MPI
+  NS_FATAL_ERROR ("Must compile with MPI if the optimistic simulator is used, see --enable-mpi option for waf");
+#endif
+}
+
+OptimisticMpiInterface::~OptimisticMpiInterface ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+OptimisticMpiInterface::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+OptimisticMpiInterface::GetSystemId ()
+{
+  return g_sid;
+}
+
+uint32_t
+OptimisticMpiInterface::GetSize ()
+{
+  return g_size;
+}
+
+bool
+OptimisticMpiInterface::IsEnabled ()
+{
+  return g_enabled;
+}
+
+void
+OptimisticMpiInterface::Enable (int* pargc, char*** pargv)
+{
+  NS_LOG_FUNCTION (this << *pargc);
+#ifdef NS3_MPI
+  MPI_Init (pargc, pargv);
+  MPI_Barrier (MPI_COMM_WORLD);
+
+  int mpiSystemId;
+  int mpiSize;
+  MPI_Comm_rank (MPI_COMM_WORLD, &mpiSystemId);
+  MPI_Comm_size (MPI_COMM_WORLD, &mpiSize);
+  g_sid = mpiSystemId;
+  g_size = mpiSize;
+
+  // Keep the messages of the simulator apart from those of the user
+  MPI_Comm_dup (MPI_COMM_WORLD, &g_comm);
+
+  g_enabled = true;
+#endif
+}
+
+void
+OptimisticMpiInterface::SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev)
+{
+  NS_LOG_FUNCTION (this << p << rxTime.GetTimeStep () << node << dev);
+  NS_ASSERT (g_enabled);
+
+  OptimisticSimulatorImpl::GetInstance ()->SendPacket (p, rxTime, node, dev);
+}
+
+void
+OptimisticMpiInterface::Send (uint32_t dest, int tag, std::vector<uint8_t> &data)
+{
+  NS_LOG_FUNCTION (dest << tag << data.size ());
+#ifdef NS3_MPI
+  g_pendingTx.push_back (PendingSend ());
+  PendingSend &send = g_pendingTx.back ();
+  send.data.swap (data);
+  MPI_Isend (&send.data[0], send.data.size (), MPI_BYTE, dest, tag, g_comm, &send.request);
+#endif
+}
+
+bool
+OptimisticMpiInterface::Receive (uint32_t &source, int &tag, std::vector<uint8_t> &data)
+{
+#ifdef NS3_MPI
+  int flag = 0;
+  MPI_Status status;
+  MPI_Iprobe (MPI_ANY_SOURCE, MPI_ANY_TAG, g_comm, &flag, &status);
+  if (!flag)
+    {
+      return false;
+    }
+  int count;
+  MPI_Get_count (&status, MPI_BYTE, &count);
+  data.resize (count);
+  MPI_Recv (&data[0], count, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, g_comm, MPI_STATUS_IGNORE);
+  source = status.MPI_SOURCE;
+  tag = status.MPI_TAG;
+  NS_LOG_LOGIC ("received " << count << " bytes from " << source << " tag " << tag);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+OptimisticMpiInterface::TestSendComplete ()
+{
+#ifdef NS3_MPI
+  std::list<PendingSend>::iterator iter = g_pendingTx.begin ();
+  while (iter != g_pendingTx.end ())
+    {
+      int flag = 0;
+      MPI_Test (&iter->request, &flag, MPI_STATUS_IGNORE);
+      if (flag)
+        {
+          iter = g_pendingTx.erase (iter);
+        }
+      else
+        {
+          ++iter;
+        }
+    }
+#endif
+}
+
+void
+OptimisticMpiInterface::StartReduce (int64_t value, bool minimum)
+{
+  NS_LOG_FUNCTION (value << minimum);
+#ifdef NS3_MPI
+  g_reduceValue = value;
+  MPI_Iallreduce (&g_reduceValue, &g_reduceResult, 1, MPI_LONG_LONG,
+                  minimum ? MPI_MIN : MPI_SUM, g_comm, &g_reduceRequest);
+#endif
+}
+
+bool
+OptimisticMpiInterface::TestReduce (int64_t &result)
+{
+#ifdef NS3_MPI
+  int flag = 0;
+  MPI_Test (&g_reduceRequest, &flag, MPI_STATUS_IGNORE);
+  if (flag)
+    {
+      result = g_reduceResult;
+    }
+  return flag;
+#else
+  return false;
+#endif
+}
+
+void
+OptimisticMpiInterface::Disable ()
+{
+  NS_LOG_FUNCTION (this);
+#ifdef NS3_MPI
+  if (OptimisticSimulatorImpl::IsWorker ())
+    {
+      // The rank process finalizes MPI once this process exits
+      g_enabled = false;
+      return;
+    }
+
+  int flag = 0;
+  MPI_Initialized (&flag);
+  if (flag)
+    {
+      for (std::list<PendingSend>::iterator iter = g_pendingTx.begin ();
+           iter != g_pendingTx.end ();
+           ++iter)
+        {
+          MPI_Cancel (&iter->request);
+          MPI_Request_free (&iter->request);
+        }
+      g_pendingTx.clear ();
+      MPI_Comm_free (&g_comm);
+      MPI_Finalize ();
+      g_enabled = false;
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Cannot disable MPI environment without Initializing it first");
+    }
+#endif
+}
+
+} // namespace ns3
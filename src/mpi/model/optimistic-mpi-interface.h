@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef NS3_OPTIMISTIC_MPI_INTERFACE_H
+#define NS3_OPTIMISTIC_MPI_INTERFACE_H
+
+#include "parallel-communication-interface.h"
+
+#include <ns3/nstime.h>
+#include <ns3/buffer.h>
+
+#ifdef NS3_MPI
+#include "mpi.h"
+#else
+typedef void* MPI_Request;
+typedef void* MPI_Comm;
+#endif
+
+#include <stdint.h>
+#include <list>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Interface between ns-3 and MPI for the optimistic simulator
+ *
+ * Only the rank process of the OptimisticSimulatorImpl talks to MPI. The
+ * worker process executing the events hands its packets over to the rank
+ * process, which forwards them with the static methods of this class,
+ * together with the anti-messages cancelling them, and computes the global
+ * virtual time with non-blocking reductions so that it never stops serving
+ * its worker.
+ */
+class OptimisticMpiInterface : public ParallelCommunicationInterface
+{
+public:
+  /// Tags of the messages exchanged by the rank processes
+  enum Tag
+  {
+    PACKET_TAG = 1,     //!< positive message carrying a packet
+    ANTI_MESSAGE_TAG    //!< anti-message cancelling a packet
+  };
+
+  OptimisticMpiInterface ();
+  ~OptimisticMpiInterface ();
+
+  // virtual from ParallelCommunicationInterface
+  virtual void Destroy ();
+  virtual uint32_t GetSystemId ();
+  virtual uint32_t GetSize ();
+  virtual bool IsEnabled ();
+  virtual void Enable (int* pargc, char*** pargv);
+  virtual void Disable ();
+  virtual void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+
+  /**
+   * Post a non-blocking send, the data is kept until the send completes
+   *
+   * \param dest the destination rank
+   * \param tag the tag of the message
+   * \param data the message, swapped out
+   */
+  static void Send (uint32_t dest, int tag, std::vector<uint8_t> &data);
+  /**
+   * Receive the next pending message, if any
+   *
+   * \param [out] source the source rank
+   * \param [out] tag the tag of the message
+   * \param [out] data the message
+   * \return true if a message was received
+   */
+  static bool Receive (uint32_t &source, int &tag, std::vector<uint8_t> &data);
+  /**
+   * Release the buffers of the completed sends
+   */
+  static void TestSendComplete ();
+  /**
+   * Start a non-blocking reduction over all the ranks
+   *
+   * \param value the local value
+   * \param minimum reduce to the minimum if true, to the sum otherwise
+   */
+  static void StartReduce (int64_t value, bool minimum);
+  /**
+   * \param [out] result the reduced value, once complete
+   * \return true if the reduction started last is complete
+   */
+  static bool TestReduce (int64_t &result);
+
+private:
+  /// A non-blocking send and its buffer
+  struct PendingSend
+  {
+    std::vector<uint8_t> data;  //!< the message
+    MPI_Request request;        //!< the request of the send
+  };
+
+  static uint32_t g_sid;                    //!< the MPI rank
+  static uint32_t g_size;                   //!< the number of ranks
+  static bool g_enabled;                    //!< whether MPI is enabled
+  static MPI_Comm g_comm;                   //!< communicator of the simulator
+  static std::list<PendingSend> g_pendingTx; //!< sends not yet complete
+  static MPI_Request g_reduceRequest;       //!< request of the reduction
+  static int64_t g_reduceValue;             //!< local value of the reduction
+  static int64_t g_reduceResult;            //!< result of the reduction
+};
+
+} // namespace ns3
+
+#endif /* NS3_OPTIMISTIC_MPI_INTERFACE_H */
@@ -0,0 +1,1582 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "optimistic-simulator-impl.h"
+#include "optimistic-mpi-interface.h"
+#include "mpi-interface.h"
+
+#include "ns3/mpi-receiver.h"
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/make-event.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/net-device.h"
+#include "ns3/pcap-file.h"
+#include "ns3/pcapng-file.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/uinteger.h"
+#include "ns3/hash.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+
+#ifdef NS3_MPI
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OptimisticSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (OptimisticSimulatorImpl);
+
+/// Timestamp of the events which never happen
+static const uint64_t INFINITE_TS = 0x7fffffffffffffffULL;
+/// Events executed by the worker between two reads of its frames
+static const uint32_t CHECK_INTERVAL = 256;
+/// First uid of the local events, the packets received get the uids below
+static const uint32_t FIRST_LOCAL_UID = 0x80000000;
+
+/**
+ * Append a value to a frame or message
+ * \param buffer the frame
+ * \param value the value
+ */
+template <typename T>
+static void
+Put (std::vector<uint8_t> &buffer, T value)
+{
+  const uint8_t *p = reinterpret_cast<const uint8_t *> (&value);
+  buffer.insert (buffer.end (), p, p + sizeof (T));
+}
+
+/**
+ * Read a value from a frame or message
+ * \param data the current position, advanced past the value
+ * \return the value
+ */
+template <typename T>
+static T
+Get (const uint8_t *&data)
+{
+  T value;
+  std::memcpy (&value, data, sizeof (T));
+  data += sizeof (T);
+  return value;
+}
+
+OptimisticSimulatorImpl* OptimisticSimulatorImpl::g_instance = 0;
+bool OptimisticSimulatorImpl::g_worker = false;
+
+TypeId
+OptimisticSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OptimisticSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Mpi")
+    .AddConstructor<OptimisticSimulatorImpl> ()
+    .AddAttribute ("SnapshotInterval",
+                   "The number of events executed between two snapshots of the state.",
+                   UintegerValue (10000),
+                   MakeUintegerAccessor (&OptimisticSimulatorImpl::m_snapshotInterval),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("GvtInterval",
+                   "The wall clock time between two computations of the global virtual time.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&OptimisticSimulatorImpl::m_gvtInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("OptimismWindow",
+                   "How far in simulation time a rank may run ahead of the global "
+                   "virtual time, zero for no limit.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&OptimisticSimulatorImpl::m_optimismWindow),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+OptimisticSimulatorImpl::OptimisticSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+
+  m_myId = 0;
+#ifdef NS3_MPI
+  m_myId = MpiInterface::GetSystemId ();
+#else
+  NS_FATAL_ERROR ("Can't use optimistic simulator without MPI compiled in");
+#endif
+
+  // uids are allocated from 4.
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  // The packets received are numbered from 4 and the local events from
+  // FIRST_LOCAL_UID, so a replay orders the events at the same time alike.
+  m_inputUid = 4;
+  m_uid = FIRST_LOCAL_UID;
+  // before ::Run is entered, the m_currentUid will be zero
+  m_currentUid = 0;
+  m_currentTs = 0;
+  m_currentContext = 0xffffffff;
+  m_unscheduledEvents = 0;
+  m_events = 0;
+  m_stopTs = INFINITE_TS;
+  m_stopUid = 0;
+
+  m_running = false;
+  m_end = false;
+  m_gvt = 0;
+  m_frames = 0;
+  m_replaying = false;
+  m_lastSeq = 0;
+  m_eventCount = 0;
+  m_lastStatus = 0;
+  m_lastStatusFrames = 0;
+  m_rollbacks = 0;
+  m_rolledBackEvents = 0;
+  m_antiMessages = 0;
+  m_worker = 0;
+  m_framesQueued = 0;
+  m_workerLvt = 0;
+  m_workerStopTs = INFINITE_TS;
+  m_seq = 0;
+  m_position = 0;
+  m_nextId = 0;
+  m_sentCount = 0;
+  m_receivedCount = 0;
+  m_gvtPhase = GVT_IDLE;
+  m_lastGvtMs = 0;
+
+  NS_ASSERT (g_instance == 0);
+  g_instance = this;
+}
+
+OptimisticSimulatorImpl::~OptimisticSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+  g_instance = 0;
+}
+
+void
+OptimisticSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  while (!m_events->IsEmpty ())
+    {
+      Scheduler::Event next = m_events->RemoveNext ();
+      next.impl->Unref ();
+    }
+  m_events = 0;
+  m_received.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+OptimisticSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+
+  MpiInterface::Destroy ();
+}
+
+OptimisticSimulatorImpl *
+OptimisticSimulatorImpl::GetInstance (void)
+{
+  NS_ASSERT (g_instance != 0);
+  return g_instance;
+}
+
+bool
+OptimisticSimulatorImpl::IsWorker (void)
+{
+  return g_worker;
+}
+
+void
+OptimisticSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+
+  Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+
+  if (m_events != 0)
+    {
+      while (!m_events->IsEmpty ())
+        {
+          Scheduler::Event next = m_events->RemoveNext ();
+          scheduler->Insert (next);
+        }
+    }
+  m_events = scheduler;
+}
+
+void
+OptimisticSimulatorImpl::ProcessOneEvent (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Scheduler::Event next = m_events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= m_currentTs);
+  m_unscheduledEvents--;
+  m_eventCount++;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  m_currentTs = next.key.m_ts;
+  m_currentContext = next.key.m_context;
+  m_currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+bool
+OptimisticSimulatorImpl::IsFinished (void) const
+{
+  return m_end || m_events->IsEmpty ();
+}
+
+uint64_t
+OptimisticSimulatorImpl::NextTs (void) const
+{
+  if (m_events->IsEmpty ())
+    {
+      return INFINITE_TS;
+    }
+  Scheduler::Event next = m_events->PeekNext ();
+  if (next.key.m_ts > m_stopTs
+      || (next.key.m_ts == m_stopTs && next.key.m_uid >= m_stopUid))
+    {
+      return INFINITE_TS;
+    }
+  return next.key.m_ts;
+}
+
+bool
+OptimisticSimulatorImpl::IsReady (void) const
+{
+  uint64_t next = NextTs ();
+  if (next == INFINITE_TS)
+    {
+      return false;
+    }
+  if (!m_optimismWindow.IsZero ())
+    {
+      uint64_t window = m_optimismWindow.GetTimeStep ();
+      return m_gvt > INFINITE_TS - window || next <= m_gvt + window;
+    }
+  return true;
+}
+
+void
+OptimisticSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  NS_ABORT_MSG_IF (m_running, "Run may only be called once with the optimistic simulator");
+  m_running = true;
+  CheckTraceFiles ();
+
+  if (pipe (m_toRank) != 0 || pipe (m_toWorker) != 0)
+    {
+      NS_FATAL_ERROR ("Cannot create the pipes of the worker: " << std::strerror (errno));
+    }
+  // The rank process never blocks on the pipes; it also drains the pipe
+  // of the worker after a rollback
+  fcntl (m_toRank[0], F_SETFL, O_NONBLOCK);
+  fcntl (m_toWorker[0], F_SETFL, O_NONBLOCK);
+  fcntl (m_toWorker[1], F_SETFL, O_NONBLOCK);
+
+  // The snapshots wait for SIGUSR1 to resume, it must stay pending until then
+  sigset_t set;
+  sigemptyset (&set);
+  sigaddset (&set, SIGUSR1);
+  sigprocmask (SIG_BLOCK, &set, 0);
+#if defined (__linux__) && defined (PR_SET_CHILD_SUBREAPER)
+  // Adopt the snapshots orphaned when their worker is killed, to reap them
+  prctl (PR_SET_CHILD_SUBREAPER, 1);
+#endif
+
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      NS_FATAL_ERROR ("Cannot fork the worker: " << std::strerror (errno));
+    }
+  if (pid == 0)
+    {
+      g_worker = true;
+      close (m_toRank[0]);
+      close (m_toWorker[1]);
+      RunWorker ();
+      return;
+    }
+
+  m_worker = pid;
+  close (m_toRank[1]);
+  RunRank ();
+  Finish ();
+#else
+  NS_FATAL_ERROR ("Can't use optimistic simulator without MPI compiled in");
+#endif
+}
+
+void
+OptimisticSimulatorImpl::RunWorker (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  TakeSnapshot ();
+  uint32_t sinceSnapshot = 0;
+  uint32_t sinceCheck = 0;
+  while (!m_end)
+    {
+      if (m_replaying)
+        {
+          // Execute no event before the replayed packets are scheduled
+          ReadFrames (true);
+          continue;
+        }
+      if (!IsReady ())
+        {
+          SendStatus ();
+          ReadFrames (true);
+          continue;
+        }
+      ProcessOneEvent ();
+      if (++sinceSnapshot >= m_snapshotInterval)
+        {
+          TakeSnapshot ();
+          sinceSnapshot = 0;
+        }
+      if (++sinceCheck >= CHECK_INTERVAL)
+        {
+          SendStatus ();
+          ReadFrames (false);
+          sinceCheck = 0;
+        }
+    }
+}
+
+void
+OptimisticSimulatorImpl::TakeSnapshot (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  // Trace files opened by the events would be written again after a rollback
+  CheckTraceFiles ();
+
+  sigset_t set;
+  sigemptyset (&set);
+  sigaddset (&set, SIGUSR1);
+  while (true)
+    {
+      std::cout.flush ();
+      std::cerr.flush ();
+      std::fflush (0);
+      pid_t pid = fork ();
+      if (pid < 0)
+        {
+          NS_FATAL_ERROR ("Cannot fork a snapshot: " << std::strerror (errno));
+        }
+      if (pid > 0)
+        {
+          std::vector<uint8_t> data;
+          Put<uint64_t> (data, pid);
+          // A straggler older than the last event executed needs an older snapshot
+          Put<uint64_t> (data, m_currentUid == 0 ? 0 : m_currentTs + 1);
+          Put<uint64_t> (data, m_lastSeq);
+          Put<uint64_t> (data, m_eventCount);
+          Put<uint64_t> (data, m_stopTs);
+          WriteFrame (SNAPSHOT_FRAME, data);
+          // Reap the snapshots discarded by the rank process, and only
+          // those: the events may have started processes of their own
+          m_forked.push_back (pid);
+          std::vector<int32_t>::iterator it = m_forked.begin ();
+          while (it != m_forked.end ())
+            {
+              if (waitpid (*it, 0, WNOHANG) != 0)
+                {
+                  it = m_forked.erase (it);
+                }
+              else
+                {
+                  ++it;
+                }
+            }
+          return;
+        }
+
+      // The snapshots forked before belong to the parent
+      m_forked.clear ();
+
+      int sig;
+      while (sigwait (&set, &sig) != 0)
+        {
+        }
+      // Resumed after a rollback: the rank process replays the frames
+      // received since the snapshot. Snapshot this state again before
+      // changing it, it may be needed by the next rollback.
+      NS_LOG_LOGIC ("resumed at " << m_currentTs);
+      m_inputBuffer.clear ();
+      m_frames = 0;
+      m_replaying = true;
+      m_lastStatusFrames = ~0ULL;
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::CheckTraceFiles (void) const
+{
+  uint32_t files = PcapFile::GetNWritingFiles () + PcapNgFile::GetNOpenFiles ()
+    + OutputStreamWrapper::GetNStreams ();
+  NS_ABORT_MSG_IF (files != 0, "The optimistic simulator cannot run with " << files
+                   << " pcap or ascii trace files open: their output would be written"
+                   " again or corrupted after a rollback");
+}
+
+void
+OptimisticSimulatorImpl::SendStatus (void)
+{
+  uint64_t lvt = NextTs ();
+  if (lvt == m_lastStatus && m_frames == m_lastStatusFrames)
+    {
+      return;
+    }
+  m_lastStatus = lvt;
+  m_lastStatusFrames = m_frames;
+  std::vector<uint8_t> data;
+  Put<uint64_t> (data, lvt);
+  Put<uint64_t> (data, m_frames);
+  Put<uint64_t> (data, m_eventCount);
+  Put<uint64_t> (data, m_stopTs);
+  WriteFrame (STATUS_FRAME, data);
+}
+
+void
+OptimisticSimulatorImpl::WriteFrame (uint32_t type, const std::vector<uint8_t> &data)
+{
+#ifdef NS3_MPI
+  std::vector<uint8_t> frame;
+  frame.reserve (2 * sizeof (uint32_t) + data.size ());
+  Put<uint32_t> (frame, type);
+  Put<uint32_t> (frame, data.size ());
+  frame.insert (frame.end (), data.begin (), data.end ());
+  std::size_t written = 0;
+  while (written < frame.size ())
+    {
+      ssize_t n = write (m_toRank[1], &frame[written], frame.size () - written);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("Cannot write to the rank process: " << std::strerror (errno));
+        }
+      written += n;
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::ReadFrames (bool block)
+{
+#ifdef NS3_MPI
+  uint8_t chunk[65536];
+  while (true)
+    {
+      if (block)
+        {
+          struct pollfd fd;
+          fd.fd = m_toWorker[0];
+          fd.events = POLLIN;
+          if (poll (&fd, 1, -1) < 0 && errno != EINTR)
+            {
+              NS_FATAL_ERROR ("Cannot poll the rank process: " << std::strerror (errno));
+            }
+        }
+      ssize_t n = read (m_toWorker[0], chunk, sizeof (chunk));
+      if (n == 0)
+        {
+          NS_FATAL_ERROR ("The rank process exited");
+        }
+      if (n < 0 && errno != EAGAIN && errno != EINTR)
+        {
+          NS_FATAL_ERROR ("Cannot read from the rank process: " << std::strerror (errno));
+        }
+      if (n > 0)
+        {
+          m_inputBuffer.insert (m_inputBuffer.end (), chunk, chunk + n);
+        }
+
+      std::size_t offset = 0;
+      bool handled = false;
+      while (!m_end && m_inputBuffer.size () - offset >= 2 * sizeof (uint32_t))
+        {
+          const uint8_t *p = &m_inputBuffer[offset];
+          uint32_t type = Get<uint32_t> (p);
+          uint32_t size = Get<uint32_t> (p);
+          if (m_inputBuffer.size () - offset < 2 * sizeof (uint32_t) + size)
+            {
+              break;
+            }
+          m_frames++;
+          HandleFrame (type, p, size);
+          offset += 2 * sizeof (uint32_t) + size;
+          handled = true;
+        }
+      m_inputBuffer.erase (m_inputBuffer.begin (), m_inputBuffer.begin () + offset);
+      if (!block || handled || m_end)
+        {
+          return;
+        }
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::HandleFrame (uint32_t type, const uint8_t *data, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << type << size);
+
+  const uint8_t *end = data + size;
+  switch (type)
+    {
+    case PACKET_FRAME:
+      {
+        uint64_t seq = Get<uint64_t> (data);
+        uint64_t ts = Get<uint64_t> (data);
+        uint32_t node = Get<uint32_t> (data);
+        uint32_t dev = Get<uint32_t> (data);
+        // The packets received are executed before the local events at the same time
+        if (ts < m_currentTs || (ts == m_currentTs && m_currentUid >= FIRST_LOCAL_UID))
+          {
+            NS_LOG_LOGIC ("straggler " << seq << " at " << ts << " before " << m_currentTs);
+            RequestRollback (ts);
+          }
+
+        Ptr<Packet> p = Create<Packet> (data, end - data, true);
+
+        // Find the correct node/device to schedule receive event
+        Ptr<Node> pNode = NodeList::GetNode (node);
+        Ptr<MpiReceiver> pMpiRec = 0;
+        uint32_t nDevices = pNode->GetNDevices ();
+        for (uint32_t i = 0; i < nDevices; ++i)
+          {
+            Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
+            if (pThisDev->GetIfIndex () == dev)
+              {
+                pMpiRec = pThisDev->GetObject<MpiReceiver> ();
+                break;
+              }
+          }
+        NS_ASSERT (pNode && pMpiRec);
+
+        EventImpl *event = MakeEvent (&MpiReceiver::Receive, pMpiRec, p);
+        Scheduler::Event ev;
+        ev.impl = event;
+        ev.key.m_ts = ts;
+        ev.key.m_context = pNode->GetId ();
+        ev.key.m_uid = m_inputUid;
+        m_inputUid++;
+        m_unscheduledEvents++;
+        m_events->Insert (ev);
+        m_received[seq] = EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+        m_lastSeq = seq;
+        break;
+      }
+    case CANCEL_FRAME:
+      {
+        uint64_t seq = Get<uint64_t> (data);
+        std::map<uint64_t, EventId>::iterator it = m_received.find (seq);
+        if (it == m_received.end ())
+          {
+            break;
+          }
+        EventId id = it->second;
+        m_received.erase (it);
+        if (!IsExpired (id))
+          {
+            Remove (id);
+          }
+        else
+          {
+            NS_LOG_LOGIC ("cancelled " << seq << " executed at " << id.GetTs ());
+            RequestRollback (id.GetTs ());
+          }
+        break;
+      }
+    case GVT_FRAME:
+      {
+        m_gvt = Get<uint64_t> (data);
+        std::map<uint64_t, EventId>::iterator it = m_received.begin ();
+        while (it != m_received.end ())
+          {
+            if (it->second.GetTs () < m_gvt)
+              {
+                m_received.erase (it++);
+              }
+            else
+              {
+                ++it;
+              }
+          }
+        break;
+      }
+    case REPLAY_FRAME:
+      m_replaying = false;
+      break;
+    case END_FRAME:
+      m_rollbacks = Get<uint64_t> (data);
+      m_rolledBackEvents = Get<uint64_t> (data);
+      m_antiMessages = Get<uint64_t> (data);
+      m_end = true;
+      break;
+    default:
+      NS_FATAL_ERROR ("Unexpected frame " << type << " from the rank process");
+    }
+}
+
+void
+OptimisticSimulatorImpl::RequestRollback (uint64_t ts)
+{
+  NS_LOG_FUNCTION (this << ts);
+
+#ifdef NS3_MPI
+  std::vector<uint8_t> data;
+  Put<uint64_t> (data, ts);
+  Put<uint64_t> (data, m_eventCount);
+  WriteFrame (ROLLBACK_FRAME, data);
+  // The rank process kills this process and resumes a snapshot instead
+  while (true)
+    {
+      pause ();
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev)
+{
+  NS_LOG_FUNCTION (this << p << rxTime.GetTimeStep () << node << dev);
+  NS_ASSERT_MSG (g_worker, "Packets can only be sent while the simulation runs");
+
+  uint32_t serializedSize = p->GetSerializedSize ();
+  std::vector<uint8_t> data;
+  data.reserve (2 * sizeof (uint64_t) + 3 * sizeof (uint32_t) + serializedSize);
+  Put<uint64_t> (data, rxTime.GetTimeStep ());
+  Put<uint64_t> (data, m_currentTs);
+  Put<uint32_t> (data, NodeList::GetNode (node)->GetSystemId ());
+  Put<uint32_t> (data, node);
+  Put<uint32_t> (data, dev);
+  std::size_t offset = data.size ();
+  data.resize (offset + serializedSize);
+  p->Serialize (&data[offset], serializedSize);
+  WriteFrame (PACKET_FRAME, data);
+}
+
+void
+OptimisticSimulatorImpl::RunRank (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  m_lastGvtMs = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+  while (!m_end)
+    {
+      ReapChildren ();
+      ReceiveMessages ();
+      ReadWorkerFrames ();
+      WriteWorkerFrames ();
+      OptimisticMpiInterface::TestSendComplete ();
+      UpdateGvt ();
+      if (m_end)
+        {
+          break;
+        }
+
+      // MPI offers nothing to poll, so wake up every millisecond
+      struct pollfd fds[2];
+      fds[0].fd = m_toRank[0];
+      fds[0].events = POLLIN;
+      fds[1].fd = m_toWorker[1];
+      fds[1].events = POLLOUT;
+      poll (fds, m_frameBuffer.empty () ? 1 : 2, 1);
+    }
+
+  std::vector<uint8_t> data;
+  Put<uint64_t> (data, m_rollbacks);
+  Put<uint64_t> (data, m_rolledBackEvents);
+  Put<uint64_t> (data, m_antiMessages);
+  QueueFrame (END_FRAME, data, INFINITE_TS);
+  while (!m_frameBuffer.empty ())
+    {
+      ReadWorkerFrames ();
+      WriteWorkerFrames ();
+      struct pollfd fds[2];
+      fds[0].fd = m_toRank[0];
+      fds[0].events = POLLIN;
+      fds[1].fd = m_toWorker[1];
+      fds[1].events = POLLOUT;
+      poll (fds, 2, 1);
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::Finish (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  for (std::deque<Snapshot>::iterator it = m_snapshots.begin (); it != m_snapshots.end (); ++it)
+    {
+      kill (it->pid, SIGKILL);
+    }
+  m_snapshots.clear ();
+
+  // The worker finishes the program, the status of the rank is its status
+  int status = 0;
+  while (true)
+    {
+      int childStatus;
+      pid_t pid = waitpid (m_worker, &childStatus, 0);
+      if (pid == m_worker)
+        {
+          status = childStatus;
+          break;
+        }
+      if (pid < 0 && errno != EINTR)
+        {
+          // The worker is not a child of this process, wait for it to
+          // close its pipe
+          uint8_t chunk[4096];
+          struct pollfd fd;
+          fd.fd = m_toRank[0];
+          fd.events = POLLIN;
+          while (poll (&fd, 1, -1) >= 0 && read (m_toRank[0], chunk, sizeof (chunk)) != 0)
+            {
+            }
+          break;
+        }
+    }
+
+  MpiInterface::Disable ();
+  std::cout.flush ();
+  std::fflush (0);
+  if (WIFSIGNALED (status))
+    {
+      _exit (128 + WTERMSIG (status));
+    }
+  _exit (WEXITSTATUS (status));
+#endif
+}
+
+void
+OptimisticSimulatorImpl::Kill (int32_t pid)
+{
+#ifdef NS3_MPI
+  kill (pid, SIGKILL);
+  m_killed.push_back (pid);
+#endif
+}
+
+void
+OptimisticSimulatorImpl::ReapChildren (void)
+{
+#ifdef NS3_MPI
+  // Only the processes of this simulator are reaped: the program may wait
+  // for its own children. A snapshot killed while its worker is alive is
+  // reaped by the worker instead.
+  std::vector<int32_t>::iterator it = m_killed.begin ();
+  while (it != m_killed.end ())
+    {
+      if (waitpid (*it, 0, WNOHANG) != 0)
+        {
+          it = m_killed.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+  int status;
+  if (waitpid (m_worker, &status, WNOHANG) == m_worker)
+    {
+      NS_FATAL_ERROR ("The worker of rank " << m_myId << " exited unexpectedly with status " << status);
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::ReceiveMessages (void)
+{
+  uint32_t source;
+  int tag;
+  std::vector<uint8_t> message;
+  while (OptimisticMpiInterface::Receive (source, tag, message))
+    {
+      m_receivedCount++;
+      const uint8_t *p = &message[0];
+      uint64_t id = Get<uint64_t> (p);
+      uint64_t ts = Get<uint64_t> (p);
+      if (tag == OptimisticMpiInterface::PACKET_TAG)
+        {
+          uint64_t seq = ++m_seq;
+          Input &input = m_inputs[seq];
+          input.source = source;
+          input.id = id;
+          input.ts = ts;
+          input.cancelled = false;
+          input.data.assign (p, static_cast<const uint8_t *> (&message[0] + message.size ()));
+          m_inputIds[std::make_pair (source, id)] = seq;
+          QueueInput (seq, input);
+        }
+      else
+        {
+          std::map<std::pair<uint32_t, uint64_t>, uint64_t>::iterator it = m_inputIds.find (std::make_pair (source, id));
+          NS_ASSERT_MSG (it != m_inputIds.end (), "Anti-message for an unknown packet");
+          uint64_t seq = it->second;
+          m_inputIds.erase (it);
+          Input &input = m_inputs[seq];
+          input.cancelled = true;
+          input.data.clear ();
+          std::vector<uint8_t> data;
+          Put<uint64_t> (data, seq);
+          QueueFrame (CANCEL_FRAME, data, ts);
+        }
+    }
+}
+
+void
+OptimisticSimulatorImpl::QueueInput (uint64_t seq, const Input &input)
+{
+  std::vector<uint8_t> data;
+  data.reserve (2 * sizeof (uint64_t) + input.data.size ());
+  Put<uint64_t> (data, seq);
+  Put<uint64_t> (data, input.ts);
+  data.insert (data.end (), input.data.begin (), input.data.end ());
+  QueueFrame (PACKET_FRAME, data, input.ts);
+}
+
+void
+OptimisticSimulatorImpl::QueueFrame (uint32_t type, const std::vector<uint8_t> &data, uint64_t ts)
+{
+  Put<uint32_t> (m_frameBuffer, type);
+  Put<uint32_t> (m_frameBuffer, data.size ());
+  m_frameBuffer.insert (m_frameBuffer.end (), data.begin (), data.end ());
+  m_framesQueued++;
+  if (ts != INFINITE_TS)
+    {
+      m_pendingFrames.push_back (std::make_pair (m_framesQueued, ts));
+    }
+}
+
+void
+OptimisticSimulatorImpl::WriteWorkerFrames (void)
+{
+#ifdef NS3_MPI
+  std::size_t written = 0;
+  while (written < m_frameBuffer.size ())
+    {
+      ssize_t n = write (m_toWorker[1], &m_frameBuffer[written], m_frameBuffer.size () - written);
+      if (n <= 0)
+        {
+          break;
+        }
+      written += n;
+    }
+  m_frameBuffer.erase (m_frameBuffer.begin (), m_frameBuffer.begin () + written);
+#endif
+}
+
+void
+OptimisticSimulatorImpl::ReadWorkerFrames (void)
+{
+#ifdef NS3_MPI
+  uint8_t chunk[65536];
+  ssize_t n;
+  while ((n = read (m_toRank[0], chunk, sizeof (chunk))) > 0)
+    {
+      m_workerBuffer.insert (m_workerBuffer.end (), chunk, chunk + n);
+    }
+
+  std::size_t offset = 0;
+  while (m_workerBuffer.size () - offset >= 2 * sizeof (uint32_t))
+    {
+      const uint8_t *p = &m_workerBuffer[offset];
+      uint32_t type = Get<uint32_t> (p);
+      uint32_t size = Get<uint32_t> (p);
+      if (m_workerBuffer.size () - offset < 2 * sizeof (uint32_t) + size)
+        {
+          break;
+        }
+      offset += 2 * sizeof (uint32_t) + size;
+      if (type == ROLLBACK_FRAME)
+        {
+          // The worker is waiting to be killed and wrote nothing after this
+          NS_ASSERT (offset == m_workerBuffer.size ());
+          uint64_t ts = Get<uint64_t> (p);
+          uint64_t events = Get<uint64_t> (p);
+          m_workerBuffer.clear ();
+          Rollback (ts, events);
+          return;
+        }
+      HandleWorkerFrame (type, p, size);
+    }
+  m_workerBuffer.erase (m_workerBuffer.begin (), m_workerBuffer.begin () + offset);
+#endif
+}
+
+void
+OptimisticSimulatorImpl::HandleWorkerFrame (uint32_t type, const uint8_t *data, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << type << size);
+
+  const uint8_t *end = data + size;
+  switch (type)
+    {
+    case PACKET_FRAME:
+      {
+        uint64_t ts = Get<uint64_t> (data);
+        uint64_t sendTs = Get<uint64_t> (data);
+        uint32_t dest = Get<uint32_t> (data);
+        // Lazy cancellation: a rolled back packet sent again unchanged
+        // is neither cancelled nor sent twice
+        uint64_t hash = Hash64 (reinterpret_cast<const char *> (data), end - data);
+        for (std::deque<Output>::iterator it = m_lazy.begin (); it != m_lazy.end (); ++it)
+          {
+            if (it->dest == dest && it->ts == ts && it->sendTs == sendTs && it->hash == hash)
+              {
+                Output output = *it;
+                m_lazy.erase (it);
+                output.position = m_position++;
+                if (!output.sent)
+                  {
+                    SendOutput (output);
+                  }
+                m_outputs.push_back (output);
+                return;
+              }
+          }
+        // Events older than the GVT are committed, they may be executed
+        // again after a rollback but must send the same packets
+        NS_ABORT_MSG_IF (sendTs < m_gvt, "Events older than the GVT sent other packets when executed again");
+
+        Output output;
+        output.position = m_position++;
+        output.id = m_nextId++;
+        output.dest = dest;
+        output.ts = ts;
+        output.sendTs = sendTs;
+        output.hash = hash;
+        output.sent = false;
+        output.data.reserve (2 * sizeof (uint64_t) + (end - data));
+        Put<uint64_t> (output.data, output.id);
+        Put<uint64_t> (output.data, ts);
+        output.data.insert (output.data.end (), data, end);
+        SendOutput (output);
+        m_outputs.push_back (output);
+        break;
+      }
+    case SNAPSHOT_FRAME:
+      {
+        Snapshot snapshot;
+        snapshot.pid = Get<uint64_t> (data);
+        snapshot.limit = Get<uint64_t> (data);
+        snapshot.seq = Get<uint64_t> (data);
+        snapshot.events = Get<uint64_t> (data);
+        snapshot.stopTs = Get<uint64_t> (data);
+        snapshot.position = m_position;
+        NS_LOG_LOGIC ("snapshot " << snapshot.pid << " from " << snapshot.limit);
+        m_snapshots.push_back (snapshot);
+        break;
+      }
+    case STATUS_FRAME:
+      {
+        m_workerLvt = Get<uint64_t> (data);
+        uint64_t frames = Get<uint64_t> (data);
+        Get<uint64_t> (data);
+        m_workerStopTs = Get<uint64_t> (data);
+        while (!m_pendingFrames.empty () && m_pendingFrames.front ().first <= frames)
+          {
+            m_pendingFrames.pop_front ();
+          }
+        // The rolled back packets the worker did not send again are cancelled
+        std::deque<Output>::iterator it = m_lazy.begin ();
+        while (it != m_lazy.end ())
+          {
+            if (it->sendTs < m_workerLvt || m_workerLvt > m_workerStopTs)
+              {
+                NS_ABORT_MSG_IF (it->sendTs < m_gvt, "Events older than the GVT did not send a packet when executed again");
+                if (it->sent)
+                  {
+                    AntiMessage anti;
+                    anti.dest = it->dest;
+                    anti.id = it->id;
+                    anti.ts = it->ts;
+                    m_antiMessages++;
+                    SendAntiMessage (anti);
+                  }
+                it = m_lazy.erase (it);
+              }
+            else
+              {
+                ++it;
+              }
+          }
+        break;
+      }
+    default:
+      NS_FATAL_ERROR ("Unexpected frame " << type << " from the worker");
+    }
+}
+
+void
+OptimisticSimulatorImpl::SendOutput (Output &output)
+{
+  if (m_gvtPhase != GVT_IDLE)
+    {
+      output.sent = false;
+      return;
+    }
+  OptimisticMpiInterface::Send (output.dest, OptimisticMpiInterface::PACKET_TAG, output.data);
+  output.data.clear ();
+  output.sent = true;
+  m_sentCount++;
+}
+
+void
+OptimisticSimulatorImpl::SendAntiMessage (const AntiMessage &anti)
+{
+  if (m_gvtPhase != GVT_IDLE)
+    {
+      m_heldAntiMessages.push_back (anti);
+      return;
+    }
+  std::vector<uint8_t> data;
+  Put<uint64_t> (data, anti.id);
+  Put<uint64_t> (data, anti.ts);
+  OptimisticMpiInterface::Send (anti.dest, OptimisticMpiInterface::ANTI_MESSAGE_TAG, data);
+  m_sentCount++;
+}
+
+void
+OptimisticSimulatorImpl::Rollback (uint64_t ts, uint64_t events)
+{
+  NS_LOG_FUNCTION (this << ts << events);
+
+#ifdef NS3_MPI
+  // The latest snapshot which executed no event at or after the straggler
+  std::deque<Snapshot>::iterator s = m_snapshots.end ();
+  while (s != m_snapshots.begin ())
+    {
+      --s;
+      if (s->limit <= ts)
+        {
+          break;
+        }
+    }
+  NS_ABORT_MSG_IF (s == m_snapshots.end () || s->limit > ts, "No snapshot to roll back to " << ts);
+  Snapshot snapshot = *s;
+  NS_LOG_LOGIC ("rollback to " << ts << " from snapshot " << snapshot.pid << " at " << snapshot.limit);
+  m_rollbacks++;
+  m_rolledBackEvents += events - snapshot.events;
+
+  // The snapshot resumes in place of the worker and snapshots itself again.
+  // Waiting for the worker ensures the snapshot has been adopted by this
+  // process, which reaps it in turn.
+  kill (m_worker, SIGKILL);
+  while (waitpid (m_worker, 0, 0) < 0 && errno == EINTR)
+    {
+    }
+  for (std::deque<Snapshot>::iterator it = s + 1; it != m_snapshots.end (); ++it)
+    {
+      Kill (it->pid);
+    }
+  m_snapshots.erase (s, m_snapshots.end ());
+
+  // Discard the frames the killed worker did not read
+  uint8_t chunk[65536];
+  while (read (m_toWorker[0], chunk, sizeof (chunk)) > 0)
+    {
+    }
+  m_frameBuffer.clear ();
+  m_pendingFrames.clear ();
+  m_framesQueued = 0;
+
+  // The packets sent after the snapshot are cancelled unless the snapshot
+  // sends them again. Those still held are kept as well: they may be part
+  // of the GVT being computed, so they are only sent if sent again.
+  while (!m_outputs.empty () && m_outputs.back ().position >= snapshot.position)
+    {
+      m_lazy.push_front (m_outputs.back ());
+      m_outputs.pop_back ();
+    }
+
+  // Replay the packets received after the snapshot and cancel those it
+  // may have scheduled
+  for (std::map<uint64_t, Input>::const_iterator it = m_inputs.begin (); it != m_inputs.end (); ++it)
+    {
+      if (it->first <= snapshot.seq)
+        {
+          if (it->second.cancelled)
+            {
+              std::vector<uint8_t> data;
+              Put<uint64_t> (data, it->first);
+              QueueFrame (CANCEL_FRAME, data, it->second.ts);
+            }
+        }
+      else if (!it->second.cancelled)
+        {
+          QueueInput (it->first, it->second);
+        }
+    }
+  QueueFrame (REPLAY_FRAME, std::vector<uint8_t> (), INFINITE_TS);
+
+  m_workerLvt = snapshot.limit > 0 ? snapshot.limit - 1 : 0;
+  m_workerStopTs = snapshot.stopTs;
+  m_worker = snapshot.pid;
+  kill (m_worker, SIGUSR1);
+#endif
+}
+
+uint64_t
+OptimisticSimulatorImpl::GetLocalMinimum (void) const
+{
+  uint64_t minimum = m_workerLvt <= m_workerStopTs ? m_workerLvt : INFINITE_TS;
+  for (std::deque<std::pair<uint64_t, uint64_t> >::const_iterator it = m_pendingFrames.begin ();
+       it != m_pendingFrames.end (); ++it)
+    {
+      if (it->second <= m_workerStopTs)
+        {
+          minimum = std::min (minimum, it->second);
+        }
+    }
+  for (std::deque<Output>::const_iterator it = m_outputs.begin (); it != m_outputs.end (); ++it)
+    {
+      if (!it->sent)
+        {
+          minimum = std::min (minimum, it->ts);
+        }
+    }
+  for (std::deque<Output>::const_iterator it = m_lazy.begin (); it != m_lazy.end (); ++it)
+    {
+      minimum = std::min (minimum, it->ts);
+    }
+  for (std::vector<AntiMessage>::const_iterator it = m_heldAntiMessages.begin ();
+       it != m_heldAntiMessages.end (); ++it)
+    {
+      minimum = std::min (minimum, it->ts);
+    }
+  return minimum;
+}
+
+void
+OptimisticSimulatorImpl::UpdateGvt (void)
+{
+#ifdef NS3_MPI
+  int64_t result;
+  switch (m_gvtPhase)
+    {
+    case GVT_IDLE:
+      {
+        struct timespec now;
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        int64_t nowMs = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+        if (nowMs - m_lastGvtMs < m_gvtInterval.GetMilliSeconds ())
+          {
+            return;
+          }
+        // Sending is held until the GVT is known, so that the messages in
+        // transit can be counted
+        m_gvtPhase = GVT_COUNT;
+        OptimisticMpiInterface::StartReduce (m_sentCount - m_receivedCount, false);
+        return;
+      }
+    case GVT_COUNT:
+      if (!OptimisticMpiInterface::TestReduce (result))
+        {
+          return;
+        }
+      if (result != 0)
+        {
+          OptimisticMpiInterface::StartReduce (m_sentCount - m_receivedCount, false);
+          return;
+        }
+      m_gvtPhase = GVT_MIN;
+      OptimisticMpiInterface::StartReduce (GetLocalMinimum (), true);
+      return;
+    case GVT_MIN:
+      {
+        if (!OptimisticMpiInterface::TestReduce (result))
+          {
+            return;
+          }
+        struct timespec now;
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        m_lastGvtMs = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+        m_gvtPhase = GVT_IDLE;
+        // A worker executing again events older than the GVT does not move it back
+        m_gvt = std::max (m_gvt, static_cast<uint64_t> (result));
+        NS_LOG_LOGIC ("gvt " << m_gvt);
+
+        for (std::deque<Output>::iterator it = m_outputs.begin (); it != m_outputs.end (); ++it)
+          {
+            if (!it->sent)
+              {
+                SendOutput (*it);
+              }
+          }
+        std::vector<AntiMessage> held;
+        held.swap (m_heldAntiMessages);
+        for (std::vector<AntiMessage>::const_iterator it = held.begin (); it != held.end (); ++it)
+          {
+            SendAntiMessage (*it);
+          }
+
+        CollectFossils ();
+        if (m_gvt == INFINITE_TS)
+          {
+            m_end = true;
+            return;
+          }
+        std::vector<uint8_t> data;
+        Put<uint64_t> (data, m_gvt);
+        QueueFrame (GVT_FRAME, data, INFINITE_TS);
+        return;
+      }
+    }
+#endif
+}
+
+void
+OptimisticSimulatorImpl::CollectFossils (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  // Keep the latest snapshot no straggler can be older than
+  std::size_t base = 0;
+  for (std::size_t i = 0; i < m_snapshots.size (); i++)
+    {
+      if (m_snapshots[i].limit <= m_gvt)
+        {
+          base = i;
+        }
+    }
+  for (std::size_t i = 0; i < base; i++)
+    {
+      Kill (m_snapshots[i].pid);
+    }
+  m_snapshots.erase (m_snapshots.begin (), m_snapshots.begin () + base);
+  if (m_snapshots.empty ())
+    {
+      return;
+    }
+
+  // The packets read by the oldest snapshot are released once they can no
+  // longer be cancelled, but a cancelled packet it may not have executed
+  // yet must still be cancelled again after a rollback
+  const Snapshot &oldest = m_snapshots.front ();
+  std::map<uint64_t, Input>::iterator it = m_inputs.begin ();
+  while (it != m_inputs.end () && it->first <= oldest.seq)
+    {
+      if (it->second.ts < (it->second.cancelled ? oldest.limit : m_gvt))
+        {
+          m_inputIds.erase (std::make_pair (it->second.source, it->second.id));
+          m_inputs.erase (it++);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+  while (!m_outputs.empty () && m_outputs.front ().position < oldest.position)
+    {
+      m_outputs.pop_front ();
+    }
+#endif
+}
+
+uint32_t
+OptimisticSimulatorImpl::GetSystemId () const
+{
+  return m_myId;
+}
+
+void
+OptimisticSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Events after the current one are not executed
+  if (m_currentTs < m_stopTs || (m_currentTs == m_stopTs && m_currentUid < m_stopUid))
+    {
+      m_stopTs = m_currentTs;
+      m_stopUid = m_currentUid + 1;
+    }
+}
+
+void
+OptimisticSimulatorImpl::Stop (Time const &delay)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep ());
+
+  // Stop as an event scheduled now would, without the event, which would
+  // be undone by the rollbacks like any other
+  uint64_t ts = m_currentTs + delay.GetTimeStep ();
+  uint32_t uid = m_uid++;
+  if (ts < m_stopTs || (ts == m_stopTs && uid < m_stopUid))
+    {
+      m_stopTs = ts;
+      m_stopUid = uid;
+    }
+}
+
+//
+// Schedule an event for a _relative_ time in the future.
+//
+EventId
+OptimisticSimulatorImpl::Schedule (Time const &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep () << event);
+
+  Time tAbsolute = delay + TimeStep (m_currentTs);
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= TimeStep (m_currentTs));
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = static_cast<uint64_t> (tAbsolute.GetTimeStep ());
+  ev.key.m_context = GetContext ();
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+OptimisticSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << delay.GetTimeStep () << m_currentTs << event);
+
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = m_currentTs + delay.GetTimeStep ();
+  ev.key.m_context = context;
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+}
+
+EventId
+OptimisticSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << event);
+
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = m_currentTs;
+  ev.key.m_context = GetContext ();
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+EventId
+OptimisticSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << event);
+
+  EventId id (Ptr<EventImpl> (event, false), m_currentTs, 0xffffffff, 2);
+  m_destroyEvents.push_back (id);
+  m_uid++;
+  return id;
+}
+
+Time
+OptimisticSimulatorImpl::Now (void) const
+{
+  return TimeStep (m_currentTs);
+}
+
+Time
+OptimisticSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - m_currentTs);
+    }
+}
+
+void
+OptimisticSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  m_events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+
+  m_unscheduledEvents--;
+}
+
+void
+OptimisticSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+OptimisticSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0
+          || id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (id.PeekEventImpl () == 0
+      || id.GetTs () < m_currentTs
+      || (id.GetTs () == m_currentTs
+          && id.GetUid () <= m_currentUid)
+      || id.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+OptimisticSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (INFINITE_TS);
+}
+
+uint32_t
+OptimisticSimulatorImpl::GetContext (void) const
+{
+  return m_currentContext;
+}
+
+uint64_t
+OptimisticSimulatorImpl::GetEventCount (void) const
+{
+  return m_eventCount;
+}
+
+uint64_t
+OptimisticSimulatorImpl::GetRollbackCount (void) const
+{
+  return m_rollbacks;
+}
+
+uint64_t
+OptimisticSimulatorImpl::GetRolledBackEventCount (void) const
+{
+  return m_rolledBackEvents;
+}
+
+uint64_t
+OptimisticSimulatorImpl::GetAntiMessageCount (void) const
+{
+  return m_antiMessages;
+}
+
+} // namespace ns3
@@ -0,0 +1,613 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/config.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/mpi-receiver.h"
+#include "ns3/optimistic-simulator-impl.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+/*
+ * The optimistic simulator needs several MPI ranks. Each test case runs
+ * the test runner again under mpirun, with its scenario in the
+ * NS3_OPTIMISTIC_SCENARIO environment variable. The ranks only run the
+ * test case of that scenario, which writes the committed results of each
+ * rank to a file. The test case then compares them with a sequential run
+ * of the same model.
+ */
+
+namespace {
+
+/** Number of ranks of the runs */
+const uint32_t N_RANKS = 2;
+/** Number of nodes of the model */
+const uint32_t N_NODES = 8;
+
+} // unnamed namespace
+
+/**
+ * \ingroup mpi
+ *
+ * \brief PHOLD without channels: a node holding a job for an exponential
+ * time forwards it to a random node, which may be on another rank.
+ *
+ * The node i is on the rank i % N_RANKS. Each node draws from its own
+ * random streams, so the receptions of the nodes do not depend on the
+ * simulator implementation. Optionally, the nodes of a rank ignore their
+ * events after a time, as the rank does once stopped by an event.
+ */
+class OptimisticPhold
+{
+public:
+  /**
+   * \param delay the delay of the packets
+   * \param distributed false to run every node in this process
+   */
+  OptimisticPhold (Time delay, bool distributed);
+
+  /**
+   * Start the jobs of the nodes of this rank
+   */
+  void Start (void);
+
+  /**
+   * Stop the rank of a node from one of its events
+   *
+   * \param node the node
+   * \param time the time of the event
+   */
+  void StopFrom (uint32_t node, Time time);
+
+  /**
+   * In a sequential run, ignore the events of the nodes of a rank after a
+   * time, as that rank does once stopped
+   *
+   * \param rank the rank
+   * \param time the time
+   */
+  void IgnoreAfter (uint32_t rank, Time time);
+
+  /**
+   * \param node a node
+   * \return whether the node is run by this process
+   */
+  bool IsLocal (uint32_t node) const;
+
+  std::vector<uint64_t> m_received;  //!< receptions of each node
+  std::vector<uint64_t> m_checksum;  //!< checksum of the reception times of each node
+  std::string m_destroyFile;         //!< file the destroy events of StopFrom append to
+
+private:
+  /**
+   * \param node the node
+   * \return whether the events of the node are ignored
+   */
+  bool IsIgnored (uint32_t node) const;
+  /**
+   * Forward a job from a node
+   * \param node the node
+   */
+  void Forward (uint32_t node);
+  /**
+   * Receive a job
+   * \param node the node
+   */
+  void Receive (uint32_t node);
+  /**
+   * Receive a job from another rank, in the context of its node
+   * \param p the packet
+   */
+  void ReceiveRemote (Ptr<Packet> p);
+  /**
+   * Stop the rank and schedule a destroy event
+   */
+  void StopNow (void);
+  /**
+   * Record the destroy event
+   */
+  void Destroyed (void);
+
+  Time m_delay;                                        //!< delay of the packets
+  bool m_distributed;                                  //!< whether the nodes are split over the ranks
+  uint32_t m_rank;                                     //!< rank of this process
+  std::vector<Ptr<Node> > m_nodes;                     //!< the nodes
+  std::vector<Ptr<ExponentialRandomVariable> > m_hold; //!< holding times of each node
+  std::vector<Ptr<UniformRandomVariable> > m_next;     //!< destinations of each node
+  uint32_t m_ignoredRank;                              //!< rank whose late events are ignored
+  Time m_ignoreAfter;                                  //!< time after which they are ignored
+};
+
+OptimisticPhold::OptimisticPhold (Time delay, bool distributed)
+  : m_received (N_NODES, 0),
+    m_checksum (N_NODES, 0),
+    m_delay (delay),
+    m_distributed (distributed),
+    m_rank (distributed ? MpiInterface::GetSystemId () : 0),
+    m_ignoredRank (N_RANKS),
+    m_ignoreAfter (Simulator::GetMaximumSimulationTime ())
+{
+  for (uint32_t i = 0; i < N_NODES; i++)
+    {
+      Ptr<Node> node = CreateObject<Node> (i % N_RANKS);
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      node->AddDevice (device);
+      Ptr<MpiReceiver> receiver = CreateObject<MpiReceiver> ();
+      receiver->SetReceiveCallback (MakeCallback (&OptimisticPhold::ReceiveRemote, this));
+      device->AggregateObject (receiver);
+      m_nodes.push_back (node);
+
+      Ptr<ExponentialRandomVariable> hold = CreateObject<ExponentialRandomVariable> ();
+      hold->SetAttribute ("Mean", DoubleValue (0.001));
+      hold->SetStream (2 * i);
+      m_hold.push_back (hold);
+      Ptr<UniformRandomVariable> next = CreateObject<UniformRandomVariable> ();
+      next->SetStream (2 * i + 1);
+      m_next.push_back (next);
+    }
+}
+
+void
+OptimisticPhold::Start (void)
+{
+  for (uint32_t i = 0; i < N_NODES; i++)
+    {
+      if (IsLocal (i))
+        {
+          for (uint32_t j = 0; j < 4; j++)
+            {
+              Simulator::ScheduleWithContext (i, Seconds (m_hold[i]->GetValue ()), &OptimisticPhold::Forward, this, i);
+            }
+        }
+    }
+}
+
+void
+OptimisticPhold::StopFrom (uint32_t node, Time time)
+{
+  if (IsLocal (node))
+    {
+      Simulator::ScheduleWithContext (node, time, &OptimisticPhold::StopNow, this);
+    }
+}
+
+void
+OptimisticPhold::IgnoreAfter (uint32_t rank, Time time)
+{
+  m_ignoredRank = rank;
+  m_ignoreAfter = time;
+}
+
+bool
+OptimisticPhold::IsLocal (uint32_t node) const
+{
+  return !m_distributed || node % N_RANKS == m_rank;
+}
+
+bool
+OptimisticPhold::IsIgnored (uint32_t node) const
+{
+  return node % N_RANKS == m_ignoredRank && Simulator::Now () > m_ignoreAfter;
+}
+
+void
+OptimisticPhold::Forward (uint32_t node)
+{
+  if (IsIgnored (node))
+    {
+      return;
+    }
+  uint32_t next = (node + m_next[node]->GetInteger (1, N_NODES - 1)) % N_NODES;
+  if (IsLocal (next))
+    {
+      Simulator::ScheduleWithContext (next, m_delay, &OptimisticPhold::Receive, this, next);
+    }
+  else
+    {
+      MpiInterface::SendPacket (Create<Packet> (16), Simulator::Now () + m_delay, next, 0);
+    }
+}
+
+void
+OptimisticPhold::Receive (uint32_t node)
+{
+  if (IsIgnored (node))
+    {
+      return;
+    }
+  m_received[node]++;
+  m_checksum[node] += Simulator::Now ().GetNanoSeconds ();
+  Simulator::Schedule (Seconds (m_hold[node]->GetValue ()), &OptimisticPhold::Forward, this, node);
+}
+
+void
+OptimisticPhold::ReceiveRemote (Ptr<Packet> p)
+{
+  Receive (Simulator::GetContext ());
+}
+
+void
+OptimisticPhold::StopNow (void)
+{
+  Simulator::Stop ();
+  Simulator::ScheduleDestroy (&OptimisticPhold::Destroyed, this);
+}
+
+void
+OptimisticPhold::Destroyed (void)
+{
+  std::ofstream out (m_destroyFile.c_str (), std::ios::app);
+  out << "destroyed" << std::endl;
+}
+
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Check a scenario of the optimistic simulator on several ranks
+ * against a sequential run
+ */
+class MpiOptimisticTestCase : public TestCase
+{
+public:
+  /// The scenarios
+  enum Scenario
+  {
+    ROLLBACK,  //!< rollbacks and anti-messages
+    GVT,       //!< a short optimism window, which needs the GVT to progress
+    STOP,      //!< Stop and ScheduleDestroy from an event of a rank
+    TRACE      //!< Run with an ascii trace file open
+  };
+
+  /**
+   * \param scenario the scenario
+   * \param name the name of the test case
+   */
+  MpiOptimisticTestCase (Scenario scenario, std::string name);
+  virtual ~MpiOptimisticTestCase ();
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  /**
+   * Run the scenario as a rank of mpirun
+   *
+   * \param results the prefix of the result files
+   */
+  void RunRank (std::string results);
+  /**
+   * Run the scenario under mpirun
+   *
+   * \param results the prefix of the result files
+   * \param log the file of the output of mpirun
+   * \return the exit status of mpirun, or -1 if mpirun is not available
+   */
+  int RunMpi (std::string results, std::string log);
+
+  /// The results of a rank
+  struct Results
+  {
+    std::vector<uint64_t> received;  //!< receptions of each node of the rank
+    std::vector<uint64_t> checksum;  //!< checksum of each node of the rank
+    uint64_t rollbacks;              //!< rollbacks
+    uint64_t antiMessages;           //!< anti-messages sent
+    int64_t now;                     //!< time at the end of the run (ns)
+    uint32_t destroyed;              //!< destroy events run
+  };
+
+  /**
+   * \param filename the file written by a rank
+   * \param results the results read
+   * \return whether the file could be read
+   */
+  static bool ReadResults (std::string filename, Results &results);
+
+  Scenario m_scenario;  //!< the scenario
+};
+
+/** Environment variable selecting the scenario run by the ranks */
+static const char *SCENARIO_VARIABLE = "NS3_OPTIMISTIC_SCENARIO";
+/** Environment variable holding the prefix of the result files */
+static const char *RESULTS_VARIABLE = "NS3_OPTIMISTIC_RESULTS";
+/** Time of the Stop () of the STOP scenario */
+static const Time STOP_TIME = MilliSeconds (50);
+/** Node of the Stop () of the STOP scenario */
+static const uint32_t STOP_NODE = 1;
+
+MpiOptimisticTestCase::MpiOptimisticTestCase (Scenario scenario, std::string name)
+  : TestCase (name),
+    m_scenario (scenario)
+{
+}
+
+MpiOptimisticTestCase::~MpiOptimisticTestCase ()
+{
+}
+
+void
+MpiOptimisticTestCase::RunRank (std::string results)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::OptimisticSimulatorImpl"));
+  Config::SetDefault ("ns3::OptimisticSimulatorImpl::SnapshotInterval", UintegerValue (64));
+  if (m_scenario == GVT)
+    {
+      Config::SetDefault ("ns3::OptimisticSimulatorImpl::OptimismWindow", TimeValue (MilliSeconds (1)));
+      Config::SetDefault ("ns3::OptimisticSimulatorImpl::GvtInterval", TimeValue (MilliSeconds (1)));
+    }
+  int argc = 1;
+  char name[] = "test-runner";
+  char *args[] = { name, 0 };
+  char **argv = args;
+  MpiInterface::Enable (&argc, &argv);
+
+  std::ostringstream filename;
+  filename << results << "-" << MpiInterface::GetSystemId ();
+  OptimisticPhold phold (MicroSeconds (1), true);
+  phold.m_destroyFile = filename.str ();
+  phold.Start ();
+  if (m_scenario == STOP)
+    {
+      phold.StopFrom (STOP_NODE, STOP_TIME);
+    }
+  Ptr<OutputStreamWrapper> trace;
+  if (m_scenario == TRACE)
+    {
+      trace = Create<OutputStreamWrapper> (filename.str () + ".tr", std::ios::out);
+    }
+  Simulator::Stop (MilliSeconds (200));
+  Simulator::Run ();
+
+  // Only the worker returns, with the committed state
+  Ptr<OptimisticSimulatorImpl> impl = DynamicCast<OptimisticSimulatorImpl> (Simulator::GetImplementation ());
+  {
+    std::ofstream out (filename.str ().c_str ());
+    for (uint32_t i = 0; i < N_NODES; i++)
+      {
+        if (phold.IsLocal (i))
+          {
+            out << "node " << i << " " << phold.m_received[i] << " " << phold.m_checksum[i] << std::endl;
+          }
+      }
+    out << "rollbacks " << impl->GetRollbackCount () << std::endl;
+    out << "anti " << impl->GetAntiMessageCount () << std::endl;
+    out << "now " << Simulator::Now ().GetNanoSeconds () << std::endl;
+  }
+  Simulator::Destroy ();
+  MpiInterface::Disable ();
+}
+
+int
+MpiOptimisticTestCase::RunMpi (std::string results, std::string log)
+{
+  if (std::system ("mpirun --version > /dev/null 2>&1") != 0)
+    {
+      return -1;
+    }
+  char exe[4096];
+  ssize_t n = readlink ("/proc/self/exe", exe, sizeof (exe) - 1);
+  if (n <= 0)
+    {
+      return -1;
+    }
+  exe[n] = 0;
+
+  std::ostringstream scenario;
+  scenario << m_scenario;
+  setenv (SCENARIO_VARIABLE, scenario.str ().c_str (), 1);
+  setenv (RESULTS_VARIABLE, results.c_str (), 1);
+  std::ostringstream command;
+  command << "mpirun";
+#ifdef NS3_OPENMPI
+  command << " --oversubscribe -x " << SCENARIO_VARIABLE << " -x " << RESULTS_VARIABLE;
+  if (getuid () == 0)
+    {
+      command << " --allow-run-as-root";
+    }
+#endif
+  command << " -np " << N_RANKS << " '" << exe << "' --suite=" << GetParent ()->GetName ()
+          << " > '" << log << "' 2>&1";
+  int status = std::system (command.str ().c_str ());
+  unsetenv (SCENARIO_VARIABLE);
+  unsetenv (RESULTS_VARIABLE);
+  return WIFEXITED (status) ? WEXITSTATUS (status) : 128;
+}
+
+bool
+MpiOptimisticTestCase::ReadResults (std::string filename, Results &results)
+{
+  std::ifstream in (filename.c_str ());
+  if (!in)
+    {
+      return false;
+    }
+  results.received.assign (N_NODES, 0);
+  results.checksum.assign (N_NODES, 0);
+  results.rollbacks = 0;
+  results.antiMessages = 0;
+  results.now = -1;
+  results.destroyed = 0;
+  std::string key;
+  while (in >> key)
+    {
+      if (key == "node")
+        {
+          uint32_t i;
+          in >> i;
+          in >> results.received[i] >> results.checksum[i];
+        }
+      else if (key == "rollbacks")
+        {
+          in >> results.rollbacks;
+        }
+      else if (key == "anti")
+        {
+          in >> results.antiMessages;
+        }
+      else if (key == "now")
+        {
+          in >> results.now;
+        }
+      else if (key == "destroyed")
+        {
+          results.destroyed++;
+        }
+    }
+  return true;
+}
+
+void
+MpiOptimisticTestCase::DoRun (void)
+{
+  const char *scenario = std::getenv (SCENARIO_VARIABLE);
+  if (scenario != 0)
+    {
+      // A rank of mpirun runs only the scenario it was started for
+      std::ostringstream mine;
+      mine << m_scenario;
+      if (mine.str () == scenario)
+        {
+          RunRank (std::getenv (RESULTS_VARIABLE));
+        }
+      return;
+    }
+
+  std::string results = CreateTempDirFilename ("optimistic");
+  std::string log = CreateTempDirFilename ("mpirun.log");
+  int status = RunMpi (results, log);
+  if (status < 0)
+    {
+      std::cerr << GetName () << ": mpirun not found, not checked" << std::endl;
+      return;
+    }
+
+  if (m_scenario == TRACE)
+    {
+      std::ifstream in (log.c_str ());
+      std::string output ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+      NS_TEST_EXPECT_MSG_NE (status, 0, "Run with a trace file open succeeded");
+      NS_TEST_EXPECT_MSG_NE (output.find ("trace files open"), std::string::npos,
+                             "Run did not report the trace file");
+      return;
+    }
+  NS_TEST_ASSERT_MSG_EQ (status, 0, "mpirun failed, see " << log);
+
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  OptimisticPhold reference (MicroSeconds (1), false);
+  reference.Start ();
+  if (m_scenario == STOP)
+    {
+      reference.IgnoreAfter (STOP_NODE % N_RANKS, STOP_TIME);
+    }
+  Simulator::Stop (MilliSeconds (200));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  uint64_t rollbacks = 0;
+  uint64_t antiMessages = 0;
+  uint64_t received = 0;
+  for (uint32_t rank = 0; rank < N_RANKS; rank++)
+    {
+      std::ostringstream filename;
+      filename << results << "-" << rank;
+      Results r;
+      NS_TEST_ASSERT_MSG_EQ (ReadResults (filename.str (), r), true, "No results from rank " << rank);
+      for (uint32_t i = rank; i < N_NODES; i += N_RANKS)
+        {
+          NS_TEST_EXPECT_MSG_EQ (r.received[i], reference.m_received[i], "Receptions differ at node " << i);
+          NS_TEST_EXPECT_MSG_EQ (r.checksum[i], reference.m_checksum[i], "Reception times differ at node " << i);
+          received += r.received[i];
+        }
+      rollbacks += r.rollbacks;
+      antiMessages += r.antiMessages;
+      bool stopped = m_scenario == STOP && rank == STOP_NODE % N_RANKS;
+      NS_TEST_EXPECT_MSG_EQ (r.destroyed, (stopped ? 1 : 0), "Unexpected destroy events on rank " << rank);
+      if (stopped)
+        {
+          NS_TEST_EXPECT_MSG_EQ (r.now, STOP_TIME.GetNanoSeconds (), "Rank " << rank << " did not stop at the Stop event");
+        }
+      else
+        {
+          NS_TEST_EXPECT_MSG_LT_OR_EQ (r.now, MilliSeconds (200).GetNanoSeconds (), "Rank " << rank << " ran past the stop time");
+        }
+      remove (filename.str ().c_str ());
+    }
+  NS_TEST_EXPECT_MSG_GT (received, 1000, "Too few jobs to check the synchronization");
+  if (m_scenario == ROLLBACK)
+    {
+      NS_TEST_EXPECT_MSG_GT (rollbacks, 0, "No rollback, the scenario checks nothing");
+      NS_TEST_EXPECT_MSG_GT (antiMessages, 0, "No anti-message, the scenario checks nothing");
+    }
+  remove (log.c_str ());
+}
+
+void
+MpiOptimisticTestCase::DoTeardown (void)
+{
+  Config::Reset ();
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Test suite of the optimistic simulator
+ */
+class MpiOptimisticTestSuite : public TestSuite
+{
+public:
+  MpiOptimisticTestSuite ();
+};
+
+MpiOptimisticTestSuite::MpiOptimisticTestSuite ()
+  : TestSuite ("mpi-optimistic", SYSTEM)
+{
+  AddTestCase (new MpiOptimisticTestCase (MpiOptimisticTestCase::ROLLBACK,
+                                          "Check that rollbacks and anti-messages give the sequential results"),
+               TestCase::QUICK);
+  AddTestCase (new MpiOptimisticTestCase (MpiOptimisticTestCase::GVT,
+                                          "Check that the GVT progresses with a short optimism window"),
+               TestCase::QUICK);
+  AddTestCase (new MpiOptimisticTestCase (MpiOptimisticTestCase::STOP,
+                                          "Check Stop and Destroy from an event of a rank"),
+               TestCase::QUICK);
+  AddTestCase (new MpiOptimisticTestCase (MpiOptimisticTestCase::TRACE,
+                                          "Check that Run refuses to run with a trace file open"),
+               TestCase::QUICK);
+}
+
+static MpiOptimisticTestSuite g_mpiOptimisticTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,236 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/nstime.h"
+#include "ns3/mpi-partition-helper.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Check the partitions of graphs with a known minimum cut
+ */
+class MpiPartitionCutTestCase : public TestCase
+{
+public:
+  MpiPartitionCutTestCase ();
+  virtual ~MpiPartitionCutTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MpiPartitionCutTestCase::MpiPartitionCutTestCase ()
+  : TestCase ("Check that the partitions are balanced and cut little traffic")
+{
+}
+
+MpiPartitionCutTestCase::~MpiPartitionCutTestCase ()
+{
+}
+
+void
+MpiPartitionCutTestCase::DoRun (void)
+{
+  // Two dense clusters joined by a single link
+  MpiPartitionHelper clusters;
+  for (uint32_t i = 0; i < 40; i++)
+    {
+      clusters.AddNode ();
+    }
+  for (uint32_t c = 0; c < 2; c++)
+    {
+      for (uint32_t i = 0; i < 20; i++)
+        {
+          for (uint32_t j = i + 1; j < 20; j++)
+            {
+              clusters.AddLink (20 * c + i, 20 * c + j, MicroSeconds (1));
+            }
+        }
+    }
+  clusters.AddLink (5, 25, MilliSeconds (1));
+  std::vector<uint32_t> ranks = clusters.Partition (2);
+  NS_TEST_ASSERT_MSG_EQ (ranks.size (), 40, "One rank per node");
+  NS_TEST_EXPECT_MSG_EQ (clusters.GetCutTraffic (ranks), 1, "Only the link between the clusters should be cut");
+  NS_TEST_EXPECT_MSG_EQ (clusters.GetLookahead (ranks), MilliSeconds (1), "Unexpected lookahead");
+  bool same = clusters.Partition (2) == ranks;
+  NS_TEST_EXPECT_MSG_EQ (same, true, "The partition is not deterministic");
+
+  // A 16x16 grid in 4 partitions, the best cut is 32 links
+  MpiPartitionHelper grid;
+  for (uint32_t i = 0; i < 256; i++)
+    {
+      grid.AddNode ();
+    }
+  for (uint32_t y = 0; y < 16; y++)
+    {
+      for (uint32_t x = 0; x < 16; x++)
+        {
+          if (x + 1 < 16)
+            {
+              grid.AddLink (16 * y + x, 16 * y + x + 1, MicroSeconds (10));
+            }
+          if (y + 1 < 16)
+            {
+              grid.AddLink (16 * y + x, 16 * (y + 1) + x, MicroSeconds (10));
+            }
+        }
+    }
+  ranks = grid.Partition (4);
+  std::vector<uint32_t> sizes (4, 0);
+  for (uint32_t i = 0; i < ranks.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_LT (ranks[i], 4, "Rank out of range");
+      sizes[ranks[i]]++;
+    }
+  for (uint32_t r = 0; r < 4; r++)
+    {
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (sizes[r], 67, "Partition " << r << " too large");
+    }
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (grid.GetCutTraffic (ranks), 48, "Too many links cut");
+}
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Check that the links shorter than the minimum lookahead are not cut
+ */
+class MpiPartitionLookaheadTestCase : public TestCase
+{
+public:
+  MpiPartitionLookaheadTestCase ();
+  virtual ~MpiPartitionLookaheadTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MpiPartitionLookaheadTestCase::MpiPartitionLookaheadTestCase ()
+  : TestCase ("Check that the partitions grant the minimum lookahead")
+{
+}
+
+MpiPartitionLookaheadTestCase::~MpiPartitionLookaheadTestCase ()
+{
+}
+
+void
+MpiPartitionLookaheadTestCase::DoRun (void)
+{
+  // A ring whose every other link is short, but carries little traffic
+  MpiPartitionHelper ring;
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      ring.AddNode ();
+    }
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      if (i % 2 == 0)
+        {
+          ring.AddLink (i, (i + 1) % 64, NanoSeconds (100), 1);
+        }
+      else
+        {
+          ring.AddLink (i, (i + 1) % 64, MicroSeconds (100), 10);
+        }
+    }
+  std::vector<uint32_t> ranks = ring.Partition (4);
+  NS_TEST_EXPECT_MSG_EQ (ring.GetLookahead (ranks), NanoSeconds (100), "The lightest links should be cut");
+
+  ring.SetMinimumLookahead (MicroSeconds (1));
+  ranks = ring.Partition (4);
+  NS_TEST_EXPECT_MSG_EQ (ring.GetLookahead (ranks), MicroSeconds (100), "A short link is cut");
+  std::vector<uint32_t> sizes (4, 0);
+  for (uint32_t i = 0; i < ranks.size (); i++)
+    {
+      sizes[ranks[i]]++;
+    }
+  for (uint32_t r = 0; r < 4; r++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (sizes[r], 16, "Unbalanced partition " << r);
+    }
+}
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Check that the links without delay are never cut
+ */
+class MpiPartitionZeroDelayTestCase : public TestCase
+{
+public:
+  MpiPartitionZeroDelayTestCase ();
+  virtual ~MpiPartitionZeroDelayTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MpiPartitionZeroDelayTestCase::MpiPartitionZeroDelayTestCase ()
+  : TestCase ("Check that the links without delay are not cut without a minimum lookahead")
+{
+}
+
+MpiPartitionZeroDelayTestCase::~MpiPartitionZeroDelayTestCase ()
+{
+}
+
+void
+MpiPartitionZeroDelayTestCase::DoRun (void)
+{
+  // A ring whose every other link has no delay, but carries little traffic
+  MpiPartitionHelper ring;
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      ring.AddNode ();
+    }
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      ring.AddLink (i, (i + 1) % 64, i % 2 == 0 ? Seconds (0) : MicroSeconds (100), i % 2 == 0 ? 1 : 10);
+    }
+  std::vector<uint32_t> ranks = ring.Partition (4);
+  NS_TEST_EXPECT_MSG_EQ (ring.GetLookahead (ranks), MicroSeconds (100), "A link without delay is cut");
+  for (uint32_t i = 0; i < 64; i += 2)
+    {
+      NS_TEST_EXPECT_MSG_EQ (ranks[i], ranks[i + 1], "Nodes " << i << " and " << i + 1 << " split");
+    }
+}
+
+/**
+ * \ingroup mpi
+ *
+ * \brief Test suite of the MPI partition helper
+ */
+class MpiPartitionTestSuite : public TestSuite
+{
+public:
+  MpiPartitionTestSuite ();
+};
+
+MpiPartitionTestSuite::MpiPartitionTestSuite ()
+  : TestSuite ("mpi-partition", UNIT)
+{
+  AddTestCase (new MpiPartitionCutTestCase, TestCase::QUICK);
+  AddTestCase (new MpiPartitionLookaheadTestCase, TestCase::QUICK);
+  AddTestCase (new MpiPartitionZeroDelayTestCase, TestCase::QUICK);
+}
+
+static MpiPartitionTestSuite g_mpiPartitionTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,154 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+// A grid of point-to-point links flooded with packets, run with the
+// default or the multithreaded simulator.
+//
+// The nodes forward every packet they receive on one of their links until
+// its hop count is exhausted. No protocol stack is installed, so the run
+// time is dominated by the simulator and the packets.
+//
+// ./waf --run "mtp-point-to-point --nodes=2000 --threads=8"
+// ./waf --run "mtp-point-to-point --nodes=2000 --mtp=false"
+
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mtp-module.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("MtpPointToPoint");
+
+static std::vector<uint64_t> g_received;   //!< receptions of each node
+
+/**
+ * \param device the sending device
+ * \param hops the remaining hops, sent as the packet size
+ */
+static void
+Forward (Ptr<NetDevice> device, uint32_t hops)
+{
+  device->Send (Create<Packet> (hops), device->GetBroadcast (), 0x0800);
+}
+
+/**
+ * Forward a packet on a link chosen by its hop count
+ *
+ * \param device the receiving device
+ * \param packet the packet
+ * \param protocol the protocol number
+ * \param from the sender address
+ * \return true
+ */
+static bool
+Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from)
+{
+  Ptr<Node> node = device->GetNode ();
+  g_received[node->GetId ()]++;
+  uint32_t hops = packet->GetSize ();
+  if (hops > 1)
+    {
+      Ptr<NetDevice> next = node->GetDevice ((node->GetId () + hops) % node->GetNDevices ());
+      Simulator::Schedule (MicroSeconds (hops % 7), &Forward, next, hops - 1);
+    }
+  return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nNodes = 2000;
+  uint32_t packets = 10;
+  uint32_t hops = 100;
+  uint32_t threads = 0;
+  bool mtp = true;
+  std::string delay = "1ms";
+
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes of the grid", nNodes);
+  cmd.AddValue ("packets", "Packets started by each node", packets);
+  cmd.AddValue ("hops", "Hops of each packet", hops);
+  cmd.AddValue ("threads", "Number of threads, 0 for one per hardware thread", threads);
+  cmd.AddValue ("mtp", "Use the multithreaded simulator", mtp);
+  cmd.AddValue ("delay", "Delay of the links", delay);
+  cmd.Parse (argc, argv);
+
+  if (mtp)
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+      Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (threads));
+    }
+
+  uint32_t columns = std::ceil (std::sqrt (nNodes));
+  NodeContainer nodes;
+  nodes.Create (nNodes);
+  g_received.assign (nNodes, 0);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue (delay));
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      if ((i + 1) % columns != 0 && i + 1 < nNodes)
+        {
+          p2p.Install (nodes.Get (i), nodes.Get (i + 1));
+        }
+      if (i + columns < nNodes)
+        {
+          p2p.Install (nodes.Get (i), nodes.Get (i + columns));
+        }
+    }
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      for (uint32_t j = 0; j < node->GetNDevices (); j++)
+        {
+          node->GetDevice (j)->SetReceiveCallback (MakeCallback (&Receive));
+        }
+      for (uint32_t j = 0; j < packets; j++)
+        {
+          Simulator::ScheduleWithContext (i, MicroSeconds (i + 10 * j), &Forward,
+                                          node->GetDevice (j % node->GetNDevices ()), hops);
+        }
+    }
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  int64_t elapsed = clock.End ();
+
+  uint64_t received = 0;
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      received += g_received[i];
+    }
+  std::cout << "simulated " << Simulator::Now ().GetSeconds () << " s, "
+            << received << " receptions in " << elapsed << " ms" << std::endl;
+  Ptr<MultithreadedSimulatorImpl> impl = DynamicCast<MultithreadedSimulatorImpl> (Simulator::GetImplementation ());
+  if (impl != 0)
+    {
+      std::cout << impl->GetNPartitions () - 1 << " partitions, " << impl->GetNThreads () << " threads, "
+                << impl->GetNWindows () << " windows of lookahead " << impl->GetLookAhead ().GetSeconds () << " s, "
+                << impl->GetEventCount () << " events" << std::endl;
+    }
+  Simulator::Destroy ();
+  return 0;
+}
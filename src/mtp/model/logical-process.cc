@@ -0,0 +1,289 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "logical-process.h"
+#include "ns3/event-impl.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace ns3 {
+
+// Note: logging is avoided in the per event paths, as in
+// DefaultSimulatorImpl
+NS_LOG_COMPONENT_DEFINE ("LogicalProcess");
+
+LogicalProcess::LogicalProcess (uint32_t id, Ptr<Scheduler> scheduler, uint32_t uid)
+  : m_id (id),
+    m_events (scheduler),
+    m_uid (uid),
+    m_currentUid (0),
+    m_currentTs (0),
+    m_currentContext (0xffffffff),
+    m_seq (0),
+    m_eventCount (0),
+    m_packetUid (0)
+{
+  NS_LOG_FUNCTION (this << id << uid);
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      m_mailbox[i].store (0);
+      m_mailboxTs[i].store (std::numeric_limits<uint64_t>::max ());
+    }
+}
+
+LogicalProcess::~LogicalProcess ()
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Message *msg = m_mailbox[i].exchange (0);
+      while (msg != 0)
+        {
+          Message *next = msg->next;
+          msg->ev.impl->Unref ();
+          delete msg;
+          msg = next;
+        }
+    }
+  while (!m_events->IsEmpty ())
+    {
+      Scheduler::Event next = m_events->RemoveNext ();
+      next.impl->Unref ();
+    }
+  m_events = 0;
+}
+
+uint32_t
+LogicalProcess::GetId (void) const
+{
+  return m_id;
+}
+
+void
+LogicalProcess::SetScheduler (Ptr<Scheduler> scheduler)
+{
+  NS_LOG_FUNCTION (this << scheduler);
+  while (!m_events->IsEmpty ())
+    {
+      scheduler->Insert (m_events->RemoveNext ());
+    }
+  m_events = scheduler;
+}
+
+EventId
+LogicalProcess::Schedule (uint64_t ts, uint32_t context, EventImpl *event)
+{
+  NS_ASSERT (ts >= m_currentTs);
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+LogicalProcess::Insert (const Scheduler::Event &ev)
+{
+  m_events->Insert (ev);
+  m_uid = std::max (m_uid, ev.key.m_uid + 1);
+}
+
+void
+LogicalProcess::Send (uint32_t slot, uint64_t ts, uint32_t context, EventImpl *event,
+                      uint32_t sender, uint64_t seq)
+{
+  Message *msg = new Message;
+  msg->ev.impl = event;
+  msg->ev.key.m_ts = ts;
+  msg->ev.key.m_context = context;
+  msg->ev.key.m_uid = 0;
+  msg->sender = sender;
+  msg->seq = seq;
+  msg->next = m_mailbox[slot].load (std::memory_order_relaxed);
+  while (!m_mailbox[slot].compare_exchange_weak (msg->next, msg,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
+    {
+    }
+  uint64_t earliest = m_mailboxTs[slot].load (std::memory_order_relaxed);
+  while (ts < earliest
+         && !m_mailboxTs[slot].compare_exchange_weak (earliest, ts, std::memory_order_relaxed))
+    {
+    }
+}
+
+bool
+LogicalProcess::MessageLess (const Message *a, const Message *b)
+{
+  if (a->ev.key.m_ts != b->ev.key.m_ts)
+    {
+      return a->ev.key.m_ts < b->ev.key.m_ts;
+    }
+  if (a->sender != b->sender)
+    {
+      return a->sender < b->sender;
+    }
+  return a->seq < b->seq;
+}
+
+void
+LogicalProcess::Receive (uint32_t slot)
+{
+  Message *msg = m_mailbox[slot].exchange (0, std::memory_order_acquire);
+  if (msg == 0)
+    {
+      return;
+    }
+  m_mailboxTs[slot].store (std::numeric_limits<uint64_t>::max (), std::memory_order_relaxed);
+
+  std::vector<Message *> received;
+  for (; msg != 0; msg = msg->next)
+    {
+      received.push_back (msg);
+    }
+  std::sort (received.begin (), received.end (), &LogicalProcess::MessageLess);
+  for (std::vector<Message *>::const_iterator i = received.begin (); i != received.end (); ++i)
+    {
+      NS_ASSERT ((*i)->ev.key.m_ts >= m_currentTs);
+      (*i)->ev.key.m_uid = m_uid;
+      m_uid++;
+      m_events->Insert ((*i)->ev);
+      delete *i;
+    }
+}
+
+uint64_t
+LogicalProcess::AllocateSeq (void)
+{
+  return m_seq++;
+}
+
+void
+LogicalProcess::Run (uint64_t end, const std::atomic<bool> &stop)
+{
+  while (!m_events->IsEmpty () && !stop.load (std::memory_order_relaxed))
+    {
+      if (m_events->PeekNext ().key.m_ts >= end)
+        {
+          break;
+        }
+      Scheduler::Event next = m_events->RemoveNext ();
+      NS_ASSERT (next.key.m_ts >= m_currentTs);
+      m_currentTs = next.key.m_ts;
+      m_currentContext = next.key.m_context;
+      m_currentUid = next.key.m_uid;
+      m_eventCount++;
+      next.impl->Invoke ();
+      next.impl->Unref ();
+    }
+}
+
+uint64_t
+LogicalProcess::GetNextTs (void) const
+{
+  uint64_t ts = std::min (m_mailboxTs[0].load (std::memory_order_relaxed),
+                          m_mailboxTs[1].load (std::memory_order_relaxed));
+  if (!m_events->IsEmpty ())
+    {
+      ts = std::min (ts, m_events->PeekNext ().key.m_ts);
+    }
+  return ts;
+}
+
+bool
+LogicalProcess::IsEmpty (void) const
+{
+  return m_events->IsEmpty ()
+         && m_mailbox[0].load (std::memory_order_relaxed) == 0
+         && m_mailbox[1].load (std::memory_order_relaxed) == 0;
+}
+
+Scheduler::Event
+LogicalProcess::RemoveNext (void)
+{
+  return m_events->RemoveNext ();
+}
+
+void
+LogicalProcess::Remove (const EventId &id)
+{
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  m_events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+bool
+LogicalProcess::IsExpired (const EventId &id) const
+{
+  return id.PeekEventImpl () == 0
+         || id.GetTs () < m_currentTs
+         || (id.GetTs () == m_currentTs && id.GetUid () <= m_currentUid)
+         || id.PeekEventImpl ()->IsCancelled ();
+}
+
+uint64_t
+LogicalProcess::GetCurrentTs (void) const
+{
+  return m_currentTs;
+}
+
+void
+LogicalProcess::SetCurrentTs (uint64_t ts)
+{
+  NS_ASSERT (ts >= m_currentTs);
+  if (ts > m_currentTs)
+    {
+      m_currentTs = ts;
+      m_currentUid = 0;
+    }
+}
+
+uint32_t
+LogicalProcess::GetContext (void) const
+{
+  return m_currentContext;
+}
+
+uint64_t
+LogicalProcess::GetEventCount (void) const
+{
+  return m_eventCount;
+}
+
+uint32_t *
+LogicalProcess::GetPacketUidCounter (void)
+{
+  return &m_packetUid;
+}
+
+} // namespace ns3
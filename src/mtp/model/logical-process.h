@@ -0,0 +1,212 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef LOGICAL_PROCESS_H
+#define LOGICAL_PROCESS_H
+
+#include <stdint.h>
+#include <atomic>
+#include "ns3/scheduler.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mtp
+ *
+ * \brief A partition of the nodes run by MultithreadedSimulatorImpl
+ *
+ * A logical process owns the event queue and the clock of its nodes. Only
+ * the thread running it inserts and removes events directly. The other
+ * logical processes send it events through a lock-free mailbox, which it
+ * drains at the start of the next window. The mailbox has two slots, one
+ * filled during even windows and one during odd windows, so that the slot
+ * being drained never receives events concurrently and the order of the
+ * received events does not depend on the thread timing.
+ */
+class LogicalProcess
+{
+public:
+  /**
+   * \param id the index of the logical process
+   * \param scheduler the event queue
+   * \param uid the first event uid to allocate
+   */
+  LogicalProcess (uint32_t id, Ptr<Scheduler> scheduler, uint32_t uid);
+  ~LogicalProcess ();
+
+  /**
+   * \return the index of the logical process
+   */
+  uint32_t GetId (void) const;
+
+  /**
+   * Move the pending events to a new event queue
+   *
+   * \param scheduler the new event queue
+   */
+  void SetScheduler (Ptr<Scheduler> scheduler);
+
+  /**
+   * Insert an event in the queue, from the thread running the logical
+   * process or while no window is running
+   *
+   * \param ts the timestamp of the event
+   * \param context the context of the event
+   * \param event the event
+   * \return the id of the event
+   */
+  EventId Schedule (uint64_t ts, uint32_t context, EventImpl *event);
+
+  /**
+   * Insert an event keeping its key, while no window is running
+   *
+   * \param ev the event
+   */
+  void Insert (const Scheduler::Event &ev);
+
+  /**
+   * Post an event to the mailbox, from any thread
+   *
+   * \param slot the mailbox slot of the current window
+   * \param ts the timestamp of the event
+   * \param context the context of the event
+   * \param event the event
+   * \param sender the index of the sending logical process
+   * \param seq the sequence number of the event at the sender
+   */
+  void Send (uint32_t slot, uint64_t ts, uint32_t context, EventImpl *event,
+             uint32_t sender, uint64_t seq);
+
+  /**
+   * Move the events of a mailbox slot to the event queue, ordered by
+   * timestamp, sender and sequence number
+   *
+   * \param slot the mailbox slot
+   */
+  void Receive (uint32_t slot);
+
+  /**
+   * \return the sequence number of the next event sent by this logical process
+   */
+  uint64_t AllocateSeq (void);
+
+  /**
+   * Run the events with a timestamp before a bound
+   *
+   * \param end the bound, excluded
+   * \param stop checked after every event
+   */
+  void Run (uint64_t end, const std::atomic<bool> &stop);
+
+  /**
+   * \return the timestamp of the next event including the mailbox,
+   *         UINT64_MAX if there is none
+   */
+  uint64_t GetNextTs (void) const;
+
+  /**
+   * \return true if the queue and the mailbox are empty
+   */
+  bool IsEmpty (void) const;
+
+  /**
+   * Remove the next event of the queue
+   *
+   * \return the event
+   */
+  Scheduler::Event RemoveNext (void);
+
+  /**
+   * \param id an event of this logical process
+   */
+  void Remove (const EventId &id);
+
+  /**
+   * \param id an event of this logical process
+   * \return true if the event has run or was cancelled
+   */
+  bool IsExpired (const EventId &id) const;
+
+  /**
+   * \return the timestamp of the current event
+   */
+  uint64_t GetCurrentTs (void) const;
+
+  /**
+   * Move the clock forward while no event is running, used to report the
+   * end time of a run
+   *
+   * \param ts the new timestamp, not before the current one
+   */
+  void SetCurrentTs (uint64_t ts);
+
+  /**
+   * \return the context of the current event
+   */
+  uint32_t GetContext (void) const;
+
+  /**
+   * \return the number of events run
+   */
+  uint64_t GetEventCount (void) const;
+
+  /**
+   * \return the counter of the uids of the packets created by the events
+   *         of this logical process, see Packet::SetUidCounter
+   */
+  uint32_t *GetPacketUidCounter (void);
+
+private:
+  /**
+   * An event in a mailbox slot
+   */
+  struct Message
+  {
+    Scheduler::Event ev;  //!< the event, its uid is allocated at reception
+    uint32_t sender;      //!< the sending logical process
+    uint64_t seq;         //!< the sequence number at the sender
+    Message *next;        //!< the next message of the slot
+  };
+
+  /**
+   * Order of the messages at reception
+   *
+   * \param a a message
+   * \param b another message
+   * \return true if a is received before b
+   */
+  static bool MessageLess (const Message *a, const Message *b);
+
+  uint32_t m_id;                          //!< index of the logical process
+  Ptr<Scheduler> m_events;                //!< the event queue
+  uint32_t m_uid;                         //!< next event uid
+  uint32_t m_currentUid;                  //!< uid of the current event
+  uint64_t m_currentTs;                   //!< timestamp of the current event
+  uint32_t m_currentContext;              //!< context of the current event
+  uint64_t m_seq;                         //!< next sequence number of a sent event
+  uint64_t m_eventCount;                  //!< number of events run
+  uint32_t m_packetUid;                   //!< next packet uid
+  std::atomic<Message *> m_mailbox[2];    //!< stacks of received messages
+  std::atomic<uint64_t> m_mailboxTs[2];   //!< earliest timestamp in each slot
+};
+
+} // namespace ns3
+
+#endif /* LOGICAL_PROCESS_H */
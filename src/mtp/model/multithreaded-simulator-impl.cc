@@ -0,0 +1,734 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "multithreaded-simulator-impl.h"
+#include "logical-process.h"
+#include "ns3/simulator.h"
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/channel-list.h"
+#include "ns3/channel.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/make-event.h"
+#include "ns3/uinteger.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace ns3 {
+
+// Note: logging is avoided in the per event paths, as in
+// DefaultSimulatorImpl
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+/// The LP run by the calling thread, 0 outside of the windows
+static thread_local LogicalProcess *g_currentLp = 0;
+
+#ifdef HAVE_PTHREAD_H
+/// Idle workers poll at this period, wake ups are not expected to be missed
+static const uint64_t WORKER_WAIT_NS = 10000000;
+#endif
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Mtp")
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("MaxThreads",
+                   "The number of threads running the partitions, "
+                   "0 for one per hardware thread.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_maxThreads),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MinLookAhead",
+                   "The nodes connected by a channel with a shorter delay, "
+                   "or without a Delay attribute, are put in the same partition.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&MultithreadedSimulatorImpl::m_minLookAhead),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_partitioned (false),
+    m_lookAhead (std::numeric_limits<uint64_t>::max ()),
+    m_maxThreads (0),
+    m_nThreads (1),
+    m_stop (false),
+    m_stopAtWindowEnd (false),
+    m_inWindow (false),
+    m_windowEnd (0),
+    m_nWindows (0),
+    m_nextLp (0)
+#ifdef HAVE_PTHREAD_H
+  , m_generation (0),
+    m_pending (0),
+    m_exit (false)
+#endif
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      delete *i;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      delete *i;
+    }
+  m_lps.clear ();
+  m_lpOfNode.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (true)
+    {
+      Ptr<EventImpl> ev;
+      {
+        CriticalSection cs (m_destroyMutex);
+        if (m_destroyEvents.empty ())
+          {
+            break;
+          }
+        ev = m_destroyEvents.front ().PeekEventImpl ();
+        m_destroyEvents.pop_front ();
+      }
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  m_schedulerFactory = schedulerFactory;
+  if (m_lps.empty ())
+    {
+      // uids are allocated from 4 as in DefaultSimulatorImpl
+      m_lps.push_back (new LogicalProcess (0, m_schedulerFactory.Create<Scheduler> (), 4));
+      return;
+    }
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      (*i)->SetScheduler (m_schedulerFactory.Create<Scheduler> ());
+    }
+}
+
+// System ID for non-distributed simulation is always zero
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop.load ())
+    {
+      return true;
+    }
+  for (std::vector<LogicalProcess *>::const_iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      if (!(*i)->IsEmpty ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+LogicalProcess *
+MultithreadedSimulatorImpl::GetLogicalProcess (uint32_t context) const
+{
+  if (context < m_lpOfNode.size ())
+    {
+      return m_lps[m_lpOfNode[context]];
+    }
+  return m_lps[0];
+}
+
+LogicalProcess *
+MultithreadedSimulatorImpl::GetCurrentLogicalProcess (void) const
+{
+  if (g_currentLp != 0)
+    {
+      return g_currentLp;
+    }
+  return m_lps[0];
+}
+
+void
+MultithreadedSimulatorImpl::Partition (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t nNodes = NodeList::GetNNodes ();
+
+  // Union-find of the nodes joined by the channels without lookahead
+  std::vector<uint32_t> parent (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      parent[i] = i;
+    }
+  std::vector<std::vector<uint32_t> > channelNodes;
+  std::vector<uint64_t> channelDelays;
+  for (ChannelList::Iterator c = ChannelList::Begin (); c != ChannelList::End (); ++c)
+    {
+      std::vector<uint32_t> nodes;
+      for (uint32_t i = 0; i < (*c)->GetNDevices (); i++)
+        {
+          Ptr<NetDevice> device = (*c)->GetDevice (i);
+          if (device != 0 && device->GetNode () != 0)
+            {
+              nodes.push_back (device->GetNode ()->GetId ());
+            }
+        }
+      TimeValue delay;
+      if ((*c)->GetAttributeFailSafe ("Delay", delay)
+          && delay.Get ().IsStrictlyPositive ()
+          && delay.Get () >= m_minLookAhead)
+        {
+          channelNodes.push_back (nodes);
+          channelDelays.push_back (delay.Get ().GetTimeStep ());
+          continue;
+        }
+      for (uint32_t i = 1; i < nodes.size (); i++)
+        {
+          uint32_t a = nodes[0];
+          uint32_t b = nodes[i];
+          while (parent[a] != a)
+            {
+              a = parent[a] = parent[parent[a]];
+            }
+          while (parent[b] != b)
+            {
+              b = parent[b] = parent[parent[b]];
+            }
+          parent[std::max (a, b)] = std::min (a, b);
+        }
+    }
+
+  // Number the LPs in the order of their first node, the public LP is 0
+  std::vector<uint32_t> lpOfRoot (nNodes, 0);
+  m_lpOfNode.resize (nNodes);
+  uint32_t nLps = 1;
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      uint32_t root = i;
+      while (parent[root] != root)
+        {
+          root = parent[root];
+        }
+      if (lpOfRoot[root] == 0)
+        {
+          lpOfRoot[root] = nLps++;
+        }
+      m_lpOfNode[i] = lpOfRoot[root];
+    }
+  for (uint32_t i = 1; i < nLps; i++)
+    {
+      m_lps.push_back (new LogicalProcess (i, m_schedulerFactory.Create<Scheduler> (), 4));
+    }
+
+  m_lookAhead = std::numeric_limits<uint64_t>::max ();
+  for (uint32_t c = 0; c < channelNodes.size (); c++)
+    {
+      const std::vector<uint32_t> &nodes = channelNodes[c];
+      for (uint32_t i = 1; i < nodes.size (); i++)
+        {
+          if (m_lpOfNode[nodes[i]] != m_lpOfNode[nodes[0]])
+            {
+              m_lookAhead = std::min (m_lookAhead, channelDelays[c]);
+              break;
+            }
+        }
+    }
+
+  // Move the events scheduled before the first Run to their LP
+  std::vector<Scheduler::Event> staged;
+  while (!m_lps[0]->IsEmpty ())
+    {
+      staged.push_back (m_lps[0]->RemoveNext ());
+    }
+  for (std::vector<Scheduler::Event>::const_iterator i = staged.begin (); i != staged.end (); ++i)
+    {
+      GetLogicalProcess (i->key.m_context)->Insert (*i);
+    }
+
+  m_partitioned = true;
+  NS_LOG_INFO (nNodes << " nodes in " << nLps - 1 << " partitions, lookahead " << TimeStep (m_lookAhead));
+}
+
+LogicalProcess *
+MultithreadedSimulatorImpl::GetOwner (const EventId &id) const
+{
+  LogicalProcess *lp = GetLogicalProcess (id.GetContext ());
+  if (m_inWindow && lp != g_currentLp && id.PeekEventImpl () != 0)
+    {
+      NS_FATAL_ERROR ("Event of context " << id.GetContext () << " at " << TimeStep (id.GetTs ())
+                      << " removed, cancelled or checked from another partition during a window"
+                      << ": the partitions must only interact through channels with a delay");
+    }
+  return lp;
+}
+
+void
+MultithreadedSimulatorImpl::Insert (LogicalProcess *lp, uint64_t ts, uint32_t context, EventImpl *event)
+{
+  if (m_inWindow && lp != g_currentLp)
+    {
+      NS_ASSERT_MSG (g_currentLp != 0, "Events may only be scheduled by the simulation threads during Run");
+      if (ts < m_windowEnd)
+        {
+          NS_FATAL_ERROR ("Event for context " << context << " at " << TimeStep (ts)
+                          << " before the end of the window at " << TimeStep (m_windowEnd)
+                          << ": the partitions must only interact through channels with a delay");
+        }
+      lp->Send (m_nWindows & 1, ts, context, event, g_currentLp->GetId (), g_currentLp->AllocateSeq ());
+      return;
+    }
+  lp->Schedule (ts, context, event);
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_partitioned)
+    {
+      Partition ();
+    }
+  m_stop = false;
+  m_stopAtWindowEnd = false;
+
+  uint32_t nNodeLps = m_lps.size () - 1;
+  m_nThreads = m_maxThreads;
+  if (m_nThreads == 0)
+    {
+      m_nThreads = std::max (1u, std::thread::hardware_concurrency ());
+    }
+  m_nThreads = std::max (1u, std::min (m_nThreads, nNodeLps));
+#if !defined (NS3_MTP) || !defined (HAVE_PTHREAD_H)
+  if (m_nThreads > 1)
+    {
+      NS_LOG_WARN ("ns-3 is not configured with --enable-mtp, running the partitions on one thread");
+      m_nThreads = 1;
+    }
+#endif
+
+#ifdef HAVE_PTHREAD_H
+  StartWorkers ();
+#endif
+
+  LogicalProcess *pub = m_lps[0];
+  const uint64_t never = std::numeric_limits<uint64_t>::max ();
+  while (!m_stop.load ())
+    {
+      pub->Receive (0);
+      pub->Receive (1);
+      uint64_t tpub = pub->GetNextTs ();
+      uint64_t tmin = never;
+      for (uint32_t i = 1; i < m_lps.size (); i++)
+        {
+          tmin = std::min (tmin, m_lps[i]->GetNextTs ());
+        }
+      if (tpub == never && tmin == never)
+        {
+          break;
+        }
+      if (tpub <= tmin)
+        {
+          // The public events may touch any node, run them alone
+          pub->Run (tpub + 1, m_stop);
+          continue;
+        }
+      m_windowEnd = m_lookAhead < never - tmin ? tmin + m_lookAhead : never;
+      m_windowEnd = std::min (m_windowEnd, tpub);
+      RunWindow ();
+    }
+
+#ifdef HAVE_PTHREAD_H
+  StopWorkers ();
+#endif
+
+  // Report the time of the latest event as the current time
+  uint64_t end = pub->GetCurrentTs ();
+  for (uint32_t i = 1; i < m_lps.size (); i++)
+    {
+      end = std::max (end, m_lps[i]->GetCurrentTs ());
+    }
+  pub->SetCurrentTs (end);
+}
+
+void
+MultithreadedSimulatorImpl::RunWindow (void)
+{
+  m_nWindows++;
+  m_inWindow = true;
+  m_nextLp.store (1);
+#ifdef HAVE_PTHREAD_H
+  if (!m_workers.empty ())
+    {
+      {
+        CriticalSection cs (m_workerMutex);
+        m_pending = m_workers.size ();
+        m_generation++;
+      }
+      for (std::vector<Worker *>::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+        {
+          (*i)->wakeup.SetCondition (true);
+          (*i)->wakeup.Signal ();
+        }
+      RunLogicalProcesses ();
+      while (true)
+        {
+          m_done.SetCondition (false);
+          {
+            CriticalSection cs (m_workerMutex);
+            if (m_pending == 0)
+              {
+                break;
+              }
+          }
+          m_done.TimedWait (WORKER_WAIT_NS);
+        }
+    }
+  else
+#endif
+    {
+      RunLogicalProcesses ();
+    }
+  m_inWindow = false;
+  if (m_stopAtWindowEnd.exchange (false))
+    {
+      m_stop = true;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::RunLogicalProcesses (void)
+{
+  // The events sent during the previous window are in the other slot
+  uint32_t slot = (m_nWindows + 1) & 1;
+  while (true)
+    {
+      uint32_t i = m_nextLp.fetch_add (1);
+      if (i >= m_lps.size ())
+        {
+          break;
+        }
+      LogicalProcess *lp = m_lps[i];
+      g_currentLp = lp;
+      // The packet uids must not depend on how the threads interleave
+      Packet::SetUidCounter (lp->GetId (), lp->GetPacketUidCounter ());
+      lp->Receive (slot);
+      lp->Run (m_windowEnd, m_stop);
+      Packet::SetUidCounter (0, 0);
+      g_currentLp = 0;
+    }
+}
+
+#ifdef HAVE_PTHREAD_H
+void
+MultithreadedSimulatorImpl::StartWorkers (void)
+{
+  NS_LOG_FUNCTION (this << m_nThreads);
+  m_exit = false;
+  for (uint32_t i = 1; i < m_nThreads; i++)
+    {
+      Worker *worker = new Worker;
+      worker->sim = this;
+      worker->generation = m_generation;
+      worker->thread = Create<SystemThread> (MakeCallback (&Worker::Loop, worker));
+      m_workers.push_back (worker);
+      worker->thread->Start ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::StopWorkers (void)
+{
+  NS_LOG_FUNCTION (this);
+  {
+    CriticalSection cs (m_workerMutex);
+    m_exit = true;
+  }
+  for (std::vector<Worker *>::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+    {
+      (*i)->wakeup.SetCondition (true);
+      (*i)->wakeup.Signal ();
+    }
+  for (std::vector<Worker *>::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+    {
+      (*i)->thread->Join ();
+      delete *i;
+    }
+  m_workers.clear ();
+}
+
+void
+MultithreadedSimulatorImpl::WorkerLoop (Worker *worker)
+{
+  while (true)
+    {
+      // Reset before checking, so that a window started after the check
+      // is not missed
+      worker->wakeup.SetCondition (false);
+      bool run = false;
+      {
+        CriticalSection cs (m_workerMutex);
+        if (m_exit)
+          {
+            return;
+          }
+        if (m_generation != worker->generation)
+          {
+            worker->generation = m_generation;
+            run = true;
+          }
+      }
+      if (!run)
+        {
+          worker->wakeup.TimedWait (WORKER_WAIT_NS);
+          continue;
+        }
+      RunLogicalProcesses ();
+      bool last;
+      {
+        CriticalSection cs (m_workerMutex);
+        m_pending--;
+        last = m_pending == 0;
+      }
+      if (last)
+        {
+          m_done.SetCondition (true);
+          m_done.Signal ();
+        }
+    }
+}
+#endif
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_inWindow)
+    {
+      // Let every LP reach the end of the window, so that the results do
+      // not depend on the number of threads
+      m_stopAtWindowEnd = true;
+      return;
+    }
+  m_stop = true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop (const Time &delay)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep ());
+  uint64_t ts = GetCurrentLogicalProcess ()->GetCurrentTs () + delay.GetTimeStep ();
+  if (m_inWindow)
+    {
+      // The public LP does not run before the end of the window
+      ts = std::max (ts, m_windowEnd);
+    }
+  Insert (m_lps[0], ts, 0xffffffff, MakeEvent (static_cast<void (*) (void)> (&Simulator::Stop)));
+}
+
+EventId
+MultithreadedSimulatorImpl::Schedule (const Time &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep () << event);
+  LogicalProcess *lp = GetCurrentLogicalProcess ();
+  Time tAbsolute = delay + TimeStep (lp->GetCurrentTs ());
+  NS_ASSERT (tAbsolute.IsPositive ());
+  return lp->Schedule (tAbsolute.GetTimeStep (), lp->GetContext (), event);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << delay.GetTimeStep () << event);
+  Time tAbsolute = delay + TimeStep (GetCurrentLogicalProcess ()->GetCurrentTs ());
+  NS_ASSERT (tAbsolute.IsPositive ());
+  Insert (GetLogicalProcess (context), tAbsolute.GetTimeStep (), context, event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  LogicalProcess *lp = GetCurrentLogicalProcess ();
+  return lp->Schedule (lp->GetCurrentTs (), lp->GetContext (), event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  CriticalSection cs (m_destroyMutex);
+  EventId id (Ptr<EventImpl> (event, false), GetCurrentLogicalProcess ()->GetCurrentTs (), 0xffffffff, 2);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  return TimeStep (GetCurrentLogicalProcess ()->GetCurrentTs ());
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  return TimeStep (id.GetTs () - GetCurrentLogicalProcess ()->GetCurrentTs ());
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_destroyMutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  GetOwner (id)->Remove (id);
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0
+          || id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (m_destroyMutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  return GetOwner (id)->IsExpired (id);
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  return GetCurrentLogicalProcess ()->GetContext ();
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetNPartitions (void) const
+{
+  return m_lps.size ();
+}
+
+Time
+MultithreadedSimulatorImpl::GetLookAhead (void) const
+{
+  if (m_lookAhead > static_cast<uint64_t> (GetMaximumSimulationTime ().GetTimeStep ()))
+    {
+      return GetMaximumSimulationTime ();
+    }
+  return TimeStep (m_lookAhead);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetNThreads (void) const
+{
+  return m_nThreads;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetNWindows (void) const
+{
+  return m_nWindows;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetEventCount (void) const
+{
+  uint64_t count = 0;
+  for (std::vector<LogicalProcess *>::const_iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      count += (*i)->GetEventCount ();
+    }
+  return count;
+}
+
+} // namespace ns3
@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <vector>
+#include "ns3/core-config.h"
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/system-mutex.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#include "ns3/system-condition.h"
+#endif
+
+namespace ns3 {
+
+class LogicalProcess;
+
+/**
+ * \defgroup mtp Multithreaded Simulation
+ */
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Shared memory parallel simulator implementation
+ *
+ * At the first call to Run the nodes are partitioned into logical processes
+ * (LPs): the nodes connected by a channel are put in the same LP unless the
+ * channel has a "Delay" attribute of at least MinLookAhead. Each LP keeps
+ * its own event queue and clock. The events of a context that is not a
+ * node id, for example the events scheduled from main, belong to a public
+ * LP. Nodes created after the partitioning also belong to the public LP.
+ *
+ * The LPs are run by a pool of threads in windows. The lookahead is the
+ * smallest delay of the channels connecting two LPs, as in
+ * DistributedSimulatorImpl::CalculateLookAhead. A window runs, in
+ * parallel, the events of every LP earlier than the earliest pending event
+ * plus the lookahead and earlier than the next public event. The public
+ * events are run alone, before the LP events with the same timestamp.
+ *
+ * The events scheduled for another LP during a window are passed through a
+ * lock-free mailbox without serialization. They must be later than the end
+ * of the window, which holds for the events sent over the channels the
+ * lookahead was computed from. The packets created by an LP take their
+ * uids from a counter of the LP, see Packet::SetUidCounter. The results do
+ * not depend on the number of threads.
+ *
+ * The threads are only used when ns-3 is configured with --enable-mtp,
+ * which makes the reference counts and the packet buffers thread-safe.
+ * Otherwise the LPs are run in turn by the calling thread.
+ *
+ * Stop () called from an event of an LP takes effect at the end of the
+ * window, once every LP has run it. EventIds must be removed, cancelled and
+ * checked from events of the LP that scheduled them, or from public events:
+ * touching the EventId of another LP during a window is a fatal error.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (const Time &delay);
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \return the number of LPs including the public LP, 1 before the first Run
+   */
+  uint32_t GetNPartitions (void) const;
+
+  /**
+   * \return the lookahead between the LPs
+   */
+  Time GetLookAhead (void) const;
+
+  /**
+   * \return the number of threads used by the last Run
+   */
+  uint32_t GetNThreads (void) const;
+
+  /**
+   * \return the number of parallel windows run
+   */
+  uint64_t GetNWindows (void) const;
+
+  /**
+   * \return the number of events run
+   */
+  uint64_t GetEventCount (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /**
+   * Group the nodes into LPs and move the pending events to their LP
+   */
+  void Partition (void);
+
+  /**
+   * \param context an event context
+   * \return the LP running the events of the context
+   */
+  LogicalProcess * GetLogicalProcess (uint32_t context) const;
+
+  /**
+   * \return the LP of the calling thread, the public LP outside of the events
+   */
+  LogicalProcess * GetCurrentLogicalProcess (void) const;
+
+  /**
+   * \param id an event
+   * \return the LP of the event, which must be the LP of the calling
+   * thread during a window
+   */
+  LogicalProcess * GetOwner (const EventId &id) const;
+
+  /**
+   * Insert an event in an LP, through its mailbox if it is run by another
+   * thread
+   *
+   * \param lp the LP
+   * \param ts the timestamp of the event
+   * \param context the context of the event
+   * \param event the event
+   */
+  void Insert (LogicalProcess *lp, uint64_t ts, uint32_t context, EventImpl *event);
+
+  /**
+   * Run the events of all the LPs before m_windowEnd
+   */
+  void RunWindow (void);
+
+  /**
+   * Claim and run LPs until all of them have run the current window
+   */
+  void RunLogicalProcesses (void);
+
+  ObjectFactory m_schedulerFactory;           //!< creates the event queues
+  std::vector<LogicalProcess *> m_lps;        //!< LPs, the public LP first
+  std::vector<uint32_t> m_lpOfNode;           //!< index of the LP of each node
+  bool m_partitioned;                         //!< whether the nodes are partitioned
+  Time m_minLookAhead;                        //!< channels with a shorter delay do not separate LPs
+  uint64_t m_lookAhead;                       //!< lookahead between the LPs (time steps)
+  uint32_t m_maxThreads;                      //!< requested number of threads
+  uint32_t m_nThreads;                        //!< number of threads of the last Run
+
+  std::atomic<bool> m_stop;                   //!< flag calling for the end of the run
+  std::atomic<bool> m_stopAtWindowEnd;        //!< Stop () called during the current window
+  bool m_inWindow;                            //!< whether a parallel window is running
+  uint64_t m_windowEnd;                       //!< end of the current window, excluded
+  uint64_t m_nWindows;                        //!< number of windows run
+  std::atomic<uint32_t> m_nextLp;             //!< next LP to claim in the window
+
+  /** Container type for the events to run at Simulator::Destroy() */
+  typedef std::list<EventId> DestroyEvents;
+  DestroyEvents m_destroyEvents;              //!< events to run at Destroy
+  mutable SystemMutex m_destroyMutex;         //!< protects m_destroyEvents
+
+#ifdef HAVE_PTHREAD_H
+  /**
+   * A thread running LPs in the windows
+   */
+  struct Worker
+  {
+    MultithreadedSimulatorImpl *sim;  //!< the simulator
+    Ptr<SystemThread> thread;         //!< the thread
+    SystemCondition wakeup;           //!< signalled when a window starts
+    uint64_t generation;              //!< the last window run
+    /**
+     * Entry point of the thread
+     */
+    void Loop (void)
+    {
+      sim->WorkerLoop (this);
+    }
+  };
+
+  /**
+   * Run the windows until the end of the Run
+   *
+   * \param worker the worker of the calling thread
+   */
+  void WorkerLoop (Worker *worker);
+
+  /**
+   * Start the worker threads of a Run
+   */
+  void StartWorkers (void);
+
+  /**
+   * Stop and join the worker threads at the end of a Run
+   */
+  void StopWorkers (void);
+
+  std::vector<Worker *> m_workers;  //!< the worker threads
+  SystemMutex m_workerMutex;        //!< protects the window state below
+  SystemCondition m_done;           //!< signalled when the last worker ends a window
+  uint64_t m_generation;            //!< incremented by every window
+  uint32_t m_pending;               //!< workers still running the window
+  bool m_exit;                      //!< set at the end of the Run
+#endif
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
@@ -0,0 +1,426 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/multithreaded-simulator-impl.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/config.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/node.h"
+#include "ns3/mac48-address.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Packets forwarded around a ring of nodes
+ *
+ * Every node starts a packet in each direction, which is forwarded for a
+ * number of hops after a processing delay depending on the node. The
+ * number and the times of the receptions do not depend on the order of
+ * the simultaneous events, so they must match across the simulator
+ * implementations and the number of threads.
+ */
+class MtpRing
+{
+public:
+  /**
+   * \param nNodes the number of nodes
+   * \param delay the delay of the links
+   */
+  MtpRing (uint32_t nNodes, Time delay);
+
+  /**
+   * Start the packets and run the simulation, the caller destroys it
+   */
+  void Run (void);
+
+  /**
+   * Call Simulator::Stop () without delay from an event of a node
+   *
+   * \param node the node
+   * \param time the time of the event
+   */
+  void StopFrom (uint32_t node, Time time);
+
+  std::vector<uint64_t> m_received;     //!< receptions of each node
+  std::vector<uint64_t> m_receiveTime;  //!< sum of the reception times (ns) of each node
+  std::vector<uint64_t> m_receiveUid;   //!< sum of the uids of the packets received by each node
+  uint64_t m_cancelledFired;            //!< cancelled or removed events that ran
+  uint64_t m_receivedAtCheck;           //!< receptions counted by a public event
+  Time m_end;                           //!< time at the end of the run
+
+private:
+  /**
+   * \param device the sending device
+   * \param hops the remaining hops
+   */
+  void Forward (Ptr<NetDevice> device, uint32_t hops);
+
+  /**
+   * \param device the receiving device
+   * \param packet the packet
+   * \param protocol the protocol number
+   * \param from the sender address
+   * \return true
+   */
+  bool Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+
+  /**
+   * An event that is cancelled before running
+   */
+  void Cancelled (void);
+
+  /**
+   * Count the receptions from a public event
+   */
+  void Check (void);
+
+  std::vector<Ptr<Node> > m_nodes;  //!< the nodes
+};
+
+MtpRing::MtpRing (uint32_t nNodes, Time delay)
+  : m_received (nNodes, 0),
+    m_receiveTime (nNodes, 0),
+    m_receiveUid (nNodes, 0),
+    m_cancelledFired (0),
+    m_receivedAtCheck (0)
+{
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      m_nodes.push_back (CreateObject<Node> ());
+    }
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+      channel->SetAttribute ("Delay", TimeValue (delay));
+      Ptr<Node> ends[2] = { m_nodes[i], m_nodes[(i + 1) % nNodes] };
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+          device->SetAddress (Mac48Address::Allocate ());
+          device->SetChannel (channel);
+          ends[j]->AddDevice (device);
+          device->SetReceiveCallback (MakeCallback (&MtpRing::Receive, this));
+        }
+    }
+}
+
+void
+MtpRing::Run (void)
+{
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Simulator::ScheduleWithContext (i, MicroSeconds (i), &MtpRing::Forward, this, m_nodes[i]->GetDevice (j), 20);
+        }
+    }
+  Simulator::Schedule (NanoSeconds (5000500), &MtpRing::Check, this);
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  m_end = Simulator::Now ();
+}
+
+void
+MtpRing::StopFrom (uint32_t node, Time time)
+{
+  Simulator::ScheduleWithContext (node, time, static_cast<void (*) (void)> (&Simulator::Stop));
+}
+
+void
+MtpRing::Forward (Ptr<NetDevice> device, uint32_t hops)
+{
+  device->Send (Create<Packet> (hops), device->GetBroadcast (), 0x800);
+
+  EventId removed = Simulator::Schedule (MicroSeconds (1), &MtpRing::Cancelled, this);
+  EventId cancelled = Simulator::Schedule (MicroSeconds (1), &MtpRing::Cancelled, this);
+  Simulator::Remove (removed);
+  Simulator::Cancel (cancelled);
+  if (!removed.IsExpired () || !cancelled.IsExpired ())
+    {
+      m_cancelledFired++;
+    }
+}
+
+bool
+MtpRing::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from)
+{
+  uint32_t id = device->GetNode ()->GetId ();
+  m_received[id]++;
+  m_receiveTime[id] += Simulator::Now ().GetNanoSeconds ();
+  m_receiveUid[id] += packet->GetUid ();
+  if (packet->GetSize () > 1)
+    {
+      // Forward on the other link of the node
+      Ptr<NetDevice> next = device->GetNode ()->GetDevice (1 - device->GetIfIndex ());
+      Simulator::Schedule (MicroSeconds (10 * (id % 3)), &MtpRing::Forward, this, next, packet->GetSize () - 1);
+    }
+  return true;
+}
+
+void
+MtpRing::Cancelled (void)
+{
+  m_cancelledFired++;
+}
+
+void
+MtpRing::Check (void)
+{
+  m_receivedAtCheck = 0;
+  for (uint32_t i = 0; i < m_received.size (); i++)
+    {
+      m_receivedAtCheck += m_received[i];
+    }
+}
+
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Check that the results match DefaultSimulatorImpl for several
+ * numbers of threads
+ */
+class MtpRingTestCase : public TestCase
+{
+public:
+  MtpRingTestCase ();//!< default constructor
+  virtual ~MtpRingTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+  virtual void DoTeardown (void);//!< restore the default simulator
+};
+
+MtpRingTestCase::MtpRingTestCase ()
+  : TestCase ("Check that the multithreaded simulator matches the default simulator")
+{
+}
+
+MtpRingTestCase::~MtpRingTestCase ()
+{
+}
+
+void
+MtpRingTestCase::DoRun (void)
+{
+  uint32_t nNodes = 16;
+  Time delay = MilliSeconds (1);
+
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  MtpRing reference (nNodes, delay);
+  reference.Run ();
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_EQ (reference.m_received[0], 40, "Unexpected number of receptions");
+
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+  uint32_t threads[] = { 1, 4 };
+  std::vector<uint64_t> uids;
+  for (uint32_t t = 0; t < 2; t++)
+    {
+      Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (threads[t]));
+      MtpRing ring (nNodes, delay);
+      ring.Run ();
+      Ptr<MultithreadedSimulatorImpl> impl = DynamicCast<MultithreadedSimulatorImpl> (Simulator::GetImplementation ());
+      NS_TEST_ASSERT_MSG_NE (impl, 0, "Not running the multithreaded simulator");
+      NS_TEST_EXPECT_MSG_EQ (impl->GetNPartitions (), nNodes + 1, "Every node should be a partition");
+      NS_TEST_EXPECT_MSG_EQ (impl->GetLookAhead (), delay, "Unexpected lookahead");
+      NS_TEST_EXPECT_MSG_GT (impl->GetNWindows (), 1, "Expected several windows");
+      Simulator::Destroy ();
+
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (ring.m_received[i], reference.m_received[i], "Receptions differ at node " << i);
+          NS_TEST_EXPECT_MSG_EQ (ring.m_receiveTime[i], reference.m_receiveTime[i], "Reception times differ at node " << i);
+          if (t > 0)
+            {
+              // The uids are numbered per logical process, not as with the default simulator
+              NS_TEST_EXPECT_MSG_EQ (ring.m_receiveUid[i], uids[i], "Packet uids depend on the threads at node " << i);
+            }
+        }
+      uids = ring.m_receiveUid;
+      NS_TEST_EXPECT_MSG_EQ (ring.m_cancelledFired, 0, "A cancelled event ran");
+      NS_TEST_EXPECT_MSG_EQ (ring.m_receivedAtCheck, reference.m_receivedAtCheck, "The public event did not run alone");
+      NS_TEST_EXPECT_MSG_EQ (ring.m_end, reference.m_end, "Unexpected end time");
+    }
+}
+
+void
+MtpRingTestCase::DoTeardown (void)
+{
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (0));
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Check the partitioning of the nodes
+ */
+class MtpPartitionTestCase : public TestCase
+{
+public:
+  MtpPartitionTestCase ();//!< default constructor
+  virtual ~MtpPartitionTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+  virtual void DoTeardown (void);//!< restore the default simulator
+};
+
+MtpPartitionTestCase::MtpPartitionTestCase ()
+  : TestCase ("Check the partitioning of the nodes by the channel delays")
+{
+}
+
+MtpPartitionTestCase::~MtpPartitionTestCase ()
+{
+}
+
+void
+MtpPartitionTestCase::DoRun (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+
+  // Links shorter than MinLookAhead join their nodes
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MinLookAhead", TimeValue (MilliSeconds (2)));
+  MtpRing ring (8, MilliSeconds (1));
+  ring.Run ();
+  Ptr<MultithreadedSimulatorImpl> impl = DynamicCast<MultithreadedSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_ASSERT_MSG_NE (impl, 0, "Not running the multithreaded simulator");
+  NS_TEST_EXPECT_MSG_EQ (impl->GetNPartitions (), 2, "The ring should be a single partition");
+  NS_TEST_EXPECT_MSG_EQ (impl->GetLookAhead (), Simulator::GetMaximumSimulationTime (), "Unexpected lookahead");
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (ring.m_received[0], 40, "Unexpected number of receptions");
+
+  // Channels without delay join their nodes
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MinLookAhead", TimeValue (Seconds (0)));
+  MtpRing zero (8, Seconds (0));
+  zero.Run ();
+  impl = DynamicCast<MultithreadedSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_EXPECT_MSG_EQ (impl->GetNPartitions (), 2, "The ring should be a single partition");
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (zero.m_received[0], 40, "Unexpected number of receptions");
+}
+
+void
+MtpPartitionTestCase::DoTeardown (void)
+{
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MinLookAhead", TimeValue (Seconds (0)));
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Check that Stop () called from a node stops at the end of the
+ * window whatever the number of threads
+ */
+class MtpStopTestCase : public TestCase
+{
+public:
+  MtpStopTestCase ();//!< default constructor
+  virtual ~MtpStopTestCase ();//!< virtual destructor
+
+private:
+  virtual void DoRun (void);//!< run test
+  virtual void DoTeardown (void);//!< restore the default simulator
+};
+
+MtpStopTestCase::MtpStopTestCase ()
+  : TestCase ("Check that Stop () from a partition does not depend on the number of threads")
+{
+}
+
+MtpStopTestCase::~MtpStopTestCase ()
+{
+}
+
+void
+MtpStopTestCase::DoRun (void)
+{
+  uint32_t nNodes = 16;
+  Time delay = MilliSeconds (1);
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+
+  std::vector<uint64_t> received;
+  uint32_t threads[] = { 1, 4 };
+  for (uint32_t t = 0; t < 2; t++)
+    {
+      Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (threads[t]));
+      MtpRing ring (nNodes, delay);
+      ring.StopFrom (5, MicroSeconds (7500));
+      ring.Run ();
+      Simulator::Destroy ();
+
+      uint64_t total = 0;
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          total += ring.m_received[i];
+        }
+      NS_TEST_EXPECT_MSG_GT (total, 0, "No reception before the stop");
+      NS_TEST_EXPECT_MSG_LT (total, 40 * nNodes, "The run was not stopped");
+      if (t == 0)
+        {
+          received = ring.m_received;
+          continue;
+        }
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (ring.m_received[i], received[i], "Receptions before the stop differ at node " << i);
+        }
+    }
+}
+
+void
+MtpStopTestCase::DoTeardown (void)
+{
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (0));
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Test suite for the multithreaded simulator
+ */
+class MtpTestSuite : public TestSuite
+{
+public:
+  MtpTestSuite ();
+};
+
+MtpTestSuite::MtpTestSuite ()
+  : TestSuite ("mtp", UNIT)
+{
+  AddTestCase (new MtpRingTestCase, TestCase::QUICK);
+  AddTestCase (new MtpPartitionTestCase, TestCase::QUICK);
+  AddTestCase (new MtpStopTestCase, TestCase::QUICK);
+}
+
+static MtpTestSuite mtpTestSuite;
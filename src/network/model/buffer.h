@@ -24,6 +24,9 @@
 #include <vector>
 #include <ostream>
 #include "ns3/assert.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 #define BUFFER_FREE_LIST 1
 
@@ -57,7 +60,9 @@ namespace ns3 {
  * safe to modify the content of a BufferData if the modification
  * falls outside of the "dirty area" defined by the BufferData.
  * In every other case, the BufferData must be copied before
- * being modified.
+ * being modified. With NS3_MTP, Buffer instances sharing a BufferData
+ * may be used by different threads, so a shared BufferData is always
+ * copied before being modified and the free lists are per thread.
  *
  * To understand the way the Buffer::Add and Buffer::Remove methods
  * work, you first need to understand the "virtual offsets" used to
@@ -657,7 +662,11 @@ private:
      * The reference count of an instance of this data structure.
      * Each buffer which references an instance holds a count.
      */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> m_count;
+#else
     uint32_t m_count;
+#endif
     /**
      * the size of the m_data field below.
      */
@@ -761,7 +770,11 @@ private:
    * writing data. i.e., m_start should be initialized to this 
    * value.
    */
+#ifdef NS3_MTP
+  static thread_local uint32_t g_recommendedStart;
+#else
   static uint32_t g_recommendedStart;
+#endif
 
   /**
    * offset to the start of the virtual zero area from the start
@@ -784,18 +797,6 @@ private:
    */
   uint32_t m_end;
 
-#ifdef BUFFER_FREE_LIST
-  /// Container for buffer data
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  /// Local static destructor structure
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
-  static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
-#endif
 };
 
 } // namespace ns3
@@ -0,0 +1,331 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "packet-arena.h"
+#include "ns3/per-thread.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <new>
+
+namespace ns3 {
+
+namespace {
+
+/** Size of the header in front of the blocks, a multiple of their alignment. */
+const uint32_t ARENA_HEADER_SIZE = 16;
+/** Log2 of the size of the smallest size class, header included. */
+const uint32_t ARENA_MIN_SHIFT = 6;
+/** Number of size classes, up to 1 MiB, larger blocks are not pooled. */
+const uint32_t ARENA_CLASSES = 15;
+/** Maximum number of free blocks kept by an arena in a size class. */
+const uint32_t ARENA_MAX_FREE = 1024;
+/** Maximum number of bytes kept by an arena in a size class. */
+const uint32_t ARENA_MAX_FREE_BYTES = 1 << 22;
+
+struct Arena;
+
+/**
+ * \ingroup packet
+ * Header in front of the blocks of the arenas.
+ */
+struct BlockHeader
+{
+  Arena *owner;        /**< Arena of the block, 0 if not pooled. */
+  uint32_t sizeClass;  /**< Size class of the block. */
+};
+
+/**
+ * \ingroup packet
+ * A block freed by another thread, linked through its first bytes.
+ */
+struct FreeBlock
+{
+  FreeBlock *next;  /**< Next free block. */
+};
+
+/**
+ * \ingroup packet
+ * Free lists of packet memory of a thread.
+ */
+struct Arena
+{
+  FreeList free[ARENA_CLASSES];          /**< Free blocks per size class. */
+  std::atomic<FreeBlock *> returned;     /**< Blocks freed by other threads. */
+  std::atomic<bool> idle;                /**< Whether the thread of the arena exited. */
+  std::atomic<uint64_t> hits;            /**< Allocations from a free list. */
+  std::atomic<uint64_t> misses;          /**< Allocations from the heap. */
+  std::atomic<uint64_t> remoteFrees;     /**< Blocks returned by other threads. */
+
+  /**
+   * \returns An idle arena, or a new one, for the calling thread.
+   */
+  static Arena *Create (void);
+  /**
+   * Free the blocks of the arena of an exiting thread, and keep it idle:
+   * the blocks it allocated still point to it.
+   * \param arena The arena.
+   */
+  static void Release (Arena *arena);
+};
+
+/**
+ * \ingroup packet
+ * All the arenas, which live as long as the process.
+ */
+struct ArenaRegistry
+{
+  std::mutex mutex;            /**< Protects the lists. */
+  std::vector<Arena *> all;    /**< All the arenas. */
+  std::vector<Arena *> idle;   /**< Arenas of exited threads, to reuse. */
+};
+
+/**
+ * \returns The registry of the arenas, never destroyed so that packets
+ * can be freed by static destructors.
+ */
+ArenaRegistry &
+GetRegistry (void)
+{
+  static ArenaRegistry *registry = new ArenaRegistry ();
+  return *registry;
+}
+
+/**
+ * Increment a counter only written by the thread of its arena.
+ * \param counter the counter
+ */
+inline void
+Increment (std::atomic<uint64_t> &counter)
+{
+  counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/**
+ * \param sizeClass a size class
+ * \returns The maximum number of free blocks kept in the size class
+ */
+inline uint32_t
+GetMaxFree (uint32_t sizeClass)
+{
+  uint32_t maxFree = ARENA_MAX_FREE_BYTES >> (ARENA_MIN_SHIFT + sizeClass);
+  return maxFree < ARENA_MAX_FREE ? maxFree : ARENA_MAX_FREE;
+}
+
+/**
+ * \param block a block
+ * \returns The header of the block
+ */
+inline BlockHeader *
+GetHeader (void *block)
+{
+  return reinterpret_cast<BlockHeader *> (static_cast<uint8_t *> (block) - ARENA_HEADER_SIZE);
+}
+
+/**
+ * Free a block to the heap.
+ * \param block the block
+ */
+inline void
+Free (void *block)
+{
+  ::operator delete (GetHeader (block));
+}
+
+/**
+ * Keep a block in a free list of an arena, or release it if the list is full.
+ * \param arena the arena of this thread
+ * \param sizeClass the size class of the block
+ * \param block the block
+ */
+inline void
+Keep (Arena *arena, uint32_t sizeClass, void *block)
+{
+  if (!arena->free[sizeClass].Push (block, GetMaxFree (sizeClass)))
+    {
+      Free (block);
+    }
+}
+
+/**
+ * Move the blocks returned by other threads to the free lists.
+ * \param arena the arena of this thread
+ */
+void
+Drain (Arena *arena)
+{
+  FreeBlock *block = arena->returned.exchange (0, std::memory_order_acquire);
+  while (block != 0)
+    {
+      FreeBlock *next = block->next;
+      Keep (arena, GetHeader (block)->sizeClass, block);
+      block = next;
+    }
+}
+
+Arena *
+Arena::Create (void)
+{
+  ArenaRegistry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.mutex);
+  Arena *arena;
+  if (registry.idle.empty ())
+    {
+      arena = new Arena ();
+      arena->returned.store (0);
+      arena->hits.store (0);
+      arena->misses.store (0);
+      arena->remoteFrees.store (0);
+      registry.all.push_back (arena);
+    }
+  else
+    {
+      arena = registry.idle.back ();
+      registry.idle.pop_back ();
+    }
+  arena->idle.store (false, std::memory_order_relaxed);
+  return arena;
+}
+
+void
+Arena::Release (Arena *arena)
+{
+  arena->idle.store (true, std::memory_order_relaxed);
+  Drain (arena);
+  for (uint32_t i = 0; i < ARENA_CLASSES; i++)
+    {
+      void *block;
+      while ((block = arena->free[i].Pop ()) != 0)
+        {
+          Free (block);
+        }
+    }
+  ArenaRegistry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.mutex);
+  registry.idle.push_back (arena);
+}
+
+} // unnamed namespace
+
+// Logging is avoided below, packets are created and destroyed too often.
+
+void *
+PacketArena::Allocate (uint32_t size, uint32_t *capacity)
+{
+  uint32_t total = size + ARENA_HEADER_SIZE;
+  uint32_t shift = ARENA_MIN_SHIFT;
+  while ((1U << shift) < total)
+    {
+      shift++;
+    }
+  uint32_t sizeClass = shift - ARENA_MIN_SHIFT;
+  Arena *arena = PerThread<Arena>::Get ();
+  BlockHeader *header;
+  if (sizeClass >= ARENA_CLASSES || arena == 0)
+    {
+      header = static_cast<BlockHeader *> (::operator new (total));
+      header->owner = 0;
+      header->sizeClass = ARENA_CLASSES;
+      *capacity = size;
+      if (arena != 0)
+        {
+          Increment (arena->misses);
+        }
+      return reinterpret_cast<uint8_t *> (header) + ARENA_HEADER_SIZE;
+    }
+
+  *capacity = (1U << shift) - ARENA_HEADER_SIZE;
+  if (arena->free[sizeClass].IsEmpty ()
+      && arena->returned.load (std::memory_order_relaxed) != 0)
+    {
+      Drain (arena);
+    }
+  void *block = arena->free[sizeClass].Pop ();
+  if (block != 0)
+    {
+      Increment (arena->hits);
+      return block;
+    }
+  header = static_cast<BlockHeader *> (::operator new (1U << shift));
+  header->owner = arena;
+  header->sizeClass = sizeClass;
+  Increment (arena->misses);
+  return reinterpret_cast<uint8_t *> (header) + ARENA_HEADER_SIZE;
+}
+
+void
+PacketArena::Deallocate (void *block)
+{
+  BlockHeader *header = GetHeader (block);
+  Arena *owner = header->owner;
+  if (owner == 0)
+    {
+      Free (block);
+    }
+  else if (owner == PerThread<Arena>::Peek ())
+    {
+      Keep (owner, header->sizeClass, block);
+    }
+  else if (PerThread<Arena>::IsReleased () || owner->idle.load (std::memory_order_relaxed))
+    {
+      Free (block);
+    }
+  else
+    {
+      FreeBlock *free = static_cast<FreeBlock *> (block);
+      free->next = owner->returned.load (std::memory_order_relaxed);
+      while (!owner->returned.compare_exchange_weak (free->next, free,
+                                                     std::memory_order_release,
+                                                     std::memory_order_relaxed))
+        {
+        }
+      owner->remoteFrees.fetch_add (1, std::memory_order_relaxed);
+    }
+}
+
+struct PacketArena::Statistics
+PacketArena::GetStatistics (void)
+{
+  struct Statistics statistics;
+  statistics.hits = 0;
+  statistics.misses = 0;
+  statistics.remoteFrees = 0;
+  ArenaRegistry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.mutex);
+  for (std::vector<Arena *>::const_iterator i = registry.all.begin (); i != registry.all.end (); ++i)
+    {
+      statistics.hits += (*i)->hits.load (std::memory_order_relaxed);
+      statistics.misses += (*i)->misses.load (std::memory_order_relaxed);
+      statistics.remoteFrees += (*i)->remoteFrees.load (std::memory_order_relaxed);
+    }
+  return statistics;
+}
+
+void
+PacketArena::ResetStatistics (void)
+{
+  ArenaRegistry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.mutex);
+  for (std::vector<Arena *>::const_iterator i = registry.all.begin (); i != registry.all.end (); ++i)
+    {
+      (*i)->hits.store (0, std::memory_order_relaxed);
+      (*i)->misses.store (0, std::memory_order_relaxed);
+      (*i)->remoteFrees.store (0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace ns3
@@ -19,6 +19,7 @@
  */
 #include <utility>
 #include <list>
+#include <algorithm>
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
@@ -26,6 +27,7 @@
 #include "buffer.h"
 #include "header.h"
 #include "trailer.h"
+#include "packet-arena.h"
 
 namespace ns3 {
 
@@ -34,19 +36,12 @@ NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
-uint32_t PacketMetadata::m_maxSize = 0;
+std::atomic<uint32_t> PacketMetadata::m_maxSize (0);
+#ifdef NS3_MTP
+std::atomic<uint16_t> PacketMetadata::m_chunkUid (0);
+#else
 uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
-
-PacketMetadata::DataFreeList::~DataFreeList ()
-{
-  NS_LOG_FUNCTION (this);
-  for (iterator i = begin (); i != end (); i++)
-    {
-      PacketMetadata::Deallocate (*i);
-    }
-  PacketMetadata::m_enable = false;
-}
+#endif
 
 void 
 PacketMetadata::Enable (void)
@@ -75,12 +70,14 @@ PacketMetadata::ReserveCopy (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
-  memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_data != 0)
     {
-      PacketMetadata::Recycle (m_data);
+      memcpy (newData->m_data, m_data->m_data, m_used);
+      if (--m_data->m_count == 0)
+        {
+          PacketMetadata::Recycle (m_data);
+        }
     }
   m_data = newData;
   if (m_head != 0xffff)
@@ -99,11 +96,18 @@ void
 PacketMetadata::Reserve (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  NS_ASSERT (m_data != 0);
-  if (m_data->m_size >= m_used + size &&
+#ifdef NS3_MTP
+  // The other references may be appending from other threads
+  if (m_data != 0 &&
+      m_data->m_size >= m_used + size &&
+      m_data->m_count == 1)
+#else
+  if (m_data != 0 &&
+      m_data->m_size >= m_used + size &&
       (m_head == 0xffff ||
        m_data->m_count == 1 ||
        m_data->m_dirtyEnd == m_used))
+#endif
     {
       /* enough room, not dirty. */
     }
@@ -133,6 +137,10 @@ bool
 PacketMetadata::IsStateOk (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_data == 0)
+    {
+      return m_used == 0 && m_head == 0xffff && m_tail == 0xffff;
+    }
   bool ok = m_used <= m_data->m_size;
   ok &= IsPointerOk (m_head);
   ok &= IsPointerOk (m_tail);
@@ -375,15 +383,23 @@ uint16_t
 PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
 {
   NS_LOG_FUNCTION (this << item->next << item->prev << item->typeUid << item->size << item->chunkUid);
-  NS_ASSERT (m_data != 0);
   NS_ASSERT (m_used != item->prev && m_used != item->next);
   uint32_t typeUidSize = GetUleb128Size (item->typeUid);
   uint32_t sizeSize = GetUleb128Size (item->size);
   uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
+  if (m_data == 0)
+    {
+      ReserveCopy (n);
+    }
+#ifdef NS3_MTP
+  if (m_used + n > m_data->m_size ||
+      m_data->m_count != 1)
+#else
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
+#endif
     {
       ReserveCopy (n);
     }
@@ -408,7 +424,6 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   NS_LOG_FUNCTION (this << next << prev <<
                    item->next << item->prev << item->typeUid << item->size << item->chunkUid <<
                    extraItem->fragmentStart << extraItem->fragmentEnd << extraItem->packetUid);
-  NS_ASSERT (m_data != 0);
   uint32_t typeUid = ((item->typeUid & 0x1) == 0x1) ? item->typeUid : item->typeUid+1;
   NS_ASSERT (m_used != prev && m_used != next);
 
@@ -418,10 +433,19 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
   uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
 
+  if (m_data == 0)
+    {
+      ReserveCopy (n);
+    }
+#ifdef NS3_MTP
+  if (m_used + n > m_data->m_size ||
+      m_data->m_count != 1)
+#else
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
+#endif
     {
       ReserveCopy (n);
     }
@@ -571,73 +595,39 @@ struct PacketMetadata::Data *
 PacketMetadata::Create (uint32_t size)
 {
   NS_LOG_FUNCTION (size);
-  NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
-  if (size > m_maxSize)
+  // The maximum size only sizes the new buffers: a lost update between
+  // threads is harmless, so relaxed accesses are enough
+  uint32_t maxSize = m_maxSize.load (std::memory_order_relaxed);
+  NS_LOG_LOGIC ("create size="<<size<<", max="<<maxSize);
+  if (size > maxSize)
     {
-      m_maxSize = size;
+      maxSize = size;
+      m_maxSize.store (maxSize, std::memory_order_relaxed);
     }
-  while (!m_freeList.empty ()) 
+  if (maxSize > PACKET_METADATA_DATA_M_DATA_SIZE)
     {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
-      if (data->m_size >= size) 
-        {
-          NS_LOG_LOGIC ("create found size="<<data->m_size);
-          data->m_count = 1;
-          return data;
-        }
-      PacketMetadata::Deallocate (data);
-      NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
+      size = maxSize;
     }
-  NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
-  return PacketMetadata::Allocate (m_maxSize);
-}
-
-void
-PacketMetadata::Recycle (struct PacketMetadata::Data *data)
-{
-  NS_LOG_FUNCTION (data);
-  if (!m_enable)
-    {
-      PacketMetadata::Deallocate (data);
-      return;
-    } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
-  NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
-      data->m_size < m_maxSize) 
-    {
-      PacketMetadata::Deallocate (data);
-    } 
-  else 
-    {
-      m_freeList.push_back (data);
-    }
-}
-
-struct PacketMetadata::Data *
-PacketMetadata::Allocate (uint32_t n)
-{
-  NS_LOG_FUNCTION (n);
-  uint32_t size = sizeof (struct Data);
-  if (n <= PACKET_METADATA_DATA_M_DATA_SIZE)
+  else
     {
-      n = PACKET_METADATA_DATA_M_DATA_SIZE;
+      size = PACKET_METADATA_DATA_M_DATA_SIZE;
     }
-  size += n - PACKET_METADATA_DATA_M_DATA_SIZE;
-  uint8_t *buf = new uint8_t [size];
+  uint32_t capacity;
+  uint8_t *buf = static_cast<uint8_t *> (PacketArena::Allocate (sizeof (struct Data) + size - PACKET_METADATA_DATA_M_DATA_SIZE, &capacity));
   struct PacketMetadata::Data *data = (struct PacketMetadata::Data *)buf;
-  data->m_size = n;
+  // the size class of the block may leave more room than requested
+  data->m_size = std::min<uint32_t> (capacity + PACKET_METADATA_DATA_M_DATA_SIZE - sizeof (struct Data), 0xffff);
   data->m_count = 1;
   data->m_dirtyEnd = 0;
   return data;
 }
-void 
-PacketMetadata::Deallocate (struct PacketMetadata::Data *data)
+
+void
+PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
   NS_LOG_FUNCTION (data);
-  uint8_t *buf = (uint8_t *)data;
-  delete [] buf;
+  NS_ASSERT (data->m_count == 0);
+  PacketArena::Deallocate (data);
 }
 
 
@@ -656,8 +646,12 @@ PacketMetadata::AddHeader (const Header &header, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &header << size);
   NS_ASSERT (IsStateOk ());
-  uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
-  DoAddHeader (uid, size);
+  if (!m_enable)
+    {
+      m_metadataSkipped = true;
+      return;
+    }
+  DoAddHeader (header.GetInstanceTypeId ().GetUid (), size);
   NS_ASSERT (IsStateOk ());
 }
 void
@@ -669,21 +663,36 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-
-  struct PacketMetadata::SmallItem item;
-  item.next = m_head;
-  item.prev = 0xffff;
-  item.typeUid = uid;
-  item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
-  uint16_t written = AddSmall (&item);
-  UpdateHead (written);
+  if (m_nPending == PACKET_METADATA_PENDING_SIZE)
+    {
+      Materialize ();
+    }
+  struct PacketMetadata::PendingHeader *header = &m_pending[m_nPending];
+  header->size = size;
+  header->tid = uid;
+  header->chunkUid = m_chunkUid++;
+  m_nPending++;
+}
+void
+PacketMetadata::Materialize (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint8_t i = 0; i < m_nPending; i++)
+    {
+      struct PacketMetadata::SmallItem item;
+      item.next = m_head;
+      item.prev = 0xffff;
+      item.typeUid = m_pending[i].tid << 1;
+      item.size = m_pending[i].size;
+      item.chunkUid = m_pending[i].chunkUid;
+      uint16_t written = AddSmall (&item);
+      UpdateHead (written);
+    }
+  m_nPending = 0;
 }
 void 
 PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
 {
-  uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
   NS_LOG_FUNCTION (this << &header << size);
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
@@ -691,6 +700,23 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  uint32_t uid = header.GetInstanceTypeId ().GetUid ();
+  if (m_nPending > 0)
+    {
+      const struct PacketMetadata::PendingHeader *pending = &m_pending[m_nPending - 1];
+      if (pending->tid != uid ||
+          pending->size != size)
+        {
+          if (m_enableChecking)
+            {
+              NS_FATAL_ERROR ("Removing unexpected header.");
+            }
+          return;
+        }
+      m_nPending--;
+      return;
+    }
+  uid <<= 1;
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -744,8 +770,7 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
   item.prev = m_tail;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = m_chunkUid++;
   uint16_t written = AddSmall (&item);
   UpdateTail (written);
   NS_ASSERT (IsStateOk ());
@@ -761,6 +786,7 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  Materialize ();
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -808,6 +834,18 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       m_metadataSkipped = true;
       return;
     }
+  if (o.m_nPending > 0)
+    {
+      PacketMetadata other = o;
+      other.Materialize ();
+      AddAtEnd (other);
+      return;
+    }
+  if (m_tail == 0xffff)
+    {
+      // our pending headers, if any, come before the items of o.
+      Materialize ();
+    }
   if (m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
@@ -896,7 +934,7 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       m_metadataSkipped = true;
       return;
     }
-  NS_ASSERT (m_data != 0);
+  Materialize ();
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
   while (current != 0xffff && leftToRemove > 0)
@@ -959,7 +997,7 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
-  NS_ASSERT (m_data != 0);
+  Materialize ();
 
   uint32_t leftToRemove = end;
   uint16_t current = m_tail;
@@ -1019,6 +1057,10 @@ PacketMetadata::GetTotalSize (void) const
 {
   NS_LOG_FUNCTION (this);
   uint32_t totalSize = 0;
+  for (uint8_t i = 0; i < m_nPending; i++)
+    {
+      totalSize += m_pending[i].size;
+    }
   uint16_t current = m_head;
   uint16_t tail = m_tail;
   while (current != 0xffff)
@@ -1054,7 +1096,8 @@ PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buff
     m_buffer (buffer),
     m_current (metadata->m_head),
     m_offset (0),
-    m_hasReadTail (false)
+    m_hasReadTail (false),
+    m_nPending (metadata->m_nPending)
 {
   NS_LOG_FUNCTION (this << metadata << &buffer);
 }
@@ -1062,6 +1105,10 @@ bool
 PacketMetadata::ItemIterator::HasNext (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_nPending > 0)
+    {
+      return true;
+    }
   if (m_current == 0xffff)
     {
       return false;
@@ -1079,12 +1126,24 @@ PacketMetadata::ItemIterator::Next (void)
   struct PacketMetadata::Item item;
   struct PacketMetadata::SmallItem smallItem;
   struct PacketMetadata::ExtraItem extraItem;
-  m_metadata->ReadItems (m_current, &smallItem, &extraItem);
-  if (m_current == m_metadata->m_tail)
+  if (m_nPending > 0)
+    {
+      // the pending headers come first, the most recent one first.
+      const struct PacketMetadata::PendingHeader *pending = &m_metadata->m_pending[--m_nPending];
+      smallItem.typeUid = pending->tid << 1;
+      smallItem.size = pending->size;
+      extraItem.fragmentStart = 0;
+      extraItem.fragmentEnd = pending->size;
+    }
+  else
     {
-      m_hasReadTail = true;
+      m_metadata->ReadItems (m_current, &smallItem, &extraItem);
+      if (m_current == m_metadata->m_tail)
+        {
+          m_hasReadTail = true;
+        }
+      m_current = smallItem.next;
     }
-  m_current = smallItem.next;
   uint32_t uid = (smallItem.typeUid & 0xfffffffe) >> 1;
   item.tid.SetUid (uid);
   item.currentTrimedFromStart = extraItem.fragmentStart;
@@ -1151,6 +1210,13 @@ PacketMetadata::GetSerializedSize (void) const
       return totalSize;
     }
 
+  if (m_nPending > 0)
+    {
+      PacketMetadata metadata = *this;
+      metadata.Materialize ();
+      return metadata.GetSerializedSize ();
+    }
+
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t current = m_head;
@@ -1183,6 +1249,12 @@ uint32_t
 PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
   NS_LOG_FUNCTION (this << &buffer << maxSize);
+  if (m_nPending > 0)
+    {
+      PacketMetadata metadata = *this;
+      metadata.Materialize ();
+      return metadata.Serialize (buffer, maxSize);
+    }
   uint8_t* start = buffer;
 
   buffer = AddToRawU64 (m_packetUid, start, buffer, maxSize);
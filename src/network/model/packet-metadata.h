@@ -21,6 +21,7 @@
 #define PACKET_METADATA_H
 
 #include <stdint.h>
+#include <atomic>
 #include <vector>
 #include <limits>
 #include "ns3/callback.h"
@@ -74,6 +75,20 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * Headers are mostly added and removed at the front of a packet in
+ * stack order, as the packet goes down and up the protocol stacks.
+ * The most recent of these headers are not written to the linked list
+ * right away: they are kept in a small fixed-size stack of
+ * (TypeId uid, size, chunk uid) entries stored in the PacketMetadata
+ * object itself, so that adding and removing them needs neither the
+ * shared data buffer nor its copy-on-write. The ItemIterator and
+ * Serialize report these pending headers in front of the linked list,
+ * and they are written to the linked list only when an operation
+ * needs the whole list (e.g., fragmentation or aggregation). The data
+ * buffer itself is only allocated when the first item is written to
+ * it, so packets created while the metadata is disabled never
+ * allocate it.
  */
 class PacketMetadata 
 {
@@ -149,6 +164,7 @@ private:
     uint16_t m_current; //!< current position
     uint32_t m_offset; //!< offset
     bool m_hasReadTail; //!< true if the metadata tail has been read
+    uint8_t m_nPending; //!< number of pending headers left to read
   };
 
   /**
@@ -410,7 +426,11 @@ private:
    */
   struct Data {
     /** number of references to this struct Data instance. */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> m_count;
+#else
     uint32_t m_count;
+#endif
     /** size (in bytes) of m_data buffer below */
     uint16_t m_size;
     /** max of the m_used field over all objects which
@@ -492,15 +512,24 @@ private:
   };
 
   /**
-   * \brief Class to hold all the metadata
+   * the number of headers which can be kept in
+   * PacketMetadata::m_pending before writing them to the linked list
    */
-  class DataFreeList : public std::vector<struct Data *>
-  {
-public:
-    ~DataFreeList ();
+#define PACKET_METADATA_PENDING_SIZE 4
+
+  /**
+   * \brief A header added to the packet but not yet written to
+   * the linked list.
+   *
+   * It stands for a whole (non-fragmented) header of this packet,
+   * that is, a SmallItem without next and prev fields.
+   */
+  struct PendingHeader {
+    uint32_t size; //!< the size (in bytes) of the header
+    uint16_t tid; //!< the uid of the TypeId of the header (zero for payload)
+    uint16_t chunkUid; //!< the chunk uid of the header
   };
 
-  friend DataFreeList::~DataFreeList ();
   friend class ItemIterator;
 
   PacketMetadata ();
@@ -615,6 +644,10 @@ public:
    * \param size header serialized size
    */
   void DoAddHeader (uint32_t uid, uint32_t size);
+  /**
+   * \brief Write the pending headers to the head of the linked list
+   */
+  void Materialize (void);
   /**
    * \brief Check if the metadata state is ok
    * \returns true if the internal state is ok
@@ -644,19 +677,7 @@ public:
    * \returns a pointer to the created buffer storage
    */
   static struct PacketMetadata::Data *Create (uint32_t size);
-  /**
-   * \brief Allocate a buffer data storage
-   * \param n the storage size to create
-   * \returns a pointer to the allocated buffer storage
-   */
-  static struct PacketMetadata::Data *Allocate (uint32_t n);
-  /**
-   * \brief Deallocate the buffer memory
-   * \param data the buffer data storage
-   */
-  static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList; //!< the metadata data storage
   static bool m_enable; //!< Enable the packet metadata
   static bool m_enableChecking; //!< Enable the packet metadata checking
 
@@ -667,8 +688,13 @@ public:
    */
   static bool m_metadataSkipped;
 
-  static uint32_t m_maxSize; //!< maximum metadata size
+  /// maximum metadata size, a hint read and written by any thread
+  static std::atomic<uint32_t> m_maxSize;
+#ifdef NS3_MTP
+  static std::atomic<uint16_t> m_chunkUid; //!< Chunk Uid
+#else
   static uint16_t m_chunkUid; //!< Chunk Uid
+#endif
 
   struct Data *m_data; //!< Metadata storage
   /*
@@ -680,6 +706,12 @@ public:
   uint16_t m_tail; //!< list tail
   uint16_t m_used; //!< used portion
   uint64_t m_packetUid; //!< packet Uid
+  /**
+   * Headers in front of the linked list which are not yet
+   * written to it; the last one is the first header of the packet.
+   */
+  struct PendingHeader m_pending[PACKET_METADATA_PENDING_SIZE];
+  uint8_t m_nPending; //!< number of pending headers
 };
 
 } // namespace ns3
@@ -687,13 +719,13 @@ public:
 namespace ns3 {
 
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
-  : m_data (PacketMetadata::Create (10)),
+  : m_data (0),
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
-    m_packetUid (uid)
+    m_packetUid (uid),
+    m_nPending (0)
 {
-  memset (m_data->m_data, 0xff, 4);
   if (size > 0)
     {
       DoAddHeader (0, size);
@@ -704,11 +736,18 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_head (o.m_head),
     m_tail (o.m_tail),
     m_used (o.m_used),
-    m_packetUid (o.m_packetUid)
+    m_packetUid (o.m_packetUid),
+    m_nPending (o.m_nPending)
 {
-  NS_ASSERT (m_data != 0);
-  NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
-  m_data->m_count++;
+  for (uint8_t i = 0; i < m_nPending; i++)
+    {
+      m_pending[i] = o.m_pending[i];
+    }
+  if (m_data != 0)
+    {
+      NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
+      m_data->m_count++;
+    }
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -716,27 +755,30 @@ PacketMetadata::operator = (PacketMetadata const& o)
   if (m_data != o.m_data) 
     {
       // not self assignment
-      NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (m_data != 0 && --m_data->m_count == 0)
         {
           PacketMetadata::Recycle (m_data);
         }
       m_data = o.m_data;
-      NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      if (m_data != 0)
+        {
+          m_data->m_count++;
+        }
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
   m_used = o.m_used;
   m_packetUid = o.m_packetUid;
+  m_nPending = o.m_nPending;
+  for (uint8_t i = 0; i < m_nPending; i++)
+    {
+      m_pending[i] = o.m_pending[i];
+    }
   return *this;
 }
 PacketMetadata::~PacketMetadata ()
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_data != 0 && --m_data->m_count == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -22,12 +22,16 @@
 
 /**
 \file   packet-tag-list.h
-\brief  Defines a linked list of Packet tags, including copy-on-write semantics.
+\brief  Defines a small inline array of Packet tags.
 */
 
 #include <stdint.h>
+#include <cstring>
 #include <ostream>
 #include "ns3/type-id.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 namespace ns3 {
 
@@ -43,96 +47,36 @@ class Tag;
  *
  * \internal
  *
- * The implementation of this class is a bit tricky.  Refer to this
- * diagram in the discussion that follows.
+ * Packets seldom carry more than a few packet tags, so the tags are
+ * stored in serialized form in a small array of TagData held in the
+ * PacketTagList itself, in the order in which they were added:
  *
- * \dot
- *    digraph {
- *        rankdir = "LR";
- *        clusterrank = local;
- *        node [ shape = record, fontname="FreeSans", fontsize="10" ];
- *        oth  [ label="<l> Other branch | <n> next | <c> ..." ];
- *        PTL1 [ label="<l> PacketTagList A | <n> m_next" , shape=Mrecord];
- *        PTL2 [ label="<l> PacketTagList B | <n> m_next" , shape=Mrecord];
- *        oth:n  -> T7:l ;
- *        PTL2:n -> T6:l ;
- *        PTL1:n -> T5:l ;
- *        T1   [ label="<l> T1  | <n> next | <c> count = 1" ];
- *        T2   [ label="<l> T2  | <n> next | <c> count = 1" ];
- *        T3   [ label="<l> T3  | <n> next | <c> count = 2" ];
- *        T4   [ label="<l> T4  | <n> next | <c> count = 1" ];
- *        T5   [ label="<l> T5  | <n> next | <c> count = 2" ];
- *        T6   [ label="<l> T6  | <n> next | <c> count = 1" ];
- *        T7   [ label="<l> T7  | <n> next | <c> count = 1" ];
- *        NULL [ label="0", shape = ellipse ];
- *        subgraph cluster_list {
- *          penwidth = 0;
- *          T6:n -> T5:l ;
- *          T5:n -> T4:l ;
- *          T4:n -> T3:l ;
- *          T7:n -> T3:l ;
- *          T3:n -> T2:l ;
- *          T2:n -> T1:l ;
- *          T1:n -> NULL ;
- *        };
- *      };
- * \enddot
+ *   - #Add appends the new tag to the array. When the array is full,
+ *     all the tags are moved to an array twice as large allocated
+ *     from the PacketArena (the SpillData), which the list keeps
+ *     until #RemoveAll.
  *
- *   - Tags are stored in serialized form in a tree of TagData
- *     structures. (<tt>T1-T7</tt> in the diagram)
- *
- *   - Each TagData points (\c next pointers in the diagram)
- *     toward the root of the tree, which is a null pointer.
- *
- *   - \c count is the number of incoming pointers to this
- *     TagData.  Branch points, where branches merge or join, have
- *     <tt>count \> 1</tt> (\c T3, \c T5); successive links along
- *     a branch have <tt>count = 1</tt> (\c T1, \c T2, \c T4, \c T6, \c T7).
- *
- *   - Each PacketTagList points to a specific TagData,
- *     which is the most recent Tag added to the packet. (<tt>T5-T7</tt>)
- *
- *   - Conceptually, therefore, each Packet has a PacketTagList which
- *     points to a singly-linked list of TagData.
- *
- * \par <b> Copy-on-write </b> is implemented as follows:
- *
- *   - #Add prepends the new tag to the list (growing that branch of the tree,
- *     as \c T6). This is a constant time operation, and does not affect
- *     any other #PacketTagList's, hence this is a \c const function.
+ *   - #Peek, #Remove and #Replace look the tag up by its TypeId,
+ *     scanning the array from the most recent tag, which is usually
+ *     the one looked up. #Remove moves the tags added after the
+ *     removed one down by one entry.
  *
  *   - Copy constructor (PacketTagList(const PacketTagList & o))
- *     and assignment (#operator=(const PacketTagList & o))
- *     simply join the tree at the same place as the original
- *     PacketTagList \c o, incrementing the \c count.
- *     For assignment, the old branch is deleted, up to
- *     the first branch point, which has its \c count decremented.
- *     (PacketTagList \c B started as a copy of PacketTagList \c A,
- *     before \c T6 was added to \c B).
- *
- *   - #Remove and #Replace are a little tricky, depending on where the
- *     target tag is found relative to the first branch point:
- *     - \e Target before <em> the first branch point: </em> \n
- *       The target is just dealt with in place (linked around and deleted,
- *       in the case of #Remove; rewritten in the case of #Replace).
- *     - \e Target at or after <em> the first branch point: </em> \n
- *       The portion of the list between the first branch and the target is
- *       shared. This portion is copied before the #Remove or #Replace is
- *       performed.
+ *     and assignment (#operator=(const PacketTagList & o)) copy the
+ *     inline tags, which is cheaper than allocating a list node for
+ *     each tag. The SpillData is shared instead, incrementing its
+ *     \c count, and #Add, #Remove and #Replace copy it before writing
+ *     to it if <tt>count \> 1</tt>.
  *
  * \par <b> Memory Management: </b>
  * \n
  * Packet tags must serialize to a finite maximum size, see TagData
- *
- * This documentation entitles the original author to a free beer.
  */
 class PacketTagList 
 {
 public:
   /**
-   * Tree node for sharing serialized tags.
-   *
-   * See PacketTagList for a discussion of the data structure.
+   * Serialized tag.
    *
    * See TagData::TagData_e for a discussion of the size limit on
    * tag serialization.
@@ -146,15 +90,9 @@ public:
      * in this constant.
      *
      * \internal
-     * Ideally, TagData would be 32 bytes in size, so they require
-     * no padding on 64-bit architectures.  (The architecture
-     * affects the size because of the \c #next pointer.)
-     * This would leave 18 bytes for \c #data.  However,
-     * ns3:Ipv6PacketInfoTag needs 19 bytes!  The current
-     * implementation allows 20 bytes, which gives TagData
-     * a size of 30 bytes on 32-byte machines (which gets
-     * padded with 2 bytes), and 34 bytes on 64-bit machines, which
-     * gets padded to 40 bytes.
+     * ns3:Ipv6PacketInfoTag needs 19 bytes. The current implementation
+     * allows 21 bytes, which gives TagData a size of 24 bytes with
+     * the #tid and one byte of padding.
      */
     enum TagData_e
     {
@@ -162,11 +100,22 @@ public:
   };
 
     uint8_t data[MAX_SIZE];   /**< Serialization buffer */
-    struct TagData * next;   /**< Pointer to next in list */
     TypeId tid;               /**< Type of the tag serialized into #data */
-    uint32_t count;           /**< Number of incoming links */
   };  /* struct TagData */
 
+  /**
+   * \brief Number of tags stored in the PacketTagList itself
+   *
+   * Each inline tag makes every Packet larger by sizeof (TagData), and
+   * is copied with the Packet even when unused, so the array only holds
+   * the one or two tags most packets carry: with four, copying and
+   * peeking at packets was slower than with the former list.
+   */
+  enum PacketTagList_e
+  {
+    INLINE_SIZE = 2           /**< Size of the inline array #m_inline */
+  };
+
   /**
    * Create a new PacketTagList.
    */
@@ -176,8 +125,7 @@ public:
    *
    * \param [in] o The PacketTagList to copy.
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This copies the tags of \pname{o}.
    */
   inline PacketTagList (PacketTagList const &o);
   /**
@@ -186,19 +134,19 @@ public:
    * \param [in] o The PacketTagList to copy.
    * \returns the copied object
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This replaces the tags of this list by copies of the tags
+   * of \pname{o}.
    */
   inline PacketTagList &operator = (PacketTagList const &o);
   /**
    * Destructor
    *
-   * #RemoveAll's the tags up to the first merge.
+   * #RemoveAll's the tags.
    */
   inline ~PacketTagList ();
 
   /**
-   * Add a tag to the head of this branch.
+   * Add a tag to the list.
    *
    * \param [in] tag The tag to add
    */
@@ -230,67 +178,79 @@ public:
    */
   bool Peek (Tag &tag) const;
   /**
-   * Remove all tags from this list (up to the first merge).
+   * Remove all tags from this list, and release the SpillData.
    */
   inline void RemoveAll (void);
   /**
-   * \returns pointer to head of tag list
+   * \returns pointer to the first (oldest) tag of the list
+   */
+  inline const struct PacketTagList::TagData *Begin (void) const;
+  /**
+   * \returns pointer past the last (most recent) tag of the list
    */
-  const struct PacketTagList::TagData *Head (void) const;
+  inline const struct PacketTagList::TagData *End (void) const;
 
 private:
   /**
-   * Typedef of method function pointer for copy-on-write operations
-   *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True if operation successful, false otherwise
+   * Spill array, shared copy-on-write by the lists copied from the
+   * list which allocated it.
+   */
+  struct SpillData
+  {
+#ifdef NS3_MTP
+    std::atomic<uint32_t> count; /**< Number of lists sharing the array */
+#else
+    uint32_t count;           /**< Number of lists sharing the array */
+#endif
+    uint32_t capacity;        /**< Number of tags which fit in #tags */
+    struct TagData tags[1];   /**< The tags, allocated past the end */
+  };
+
+  /**
+   * \returns pointer to the array of tags
    */
-  typedef bool (PacketTagList::*COWWriter)
-    (Tag       & tag, bool         preMerge,
-    struct TagData * cur, struct TagData ** prevNext);
+  inline struct PacketTagList::TagData *GetTags (void);
   /**
-   * Traverse the list implementing copy-on-write, using \pname{Writer}.
+   * Look a tag up.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] Writer The copy-on-write function to use.
-   * \returns True if \pname{tag} found, false otherwise.
+   * \param [in] tid The TypeId of the tag to find.
+   * \returns the index of the tag in the array, or -1 if the
+   *          list has no tag of this type.
    */
-  bool COWTraverse   (Tag & tag, PacketTagList::COWWriter Writer);
+  inline int32_t Find (TypeId tid) const;
   /**
-   * Copy-on-write implementing Remove.
+   * Copy the tags of another list, replacing the tags of this list.
    *
-   * \param [in] tag The target tag type to remove.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag will definitely be removed.
+   * \param [in] o The PacketTagList to copy.
    */
-  bool RemoveWriter  (Tag       & tag, bool         preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
+  inline void Assign (PacketTagList const &o);
   /**
-   * Copy-on-write implementing Replace
+   * Move the tags to a new SpillData of at least \pname{n} tags.
    *
-   * \param [in] tag The target tag type to replace
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *          false otherwise.
-   * \param [in] cur Pointer to the tag
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag value will definitely be replaced.
+   * \param [in] n The number of tags the array must hold.
+   */
+  void Reserve (uint32_t n);
+  /**
+   * Copy the SpillData if it is shared with other lists, before
+   * writing to it.
+   */
+  inline void Unshare (void);
+  /**
+   * Release the SpillData, deleting it if this was the last list
+   * sharing it, and go back to the inline array.
    */
-  bool ReplaceWriter (Tag & tag, bool preMerge, struct TagData * cur, struct TagData ** prevNext);
+  void Release (void);
 
   /**
-   * Pointer to first \ref TagData on the list
+   * Storage of the tags while there are at most INLINE_SIZE of them
+   */
+  struct TagData m_inline[INLINE_SIZE];
+  /**
+   * Storage of the tags when the inline array overflowed, or 0
    */
-  struct TagData *m_next;
+  struct SpillData *m_spill;
+  uint16_t m_size;     //!< number of tags in the list
+  uint16_t m_capacity; //!< number of tags which fit in the current array
 };
 
 } // namespace ns3
@@ -302,33 +262,29 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_spill (0),
+    m_size (0),
+    m_capacity (INLINE_SIZE)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_spill (0),
+    m_size (0),
+    m_capacity (INLINE_SIZE)
 {
-  if (m_next != 0)
-    {
-      m_next->count++;
-    }
+  Assign (o);
 }
 
 PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o) 
     {
       return *this;
     }
-  RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
-    {
-      m_next->count++;
-    }
+  Assign (o);
   return *this;
 }
 
@@ -340,25 +296,74 @@ PacketTagList::~PacketTagList ()
 void
 PacketTagList::RemoveAll (void)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  m_size = 0;
+  if (m_spill != 0)
     {
-      cur->count--;
-      if (cur->count > 0) 
-        {
-          break;
-        }
-      if (prev != 0) 
+      Release ();
+    }
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::Begin (void) const
+{
+  return m_spill != 0 ? m_spill->tags : m_inline;
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::End (void) const
+{
+  return Begin () + m_size;
+}
+
+struct PacketTagList::TagData *
+PacketTagList::GetTags (void)
+{
+  return m_spill != 0 ? m_spill->tags : m_inline;
+}
+
+void
+PacketTagList::Assign (PacketTagList const &o)
+{
+  if (m_spill != 0)
+    {
+      Release ();
+    }
+  if (o.m_spill != 0)
+    {
+      m_spill = o.m_spill;
+      m_spill->count++;
+      m_capacity = o.m_capacity;
+    }
+  else
+    {
+      // TypeId is a plain uid, so the tags can be copied as bytes,
+      // and copying the whole array avoids a call to memcpy
+      std::memcpy (static_cast<void *> (m_inline), o.m_inline, sizeof (m_inline));
+    }
+  m_size = o.m_size;
+}
+
+int32_t
+PacketTagList::Find (TypeId tid) const
+{
+  const struct TagData *tags = Begin ();
+  for (int32_t i = m_size - 1; i >= 0; i--)
+    {
+      if (tags[i].tid == tid)
         {
-	  delete prev;
+          return i;
         }
-      prev = cur;
     }
-  if (prev != 0) 
+  return -1;
+}
+
+void
+PacketTagList::Unshare (void)
+{
+  if (m_spill != 0 && m_spill->count > 1)
     {
-      delete prev;
+      Reserve (m_capacity);
     }
-  m_next = 0;
 }
 
 } // namespace ns3
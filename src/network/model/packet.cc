@@ -28,7 +28,13 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("Packet");
 
+#ifdef NS3_MTP
+std::atomic<uint32_t> Packet::m_globalUid (0);
+#else
 uint32_t Packet::m_globalUid = 0;
+#endif
+thread_local uint32_t *Packet::m_uidCounter = 0;
+thread_local uint32_t Packet::m_uidSpace = 0;
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -81,22 +87,24 @@ ByteTagIterator::ByteTagIterator (ByteTagList::Iterator i)
 }
 
 
-PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *head)
-  : m_current (head)
+PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *begin,
+                                      const struct PacketTagList::TagData *end)
+  : m_begin (begin),
+    m_current (end)
 {
 }
 bool
 PacketTagIterator::HasNext (void) const
 {
-  return m_current != 0;
+  return m_current != m_begin;
 }
 PacketTagIterator::Item
 PacketTagIterator::Next (void)
 {
   NS_ASSERT (HasNext ());
-  const struct PacketTagList::TagData *prev = m_current;
-  m_current = m_current->next;
-  return PacketTagIterator::Item (prev);
+  // the most recent tags first
+  m_current--;
+  return PacketTagIterator::Item (m_current);
 }
 
 PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
@@ -135,12 +143,29 @@ Packet::Packet ()
      * metadata is for the system id. For non-
      * distributed simulations, this is simply 
      * zero.  The lower 32 bits are for the 
-     * global UID
+     * global UID, see AllocateUid
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (AllocateUid (), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
+}
+
+uint64_t
+Packet::AllocateUid (void)
+{
+  if (m_uidCounter != 0)
+    {
+      return static_cast<uint64_t> (m_uidSpace) << 32 | (*m_uidCounter)++;
+    }
+  return static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid++;
+}
+
+void
+Packet::SetUidCounter (uint32_t space, uint32_t *counter)
+{
+  NS_LOG_FUNCTION (space << counter);
+  m_uidSpace = space;
+  m_uidCounter = counter;
 }
 
 Packet::Packet (const Packet &o)
@@ -177,12 +202,11 @@ Packet::Packet (uint32_t size)
      * metadata is for the system id. For non-
      * distributed simulations, this is simply 
      * zero.  The lower 32 bits are for the 
-     * global UID
+     * global UID, see AllocateUid
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -203,12 +227,11 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * metadata is for the system id. For non-
      * distributed simulations, this is simply 
      * zero.  The lower 32 bits are for the 
-     * global UID
+     * global UID, see AllocateUid
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
@@ -881,7 +904,7 @@ Packet::PrintPacketTags (std::ostream &os) const
 PacketTagIterator 
 Packet::GetPacketTagIterator (void) const
 {
-  return PacketTagIterator (m_packetTagList.Head ());
+  return PacketTagIterator (m_packetTagList.Begin (), m_packetTagList.End ());
 }
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet)
@@ -34,6 +34,9 @@
 #include "ns3/assert.h"
 #include "ns3/ptr.h"
 #include "ns3/deprecated.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 namespace ns3 {
 
@@ -169,9 +172,12 @@ private:
   friend class Packet;
   /**
    * Constructor
-   * \param head head of the items
+   * \param begin the oldest item
+   * \param end past the most recent item
    */
-  PacketTagIterator (const struct PacketTagList::TagData *head);
+  PacketTagIterator (const struct PacketTagList::TagData *begin,
+                     const struct PacketTagList::TagData *end);
+  const struct PacketTagList::TagData *m_begin;    //!< the oldest tag in the packet
   const struct PacketTagList::TagData *m_current;  //!< actual position over the set of tags in a packet
 };
 
@@ -502,6 +508,22 @@ public:
    */
   static void EnableChecking (void);
 
+  /**
+   * \brief Allocate the uids of the packets created by this thread
+   * from another counter.
+   *
+   * The uid of a packet holds the system id in its upper 32 bits and a
+   * global counter in its lower 32 bits, so when several threads create
+   * packets the uids depend on how the threads interleave. A simulator
+   * running logical processes on several threads gives each of them its
+   * own counter while running it, which keeps the uids reproducible.
+   *
+   * \param [in] space The upper 32 bits of the uids.
+   * \param [in] counter The counter of the lower 32 bits, or 0 to use
+   *            the system id and the global counter again.
+   */
+  static void SetUidCounter (uint32_t space, uint32_t *counter);
+
   /**
    * \brief Returns number of bytes required for packet
    * serialization.
@@ -719,6 +741,11 @@ private:
    */
   uint32_t Deserialize (uint8_t const*buffer, uint32_t size);
 
+  /**
+   * \returns The uid of a new packet, see SetUidCounter.
+   */
+  static uint64_t AllocateUid (void);
+
   Buffer m_buffer;                //!< the packet buffer (it's actual contents)
   ByteTagList m_byteTagList;      //!< the ByteTag list
   PacketTagList m_packetTagList;  //!< the packet's Tag list
@@ -727,7 +754,13 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
+#ifdef NS3_MTP
+  static std::atomic<uint32_t> m_globalUid; //!< Global counter of packets Uid
+#else
   static uint32_t m_globalUid; //!< Global counter of packets Uid
+#endif
+  static thread_local uint32_t *m_uidCounter; //!< Counter of the uids of this thread, or 0
+  static thread_local uint32_t m_uidSpace;    //!< Upper 32 bits of the uids of m_uidCounter
 };
 
 /**
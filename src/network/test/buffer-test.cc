@@ -22,6 +22,8 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/double.h"
 #include "ns3/test.h"
+#include <algorithm>
+#include <vector>
 
 using namespace ns3;
 
@@ -360,6 +362,95 @@ BufferTest::DoRun (void)
   val2 |= i.ReadU8 ();
   NS_TEST_ASSERT_MSG_EQ (val1, val2, "Bad ReadNtohU16()");
 }
+//-----------------------------------------------------------------------------
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Check that aggregating buffers keeps their zero areas virtual
+ */
+class BufferZeroAreaTest : public TestCase
+{
+public:
+  BufferZeroAreaTest ();
+private:
+  virtual void DoRun (void);
+  /**
+   * Check the bytes and the checksum of a buffer
+   * \param buffer the buffer
+   * \param expected the expected bytes
+   * \param msg the context of the check
+   */
+  void Check (const Buffer &buffer, const std::vector<uint8_t> &expected, const char *msg);
+};
+
+BufferZeroAreaTest::BufferZeroAreaTest ()
+  : TestCase ("Buffer zero areas")
+{
+}
+
+void
+BufferZeroAreaTest::Check (const Buffer &buffer, const std::vector<uint8_t> &expected, const char *msg)
+{
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), expected.size (), msg);
+  std::vector<uint8_t> bytes (buffer.GetSize ());
+  buffer.CopyData (&bytes[0], bytes.size ());
+  bool same = bytes == expected;
+  NS_TEST_EXPECT_MSG_EQ (same, true, msg);
+
+  Buffer real;
+  real.AddAtStart (expected.size ());
+  real.Begin ().Write (&expected[0], expected.size ());
+  uint16_t size = std::min<uint32_t> (expected.size (), 65535);
+  NS_TEST_EXPECT_MSG_EQ (buffer.Begin ().CalculateIpChecksum (size), real.Begin ().CalculateIpChecksum (size), msg);
+}
+
+void
+BufferZeroAreaTest::DoRun (void)
+{
+  // A payload of zeroes behind a header of odd size, cut in fragments
+  Buffer packet (40000);
+  packet.AddAtStart (3);
+  packet.Begin ().Write ((const uint8_t *)"abc", 3);
+  std::vector<uint8_t> expected (40003, 0);
+  expected[0] = 'a';
+  expected[1] = 'b';
+  expected[2] = 'c';
+
+  Buffer reassembled;
+  for (uint32_t start = 0; start < packet.GetSize (); start += 1000)
+    {
+      reassembled.AddAtEnd (packet.CreateFragment (start, std::min<uint32_t> (1000, packet.GetSize () - start)));
+    }
+  Check (reassembled, expected, "Bad reassembled payload");
+  NS_TEST_EXPECT_MSG_LT (reassembled.GetSerializedSize (), 100U, "The zero area was written out");
+
+  // Bytes after the zero area
+  Buffer trailer;
+  trailer.AddAtStart (2);
+  trailer.Begin ().Write ((const uint8_t *)"de", 2);
+  reassembled.AddAtEnd (trailer);
+  expected.push_back ('d');
+  expected.push_back ('e');
+  Check (reassembled, expected, "Bad trailer");
+  NS_TEST_EXPECT_MSG_LT (reassembled.GetSerializedSize (), 100U, "The zero area was written out for a trailer");
+
+  // A smaller zero area is written out
+  reassembled.AddAtEnd (Buffer (1000));
+  expected.insert (expected.end (), 1000, 0);
+  Check (reassembled, expected, "Bad smaller zero area");
+  NS_TEST_EXPECT_MSG_LT (reassembled.GetSerializedSize (), 1100U, "The larger zero area was written out");
+
+  // A larger zero area is kept
+  Buffer header;
+  header.AddAtStart (1);
+  header.Begin ().WriteU8 ('f');
+  header.AddAtEnd (reassembled);
+  expected.insert (expected.begin (), 'f');
+  Check (header, expected, "Bad larger zero area");
+  NS_TEST_EXPECT_MSG_LT (header.GetSerializedSize (), 1100U, "The larger zero area was written out when prepending");
+}
+
 //-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
 {
@@ -371,6 +462,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest, TestCase::QUICK);
+  AddTestCase (new BufferZeroAreaTest, TestCase::QUICK);
 }
 
 static BufferTestSuite g_bufferTestSuite;
@@ -821,6 +821,44 @@ PacketMetadataTest::DoRun (void)
                                  p3->GetSize ());
   delete [] buf;
   NS_TEST_EXPECT_MSG_EQ (msg, std::string ("hello world"), "Could not find original data in received packet");
+
+  // headers pushed and popped across the pending headers and the list.
+  p = Create<Packet> (100);
+  ADD_HEADER (p, 1);
+  ADD_HEADER (p, 2);
+  ADD_HEADER (p, 3);
+  ADD_HEADER (p, 4);
+  ADD_HEADER (p, 5);
+  ADD_HEADER (p, 6);
+  p1 = p->Copy ();
+  REM_HEADER (p1, 6);
+  REM_HEADER (p1, 5);
+  REM_HEADER (p1, 4);
+  CHECK_HISTORY (p1, 4, 3, 2, 1, 100);
+  ADD_HEADER (p1, 7);
+  ADD_TRAILER (p1, 8);
+  CHECK_HISTORY (p1, 6, 7, 3, 2, 1, 100, 8);
+  CHECK_HISTORY (p, 7, 6, 5, 4, 3, 2, 1, 100);
+  REM_HEADER (p1, 7);
+  REM_HEADER (p1, 3);
+  REM_HEADER (p1, 2);
+  REM_HEADER (p1, 1);
+  REM_TRAILER (p1, 8);
+  CHECK_HISTORY (p1, 1, 100);
+
+  // fragments and aggregates of packets with pending headers.
+  p = Create<Packet> (100);
+  ADD_HEADER (p, 10);
+  p1 = p->CreateFragment (0, 60);
+  p2 = p->CreateFragment (60, 50);
+  CHECK_HISTORY (p1, 2, 10, 50);
+  CHECK_HISTORY (p2, 1, 50);
+  ADD_HEADER (p2, 5);
+  p3 = Create<Packet> ();
+  ADD_HEADER (p3, 4);
+  p3->AddAtEnd (p1);
+  p3->AddAtEnd (p2);
+  CHECK_HISTORY (p3, 5, 4, 10, 50, 5, 50);
 }
 //-----------------------------------------------------------------------------
 class PacketMetadataTestSuite : public TestSuite
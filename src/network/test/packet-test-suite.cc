@@ -21,6 +21,14 @@
 #include "ns3/packet-tag-list.h"
 #include "ns3/test.h"
 #include "ns3/unused.h"
+#include "ns3/packet-arena.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#endif
 #include <limits>     // std:numeric_limits
 #include <string>
 #include <cstdarg>
@@ -847,6 +855,94 @@ PacketTagListTest::DoRun (void)
     
 }
 
+//-----------------------------------------------------------------------------
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Check that the packet memory is recycled by the thread which
+ * allocated it.
+ */
+class PacketArenaTest : public TestCase
+{
+public:
+  PacketArenaTest ();
+private:
+  void DoRun (void);
+#ifdef HAVE_PTHREAD_H
+  /// Create packets, then recreate them once destroyed by the main thread
+  void Produce (void);
+
+  std::vector<Ptr<Packet> > m_packets; //!< packets passed to the main thread
+  std::atomic<int> m_step;             //!< progress of the threads
+  uint64_t m_hits;                     //!< hits of the second round of the producer
+#endif
+};
+
+PacketArenaTest::PacketArenaTest ()
+  : TestCase ("Packet memory arenas")
+{
+}
+
+#ifdef HAVE_PTHREAD_H
+void
+PacketArenaTest::Produce (void)
+{
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      m_packets.push_back (Create<Packet> (1000));
+    }
+  m_step = 1;
+  while (m_step != 2)
+    {
+      std::this_thread::yield ();
+    }
+  uint64_t hits = PacketArena::GetStatistics ().hits;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      m_packets.push_back (Create<Packet> (1000));
+    }
+  m_hits = PacketArena::GetStatistics ().hits - hits;
+  m_packets.clear ();
+}
+#endif
+
+void
+PacketArenaTest::DoRun (void)
+{
+  PacketArena::Statistics before = PacketArena::GetStatistics ();
+  Create<Packet> (1000);
+  Create<Packet> (1000);
+  PacketArena::Statistics after = PacketArena::GetStatistics ();
+  NS_TEST_EXPECT_MSG_GT (after.hits, before.hits, "The memory of the first packet was not recycled");
+
+  uint32_t capacity;
+  void *block = PacketArena::Allocate (100, &capacity);
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (capacity, 100U, "The block is too small");
+  PacketArena::Deallocate (block);
+  block = PacketArena::Allocate (1 << 24, &capacity);
+  NS_TEST_EXPECT_MSG_EQ (capacity, 1U << 24, "A large block is not pooled");
+  PacketArena::Deallocate (block);
+
+#ifdef HAVE_PTHREAD_H
+  m_step = 0;
+  m_hits = 0;
+  Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&PacketArenaTest::Produce, this));
+  thread->Start ();
+  while (m_step != 1)
+    {
+      std::this_thread::yield ();
+    }
+  before = PacketArena::GetStatistics ();
+  m_packets.clear ();
+  after = PacketArena::GetStatistics ();
+  m_step = 2;
+  thread->Join ();
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (after.remoteFrees - before.remoteFrees, 100U, "The packets were not returned to their thread");
+  NS_TEST_EXPECT_MSG_EQ (m_hits, after.remoteFrees - before.remoteFrees, "The packets returned were not recycled");
+#endif
+}
+
 //-----------------------------------------------------------------------------
 class PacketTestSuite : public TestSuite
 {
@@ -859,6 +955,7 @@ PacketTestSuite::PacketTestSuite ()
 {
   AddTestCase (new PacketTest, TestCase::QUICK);
   AddTestCase (new PacketTagListTest, TestCase::QUICK);
+  AddTestCase (new PacketArenaTest, TestCase::QUICK);
 }
 
 static PacketTestSuite g_packetTestSuite;
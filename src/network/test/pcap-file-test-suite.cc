@@ -25,6 +25,14 @@
 #include "ns3/log.h"
 #include "ns3/test.h"
 #include "ns3/pcap-file.h"
+#include "ns3/pcap-file-wrapper.h"
+#include "ns3/async-file-writer.h"
+#include "ns3/checkpoint.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include <vector>
+#include <unistd.h>
 
 using namespace ns3;
 
@@ -1121,6 +1129,296 @@ DiffTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (usec, 3696, "Files are different from 2.3696 seconds");
 }
 
+// ===========================================================================
+// Test case to make sure that asynchronous files have the same contents as
+// the files written synchronously.
+// ===========================================================================
+class AsynchronousWriteTestCase : public TestCase
+{
+public:
+  AsynchronousWriteTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Write packets to a pcap file.
+   * \param filename the name of the file
+   * \param async whether to write the file asynchronously
+   */
+  void WriteFile (std::string filename, bool async);
+};
+
+/**
+ * \param filename the name of a file
+ * \return the contents of the file
+ */
+static std::vector<uint8_t>
+ReadFileContents (std::string filename)
+{
+  std::vector<uint8_t> contents;
+  FILE * p = std::fopen (filename.c_str (), "rb");
+  if (p == 0)
+    {
+      return contents;
+    }
+  int c;
+  while ((c = std::fgetc (p)) != EOF)
+    {
+      contents.push_back (c);
+    }
+  std::fclose (p);
+  return contents;
+}
+
+AsynchronousWriteTestCase::AsynchronousWriteTestCase ()
+  : TestCase ("Check that asynchronous files are the same as the synchronous ones")
+{
+}
+
+void
+AsynchronousWriteTestCase::WriteFile (std::string filename, bool async)
+{
+  PcapFile f;
+  f.SetAsynchronous (async);
+  f.Open (filename, std::ios::out);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << filename << ", \"std::ios::out\") returns error");
+  f.Init (1, 100000);
+
+  uint8_t data[N_PACKET_BYTES];
+  for (uint32_t i = 0; i < N_PACKET_BYTES; ++i)
+    {
+      data[i] = i;
+    }
+  LlcSnapHeader header;
+  header.SetType (0x0800);
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      // some packets are larger than the blocks of the writer
+      uint32_t size = i % 100 == 0 ? 70000 : i * 7 % 1500;
+      f.Write (i, i * 3, data, N_PACKET_BYTES);
+      f.Write (i, i * 5, Create<Packet> (size));
+      f.Write (i, i * 7, header, Create<Packet> (size));
+      NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Write must not fail");
+    }
+  f.Close ();
+}
+
+void
+AsynchronousWriteTestCase::DoRun (void)
+{
+  std::string syncFilename = CreateTempDirFilename ("sync.pcap");
+  std::string asyncFilename = CreateTempDirFilename ("async.pcap");
+  WriteFile (syncFilename, false);
+  WriteFile (asyncFilename, true);
+
+  std::vector<uint8_t> expected = ReadFileContents (syncFilename);
+  NS_TEST_ASSERT_MSG_EQ ((ReadFileContents (asyncFilename) == expected), true,
+                         "Asynchronous file differs from the synchronous one");
+  uint32_t sec (0), usec (0), packets (0);
+  bool diff = PcapFile::Diff (syncFilename, asyncFilename, sec, usec, packets, 100000);
+  NS_TEST_EXPECT_MSG_EQ (diff, false, "PcapDiff(sync, async) must be false");
+  NS_TEST_EXPECT_MSG_EQ (packets, 3000, "Unexpected number of packets");
+
+  //
+  // A writer with a ring of two tiny blocks waits for the background thread
+  // and splits the data over the blocks.
+  //
+  expected.resize (20000);
+  std::string smallFilename = CreateTempDirFilename ("small.bin");
+  AsyncFileWriter writer (7, 2);
+  writer.Open (smallFilename);
+  for (uint32_t i = 0; i < expected.size (); i += 1000)
+    {
+      uint32_t n = std::min<uint32_t> (1000, expected.size () - i);
+      if (n <= 7)
+        {
+          std::memcpy (writer.Reserve (n), &expected[i], n);
+        }
+      else
+        {
+          writer.Write (&expected[i], n);
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ ((writer.Reserve (8) == 0), true, "Reserved more than a block");
+  writer.Close ();
+  NS_TEST_EXPECT_MSG_EQ (writer.Fail (), false, "Write must not fail");
+  NS_TEST_ASSERT_MSG_EQ ((ReadFileContents (smallFilename) == expected), true,
+                         "The file differs from the data written");
+
+  remove (syncFilename.c_str ());
+  remove (asyncFilename.c_str ());
+  remove (smallFilename.c_str ());
+}
+
+// ===========================================================================
+// Test case to make sure that asynchronous files are still written after
+// the process forks.
+// ===========================================================================
+class AsynchronousBranchTestCase : public TestCase
+{
+public:
+  AsynchronousBranchTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AsynchronousBranchTestCase::AsynchronousBranchTestCase ()
+  : TestCase ("Check that asynchronous files are written across Checkpoint::Branch")
+{
+}
+
+/**
+ * Write data to a writer with a ring of two tiny blocks, which keeps the
+ * background thread busy.
+ *
+ * \param writer the writer
+ * \param data the data
+ * \param begin the first byte of data to write
+ * \param end the byte after the last one to write
+ */
+static void
+WriteSlowly (AsyncFileWriter &writer, std::vector<uint8_t> const &data, uint32_t begin, uint32_t end)
+{
+  for (uint32_t i = begin; i < end; i += 1000)
+    {
+      writer.Write (&data[i], std::min<uint32_t> (1000, end - i));
+    }
+}
+
+void
+AsynchronousBranchTestCase::DoRun (void)
+{
+  std::vector<uint8_t> expected (20000);
+  for (uint32_t i = 0; i < expected.size (); ++i)
+    {
+      expected[i] = i * 7;
+    }
+
+  // Blocks of this file are queued when the process forks
+  std::string filename = CreateTempDirFilename ("before-branch.bin");
+  AsyncFileWriter writer (7, 2);
+  writer.Open (filename);
+  WriteSlowly (writer, expected, 0, 10000);
+
+  uint32_t branch = Checkpoint::Branch (2, 2);
+  if (branch != 0)
+    {
+      std::ostringstream name;
+      name << "branch-" << branch << ".bin";
+      std::string branchFilename = CreateTempDirFilename (name.str ());
+      AsyncFileWriter branchWriter (7, 2);
+      branchWriter.Open (branchFilename);
+      WriteSlowly (branchWriter, expected, 0, expected.size ());
+      branchWriter.Close ();
+      bool ok = !branchWriter.Fail () && ReadFileContents (branchFilename) == expected;
+      remove (branchFilename.c_str ());
+      // Leave the test runner and the file opened before the branch to the
+      // original process
+      _exit (ok ? 10 + branch : 1);
+    }
+
+  for (uint32_t i = 1; i <= 2; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (Checkpoint::GetExitStatus (i), static_cast<int> (10 + i), "Branch " << i << " could not write its file");
+    }
+  WriteSlowly (writer, expected, 10000, expected.size ());
+  writer.Close ();
+  NS_TEST_EXPECT_MSG_EQ (writer.Fail (), false, "Write must not fail");
+  NS_TEST_EXPECT_MSG_EQ ((ReadFileContents (filename) == expected), true,
+                         "The file differs from the data written around the branch");
+  remove (filename.c_str ());
+}
+
+// ===========================================================================
+// Test case to make sure that several PcapFileWrapper write the blocks of
+// their interfaces to a pcapng file.
+// ===========================================================================
+class PcapNgTestCase : public TestCase
+{
+public:
+  PcapNgTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+PcapNgTestCase::PcapNgTestCase ()
+  : TestCase ("Check that PcapFileWrapper can write interfaces of a pcapng file")
+{
+}
+
+/**
+ * \param contents the contents of a file
+ * \param offset the offset of a 32 bit word in the file
+ * \return the word
+ */
+static uint32_t
+ReadU32 (std::vector<uint8_t> const &contents, uint32_t offset)
+{
+  uint32_t value;
+  std::memcpy (&value, &contents[offset], sizeof (value));
+  return value;
+}
+
+void
+PcapNgTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("interfaces.pcapng");
+  for (uint32_t async = 0; async < 2; async++)
+    {
+      Ptr<PcapFileWrapper> a = CreateObject<PcapFileWrapper> ();
+      Ptr<PcapFileWrapper> b = CreateObject<PcapFileWrapper> ();
+      a->SetAttribute ("PcapNgFile", StringValue (filename));
+      a->SetAttribute ("Asynchronous", BooleanValue (async));
+      b->SetAttribute ("PcapNgFile", StringValue (filename));
+      b->SetAttribute ("NanosecMode", BooleanValue (true));
+      a->Open ("node-0.pcap", std::ios::out);
+      b->Open ("node-1.pcap", std::ios::out);
+      a->Init (1);
+      b->Init (9, 100);
+      NS_TEST_ASSERT_MSG_EQ (a->Fail () || b->Fail (), false, "Init returns error");
+      a->Write (Seconds (1), Create<Packet> (10));
+      b->Write (Seconds (2), Create<Packet> (1000));
+      a->Write (Seconds (3), Create<Packet> (3));
+      a->Close ();
+      b->Close ();
+
+      //
+      // Walk the blocks: a section header, two interfaces and three packets
+      //
+      std::vector<uint8_t> contents = ReadFileContents (filename);
+      uint32_t types[] = { 0x0a0d0d0a, 1, 1, 6, 6, 6 };
+      uint32_t interfaces[] = { 0, 1, 0 };
+      uint32_t lengths[] = { 10, 100, 3 };
+      uint64_t timestamps[] = { 1000000, 2000000000, 3000000 };
+      uint32_t offset = 0;
+      for (uint32_t i = 0; i < 6; i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ ((offset + 12 <= contents.size ()), true, "Missing block " << i);
+          NS_TEST_ASSERT_MSG_EQ (ReadU32 (contents, offset), types[i], "Unexpected type of block " << i);
+          uint32_t length = ReadU32 (contents, offset + 4);
+          NS_TEST_ASSERT_MSG_EQ ((length % 4 == 0 && offset + length <= contents.size ()), true, "Bad length of block " << i);
+          NS_TEST_ASSERT_MSG_EQ (ReadU32 (contents, offset + length - 4), length, "Bad trailing length of block " << i);
+          if (i == 0)
+            {
+              NS_TEST_EXPECT_MSG_EQ (ReadU32 (contents, offset + 8), 0x1a2b3c4d, "Bad byte order magic");
+            }
+          if (i >= 3)
+            {
+              uint32_t j = i - 3;
+              uint64_t ts = (uint64_t (ReadU32 (contents, offset + 12)) << 32) | ReadU32 (contents, offset + 16);
+              NS_TEST_EXPECT_MSG_EQ (ReadU32 (contents, offset + 8), interfaces[j], "Bad interface of packet " << j);
+              NS_TEST_EXPECT_MSG_EQ (ts, timestamps[j], "Bad timestamp of packet " << j);
+              NS_TEST_EXPECT_MSG_EQ (ReadU32 (contents, offset + 20), lengths[j], "Bad captured length of packet " << j);
+            }
+          offset += length;
+        }
+      NS_TEST_EXPECT_MSG_EQ (offset, contents.size (), "Unexpected data after the blocks");
+    }
+  remove (filename.c_str ());
+}
+
 class PcapFileTestSuite : public TestSuite
 {
 public:
@@ -1138,6 +1436,9 @@ PcapFileTestSuite::PcapFileTestSuite ()
   AddTestCase (new RecordHeaderTestCase, TestCase::QUICK);
   AddTestCase (new ReadFileTestCase, TestCase::QUICK);
   AddTestCase (new DiffTestCase, TestCase::QUICK);
+  AddTestCase (new AsynchronousWriteTestCase, TestCase::QUICK);
+  AddTestCase (new AsynchronousBranchTestCase, TestCase::QUICK);
+  AddTestCase (new PcapNgTestCase, TestCase::QUICK);
 }
 
 static PcapFileTestSuite pcapFileTestSuite;
@@ -0,0 +1,395 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "async-file-writer.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AsyncFileWriter");
+
+/**
+ * \brief The thread writing the queued blocks of all the files
+ *
+ * The Flusher is created with the first file which queues a block, and
+ * is never destroyed, so that the files closed by static destructors can
+ * still be written.
+ *
+ * Only the forking thread survives a fork, so the Flusher writes all the
+ * queued blocks and holds its mutex across the fork, then starts a new
+ * thread in the child process.
+ */
+class AsyncFileWriter::Flusher
+{
+public:
+  /**
+   * \return the Flusher, created on demand
+   */
+  static Flusher *Get (void);
+
+  std::mutex m_mutex;              //!< protects the queue and the blocks of the files
+  std::condition_variable m_work;  //!< notified when a file is queued
+  std::deque<AsyncFileWriter *> m_queue; //!< the files with full blocks
+
+private:
+  Flusher ();
+  /**
+   * Entry point of the thread
+   */
+  void Run (void);
+  /**
+   * Called before fork: wait until the queue is written and keep the mutex
+   */
+  static void Prepare (void);
+  /**
+   * Called after fork in the parent process: release the mutex
+   */
+  static void Parent (void);
+  /**
+   * Called after fork in the child process: release the mutex and start
+   * a new thread
+   */
+  static void Child (void);
+  /**
+   * Write blocks to a file.
+   *
+   * \param fd the file descriptor
+   * \param blocks the blocks
+   * \return false if the blocks could not be written
+   */
+  static bool WriteBlocks (int fd, std::vector<Block> const &blocks);
+
+  bool m_busy;                     //!< whether the thread is writing blocks
+  std::condition_variable m_idle;  //!< notified when the queue is written
+};
+
+AsyncFileWriter::Flusher *
+AsyncFileWriter::Flusher::Get (void)
+{
+  static Flusher *flusher = new Flusher ();
+  return flusher;
+}
+
+AsyncFileWriter::Flusher::Flusher ()
+  : m_busy (false)
+{
+  int error = pthread_atfork (&Flusher::Prepare, &Flusher::Parent, &Flusher::Child);
+  NS_ABORT_MSG_IF (error != 0, "AsyncFileWriter: pthread_atfork failed: " << std::strerror (error));
+  std::thread (&Flusher::Run, this).detach ();
+}
+
+void
+AsyncFileWriter::Flusher::Prepare (void)
+{
+  Flusher *flusher = Get ();
+  std::unique_lock<std::mutex> lock (flusher->m_mutex);
+  while (!flusher->m_queue.empty () || flusher->m_busy)
+    {
+      flusher->m_idle.wait (lock);
+    }
+  // held until Parent or Child
+  lock.release ();
+}
+
+void
+AsyncFileWriter::Flusher::Parent (void)
+{
+  Get ()->m_mutex.unlock ();
+}
+
+void
+AsyncFileWriter::Flusher::Child (void)
+{
+  Flusher *flusher = Get ();
+  // The thread waiting on m_work does not exist in the child. The
+  // condition variables are not destroyed, as the destructor would wait
+  // for their missing waiters.
+  new (&flusher->m_work) std::condition_variable ();
+  new (&flusher->m_idle) std::condition_variable ();
+  flusher->m_mutex.unlock ();
+  std::thread (&Flusher::Run, flusher).detach ();
+}
+
+void
+AsyncFileWriter::Flusher::Run (void)
+{
+  std::vector<Block> blocks;
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      while (m_queue.empty ())
+        {
+          m_work.wait (lock);
+        }
+      AsyncFileWriter *writer = m_queue.front ();
+      m_queue.pop_front ();
+      writer->m_queued = false;
+      writer->m_writing = true;
+      m_busy = true;
+      blocks.assign (writer->m_full.begin (), writer->m_full.end ());
+      writer->m_full.clear ();
+      int fd = writer->m_fd;
+
+      lock.unlock ();
+      bool ok = WriteBlocks (fd, blocks);
+      lock.lock ();
+
+      if (!ok)
+        {
+          // Read by Fail () without the mutex
+          writer->m_fail.store (true);
+        }
+      for (std::vector<Block>::const_iterator i = blocks.begin (); i != blocks.end (); ++i)
+        {
+          writer->m_free.push_back (i->data);
+        }
+      writer->m_writing = false;
+      writer->m_done.notify_all ();
+      m_busy = false;
+      if (m_queue.empty ())
+        {
+          m_idle.notify_all ();
+        }
+    }
+}
+
+bool
+AsyncFileWriter::Flusher::WriteBlocks (int fd, std::vector<Block> const &blocks)
+{
+  std::vector<struct iovec> iov (blocks.size ());
+  for (uint32_t i = 0; i < blocks.size (); i++)
+    {
+      iov[i].iov_base = blocks[i].data;
+      iov[i].iov_len = blocks[i].size;
+    }
+  uint32_t first = 0;
+  while (first < iov.size ())
+    {
+      int count = std::min<uint32_t> (iov.size () - first, IOV_MAX);
+      ssize_t written = ::writev (fd, &iov[first], count);
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          return false;
+        }
+      // skip what was written, which may end in the middle of a block
+      while (first < iov.size () && static_cast<size_t> (written) >= iov[first].iov_len)
+        {
+          written -= iov[first].iov_len;
+          first++;
+        }
+      if (first < iov.size ())
+        {
+          iov[first].iov_base = static_cast<uint8_t *> (iov[first].iov_base) + written;
+          iov[first].iov_len -= written;
+        }
+    }
+  return true;
+}
+
+
+AsyncFileWriter::AsyncFileWriter (uint32_t blockSize, uint32_t maxBlocks)
+  : m_fd (-1),
+    m_fail (false),
+    m_blockSize (blockSize),
+    m_maxBlocks (maxBlocks),
+    m_nBlocks (0),
+    m_queued (false),
+    m_writing (false)
+{
+  NS_LOG_FUNCTION (this << blockSize << maxBlocks);
+  NS_ASSERT (blockSize > 0 && maxBlocks > 0);
+  m_current.data = 0;
+  m_current.size = 0;
+}
+
+AsyncFileWriter::~AsyncFileWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+void
+AsyncFileWriter::Open (std::string const &filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  Close ();
+  m_fd = ::open (filename.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (m_fd < 0)
+    {
+      m_fail = true;
+    }
+}
+
+void
+AsyncFileWriter::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_fd < 0)
+    {
+      return;
+    }
+  Flush ();
+  if (::close (m_fd) != 0)
+    {
+      m_fail = true;
+    }
+  m_fd = -1;
+  Release ();
+}
+
+bool
+AsyncFileWriter::Fail (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_fail.load ();
+}
+
+void
+AsyncFileWriter::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_fail.store (false);
+}
+
+void
+AsyncFileWriter::Write (uint8_t const *data, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << &data << size);
+  if (m_fd < 0)
+    {
+      m_fail = true;
+      return;
+    }
+  while (size > 0)
+    {
+      if (m_current.data == 0 || m_current.size == m_blockSize)
+        {
+          Queue (true);
+        }
+      uint32_t n = std::min (size, m_blockSize - m_current.size);
+      std::memcpy (m_current.data + m_current.size, data, n);
+      m_current.size += n;
+      data += n;
+      size -= n;
+    }
+}
+
+uint8_t *
+AsyncFileWriter::Reserve (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_fd < 0 || size > m_blockSize)
+    {
+      return 0;
+    }
+  if (m_current.data == 0 || m_blockSize - m_current.size < size)
+    {
+      Queue (true);
+    }
+  uint8_t *data = m_current.data + m_current.size;
+  m_current.size += size;
+  return data;
+}
+
+void
+AsyncFileWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_fd < 0 || m_nBlocks == 0)
+    {
+      return;
+    }
+  Queue (false);
+  Flusher *flusher = Flusher::Get ();
+  std::unique_lock<std::mutex> lock (flusher->m_mutex);
+  while (m_queued || m_writing)
+    {
+      m_done.wait (lock);
+    }
+}
+
+void
+AsyncFileWriter::Queue (bool next)
+{
+  Flusher *flusher = Flusher::Get ();
+  std::unique_lock<std::mutex> lock (flusher->m_mutex);
+  if (m_current.size > 0)
+    {
+      m_full.push_back (m_current);
+      if (!m_queued)
+        {
+          m_queued = true;
+          flusher->m_queue.push_back (this);
+          flusher->m_work.notify_one ();
+        }
+    }
+  else if (m_current.data != 0)
+    {
+      m_free.push_back (m_current.data);
+    }
+  m_current.data = 0;
+  m_current.size = 0;
+  if (!next)
+    {
+      return;
+    }
+  if (m_free.empty () && m_nBlocks < m_maxBlocks)
+    {
+      m_nBlocks++;
+      m_current.data = new uint8_t [m_blockSize];
+      return;
+    }
+  // all the blocks of the ring are queued: wait for the disk
+  while (m_free.empty ())
+    {
+      m_done.wait (lock);
+    }
+  m_current.data = m_free.back ();
+  m_free.pop_back ();
+}
+
+void
+AsyncFileWriter::Release (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_current.data == 0 && m_full.empty ());
+  for (std::vector<uint8_t *>::const_iterator i = m_free.begin (); i != m_free.end (); ++i)
+    {
+      delete [] *i;
+    }
+  m_free.clear ();
+  m_nBlocks = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef ASYNC_FILE_WRITER_H
+#define ASYNC_FILE_WRITER_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief A file written in large blocks by a background thread
+ *
+ * The data written to the file is copied into a ring of blocks. When a
+ * block is full, it is queued to a thread shared by all the files, which
+ * writes the queued blocks of a file with a single writev system call and
+ * returns them to the ring, so the writer only waits for the disk when
+ * all the blocks of its ring are queued. The blocks are allocated on
+ * demand, so a file written slowly holds a single block.
+ *
+ * A file must only be written by one thread at a time. The data is only
+ * guaranteed to be in the file once #Flush or #Close returns.
+ *
+ * The process may fork, e.g. in Checkpoint::Branch: the queued blocks are
+ * written before the fork, and the child gets its own background thread.
+ * As with stdio, the block being filled is copied into the child, so a
+ * file opened before the fork should only be written by one process.
+ */
+class AsyncFileWriter
+{
+public:
+  static const uint32_t BLOCK_SIZE_DEFAULT = 131072; /**< Default size of the blocks, in bytes */
+  static const uint32_t MAX_BLOCKS_DEFAULT = 4;     /**< Default maximum number of blocks of a file */
+
+  /**
+   * \param blockSize the size of the blocks, in bytes
+   * \param maxBlocks the maximum number of blocks of the ring
+   */
+  AsyncFileWriter (uint32_t blockSize = BLOCK_SIZE_DEFAULT,
+                   uint32_t maxBlocks = MAX_BLOCKS_DEFAULT);
+  /**
+   * #Close the file.
+   */
+  ~AsyncFileWriter ();
+
+  /**
+   * Create a file, or truncate an existing one.
+   *
+   * \param filename the name of the file
+   */
+  void Open (std::string const &filename);
+  /**
+   * Write the queued blocks, wait until they are in the file, and close it.
+   */
+  void Close (void);
+  /**
+   * \return true if the file could not be opened or written, false otherwise.
+   */
+  bool Fail (void) const;
+  /**
+   * Clear the failure state.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Copy data to the file
+   *
+   * \param data the data
+   * \param size the number of bytes of data
+   */
+  void Write (uint8_t const *data, uint32_t size);
+  /**
+   * \brief Reserve contiguous space in the file
+   *
+   * The caller must fill the space before the next call to the writer.
+   *
+   * \param size the number of bytes to reserve
+   * \return a pointer to the space, or 0 if size is larger than a block
+   */
+  uint8_t *Reserve (uint32_t size);
+  /**
+   * Queue the current block, and wait until all the data written so far
+   * is in the file.
+   */
+  void Flush (void);
+
+private:
+  /**
+   * \brief A block of the ring, and the number of bytes used in it
+   */
+  struct Block
+  {
+    uint8_t *data; //!< the data
+    uint32_t size; //!< the number of bytes of data
+  };
+
+  class Flusher;
+  friend class Flusher;
+
+  /**
+   * Queue the current block, if it is not empty.
+   *
+   * \param next whether to get a new current block
+   */
+  void Queue (bool next);
+  /**
+   * Release the blocks of the ring.
+   */
+  void Release (void);
+
+  int m_fd;                    //!< the file descriptor, or -1
+  /// whether the file could not be opened or written, also set by the Flusher
+  std::atomic<bool> m_fail;
+  uint32_t m_blockSize;        //!< size of the blocks
+  uint32_t m_maxBlocks;        //!< maximum number of blocks of the ring
+  uint32_t m_nBlocks;          //!< number of blocks allocated
+  Block m_current;             //!< the block being filled, data is 0 before the first write
+  // Shared with the Flusher, under its mutex
+  std::vector<uint8_t *> m_free; //!< the free blocks
+  std::deque<Block> m_full;    //!< the blocks waiting for the Flusher
+  bool m_queued;               //!< whether the file is in the queue of the Flusher
+  bool m_writing;              //!< whether the Flusher is writing blocks of the file
+  std::condition_variable m_done; //!< notified when the Flusher returns blocks of the file
+};
+
+} // namespace ns3
+
+#endif /* ASYNC_FILE_WRITER_H */
@@ -26,6 +26,8 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("OutputStreamWrapper");
 
+uint32_t OutputStreamWrapper::g_nStreams = 0;
+
 OutputStreamWrapper::OutputStreamWrapper (std::string filename, std::ios::openmode filemode)
   : m_destroyable (true)
 {
@@ -33,6 +35,7 @@ OutputStreamWrapper::OutputStreamWrapper (std::string filename, std::ios::openmo
   std::ofstream* os = new std::ofstream ();
   os->open (filename.c_str (), filemode);
   m_ostream = os;
+  g_nStreams++;
   FatalImpl::RegisterStream (m_ostream);
   NS_ABORT_MSG_UNLESS (os->is_open (), "AsciiTraceHelper::CreateFileStream():  " <<
                        "Unable to Open " << filename << " for mode " << filemode);
@@ -42,6 +45,7 @@ OutputStreamWrapper::OutputStreamWrapper (std::ostream* os)
   : m_ostream (os), m_destroyable (false)
 {
   NS_LOG_FUNCTION (this << os);
+  g_nStreams++;
   FatalImpl::RegisterStream (m_ostream);
   NS_ABORT_MSG_UNLESS (m_ostream->good (), "Output stream is not vaild for writing.");
 }
@@ -52,6 +56,7 @@ OutputStreamWrapper::~OutputStreamWrapper ()
   FatalImpl::UnregisterStream (m_ostream);
   if (m_destroyable) delete m_ostream;
   m_ostream = 0;
+  g_nStreams--;
 }
 
 std::ostream *
@@ -61,4 +66,10 @@ OutputStreamWrapper::GetStream (void)
   return m_ostream;
 }
 
+uint32_t
+OutputStreamWrapper::GetNStreams (void)
+{
+  return g_nStreams;
+}
+
 } // namespace ns3
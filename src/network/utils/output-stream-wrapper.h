@@ -92,9 +92,16 @@ public:
    */
   std::ostream *GetStream (void);
 
+  /**
+   * \return the number of wrappers alive
+   */
+  static uint32_t GetNStreams (void);
+
 private:
   std::ostream *m_ostream; //!< The output stream
   bool m_destroyable; //!< Can be destroyed
+
+  static uint32_t g_nStreams; //!< Number of wrappers alive
 };
 
 } // namespace ns3
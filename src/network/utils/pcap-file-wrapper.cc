@@ -19,6 +19,7 @@
 #include "ns3/log.h"
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
+#include "ns3/string.h"
 #include "ns3/buffer.h"
 #include "ns3/header.h"
 #include "pcap-file-wrapper.h"
@@ -46,12 +47,25 @@ PcapFileWrapper::GetTypeId (void)
                    BooleanValue (false),
                    MakeBooleanAccessor (&PcapFileWrapper::m_nanosecMode),
                    MakeBooleanChecker())
+    .AddAttribute ("Asynchronous",
+                   "Whether the files opened for writing are written by a background thread, "
+                   "in large blocks, rather than as the packets are captured.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PcapFileWrapper::m_asynchronous),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PcapNgFile",
+                   "If not empty, the name of a pcapng file in which the files opened for writing "
+                   "are written as interfaces, named after the files, instead of pcap files.",
+                   StringValue (""),
+                   MakeStringAccessor (&PcapFileWrapper::m_pcapNgFilename),
+                   MakeStringChecker ())
   ;
   return tid;
 }
 
 
 PcapFileWrapper::PcapFileWrapper ()
+  : m_interface (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -66,6 +80,10 @@ bool
 PcapFileWrapper::Fail (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_pcapNg != 0)
+    {
+      return m_pcapNg->Fail ();
+    }
   return m_file.Fail ();
 }
 
@@ -73,6 +91,10 @@ bool
 PcapFileWrapper::Eof (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_pcapNg != 0)
+    {
+      return false;
+    }
   return m_file.Eof ();
 }
 void 
@@ -86,6 +108,7 @@ void
 PcapFileWrapper::Close (void)
 {
   NS_LOG_FUNCTION (this);
+  m_pcapNg = 0;
   m_file.Close ();
 }
 
@@ -93,6 +116,18 @@ void
 PcapFileWrapper::Open (std::string const &filename, std::ios::openmode mode)
 {
   NS_LOG_FUNCTION (this << filename << mode);
+  if (!m_pcapNgFilename.empty () && (mode & std::ios::in) == 0)
+    {
+      m_pcapNg = PcapNgFile::Get (m_pcapNgFilename, m_asynchronous);
+      m_interfaceName = filename;
+      std::string::size_type n = filename.rfind (".pcap");
+      if (n != std::string::npos && n + 5 == filename.size ())
+        {
+          m_interfaceName = filename.substr (0, n);
+        }
+      return;
+    }
+  m_file.SetAsynchronous (m_asynchronous);
   m_file.Open (filename, mode);
 }
 
@@ -105,6 +140,15 @@ PcapFileWrapper::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t tzCorrec
   // a snaplen, we use the one provided.
   //
   NS_LOG_FUNCTION (this << dataLinkType << snapLen << tzCorrection);
+  if (m_pcapNg != 0)
+    {
+      if (snapLen == std::numeric_limits<uint32_t>::max ())
+        {
+          snapLen = m_snapLen;
+        }
+      m_interface = m_pcapNg->AddInterface (dataLinkType, snapLen, m_interfaceName, m_nanosecMode);
+      return;
+    }
   if (snapLen != std::numeric_limits<uint32_t>::max ())
     {
       m_file.Init (dataLinkType, snapLen, tzCorrection, false, m_nanosecMode);
@@ -119,6 +163,12 @@ void
 PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (this << t << p);
+  if (m_pcapNg != 0)
+    {
+      uint64_t ts = m_nanosecMode ? t.GetNanoSeconds () : t.GetMicroSeconds ();
+      m_pcapNg->Write (m_interface, ts, p);
+      return;
+    }
   if (m_file.IsNanoSecMode())
     {
       uint64_t current = t.GetNanoSeconds ();
@@ -139,6 +189,12 @@ void
 PcapFileWrapper::Write (Time t, const Header &header, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (this << t << &header << p);
+  if (m_pcapNg != 0)
+    {
+      uint64_t ts = m_nanosecMode ? t.GetNanoSeconds () : t.GetMicroSeconds ();
+      m_pcapNg->Write (m_interface, ts, header, p);
+      return;
+    }
   if (m_file.IsNanoSecMode())
     {
       uint64_t current = t.GetNanoSeconds ();
@@ -159,6 +215,12 @@ void
 PcapFileWrapper::Write (Time t, uint8_t const *buffer, uint32_t length)
 {
   NS_LOG_FUNCTION (this << t << &buffer << length);
+  if (m_pcapNg != 0)
+    {
+      uint64_t ts = m_nanosecMode ? t.GetNanoSeconds () : t.GetMicroSeconds ();
+      m_pcapNg->Write (m_interface, ts, buffer, length);
+      return;
+    }
   if (m_file.IsNanoSecMode())
     {
       uint64_t current = t.GetNanoSeconds ();
@@ -184,6 +246,7 @@ PcapFileWrapper::Read (Time &t)
   uint32_t origLen;
   uint32_t readLen;
 
+  NS_ASSERT_MSG (m_pcapNg == 0, "Cannot read an interface of a pcapng file");
   uint32_t maxBytes=65536;
   uint8_t  datbuf[maxBytes];
 
@@ -27,6 +27,7 @@
 #include "ns3/object.h"
 #include "ns3/nstime.h"
 #include "pcap-file.h"
+#include "pcapng-file.h"
 
 namespace ns3 {
 
@@ -35,6 +36,12 @@ namespace ns3 {
  * ns-3 interface to the low-level public methods of PcapFile.  Users are
  * encouraged to use this object instead of class ns3::PcapFile in ns-3
  * public APIs.
+ *
+ * The files opened for writing can be written asynchronously (see the
+ * Asynchronous attribute), and can be interfaces of a single pcapng file
+ * shared by all the wrappers with the same PcapNgFile attribute, e.g.,
+ * all the devices traced by PcapHelperForDevice::EnablePcapAll. The pcap
+ * header accessors are meaningless for such interfaces.
  */
 class PcapFileWrapper : public Object
 {
@@ -224,6 +231,11 @@ private:
   PcapFile m_file; //!< Pcap file
   uint32_t m_snapLen; //!< max length of saved packets
   bool     m_nanosecMode; //!< Timestamps in nanosecond mode
+  bool     m_asynchronous; //!< Write the files asynchronously
+  std::string m_pcapNgFilename; //!< Name of the pcapng file to write to, or empty
+  Ptr<PcapNgFile> m_pcapNg; //!< The pcapng file written to, or 0
+  std::string m_interfaceName; //!< Name of the interface in the pcapng file
+  uint32_t m_interface; //!< Identifier of the interface in the pcapng file
 };
 
 } // namespace ns3
@@ -20,6 +20,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <vector>
 #include "ns3/assert.h"
 #include "ns3/packet.h"
 #include "ns3/fatal-error.h"
@@ -27,6 +28,7 @@
 #include "ns3/header.h"
 #include "ns3/buffer.h"
 #include "pcap-file.h"
+#include "async-file-writer.h"
 #include "ns3/log.h"
 #include "ns3/build-profile.h"
 //
@@ -47,10 +49,15 @@ const uint32_t NS_SWAPPED_MAGIC = 0x4d3cb2a1; /**< Looks this way if byte swappi
 const uint16_t VERSION_MAJOR = 2;             /**< Major version of supported pcap file format */
 const uint16_t VERSION_MINOR = 4;             /**< Minor version of supported pcap file format */
 
+uint32_t PcapFile::g_writingFiles = 0;
+
 PcapFile::PcapFile ()
   : m_file (),
     m_swapMode (false),
-    m_nanosecMode (false)
+    m_nanosecMode (false),
+    m_async (false),
+    m_writer (0),
+    m_writing (false)
 {
   NS_LOG_FUNCTION (this);
   FatalImpl::RegisterStream (&m_file); 
@@ -68,18 +75,30 @@ bool
 PcapFile::Fail (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writer->Fail ();
+    }
   return m_file.fail ();
 }
 bool 
 PcapFile::Eof (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return false;
+    }
   return m_file.eof ();
 }
 void 
 PcapFile::Clear (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      m_writer->Clear ();
+    }
   m_file.clear ();
 }
 
@@ -88,7 +107,25 @@ void
 PcapFile::Close (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      m_writer->Close ();
+      delete m_writer;
+      m_writer = 0;
+    }
   m_file.close ();
+  if (m_writing)
+    {
+      g_writingFiles--;
+      m_writing = false;
+    }
+}
+
+void
+PcapFile::SetAsynchronous (bool async)
+{
+  NS_LOG_FUNCTION (this << async);
+  m_async = async;
 }
 
 uint32_t
@@ -206,7 +243,10 @@ PcapFile::WriteFileHeader (void)
   // If we're initializing the file, we need to write the pcap file header
   // at the start of the file.
   //
-  m_file.seekp (0, std::ios::beg);
+  if (m_writer == 0)
+    {
+      m_file.seekp (0, std::ios::beg);
+    }
  
   //
   // We have the ability to write out the pcap file header in a foreign endian
@@ -234,13 +274,13 @@ PcapFile::WriteFileHeader (void)
   // Watch out for memory alignment differences between machines, so write
   // them all individually.
   //
-  m_file.write ((const char *)&headerOut->m_magicNumber, sizeof(headerOut->m_magicNumber));
-  m_file.write ((const char *)&headerOut->m_versionMajor, sizeof(headerOut->m_versionMajor));
-  m_file.write ((const char *)&headerOut->m_versionMinor, sizeof(headerOut->m_versionMinor));
-  m_file.write ((const char *)&headerOut->m_zone, sizeof(headerOut->m_zone));
-  m_file.write ((const char *)&headerOut->m_sigFigs, sizeof(headerOut->m_sigFigs));
-  m_file.write ((const char *)&headerOut->m_snapLen, sizeof(headerOut->m_snapLen));
-  m_file.write ((const char *)&headerOut->m_type, sizeof(headerOut->m_type));
+  WriteData (&headerOut->m_magicNumber, sizeof(headerOut->m_magicNumber));
+  WriteData (&headerOut->m_versionMajor, sizeof(headerOut->m_versionMajor));
+  WriteData (&headerOut->m_versionMinor, sizeof(headerOut->m_versionMinor));
+  WriteData (&headerOut->m_zone, sizeof(headerOut->m_zone));
+  WriteData (&headerOut->m_sigFigs, sizeof(headerOut->m_sigFigs));
+  WriteData (&headerOut->m_snapLen, sizeof(headerOut->m_snapLen));
+  WriteData (&headerOut->m_type, sizeof(headerOut->m_type));
 }
 
 void
@@ -333,6 +373,20 @@ PcapFile::Open (std::string const &filename, std::ios::openmode mode)
   mode |= std::ios::binary;
 
   m_filename=filename;
+  if ((mode & std::ios::out) != 0 && !m_writing)
+    {
+      g_writingFiles++;
+      m_writing = true;
+    }
+  if (m_async && (mode & std::ios::in) == 0)
+    {
+      if (m_writer == 0)
+        {
+          m_writer = new AsyncFileWriter ();
+        }
+      m_writer->Open (filename);
+      return;
+    }
   m_file.open (filename.c_str (), mode);
   if (mode & std::ios::in)
     {
@@ -403,7 +457,7 @@ uint32_t
 PcapFile::WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen)
 {
   NS_LOG_FUNCTION (this << tsSec << tsUsec << totalLen);
-  NS_ASSERT (m_file.good ());
+  NS_ASSERT (m_writer != 0 ? !m_writer->Fail () : m_file.good ());
 
   uint32_t inclLen = totalLen > m_fileHeader.m_snapLen ? m_fileHeader.m_snapLen : totalLen;
 
@@ -422,21 +476,40 @@ PcapFile::WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen)
   // Watch out for memory alignment differences between machines, so write
   // them all individually.
   //
-  m_file.write ((const char *)&header.m_tsSec, sizeof(header.m_tsSec));
-  m_file.write ((const char *)&header.m_tsUsec, sizeof(header.m_tsUsec));
-  m_file.write ((const char *)&header.m_inclLen, sizeof(header.m_inclLen));
-  m_file.write ((const char *)&header.m_origLen, sizeof(header.m_origLen));
-  NS_BUILD_DEBUG(m_file.flush());
+  WriteData (&header.m_tsSec, sizeof(header.m_tsSec));
+  WriteData (&header.m_tsUsec, sizeof(header.m_tsUsec));
+  WriteData (&header.m_inclLen, sizeof(header.m_inclLen));
+  WriteData (&header.m_origLen, sizeof(header.m_origLen));
+  if (m_writer == 0)
+    {
+      NS_BUILD_DEBUG(m_file.flush());
+    }
   return inclLen;
 }
 
+void
+PcapFile::WriteData (void const *data, uint32_t size)
+{
+  if (m_writer != 0)
+    {
+      m_writer->Write (static_cast<uint8_t const *> (data), size);
+    }
+  else
+    {
+      m_file.write (static_cast<const char *> (data), size);
+    }
+}
+
 void
 PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen)
 {
   NS_LOG_FUNCTION (this << tsSec << tsUsec << &data << totalLen);
   uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, totalLen);
-  m_file.write ((const char *)data, inclLen);
-  NS_BUILD_DEBUG(m_file.flush());
+  WriteData (data, inclLen);
+  if (m_writer == 0)
+    {
+      NS_BUILD_DEBUG(m_file.flush());
+    }
 }
 
 void 
@@ -444,6 +517,23 @@ PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (this << tsSec << tsUsec << p);
   uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, p->GetSize ());
+  if (m_writer != 0)
+    {
+      // copy the packet straight into the block, if it fits
+      std::vector<uint8_t> buffer;
+      uint8_t *data = m_writer->Reserve (inclLen);
+      if (data == 0)
+        {
+          buffer.resize (inclLen);
+          data = buffer.data ();
+        }
+      p->CopyData (data, inclLen);
+      if (!buffer.empty ())
+        {
+          m_writer->Write (data, inclLen);
+        }
+      return;
+    }
   p->CopyData (&m_file, inclLen);
   NS_BUILD_DEBUG(m_file.flush());
 }
@@ -460,6 +550,23 @@ PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, const Header &header, Ptr<cons
   headerBuffer.AddAtStart (headerSize);
   header.Serialize (headerBuffer.Begin ());
   uint32_t toCopy = std::min (headerSize, inclLen);
+  if (m_writer != 0)
+    {
+      std::vector<uint8_t> buffer;
+      uint8_t *data = m_writer->Reserve (inclLen);
+      if (data == 0)
+        {
+          buffer.resize (inclLen);
+          data = buffer.data ();
+        }
+      headerBuffer.CopyData (data, toCopy);
+      p->CopyData (data + toCopy, inclLen - toCopy);
+      if (!buffer.empty ())
+        {
+          m_writer->Write (data, inclLen);
+        }
+      return;
+    }
   headerBuffer.CopyData (&m_file, toCopy);
   inclLen -= toCopy;
   p->CopyData (&m_file, inclLen);
@@ -524,6 +631,12 @@ PcapFile::Read (
     }
 }
 
+uint32_t
+PcapFile::GetNWritingFiles (void)
+{
+  return g_writingFiles;
+}
+
 bool
 PcapFile::Diff (std::string const & f1, std::string const & f2, 
                 uint32_t & sec, uint32_t & usec, uint32_t & packets,
@@ -30,6 +30,7 @@ namespace ns3 {
 
 class Packet;
 class Header;
+class AsyncFileWriter;
 
 
 /**
@@ -38,6 +39,10 @@ class Header;
  * A class representing a pcap file.  This allows easy creation, writing and 
  * reading of files composed of stored packets; which may be viewed using
  * standard tools.
+ *
+ * A file opened for writing in asynchronous mode (see #SetAsynchronous) is
+ * written through an AsyncFileWriter, which copies the records into large
+ * blocks written by a background thread, instead of a std::fstream.
  */
 class PcapFile
 {
@@ -85,6 +90,18 @@ public:
    */
   void Close (void);
 
+  /**
+   * \brief Set the asynchronous mode of the file
+   *
+   * The files later opened for writing only (without std::ios::in) in
+   * asynchronous mode are written through an AsyncFileWriter, so that
+   * writing a packet only copies it to memory. The file is only complete
+   * once it is closed.
+   *
+   * \param async true to write the file asynchronously
+   */
+  void SetAsynchronous (bool async);
+
   /**
    * Initialize the pcap file associated with this object.  This file must have
    * been previously opened with write permissions.
@@ -289,6 +306,11 @@ public:
                     uint32_t & sec, uint32_t & usec, uint32_t & packets,
                     uint32_t snapLen = SNAPLEN_DEFAULT);
 
+  /**
+   * \return the number of files open for writing
+   */
+  static uint32_t GetNWritingFiles (void);
+
 private:
   /**
    * \brief Pcap file header
@@ -365,12 +387,23 @@ private:
    * \brief Read and verify a Pcap file header
    */
   void ReadAndVerifyFileHeader (void);
+  /**
+   * \brief Write data to the file stream, or to the AsyncFileWriter
+   * \param data the data
+   * \param size the number of bytes of data
+   */
+  void WriteData (void const *data, uint32_t size);
 
   std::string    m_filename;    //!< file name
   std::fstream   m_file;        //!< file stream
   PcapFileHeader m_fileHeader;  //!< file header
   bool m_swapMode;              //!< swap mode
   bool m_nanosecMode;           //!< nanosecond timestamp mode
+  bool m_async;                 //!< write the files opened for writing asynchronously
+  AsyncFileWriter *m_writer;    //!< the writer of an asynchronous file, or 0
+  bool m_writing;               //!< whether the file is open for writing
+
+  static uint32_t g_writingFiles; //!< number of files open for writing
 };
 
 } // namespace ns3
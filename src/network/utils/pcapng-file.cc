@@ -0,0 +1,343 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include "ns3/assert.h"
+#include "ns3/packet.h"
+#include "ns3/header.h"
+#include "ns3/buffer.h"
+#include "ns3/log.h"
+#include "pcapng-file.h"
+#include "async-file-writer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PcapNgFile");
+
+const uint32_t SECTION_HEADER_BLOCK = 0x0a0d0d0a;  /**< Type of the section header block */
+const uint32_t INTERFACE_BLOCK = 0x00000001;       /**< Type of the interface description block */
+const uint32_t ENHANCED_PACKET_BLOCK = 0x00000006; /**< Type of the enhanced packet block */
+const uint32_t BYTE_ORDER_MAGIC = 0x1a2b3c4d;      /**< Identifies the byte order of a section */
+const uint16_t VERSION_MAJOR = 1;                  /**< Major version of the pcapng format */
+const uint16_t VERSION_MINOR = 0;                  /**< Minor version of the pcapng format */
+
+const uint16_t OPT_ENDOFOPT = 0;                   /**< Code of the end of the options */
+const uint16_t OPT_IF_NAME = 2;                    /**< Code of the interface name option */
+const uint16_t OPT_IF_TSRESOL = 9;                 /**< Code of the timestamp resolution option */
+
+namespace {
+
+/**
+ * \param size a number of bytes
+ * \return size rounded up to a multiple of 4
+ */
+uint32_t
+Pad (uint32_t size)
+{
+  return (size + 3) & ~3U;
+}
+
+/**
+ * Append data to a block.
+ *
+ * \param block the block
+ * \param data the data
+ * \param size the number of bytes of data
+ */
+void
+Append (std::vector<uint8_t> &block, void const *data, uint32_t size)
+{
+  uint8_t const *bytes = static_cast<uint8_t const *> (data);
+  block.insert (block.end (), bytes, bytes + size);
+}
+
+/**
+ * Append an option to a block.
+ *
+ * \param block the block
+ * \param code the code of the option
+ * \param data the value of the option
+ * \param size the number of bytes of the value
+ */
+void
+AppendOption (std::vector<uint8_t> &block, uint16_t code, void const *data, uint16_t size)
+{
+  Append (block, &code, sizeof (code));
+  Append (block, &size, sizeof (size));
+  Append (block, data, size);
+  // the values are padded to 32 bits
+  block.resize (block.size () + Pad (size) - size, 0);
+}
+
+/**
+ * \return the open files, by name
+ */
+std::map<std::string, PcapNgFile *> &
+GetFiles (void)
+{
+  static std::map<std::string, PcapNgFile *> files;
+  return files;
+}
+
+/** Number of open files */
+uint32_t g_openFiles = 0;
+
+} // unnamed namespace
+
+Ptr<PcapNgFile>
+PcapNgFile::Get (std::string const &filename, bool async)
+{
+  NS_LOG_FUNCTION (filename << async);
+  std::map<std::string, PcapNgFile *> &files = GetFiles ();
+  std::map<std::string, PcapNgFile *>::const_iterator i = files.find (filename);
+  if (i != files.end ())
+    {
+      return Ptr<PcapNgFile> (i->second);
+    }
+  Ptr<PcapNgFile> file = Create<PcapNgFile> ();
+  file->Open (filename, async);
+  files[filename] = PeekPointer (file);
+  return file;
+}
+
+uint32_t
+PcapNgFile::GetNOpenFiles (void)
+{
+  return g_openFiles;
+}
+
+PcapNgFile::PcapNgFile ()
+  : m_writer (0),
+    m_open (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PcapNgFile::~PcapNgFile ()
+{
+  NS_LOG_FUNCTION (this);
+  std::map<std::string, PcapNgFile *> &files = GetFiles ();
+  std::map<std::string, PcapNgFile *>::iterator i = files.find (m_filename);
+  if (i != files.end () && i->second == this)
+    {
+      files.erase (i);
+    }
+  Close ();
+}
+
+void
+PcapNgFile::Open (std::string const &filename, bool async)
+{
+  NS_LOG_FUNCTION (this << filename << async);
+  Close ();
+  m_filename = filename;
+  m_open = true;
+  g_openFiles++;
+  if (async)
+    {
+      m_writer = new AsyncFileWriter ();
+      m_writer->Open (filename);
+    }
+  else
+    {
+      m_file.open (filename.c_str (), std::ios::out | std::ios::binary);
+    }
+
+  //
+  // A single section, of unspecified length
+  //
+  uint64_t sectionLength = 0xffffffffffffffffULL;
+  WriteU32 (SECTION_HEADER_BLOCK);
+  WriteU32 (28);
+  WriteU32 (BYTE_ORDER_MAGIC);
+  WriteData (&VERSION_MAJOR, sizeof (VERSION_MAJOR));
+  WriteData (&VERSION_MINOR, sizeof (VERSION_MINOR));
+  WriteData (&sectionLength, sizeof (sectionLength));
+  WriteU32 (28);
+}
+
+void
+PcapNgFile::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      m_writer->Close ();
+      delete m_writer;
+      m_writer = 0;
+    }
+  m_file.close ();
+  m_snapLen.clear ();
+  if (m_open)
+    {
+      g_openFiles--;
+      m_open = false;
+    }
+}
+
+bool
+PcapNgFile::Fail (void) const
+{
+  NS_LOG_FUNCTION (this);
+  if (m_writer != 0)
+    {
+      return m_writer->Fail ();
+    }
+  return m_file.fail ();
+}
+
+uint32_t
+PcapNgFile::AddInterface (uint32_t dataLinkType, uint32_t snapLen,
+                          std::string const &name, bool nanosecMode)
+{
+  NS_LOG_FUNCTION (this << dataLinkType << snapLen << name << nanosecMode);
+#ifdef NS3_MTP
+  std::lock_guard<std::mutex> lock (m_mutex);
+#endif
+  std::vector<uint8_t> block;
+  uint32_t type = INTERFACE_BLOCK;
+  uint16_t linkType = dataLinkType;
+  uint16_t reserved = 0;
+  uint8_t tsresol = nanosecMode ? 9 : 6;
+  Append (block, &type, sizeof (type));
+  block.resize (block.size () + 4);  // block length, set below
+  Append (block, &linkType, sizeof (linkType));
+  Append (block, &reserved, sizeof (reserved));
+  Append (block, &snapLen, sizeof (snapLen));
+  if (!name.empty ())
+    {
+      AppendOption (block, OPT_IF_NAME, name.c_str (), name.size ());
+    }
+  AppendOption (block, OPT_IF_TSRESOL, &tsresol, sizeof (tsresol));
+  AppendOption (block, OPT_ENDOFOPT, 0, 0);
+  uint32_t length = block.size () + 4;
+  std::memcpy (&block[4], &length, sizeof (length));
+  Append (block, &length, sizeof (length));
+  WriteData (&block[0], block.size ());
+
+  m_snapLen.push_back (snapLen);
+  return m_snapLen.size () - 1;
+}
+
+uint32_t
+PcapNgFile::WritePacketHeader (uint32_t interface, uint64_t ts, uint32_t totalLen)
+{
+  NS_LOG_FUNCTION (this << interface << ts << totalLen);
+  NS_ASSERT_MSG (interface < m_snapLen.size (), "Unknown interface " << interface);
+  NS_ASSERT (!Fail ());
+
+  uint32_t inclLen = std::min (totalLen, m_snapLen[interface]);
+  WriteU32 (ENHANCED_PACKET_BLOCK);
+  WriteU32 (32 + Pad (inclLen));
+  WriteU32 (interface);
+  WriteU32 (ts >> 32);
+  WriteU32 (ts & 0xffffffff);
+  WriteU32 (inclLen);
+  WriteU32 (totalLen);
+  return inclLen;
+}
+
+void
+PcapNgFile::WritePacketTrailer (uint32_t inclLen)
+{
+  NS_LOG_FUNCTION (this << inclLen);
+  static const uint8_t zeros[4] = { 0, 0, 0, 0 };
+  WriteData (zeros, Pad (inclLen) - inclLen);
+  WriteU32 (32 + Pad (inclLen));
+}
+
+void
+PcapNgFile::WriteData (void const *data, uint32_t size)
+{
+  if (m_writer != 0)
+    {
+      m_writer->Write (static_cast<uint8_t const *> (data), size);
+    }
+  else
+    {
+      m_file.write (static_cast<const char *> (data), size);
+    }
+}
+
+void
+PcapNgFile::WriteU32 (uint32_t value)
+{
+  WriteData (&value, sizeof (value));
+}
+
+void
+PcapNgFile::Write (uint32_t interface, uint64_t ts, uint8_t const *data, uint32_t totalLen)
+{
+  NS_LOG_FUNCTION (this << interface << ts << &data << totalLen);
+#ifdef NS3_MTP
+  std::lock_guard<std::mutex> lock (m_mutex);
+#endif
+  uint32_t inclLen = WritePacketHeader (interface, ts, totalLen);
+  WriteData (data, inclLen);
+  WritePacketTrailer (inclLen);
+}
+
+void
+PcapNgFile::Write (uint32_t interface, uint64_t ts, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << interface << ts << p);
+#ifdef NS3_MTP
+  std::lock_guard<std::mutex> lock (m_mutex);
+#endif
+  uint32_t inclLen = WritePacketHeader (interface, ts, p->GetSize ());
+  uint8_t *data = m_writer != 0 ? m_writer->Reserve (inclLen) : 0;
+  if (data != 0)
+    {
+      p->CopyData (data, inclLen);
+    }
+  else if (m_writer != 0)
+    {
+      std::vector<uint8_t> buffer (inclLen);
+      p->CopyData (buffer.data (), inclLen);
+      m_writer->Write (buffer.data (), inclLen);
+    }
+  else
+    {
+      p->CopyData (&m_file, inclLen);
+    }
+  WritePacketTrailer (inclLen);
+}
+
+void
+PcapNgFile::Write (uint32_t interface, uint64_t ts, const Header &header, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << interface << ts << &header << p);
+#ifdef NS3_MTP
+  std::lock_guard<std::mutex> lock (m_mutex);
+#endif
+  uint32_t headerSize = header.GetSerializedSize ();
+  uint32_t inclLen = WritePacketHeader (interface, ts, headerSize + p->GetSize ());
+
+  Buffer headerBuffer;
+  headerBuffer.AddAtStart (headerSize);
+  header.Serialize (headerBuffer.Begin ());
+  uint32_t toCopy = std::min (headerSize, inclLen);
+  std::vector<uint8_t> buffer (inclLen);
+  headerBuffer.CopyData (buffer.data (), toCopy);
+  p->CopyData (buffer.data () + toCopy, inclLen - toCopy);
+  WriteData (buffer.data (), inclLen);
+  WritePacketTrailer (inclLen);
+}
+
+} // namespace ns3
@@ -23,6 +23,11 @@
 
 #include "data-collector.h"
 #include "data-calculator.h"
+#include "basic-data-calculators.h"
+#ifndef _WIN32
+#include "ns3/replication-runner.h"
+#endif
+#include <sstream>
 
 using namespace ns3;
 
@@ -90,6 +95,35 @@ DataCollector::AddDataCalculator (Ptr<DataCalculator> datac)
   // end DataCollector::AddDataCalculator
 }
 
+#ifndef _WIN32
+void
+DataCollector::AddReplications (const ReplicationRunner &runner, std::string context)
+{
+  NS_LOG_FUNCTION (this << context);
+
+  AddMetadata ("replications", runner.GetReplications ());
+  std::ostringstream run;
+  run << runner.GetFirstRun ();
+  AddMetadata ("first-run", run.str ());
+
+  std::vector<std::string> names = runner.GetNames ();
+  for (std::vector<std::string>::const_iterator i = names.begin (); i != names.end (); ++i)
+    {
+      Ptr<MinMaxAvgTotalCalculator<double> > calc = CreateObject<MinMaxAvgTotalCalculator<double> > ();
+      calc->SetContext (context);
+      calc->SetKey (*i);
+      std::vector<double> values = runner.GetValues (*i);
+      for (std::vector<double>::const_iterator j = values.begin (); j != values.end (); ++j)
+        {
+          calc->Update (*j);
+        }
+      AddDataCalculator (calc);
+    }
+
+  // end DataCollector::AddReplications
+}
+#endif
+
 DataCalculatorList::iterator
 DataCollector::DataCalculatorBegin ()
 {
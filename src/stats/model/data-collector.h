@@ -29,6 +29,7 @@
 namespace ns3 {
 
 class DataCalculator;
+class ReplicationRunner;
 
 //------------------------------------------------------------
 //--------------------------------------------
@@ -142,6 +143,17 @@ public:
    */
   DataCalculatorList::iterator DataCalculatorEnd ();
 
+#ifndef _WIN32
+  /**
+   * Add the results of replications, one MinMaxAvgTotalCalculator per
+   * result name, and the number of replications and the first run number
+   * as metadata
+   * \param runner ReplicationRunner which ran the replications
+   * \param context Context of the calculators
+   */
+  void AddReplications (const ReplicationRunner &runner, std::string context = "replications");
+#endif
+
 protected:
   virtual void DoDispose ();
 
@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include "ns3/core-module.h"
+#include "ns3/packet.h"
+#include "ns3/packet-metadata.h"
+#include "ns3/packet-arena.h"
+
+using namespace ns3;
+
+/*
+ * Benchmark of the packet memory arenas. Each thread creates its share
+ * of the packets, copies them and splits the copies in two fragments.
+ * With --handoff, the packets are passed in batches to the next thread,
+ * which destroys them, as when packets are created by an emulation or a
+ * channel thread and consumed by the simulator thread.
+ */
+
+class ArenaBench
+{
+public:
+  ArenaBench (uint32_t threads, uint64_t packets, uint32_t size, bool handoff)
+    : m_threads (threads),
+      m_packets (packets),
+      m_size (size),
+      m_handoff (handoff),
+      m_next (0),
+      m_inboxes (threads)
+  {
+  }
+
+  void Run (void);
+
+private:
+  /// Packets passed between threads
+  typedef std::vector<Ptr<Packet> > Batch;
+
+  /// Batches received by a thread
+  struct Inbox
+  {
+    std::mutex mutex;              //!< protects the batches
+    std::vector<Batch> batches;    //!< batches to destroy
+  };
+
+  void Work (void);
+  void Drain (uint32_t thread);
+
+  uint32_t m_threads;                //!< number of threads
+  uint64_t m_packets;                //!< packets created over all the threads
+  uint32_t m_size;                   //!< size of the packets
+  bool m_handoff;                    //!< whether packets are destroyed by another thread
+  std::atomic<uint32_t> m_next;      //!< index of the next thread to start
+  std::vector<Inbox> m_inboxes;      //!< batches received by each thread
+};
+
+void
+ArenaBench::Drain (uint32_t thread)
+{
+  std::vector<Batch> batches;
+  {
+    std::lock_guard<std::mutex> lock (m_inboxes[thread].mutex);
+    batches.swap (m_inboxes[thread].batches);
+  }
+  // the packets of the other thread are destroyed here
+}
+
+void
+ArenaBench::Work (void)
+{
+  uint32_t thread = m_next++;
+  uint64_t packets = m_packets / m_threads;
+  const uint32_t batchSize = 256;
+  Batch batch;
+  batch.reserve (batchSize);
+  for (uint64_t i = 0; i < packets; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (m_size);
+      Ptr<Packet> copy = p->Copy ();
+      Ptr<Packet> head = copy->CreateFragment (0, m_size / 2);
+      Ptr<Packet> tail = copy->CreateFragment (m_size / 2, m_size - m_size / 2);
+      head->AddAtEnd (tail);
+      if (!m_handoff)
+        {
+          continue;
+        }
+      batch.push_back (p);
+      batch.push_back (head);
+      if (batch.size () >= batchSize)
+        {
+          uint32_t next = (thread + 1) % m_threads;
+          {
+            std::lock_guard<std::mutex> lock (m_inboxes[next].mutex);
+            m_inboxes[next].batches.push_back (Batch ());
+            m_inboxes[next].batches.back ().swap (batch);
+          }
+          batch.reserve (batchSize);
+          Drain (thread);
+        }
+    }
+}
+
+void
+ArenaBench::Run (void)
+{
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      threads.push_back (Create<SystemThread> (MakeCallback (&ArenaBench::Work, this)));
+    }
+
+  PacketArena::ResetStatistics ();
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      threads[i]->Start ();
+    }
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      threads[i]->Join ();
+    }
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      Drain (i);
+    }
+  int64_t ms = clock.End ();
+
+  PacketArena::Statistics stats = PacketArena::GetStatistics ();
+  uint64_t total = m_packets / m_threads * m_threads;
+  uint64_t allocations = stats.hits + stats.misses;
+  std::cout << std::left
+            << std::setw (10) << m_threads
+            << std::setw (12) << total
+            << std::setw (10) << ms
+            << std::setw (14) << (ms > 0 ? total * 1000 / ms : 0)
+            << std::setw (10) << (allocations > 0 ? 100.0 * stats.hits / allocations : 0)
+            << std::setw (14) << stats.remoteFrees
+            << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t threads = 4;
+  uint64_t packets = 100000000;
+  uint32_t size = 1500;
+  bool handoff = false;
+  bool metadata = false;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the packet memory arenas.\n"
+             "Each thread creates, copies and fragments its share of the packets.");
+  cmd.AddValue ("threads",  "number of threads",                              threads);
+  cmd.AddValue ("packets",  "number of packets created over all the threads", packets);
+  cmd.AddValue ("size",     "size of the packets",                            size);
+  cmd.AddValue ("handoff",  "destroy the packets in the next thread",         handoff);
+  cmd.AddValue ("metadata", "enable the packet metadata",                     metadata);
+  cmd.Parse (argc, argv);
+
+#ifndef NS3_MTP
+  if (threads > 1)
+    {
+      // the packet uids and reference counts are not atomic
+      std::cerr << "Several threads need ns-3 configured with --enable-mtp" << std::endl;
+      return 1;
+    }
+#endif
+
+  if (metadata)
+    {
+      PacketMetadata::Enable ();
+    }
+
+  std::cout << std::left
+            << std::setw (10) << "threads"
+            << std::setw (12) << "packets"
+            << std::setw (10) << "ms"
+            << std::setw (14) << "packets/s"
+            << std::setw (10) << "hits %"
+            << std::setw (14) << "remote frees"
+            << std::endl;
+
+  ArenaBench bench (threads, packets, size, handoff);
+  bench.Run ();
+  return 0;
+}
@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/packet.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h> // for exit ()
+#include <limits>
+#include <algorithm>
+
+using namespace ns3;
+
+/*
+ * Benchmark of the packet tags, as used by the stacks which attach a
+ * few tags to each packet (QosTag, SnrTag, EpsBearerTag, ...), look
+ * them up at each layer and copy the packets along the way.
+ */
+
+template <int N>
+class BenchTag : public Tag
+{
+public:
+  static std::string GetName (void) {
+    std::ostringstream oss;
+    oss << "anon::BenchTag<" << N << ">";
+    return oss.str ();
+  }
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void) {
+    static TypeId tid = TypeId (GetName ().c_str ())
+      .SetParent<Tag> ()
+      .SetGroupName ("Utils")
+      .HideFromDocumentation ()
+      .AddConstructor<BenchTag<N> > ()
+      ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const {
+    return GetTypeId ();
+  }
+  virtual uint32_t GetSerializedSize (void) const {
+    return N;
+  }
+  virtual void Serialize (TagBuffer buf) const {
+    for (uint32_t i = 0; i < N; ++i)
+      {
+        buf.WriteU8 (N);
+      }
+  }
+  virtual void Deserialize (TagBuffer buf) {
+    for (uint32_t i = 0; i < N; ++i)
+      {
+        buf.ReadU8 ();
+      }
+  }
+  virtual void Print (std::ostream &os) const {
+    os << "N=" << N;
+  }
+  BenchTag ()
+    : Tag () {}
+};
+
+/// The tags attached to the packets, and a tag which is never attached
+static std::vector<Tag *> g_tags;
+static BenchTag<3> g_missing;
+
+static void
+AddTags (Ptr<Packet> p)
+{
+  for (uint32_t j = 0; j < g_tags.size (); j++)
+    {
+      p->AddPacketTag (*g_tags[j]);
+    }
+}
+
+static void
+PeekTags (Ptr<const Packet> p)
+{
+  for (uint32_t j = 0; j < g_tags.size (); j++)
+    {
+      p->PeekPacketTag (*g_tags[j]);
+    }
+  p->PeekPacketTag (g_missing);
+}
+
+static void
+benchAddRemove (uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (100);
+      AddTags (p);
+      PeekTags (p);
+      for (uint32_t j = 0; j < g_tags.size (); j++)
+        {
+          p->RemovePacketTag (*g_tags[j]);
+        }
+    }
+}
+
+static void
+benchCopyPeek (uint32_t n)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  AddTags (p);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      // a few hops, each copying the packet and looking its tags up
+      Ptr<Packet> q = p;
+      for (uint32_t hop = 0; hop < 4; hop++)
+        {
+          q = q->Copy ();
+          PeekTags (q);
+        }
+    }
+}
+
+static void
+benchReplace (uint32_t n)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  AddTags (p);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> q = p->Copy ();
+      for (uint32_t j = 0; j < g_tags.size (); j++)
+        {
+          q->ReplacePacketTag (*g_tags[j]);
+        }
+    }
+}
+
+static uint64_t
+runBenchOneIteration (void (*bench) (uint32_t), uint32_t n)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  (*bench) (n);
+  uint64_t deltaMs = time.End ();
+  return deltaMs;
+}
+
+static void
+runBench (void (*bench) (uint32_t), uint32_t n, uint32_t minIterations, char const *name)
+{
+  uint64_t minDelay = std::numeric_limits<uint64_t>::max ();
+  for (uint32_t i = 0; i < minIterations; i++)
+    {
+      uint64_t delay = runBenchOneIteration (bench, n);
+      minDelay = std::min (minDelay, delay);
+    }
+  double ps = n;
+  ps *= 1000;
+  ps /= std::max<uint64_t> (minDelay, 1);
+  std::cout << ps << " packets/s"
+            << " (" << minDelay << " ms elapsed)\t"
+            << name
+            << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  uint32_t minIterations = 1;
+  uint32_t tags = 4;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the packet tags");
+  cmd.AddValue ("n", "number of iterations", n);
+  cmd.AddValue ("min-iterations", "number of subiterations to minimize iteration time over", minIterations);
+  cmd.AddValue ("tags", "number of tags per packet (at most 8)", tags);
+  cmd.Parse (argc, argv);
+
+  if (tags > 8)
+    {
+      std::cerr << "Error-- at most 8 tags per packet" << std::endl;
+      exit (1);
+    }
+  // tags of the sizes of the common tags
+  BenchTag<1> t1;
+  BenchTag<4> t4;
+  BenchTag<8> t8;
+  BenchTag<2> t2;
+  BenchTag<16> t16;
+  BenchTag<5> t5;
+  BenchTag<12> t12;
+  BenchTag<19> t19;
+  Tag *all[] = { &t1, &t4, &t8, &t2, &t16, &t5, &t12, &t19 };
+  g_tags.assign (all, all + tags);
+
+  std::cout << "Running bench-packet-tags with n=" << n
+            << " and " << tags << " tags per packet" << std::endl;
+
+  runBench (&benchAddRemove, n, minIterations, "Add, peek and remove tags");
+  runBench (&benchCopyPeek, n, minIterations, "Copy and peek tags over 4 hops");
+  runBench (&benchReplace, n, minIterations, "Copy and replace tags");
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+/*
+ * Benchmark of the events scheduled by other threads, as the reader
+ * threads of FdNetDevice do. Each thread schedules its share of the
+ * events with Simulator::ScheduleWithContext while the main thread runs
+ * the simulation, which stops when all the events have run.
+ */
+
+class ContentionBench
+{
+public:
+  ContentionBench (uint32_t threads, uint32_t events, bool realtime)
+    : m_threads (threads),
+      m_events (events),
+      m_realtime (realtime),
+      m_count (0),
+      m_scheduleMs (0)
+  {
+  }
+
+  void Run (void);
+
+private:
+  void Produce (void);
+  void Count (void);
+  void KeepAlive (void);
+
+  uint32_t m_threads;               //!< number of scheduling threads
+  uint32_t m_events;                //!< events scheduled by each thread
+  bool m_realtime;                  //!< whether the realtime simulator is used
+  uint64_t m_count;                 //!< events run
+  std::atomic<int64_t> m_scheduleMs; //!< time spent scheduling, over all the threads
+};
+
+void
+ContentionBench::Produce (void)
+{
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < m_events; i++)
+    {
+      Simulator::ScheduleWithContext (i % 64, Seconds (0), &ContentionBench::Count, this);
+    }
+  m_scheduleMs += clock.End ();
+}
+
+void
+ContentionBench::Count (void)
+{
+  if (++m_count == uint64_t (m_threads) * m_events)
+    {
+      Simulator::Stop ();
+    }
+}
+
+void
+ContentionBench::KeepAlive (void)
+{
+  //The default simulator returns from Run as soon as its event list is empty
+  Simulator::Schedule (MicroSeconds (1), &ContentionBench::KeepAlive, this);
+}
+
+void
+ContentionBench::Run (void)
+{
+  if (m_realtime)
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
+    }
+  else
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+      Simulator::Schedule (MicroSeconds (1), &ContentionBench::KeepAlive, this);
+    }
+
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      threads.push_back (Create<SystemThread> (MakeCallback (&ContentionBench::Produce, this)));
+    }
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      threads[i]->Start ();
+    }
+  Simulator::Run ();
+  int64_t ms = clock.End ();
+  for (uint32_t i = 0; i < m_threads; i++)
+    {
+      threads[i]->Join ();
+    }
+  Simulator::Destroy ();
+
+  uint64_t total = uint64_t (m_threads) * m_events;
+  std::cout << std::left
+            << std::setw (10) << m_threads
+            << std::setw (12) << total
+            << std::setw (10) << ms
+            << std::setw (14) << (ms > 0 ? total * 1000 / ms : 0)
+            << std::setw (10) << (total > 0 ? m_scheduleMs.load () * 1e6 / total : 0)
+            << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t threads = 4;
+  uint32_t events = 1000000;
+  bool realtime = false;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the scheduling of events by other threads than the main one.\n"
+             "Each thread schedules its events as fast as it can, the main thread runs them.");
+  cmd.AddValue ("threads",  "number of scheduling threads",                threads);
+  cmd.AddValue ("events",   "number of events scheduled by each thread",   events);
+  cmd.AddValue ("realtime", "use the RealtimeSimulatorImpl",               realtime);
+  cmd.Parse (argc, argv);
+
+  std::cout << std::left
+            << std::setw (10) << "threads"
+            << std::setw (12) << "events"
+            << std::setw (10) << "ms"
+            << std::setw (14) << "events/s"
+            << std::setw (10) << "ns/schedule"
+            << std::endl;
+
+  ContentionBench bench (threads, events, realtime);
+  bench.Run ();
+  return 0;
+}
@@ -183,7 +183,9 @@ int main (int argc, char *argv[])
 {
 
   bool schedCal  = false;
+  bool schedDary = false;
   bool schedHeap = false;
+  bool schedLadd = false;
   bool schedList = false;
   bool schedMap  = true;
 
@@ -202,7 +204,9 @@ int main (int argc, char *argv[])
              "In the case of either --file form, the input is expected\n"
              "to be ascii, giving the relative event times in ns.");
   cmd.AddValue ("cal",   "use CalendarSheduler",          schedCal);
+  cmd.AddValue ("dary",  "use DaryHeapScheduler",         schedDary);
   cmd.AddValue ("heap",  "use HeapScheduler",             schedHeap);
+  cmd.AddValue ("ladder", "use LadderScheduler",          schedLadd);
   cmd.AddValue ("list",  "use ListSheduler",              schedList);
   cmd.AddValue ("map",   "use MapScheduler (default)",    schedMap);
   cmd.AddValue ("debug", "enable debugging output",       g_debug);
@@ -217,7 +221,9 @@ int main (int argc, char *argv[])
 
   ObjectFactory factory ("ns3::MapScheduler");
   if (schedCal)  { factory.SetTypeId ("ns3::CalendarScheduler"); }
+  if (schedDary) { factory.SetTypeId ("ns3::DaryHeapScheduler"); }
   if (schedHeap) { factory.SetTypeId ("ns3::HeapScheduler");     }
+  if (schedLadd) { factory.SetTypeId ("ns3::LadderScheduler");   }
   if (schedList) { factory.SetTypeId ("ns3::ListScheduler");     }  
   Simulator::SetScheduler (factory);
 